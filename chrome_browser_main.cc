@@ -200,6 +200,9 @@ using content::BrowserThread;
 
 namespace {
 
+// Merges the tasks written to the --profiling-output-file by location.
+const char kProfilingOutputAggregated[] = "profiling-output-aggregated";
+
 // This function provides some ways to test crash and assertion handling
 // behavior of the program.
 void HandleTestParameters(const CommandLine& command_line) {
@@ -835,6 +838,8 @@ int ChromeBrowserMainParts::PreCreateThreadsImpl() {
     tracking_objects_.set_output_file_path(
         parsed_command_line().GetSwitchValuePath(
             switches::kProfilingOutputFile));
+    tracking_objects_.set_aggregate_by_location(
+        parsed_command_line().HasSwitch(kProfilingOutputAggregated));
   }
 
   local_state_ = InitializeLocalState(
@@ -10,6 +10,7 @@
 #include "base/callback_helpers.h"
 #include "base/metrics/histogram.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/task_runner_util.h"
 #include "base/time/time.h"
 #include "chrome/browser/chromeos/drive/change_list_loader_observer.h"
 #include "chrome/browser/chromeos/drive/change_list_processor.h"
@@ -37,35 +38,45 @@ class ChangeListLoader::FeedFetcher {
 
 namespace {
 
-// Fetches all the (currently available) resource entries from the server.
-class FullFeedFetcher : public ChangeListLoader::FeedFetcher {
+// Converts |resource_list| to ChangeList. Runs on the blocking pool.
+scoped_ptr<ChangeList> ConvertToChangeList(
+    scoped_ptr<google_apis::ResourceList> resource_list) {
+  return make_scoped_ptr(new ChangeList(*resource_list));
+}
+
+// Base class of the fetchers which fetch a feed page by page. Each fetched
+// page is converted to ChangeList on the blocking pool while the next page is
+// being fetched, so that only the last page is left to be converted when the
+// fetch completes.
+class PagedFeedFetcher : public ChangeListLoader::FeedFetcher {
  public:
-  explicit FullFeedFetcher(JobScheduler* scheduler)
-      : scheduler_(scheduler),
+  explicit PagedFeedFetcher(base::SequencedTaskRunner* blocking_task_runner)
+      : blocking_task_runner_(blocking_task_runner),
+        num_pending_conversions_(0),
+        all_pages_fetched_(false),
         weak_ptr_factory_(this) {
   }
 
-  virtual ~FullFeedFetcher() {
+  virtual ~PagedFeedFetcher() {
   }
 
-  virtual void Run(const FeedFetcherCallback& callback) OVERRIDE {
-    DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
-    DCHECK(!callback.is_null());
-
-    // Remember the time stamp for usage stats.
-    start_time_ = base::TimeTicks::Now();
-
-    // This is full resource list fetch.
-    scheduler_->GetAllResourceList(
-        base::Bind(&FullFeedFetcher::OnFileListFetched,
-                   weak_ptr_factory_.GetWeakPtr(), callback));
+ protected:
+  // Returns a callback to be passed to JobScheduler to fetch a page.
+  google_apis::GetResourceListCallback GetPageFetchedCallback(
+      const FeedFetcherCallback& callback) {
+    return base::Bind(&PagedFeedFetcher::OnPageFetched,
+                      weak_ptr_factory_.GetWeakPtr(), callback);
   }
 
+  // Fetches the remaining result at |next_url|. The callback returned by
+  // GetPageFetchedCallback() should be used to receive the result.
+  virtual void FetchNextPage(const FeedFetcherCallback& callback,
+                             const GURL& next_url) = 0;
+
  private:
-  void OnFileListFetched(
-      const FeedFetcherCallback& callback,
-      google_apis::GDataErrorCode status,
-      scoped_ptr<google_apis::ResourceList> resource_list) {
+  void OnPageFetched(const FeedFetcherCallback& callback,
+                     google_apis::GDataErrorCode status,
+                     scoped_ptr<google_apis::ResourceList> resource_list) {
     DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
     DCHECK(!callback.is_null());
 
@@ -76,20 +87,37 @@ class FullFeedFetcher : public ChangeListLoader::FeedFetcher {
     }
 
     DCHECK(resource_list);
-    change_lists_.push_back(new ChangeList(*resource_list));
-
     GURL next_url;
-    if (resource_list->GetNextFeedURL(&next_url) && !next_url.is_empty()) {
+    const bool has_next_page =
+        resource_list->GetNextFeedURL(&next_url) && !next_url.is_empty();
+
+    // Replies are delivered in the order of the posted tasks, as the tasks
+    // run in sequence.
+    ++num_pending_conversions_;
+    base::PostTaskAndReplyWithResult(
+        blocking_task_runner_.get(),
+        FROM_HERE,
+        base::Bind(&ConvertToChangeList, base::Passed(&resource_list)),
+        base::Bind(&PagedFeedFetcher::OnPageConverted,
+                   weak_ptr_factory_.GetWeakPtr(), callback));
+
+    if (has_next_page) {
       // There is the remaining result so fetch it.
-      scheduler_->GetRemainingFileList(
-          next_url,
-          base::Bind(&FullFeedFetcher::OnFileListFetched,
-                     weak_ptr_factory_.GetWeakPtr(), callback));
+      FetchNextPage(callback, next_url);
       return;
     }
+    all_pages_fetched_ = true;
+  }
 
-    UMA_HISTOGRAM_LONG_TIMES("Drive.FullFeedLoadTime",
-                             base::TimeTicks::Now() - start_time_);
+  void OnPageConverted(const FeedFetcherCallback& callback,
+                       scoped_ptr<ChangeList> change_list) {
+    DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+    DCHECK(!callback.is_null());
+    DCHECK_LT(0, num_pending_conversions_);
+
+    change_lists_.push_back(change_list.release());
+    if (--num_pending_conversions_ > 0 || !all_pages_fetched_)
+      return;
 
     // Note: The fetcher is managed by ChangeListLoader, and the instance
     // will be deleted in the callback. Do not touch the fields after this
@@ -97,72 +125,105 @@ class FullFeedFetcher : public ChangeListLoader::FeedFetcher {
     callback.Run(FILE_ERROR_OK, change_lists_.Pass());
   }
 
-  JobScheduler* scheduler_;
+  scoped_refptr<base::SequencedTaskRunner> blocking_task_runner_;
   ScopedVector<ChangeList> change_lists_;
-  base::TimeTicks start_time_;
-  base::WeakPtrFactory<FullFeedFetcher> weak_ptr_factory_;
-  DISALLOW_COPY_AND_ASSIGN(FullFeedFetcher);
+  int num_pending_conversions_;
+  bool all_pages_fetched_;
+  base::WeakPtrFactory<PagedFeedFetcher> weak_ptr_factory_;
+  DISALLOW_COPY_AND_ASSIGN(PagedFeedFetcher);
 };
 
-// Fetches the delta changes since |start_change_id|.
-class DeltaFeedFetcher : public ChangeListLoader::FeedFetcher {
+// Fetches all the (currently available) resource entries from the server.
+class FullFeedFetcher : public PagedFeedFetcher {
  public:
-  DeltaFeedFetcher(JobScheduler* scheduler, int64 start_change_id)
-      : scheduler_(scheduler),
-        start_change_id_(start_change_id),
+  FullFeedFetcher(JobScheduler* scheduler,
+                  base::SequencedTaskRunner* blocking_task_runner)
+      : PagedFeedFetcher(blocking_task_runner),
+        scheduler_(scheduler),
         weak_ptr_factory_(this) {
   }
 
-  virtual ~DeltaFeedFetcher() {
+  virtual ~FullFeedFetcher() {
   }
 
   virtual void Run(const FeedFetcherCallback& callback) OVERRIDE {
     DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
     DCHECK(!callback.is_null());
 
-    scheduler_->GetChangeList(
-        start_change_id_,
-        base::Bind(&DeltaFeedFetcher::OnChangeListFetched,
-                   weak_ptr_factory_.GetWeakPtr(), callback));
+    // Remember the time stamp for usage stats.
+    start_time_ = base::TimeTicks::Now();
+
+    // This is full resource list fetch.
+    scheduler_->GetAllResourceList(GetPageFetchedCallback(
+        base::Bind(&FullFeedFetcher::OnFileListFetched,
+                   weak_ptr_factory_.GetWeakPtr(), callback)));
+  }
+
+ protected:
+  // PagedFeedFetcher overrides.
+  virtual void FetchNextPage(const FeedFetcherCallback& callback,
+                             const GURL& next_url) OVERRIDE {
+    scheduler_->GetRemainingFileList(next_url,
+                                     GetPageFetchedCallback(callback));
   }
 
  private:
-  void OnChangeListFetched(
-      const FeedFetcherCallback& callback,
-      google_apis::GDataErrorCode status,
-      scoped_ptr<google_apis::ResourceList> resource_list) {
+  void OnFileListFetched(const FeedFetcherCallback& callback,
+                         FileError error,
+                         ScopedVector<ChangeList> change_lists) {
     DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
     DCHECK(!callback.is_null());
 
-    FileError error = GDataToFileError(status);
-    if (error != FILE_ERROR_OK) {
-      callback.Run(error, ScopedVector<ChangeList>());
-      return;
-    }
-
-    DCHECK(resource_list);
-    change_lists_.push_back(new ChangeList(*resource_list));
-
-    GURL next_url;
-    if (resource_list->GetNextFeedURL(&next_url) && !next_url.is_empty()) {
-      // There is the remaining result so fetch it.
-      scheduler_->GetRemainingChangeList(
-          next_url,
-          base::Bind(&DeltaFeedFetcher::OnChangeListFetched,
-                     weak_ptr_factory_.GetWeakPtr(), callback));
-      return;
+    if (error == FILE_ERROR_OK) {
+      UMA_HISTOGRAM_LONG_TIMES("Drive.FullFeedLoadTime",
+                               base::TimeTicks::Now() - start_time_);
     }
 
     // Note: The fetcher is managed by ChangeListLoader, and the instance
     // will be deleted in the callback. Do not touch the fields after this
     // invocation.
-    callback.Run(FILE_ERROR_OK, change_lists_.Pass());
+    callback.Run(error, change_lists.Pass());
+  }
+
+  JobScheduler* scheduler_;
+  base::TimeTicks start_time_;
+  base::WeakPtrFactory<FullFeedFetcher> weak_ptr_factory_;
+  DISALLOW_COPY_AND_ASSIGN(FullFeedFetcher);
+};
+
+// Fetches the delta changes since |start_change_id|.
+class DeltaFeedFetcher : public PagedFeedFetcher {
+ public:
+  DeltaFeedFetcher(JobScheduler* scheduler,
+                   base::SequencedTaskRunner* blocking_task_runner,
+                   int64 start_change_id)
+      : PagedFeedFetcher(blocking_task_runner),
+        scheduler_(scheduler),
+        start_change_id_(start_change_id) {
+  }
+
+  virtual ~DeltaFeedFetcher() {
   }
 
+  virtual void Run(const FeedFetcherCallback& callback) OVERRIDE {
+    DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+    DCHECK(!callback.is_null());
+
+    scheduler_->GetChangeList(start_change_id_,
+                              GetPageFetchedCallback(callback));
+  }
+
+ protected:
+  // PagedFeedFetcher overrides.
+  virtual void FetchNextPage(const FeedFetcherCallback& callback,
+                             const GURL& next_url) OVERRIDE {
+    scheduler_->GetRemainingChangeList(next_url,
+                                       GetPageFetchedCallback(callback));
+  }
+
+ private:
   JobScheduler* scheduler_;
   int64 start_change_id_;
-  ScopedVector<ChangeList> change_lists_;
-  base::WeakPtrFactory<DeltaFeedFetcher> weak_ptr_factory_;
   DISALLOW_COPY_AND_ASSIGN(DeltaFeedFetcher);
 };
 
@@ -446,10 +507,11 @@ void ChangeListLoader::LoadChangeListFromServer(int64 start_changestamp) {
 
   // Set up feed fetcher.
   if (is_delta_update) {
-    change_feed_fetcher_.reset(
-        new DeltaFeedFetcher(scheduler_, start_changestamp));
+    change_feed_fetcher_.reset(new DeltaFeedFetcher(
+        scheduler_, blocking_task_runner_.get(), start_changestamp));
   } else {
-    change_feed_fetcher_.reset(new FullFeedFetcher(scheduler_));
+    change_feed_fetcher_.reset(
+        new FullFeedFetcher(scheduler_, blocking_task_runner_.get()));
   }
 
   // Make a copy of cached_about_resource_ to remember at which changestamp we
@@ -9,6 +9,7 @@
 #include "base/memory/scoped_ptr.h"
 #include "base/prefs/testing_pref_service.h"
 #include "base/run_loop.h"
+#include "base/test/test_simple_task_runner.h"
 #include "chrome/browser/chromeos/drive/change_list_loader_observer.h"
 #include "chrome/browser/chromeos/drive/file_cache.h"
 #include "chrome/browser/chromeos/drive/file_system_util.h"
@@ -174,6 +175,59 @@ TEST_F(ChangeListLoaderTest, Load) {
             metadata_->GetResourceEntryByPath(file_path, &entry));
 }
 
+// The pages of a feed should be converted on the blocking task runner while
+// the next pages are fetched, and applied once all of them are converted.
+TEST_F(ChangeListLoaderTest, Load_MultiplePages) {
+  drive_service_->set_default_max_results(2);
+  scoped_refptr<base::TestSimpleTaskRunner> blocking_task_runner(
+      new base::TestSimpleTaskRunner);
+  change_list_loader_.reset(
+      new ChangeListLoader(logger_.get(),
+                           blocking_task_runner.get(),
+                           metadata_.get(),
+                           scheduler_.get(),
+                           about_resource_loader_.get(),
+                           loader_controller_.get()));
+
+  FileError error = FILE_ERROR_FAILED;
+  change_list_loader_->LoadIfNeeded(
+      google_apis::test_util::CreateCopyResultCallback(&error));
+
+  // Run the blocking tasks until the feed starts to be fetched.
+  base::RunLoop().RunUntilIdle();
+  while (drive_service_->resource_list_load_count() == 0) {
+    ASSERT_TRUE(blocking_task_runner->HasPendingTask());
+    blocking_task_runner->RunPendingTasks();
+    base::RunLoop().RunUntilIdle();
+  }
+
+  // Without running any conversion, every page has been fetched and waits to
+  // be converted.
+  EXPECT_LT(1u, blocking_task_runner->GetPendingTasks().size());
+  EXPECT_EQ(FILE_ERROR_FAILED, error);
+  EXPECT_TRUE(change_list_loader_->IsRefreshing());
+
+  while (blocking_task_runner->HasPendingTask()) {
+    blocking_task_runner->RunPendingTasks();
+    base::RunLoop().RunUntilIdle();
+  }
+  EXPECT_EQ(FILE_ERROR_OK, error);
+  EXPECT_FALSE(change_list_loader_->IsRefreshing());
+  EXPECT_EQ(1, drive_service_->resource_list_load_count());
+
+  // The entries of the first and the last pages are all there.
+  ResourceEntry entry;
+  EXPECT_EQ(FILE_ERROR_OK, metadata_->GetResourceEntryByPath(
+      util::GetDriveMyDriveRootPath().AppendASCII("File 1.txt"), &entry));
+  EXPECT_EQ(FILE_ERROR_OK, metadata_->GetResourceEntryByPath(
+      util::GetDriveMyDriveRootPath().AppendASCII("Directory 1")
+          .AppendASCII("Sub Directory Folder")
+          .AppendASCII("Sub Sub Directory Folder"), &entry));
+  EXPECT_EQ(FILE_ERROR_OK, metadata_->GetResourceEntryByPath(
+      util::GetDriveGrandRootPath().AppendASCII("other")
+          .AppendASCII("Orphan File 1.txt"), &entry));
+}
+
 TEST_F(ChangeListLoaderTest, Load_LocalMetadataAvailable) {
   // Prepare metadata.
   FileError error = FILE_ERROR_FAILED;
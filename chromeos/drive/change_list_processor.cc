@@ -166,7 +166,8 @@ FileError ChangeListProcessor::Apply(
     }
   }
 
-  FileError error = ApplyEntryMap(largest_changestamp, about_resource.Pass());
+  FileError error = ApplyEntryMap(largest_changestamp, about_resource.Pass(),
+                                 is_delta_update);
   if (error != FILE_ERROR_OK) {
     DLOG(ERROR) << "ApplyEntryMap failed: " << FileErrorToString(error);
     return error;
@@ -188,7 +189,8 @@ FileError ChangeListProcessor::Apply(
 
 FileError ChangeListProcessor::ApplyEntryMap(
     int64 changestamp,
-    scoped_ptr<google_apis::AboutResource> about_resource) {
+    scoped_ptr<google_apis::AboutResource> about_resource,
+    bool is_delta_update) {
   DCHECK(about_resource);
 
   // Create the entry for "My Drive" directory with the latest changestamp.
@@ -214,11 +216,20 @@ FileError ChangeListProcessor::ApplyEntryMap(
   // The old paths must be calculated before we apply any actual changes.
   // The new paths are calculated after each change is applied. It correctly
   // sets the new path because we apply changes in such an order (see below).
-  for (ResourceEntryMap::iterator it = entry_map_.begin();
-       it != entry_map_.end(); ++it) {
-    UpdateChangedDirs(it->second);
+  // Changed directories are not notified for full updates, no need to collect
+  // them.
+  if (is_delta_update) {
+    for (ResourceEntryMap::iterator it = entry_map_.begin();
+         it != entry_map_.end(); ++it) {
+      UpdateChangedDirs(it->second);
+    }
   }
 
+  // The memoized old paths are stale once any change is applied. As ancestors
+  // are applied before their descendants and never move again during this
+  // apply, paths memoized from now on stay valid until the end.
+  file_path_map_.clear();
+
   // Apply all entries except deleted ones to the metadata.
   std::vector<std::string> deleted_resource_ids;
   while (!entry_map_.empty()) {
@@ -259,8 +270,8 @@ FileError ChangeListProcessor::ApplyEntryMap(
         // Current entry's parent is already updated or not going to be updated,
         // get the parent from the local tree.
         std::string parent_local_id;
-        FileError error = resource_metadata_->GetIdByResourceId(
-            parent_resource_id, &parent_local_id);
+        FileError error = GetIdByResourceId(parent_resource_id,
+                                            &parent_local_id);
         if (error != FILE_ERROR_OK) {
           // See crbug.com/326043. In some complicated situations, parent folder
           // for shared entries may be accessible (and hence its resource id is
@@ -302,6 +313,8 @@ FileError ChangeListProcessor::ApplyEntryMap(
         DLOG_IF(WARNING, error != FILE_ERROR_OK)
             << "ApplyEntry failed: " << FileErrorToString(error)
             << ", title = " << it->second.title();
+        if (error == FILE_ERROR_OK && is_delta_update)
+          UpdateChangedDirs(it->second);
       }
       entry_map_.erase(it);
     }
@@ -310,8 +323,7 @@ FileError ChangeListProcessor::ApplyEntryMap(
   // Apply deleted entries.
   for (size_t i = 0; i < deleted_resource_ids.size(); ++i) {
     std::string local_id;
-    FileError error = resource_metadata_->GetIdByResourceId(
-        deleted_resource_ids[i], &local_id);
+    FileError error = GetIdByResourceId(deleted_resource_ids[i], &local_id);
     if (error == FILE_ERROR_OK)
       error = resource_metadata_->RemoveEntry(local_id);
 
@@ -333,14 +345,20 @@ FileError ChangeListProcessor::ApplyEntry(const ResourceEntry& entry) {
       modification_date_map_[entry.resource_id()];
 
   ResourceEntry new_entry(entry);
-  FileError error = SetParentLocalIdOfEntry(resource_metadata_, &new_entry,
-                                            parent_resource_id);
-  if (error != FILE_ERROR_OK)
-    return error;
+  std::string parent_local_id;
+  if (parent_resource_id.empty()) {
+    // Entries without parents should go under "other" directory.
+    parent_local_id = util::kDriveOtherDirLocalId;
+  } else {
+    FileError error = GetIdByResourceId(parent_resource_id, &parent_local_id);
+    if (error != FILE_ERROR_OK)
+      return error;
+  }
+  new_entry.set_parent_local_id(parent_local_id);
 
   // Lookup the entry.
   std::string local_id;
-  error = resource_metadata_->GetIdByResourceId(entry.resource_id(), &local_id);
+  FileError error = GetIdByResourceId(entry.resource_id(), &local_id);
 
   ResourceEntry existing_entry;
   if (error == FILE_ERROR_OK)
@@ -367,16 +385,14 @@ FileError ChangeListProcessor::ApplyEntry(const ResourceEntry& entry) {
     case FILE_ERROR_NOT_FOUND: {  // Adding a new entry.
       std::string local_id;
       error = resource_metadata_->AddEntry(new_entry, &local_id);
+      if (error == FILE_ERROR_OK)
+        local_id_map_[entry.resource_id()] = local_id;
       break;
     }
     default:
       return error;
   }
-  if (error != FILE_ERROR_OK)
-    return error;
-
-  UpdateChangedDirs(entry);
-  return FILE_ERROR_OK;
+  return error;
 }
 
 // static
@@ -462,9 +478,8 @@ void ChangeListProcessor::UpdateChangedDirs(const ResourceEntry& entry) {
 
   std::string local_id;
   base::FilePath file_path;
-  if (resource_metadata_->GetIdByResourceId(
-          entry.resource_id(), &local_id) == FILE_ERROR_OK)
-    file_path = resource_metadata_->GetFilePath(local_id);
+  if (GetIdByResourceId(entry.resource_id(), &local_id) == FILE_ERROR_OK)
+    file_path = GetFilePath(local_id);
 
   if (!file_path.empty()) {
     // Notify parent.
@@ -485,5 +500,38 @@ void ChangeListProcessor::UpdateChangedDirs(const ResourceEntry& entry) {
   }
 }
 
+FileError ChangeListProcessor::GetIdByResourceId(
+    const std::string& resource_id,
+    std::string* out_local_id) {
+  LocalIdMap::const_iterator it = local_id_map_.find(resource_id);
+  if (it != local_id_map_.end()) {
+    *out_local_id = it->second;
+    return FILE_ERROR_OK;
+  }
+
+  FileError error = resource_metadata_->GetIdByResourceId(resource_id,
+                                                          out_local_id);
+  if (error == FILE_ERROR_OK)
+    local_id_map_[resource_id] = *out_local_id;
+  return error;
+}
+
+base::FilePath ChangeListProcessor::GetFilePath(const std::string& local_id) {
+  FilePathMap::const_iterator it = file_path_map_.find(local_id);
+  if (it != file_path_map_.end())
+    return it->second;
+
+  base::FilePath path;
+  ResourceEntry entry;
+  if (resource_metadata_->GetResourceEntryById(local_id, &entry) ==
+      FILE_ERROR_OK) {
+    if (!entry.parent_local_id().empty())
+      path = GetFilePath(entry.parent_local_id());
+    path = path.Append(base::FilePath::FromUTF8Unsafe(entry.base_name()));
+  }
+  file_path_map_[local_id] = path;
+  return path;
+}
+
 }  // namespace internal
 }  // namespace drive
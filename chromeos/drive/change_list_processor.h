@@ -120,6 +120,7 @@ class ChangeListProcessor {
                   bool is_delta_update);
 
   // The set of changed directories as a result of change list processing.
+  // Only collected for delta updates.
   const std::set<base::FilePath>& changed_dirs() const { return changed_dirs_; }
 
   // Adds or refreshes the child entries from |change_list| to the directory.
@@ -142,12 +143,17 @@ class ChangeListProcessor {
                    std::string /* parent_resource_id*/> ParentResourceIdMap;
   typedef std::map<std::string /* resource_id */,
                    base::Time /* modification_date */> ModificationDateMap;
+  typedef std::map<std::string /* resource_id */,
+                   std::string /* local_id */> LocalIdMap;
+  typedef std::map<std::string /* local_id */,
+                   base::FilePath /* path */> FilePathMap;
 
   // Applies the pre-processed metadata from entry_map_ onto the resource
   // metadata. |about_resource| must not be null.
   FileError ApplyEntryMap(
       int64 changestamp,
-      scoped_ptr<google_apis::AboutResource> about_resource);
+      scoped_ptr<google_apis::AboutResource> about_resource,
+      bool is_delta_update);
 
   // Apply |entry| to resource_metadata_.
   FileError ApplyEntry(const ResourceEntry& entry);
@@ -155,11 +161,23 @@ class ChangeListProcessor {
   // Adds the directories changed by the update on |entry| to |changed_dirs_|.
   void UpdateChangedDirs(const ResourceEntry& entry);
 
+  // Same as ResourceMetadata::GetIdByResourceId(), but the result is memoized
+  // in |local_id_map_| for the duration of Apply().
+  FileError GetIdByResourceId(const std::string& resource_id,
+                              std::string* out_local_id);
+
+  // Same as ResourceMetadata::GetFilePath(), but the paths of the entry and
+  // its ancestors are memoized in |file_path_map_|. The caller is responsible
+  // to clear |file_path_map_| when entries may have been moved.
+  base::FilePath GetFilePath(const std::string& local_id);
+
   ResourceMetadata* resource_metadata_;  // Not owned.
 
   ResourceEntryMap entry_map_;
   ParentResourceIdMap parent_resource_id_map_;
   ModificationDateMap modification_date_map_;
+  LocalIdMap local_id_map_;
+  FilePathMap file_path_map_;
   std::set<base::FilePath> changed_dirs_;
 
   DISALLOW_COPY_AND_ASSIGN(ChangeListProcessor);
@@ -57,6 +57,22 @@ void ConvertToMap(ScopedVector<ChangeList> change_lists,
   }
 }
 
+// Appends an entry titled |title| under |parent_resource_id| to |change_list|.
+// It is modified after its creation, so it also updates existing entries.
+void AddEntryToChangeList(const std::string& resource_id,
+                          const std::string& title,
+                          const std::string& parent_resource_id,
+                          FileOrDirectory type,
+                          ChangeList* change_list) {
+  ResourceEntry entry;
+  entry.set_resource_id(resource_id);
+  entry.set_title(title);
+  entry.mutable_file_info()->set_is_directory(type == DIRECTORY);
+  change_list->mutable_entries()->push_back(entry);
+  change_list->mutable_parent_resource_ids()->push_back(parent_resource_id);
+  change_list->mutable_modification_dates()->push_back(base::Time::Now());
+}
+
 class ChangeListProcessorTest : public testing::Test {
  protected:
   virtual void SetUp() OVERRIDE {
@@ -350,6 +366,96 @@ TEST_F(ChangeListProcessorTest, DeltaFileRenamedInDirectory) {
       base::FilePath::FromUTF8Unsafe("drive/root/Directory 1")));
 }
 
+TEST_F(ChangeListProcessorTest, DeltaMovesAndRenamesInOneChangeList) {
+  EXPECT_EQ(FILE_ERROR_OK,
+            ApplyFullResourceList(ParseChangeList(kBaseResourceListFile)));
+
+  // Move and rename "Directory 1" into "Directory 2 excludeDir-test", rename a
+  // file in it, and move one of its subdirectories out to the root.
+  ScopedVector<ChangeList> change_lists;
+  change_lists.push_back(new ChangeList);
+  AddEntryToChangeList("folder:1_folder_resource_id", "Renamed Directory",
+                       "folder:sub_dir_folder_2_self_link", DIRECTORY,
+                       change_lists[0]);
+  AddEntryToChangeList("file:subdirectory_file_1_id", "Renamed File.txt",
+                       "folder:1_folder_resource_id", FILE, change_lists[0]);
+  AddEntryToChangeList("folder:sub_dir_folder_resource_id",
+                       "Sub Directory Folder", kRootId, DIRECTORY,
+                       change_lists[0]);
+  change_lists[0]->set_largest_changestamp(kBaseResourceListChangestamp + 1);
+
+  std::set<base::FilePath> changed_dirs;
+  EXPECT_EQ(FILE_ERROR_OK, ApplyChangeList(change_lists.Pass(), &changed_dirs));
+
+  EXPECT_FALSE(GetResourceEntry("drive/root/Directory 1"));
+  EXPECT_TRUE(GetResourceEntry(
+      "drive/root/Directory 2 excludeDir-test/Renamed Directory"));
+  EXPECT_TRUE(GetResourceEntry(
+      "drive/root/Directory 2 excludeDir-test/Renamed Directory/"
+      "Renamed File.txt"));
+  EXPECT_TRUE(GetResourceEntry(
+      "drive/root/Directory 2 excludeDir-test/Renamed Directory/"
+      "Shared To The Account Owner.txt"));
+  EXPECT_TRUE(GetResourceEntry(
+      "drive/root/Sub Directory Folder/Sub Sub Directory Folder"));
+
+  // Both the old and the new locations are notified.
+  std::set<base::FilePath> expected;
+  expected.insert(base::FilePath::FromUTF8Unsafe("drive/root"));
+  expected.insert(base::FilePath::FromUTF8Unsafe("drive/root/Directory 1"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      "drive/root/Directory 1/Sub Directory Folder"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      "drive/root/Directory 2 excludeDir-test"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      "drive/root/Directory 2 excludeDir-test/Renamed Directory"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      "drive/root/Sub Directory Folder"));
+  EXPECT_EQ(expected, changed_dirs);
+}
+
+// The paths memoized while collecting the old locations must not be used for
+// the new ones: here the new path of the renamed directory goes through the
+// moved "Directory 1", whose old path was memoized on the way.
+TEST_F(ChangeListProcessorTest, DeltaNewPathsAfterAncestorMoved) {
+  EXPECT_EQ(FILE_ERROR_OK,
+            ApplyFullResourceList(ParseChangeList(kBaseResourceListFile)));
+
+  ScopedVector<ChangeList> change_lists;
+  change_lists.push_back(new ChangeList);
+  AddEntryToChangeList("folder:1_folder_resource_id", "Directory 1",
+                       "folder:sub_dir_folder_2_self_link", DIRECTORY,
+                       change_lists[0]);
+  AddEntryToChangeList("folder:sub_sub_directory_folder_id", "Renamed Folder",
+                       "folder:sub_dir_folder_resource_id", DIRECTORY,
+                       change_lists[0]);
+  change_lists[0]->set_largest_changestamp(kBaseResourceListChangestamp + 1);
+
+  std::set<base::FilePath> changed_dirs;
+  EXPECT_EQ(FILE_ERROR_OK, ApplyChangeList(change_lists.Pass(), &changed_dirs));
+
+  const char kNewParent[] =
+      "drive/root/Directory 2 excludeDir-test/Directory 1/"
+      "Sub Directory Folder";
+  EXPECT_TRUE(GetResourceEntry(std::string(kNewParent) + "/Renamed Folder"));
+
+  std::set<base::FilePath> expected;
+  expected.insert(base::FilePath::FromUTF8Unsafe("drive/root"));
+  expected.insert(base::FilePath::FromUTF8Unsafe("drive/root/Directory 1"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      "drive/root/Directory 1/Sub Directory Folder"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      "drive/root/Directory 1/Sub Directory Folder/Sub Sub Directory Folder"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      "drive/root/Directory 2 excludeDir-test"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      "drive/root/Directory 2 excludeDir-test/Directory 1"));
+  expected.insert(base::FilePath::FromUTF8Unsafe(kNewParent));
+  expected.insert(base::FilePath::FromUTF8Unsafe(
+      std::string(kNewParent) + "/Renamed Folder"));
+  EXPECT_EQ(expected, changed_dirs);
+}
+
 TEST_F(ChangeListProcessorTest, DeltaAddAndDeleteFileInRoot) {
   const char kTestJsonAdd[] =
       "gdata/delta_file_added_in_root.json";
@@ -51,14 +51,17 @@ DebugInfoCollector::DebugInfoCollector(
     internal::FileCache* file_cache,
     internal::ResourceMetadata* metadata,
     FileSystemInterface* file_system,
+    JobScheduler* scheduler,
     base::SequencedTaskRunner* blocking_task_runner)
     : file_cache_(file_cache),
       metadata_(metadata),
       file_system_(file_system),
+      scheduler_(scheduler),
       blocking_task_runner_(blocking_task_runner) {
   DCHECK(file_cache_);
   DCHECK(metadata_);
   DCHECK(file_system_);
+  DCHECK(scheduler_);
 }
 
 DebugInfoCollector::~DebugInfoCollector() {
@@ -126,4 +129,9 @@ void DebugInfoCollector::GetMetadata(
   file_system_->GetMetadata(callback);
 }
 
+std::vector<JobScheduler::QueueStats> DebugInfoCollector::GetJobQueueStats() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  return scheduler_->GetQueueStats();
+}
+
 }  // namespace drive
@@ -5,10 +5,13 @@
 #ifndef CHROME_BROWSER_CHROMEOS_DRIVE_DEBUG_INFO_COLLECTOR_H_
 #define CHROME_BROWSER_CHROMEOS_DRIVE_DEBUG_INFO_COLLECTOR_H_
 
+#include <vector>
+
 #include "base/basictypes.h"
 #include "base/callback_forward.h"
 #include "chrome/browser/chromeos/drive/file_cache.h"
 #include "chrome/browser/chromeos/drive/file_system_interface.h"
+#include "chrome/browser/chromeos/drive/job_scheduler.h"
 
 namespace drive {
 
@@ -30,6 +33,7 @@ class DebugInfoCollector {
   DebugInfoCollector(internal::FileCache* file_cache,
                      internal::ResourceMetadata* metadata,
                      FileSystemInterface* file_system,
+                     JobScheduler* scheduler,
                      base::SequencedTaskRunner* blocking_task_runner);
   ~DebugInfoCollector();
 
@@ -54,10 +58,14 @@ class DebugInfoCollector {
   // timestamp. |callback| must not be null.
   void GetMetadata(const GetFilesystemMetadataCallback& callback);
 
+  // Returns the depths of the job queues and how long the jobs waited in them.
+  std::vector<JobScheduler::QueueStats> GetJobQueueStats();
+
  private:
   internal::FileCache* file_cache_;  // Not owned.
   internal::ResourceMetadata* metadata_;  // No owned.
   FileSystemInterface* file_system_;  // Not owned.
+  JobScheduler* scheduler_;  // Not owned.
   scoped_refptr<base::SequencedTaskRunner> blocking_task_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(DebugInfoCollector);
@@ -8,12 +8,15 @@
 
 #include "base/callback_helpers.h"
 #include "base/file_util.h"
+#include "base/files/file.h"
 #include "base/files/file_enumerator.h"
 #include "base/logging.h"
+#include "base/md5.h"
 #include "base/metrics/histogram.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/sys_info.h"
+#include "base/time/time.h"
 #include "chrome/browser/chromeos/drive/drive.pb.h"
 #include "chrome/browser/chromeos/drive/file_system_util.h"
 #include "chrome/browser/chromeos/drive/resource_metadata_storage.h"
@@ -37,6 +40,48 @@ std::string GetIdFromPath(const base::FilePath& path) {
   return util::UnescapeCacheFileName(path.BaseName().AsUTF8Unsafe());
 }
 
+// Copies |source_path| to |dest_path| while computing MD5 of the content, so
+// that the file doesn't have to be read again to get the MD5.
+bool CopyFileAndComputeMd5(const base::FilePath& source_path,
+                           const base::FilePath& dest_path,
+                           std::string* md5) {
+  const int kBufferSize = 512 * 1024;  // 512kB.
+
+  base::File source(source_path,
+                    base::File::FLAG_OPEN | base::File::FLAG_READ);
+  if (!source.IsValid())
+    return false;
+
+  base::File dest(dest_path,
+                  base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  if (!dest.IsValid())
+    return false;
+
+  base::MD5Context context;
+  base::MD5Init(&context);
+
+  int64 offset = 0;
+  scoped_ptr<char[]> buffer(new char[kBufferSize]);
+  while (true) {
+    const int result = source.Read(offset, buffer.get(), kBufferSize);
+    if (result < 0)
+      return false;
+    if (result == 0)  // End of file.
+      break;
+
+    if (dest.Write(offset, buffer.get(), result) != result)
+      return false;
+
+    offset += result;
+    base::MD5Update(&context, base::StringPiece(buffer.get(), result));
+  }
+
+  base::MD5Digest digest;
+  base::MD5Final(&digest, &context);
+  *md5 = base::MD5DigestToBase16(digest);
+  return true;
+}
+
 }  // namespace
 
 FileCache::FileCache(ResourceMetadataStorage* storage,
@@ -92,15 +137,21 @@ bool FileCache::FreeDiskSpaceIfNeededFor(int64 num_bytes) {
   // Otherwise, try to free up the disk space.
   DVLOG(1) << "Freeing up disk space for " << num_bytes;
 
-  // Remove all entries unless specially marked.
-  scoped_ptr<ResourceMetadataStorage::CacheEntryIterator> it =
-      storage_->GetCacheEntryIterator();
+  // Remove the least recently used files first, until we have enough space.
+  // Pinned or dirty files are not on the eviction index.
+  scoped_ptr<ResourceMetadataStorage::EvictableCacheEntryIterator> it =
+      storage_->GetEvictableCacheEntryIterator();
   for (; !it->IsAtEnd(); it->Advance()) {
-    const FileCacheEntry& entry = it->GetValue();
-    if (!entry.is_pinned() &&
-        !entry.is_dirty() &&
-        !mounted_files_.count(it->GetID()))
-      storage_->RemoveCacheEntry(it->GetID());
+    const std::string& id = it->GetID();
+    if (mounted_files_.count(id))
+      continue;
+
+    if (!base::DeleteFile(GetCacheFilePath(id), false /* recursive */) ||
+        !storage_->RemoveCacheEntry(id))
+      continue;
+
+    if (HasEnoughSpaceFor(num_bytes, cache_file_directory_))
+      return true;
   }
   DCHECK(!it->HasError());
 
@@ -130,6 +181,11 @@ FileError FileCache::GetFile(const std::string& id,
       !cache_entry.is_present())
     return FILE_ERROR_NOT_FOUND;
 
+  // Update the last access time to keep the file from being evicted.
+  cache_entry.set_last_access_time(base::Time::Now().ToInternalValue());
+  if (!storage_->PutCacheEntry(id, cache_entry))
+    return FILE_ERROR_FAILED;
+
   *cache_file_path = GetCacheFilePath(id);
   return FILE_ERROR_OK;
 }
@@ -155,13 +211,19 @@ FileError FileCache::Store(const std::string& id,
     return FILE_ERROR_IN_USE;
 
   base::FilePath dest_path = GetCacheFilePath(id);
+  std::string computed_md5;
   bool success = false;
   switch (file_operation_type) {
     case FILE_OPERATION_MOVE:
       success = base::Move(source_path, dest_path);
       break;
     case FILE_OPERATION_COPY:
-      success = base::CopyFile(source_path, dest_path);
+      // Dirty files will need MD5 to be uploaded. Compute it while copying
+      // rather than reading the whole file again in UpdateMd5().
+      if (md5.empty())
+        success = CopyFileAndComputeMd5(source_path, dest_path, &computed_md5);
+      else
+        success = base::CopyFile(source_path, dest_path);
       break;
     default:
       NOTREACHED();
@@ -178,8 +240,9 @@ FileError FileCache::Store(const std::string& id,
   // Now that file operations have completed, update metadata.
   FileCacheEntry cache_entry;
   storage_->GetCacheEntry(id, &cache_entry);
-  cache_entry.set_md5(md5);
+  cache_entry.set_md5(md5.empty() ? computed_md5 : md5);
   cache_entry.set_is_present(true);
+  cache_entry.set_last_access_time(base::Time::Now().ToInternalValue());
   if (md5.empty())
     cache_entry.set_is_dirty(true);
   return storage_->PutCacheEntry(id, cache_entry) ?
@@ -77,18 +77,21 @@ class FileCache {
 
   // Frees up disk space to store a file with |num_bytes| size content, while
   // keeping cryptohome::kMinFreeSpaceInBytes bytes on the disk, if needed.
+  // Files are evicted in the least recently used order.
   // Returns true if we successfully manage to have enough space, otherwise
   // false.
   bool FreeDiskSpaceIfNeededFor(int64 num_bytes);
 
   // Checks if file corresponding to |id| exists in cache, and returns
   // FILE_ERROR_OK with |cache_file_path| storing the path to the file.
+  // The file is marked as most recently used.
   // |cache_file_path| must not be null.
   FileError GetFile(const std::string& id, base::FilePath* cache_file_path);
 
   // Stores |source_path| as a cache of the remote content of the file
   // with |id| and |md5|.
-  // Pass an empty string as MD5 to mark the entry as dirty.
+  // Pass an empty string as MD5 to mark the entry as dirty. In that case, MD5
+  // is computed while copying the file with FILE_OPERATION_COPY.
   FileError Store(const std::string& id,
                   const std::string& md5,
                   const base::FilePath& source_path,
@@ -184,6 +184,49 @@ TEST_F(FileCacheTest, FreeDiskSpaceIfNeededFor) {
   EXPECT_FALSE(cache_->FreeDiskSpaceIfNeededFor(kNeededBytes));
 }
 
+TEST_F(FileCacheTest, FreeDiskSpaceIfNeededFor_LeastRecentlyUsedFirst) {
+  base::FilePath src_file;
+  ASSERT_TRUE(base::CreateTemporaryFileInDir(temp_dir_.path(), &src_file));
+
+  // Store three files.
+  const std::string id_old = "id_old", id_new = "id_new";
+  const std::string id_mounted = "id_mounted";
+  ASSERT_EQ(FILE_ERROR_OK, cache_->Store(id_mounted, "md5", src_file,
+                                         FileCache::FILE_OPERATION_COPY));
+  ASSERT_EQ(FILE_ERROR_OK, cache_->Store(id_old, "md5", src_file,
+                                         FileCache::FILE_OPERATION_COPY));
+  ASSERT_EQ(FILE_ERROR_OK, cache_->Store(id_new, "md5", src_file,
+                                         FileCache::FILE_OPERATION_COPY));
+
+  base::FilePath mounted_path, old_path, new_path;
+  ASSERT_EQ(FILE_ERROR_OK, cache_->MarkAsMounted(id_mounted, &mounted_path));
+  ASSERT_EQ(FILE_ERROR_OK, cache_->GetFile(id_old, &old_path));
+  ASSERT_EQ(FILE_ERROR_OK, cache_->GetFile(id_new, &new_path));
+
+  // Set the last access time in the order of mounted, old and new.
+  const std::string ids[] = { id_mounted, id_old, id_new };
+  for (size_t i = 0; i < arraysize(ids); ++i) {
+    FileCacheEntry entry;
+    ASSERT_TRUE(metadata_storage_->GetCacheEntry(ids[i], &entry));
+    entry.set_last_access_time(i + 1);
+    ASSERT_TRUE(metadata_storage_->PutCacheEntry(ids[i], entry));
+  }
+
+  // Freeing space once should remove only the least recently used file which
+  // is not mounted.
+  fake_free_disk_space_getter_->set_default_value(test_util::kLotsOfSpace);
+  fake_free_disk_space_getter_->PushFakeValue(0);
+  EXPECT_TRUE(cache_->FreeDiskSpaceIfNeededFor(1));
+
+  FileCacheEntry entry;
+  EXPECT_TRUE(cache_->GetCacheEntry(id_mounted, &entry));
+  EXPECT_TRUE(base::PathExists(mounted_path));
+  EXPECT_FALSE(cache_->GetCacheEntry(id_old, &entry));
+  EXPECT_FALSE(base::PathExists(old_path));
+  EXPECT_TRUE(cache_->GetCacheEntry(id_new, &entry));
+  EXPECT_TRUE(base::PathExists(new_path));
+}
+
 TEST_F(FileCacheTest, GetFile) {
   const base::FilePath src_file_path = temp_dir_.path().Append("test.dat");
   const std::string src_contents = "test";
@@ -258,12 +301,23 @@ TEST_F(FileCacheTest, Store) {
       id, md5, base::FilePath::FromUTF8Unsafe("non_existent_file"),
       FileCache::FILE_OPERATION_COPY));
 
-  // Passing empty MD5 marks the entry as dirty.
+  // Passing empty MD5 marks the entry as dirty. MD5 is computed on copy.
   EXPECT_EQ(FILE_ERROR_OK, cache_->Store(
       id, std::string(), src_file_path, FileCache::FILE_OPERATION_COPY));
 
   EXPECT_TRUE(cache_->GetCacheEntry(id, &cache_entry));
   EXPECT_TRUE(cache_entry.is_present());
+  EXPECT_EQ(md5, cache_entry.md5());
+  EXPECT_TRUE(cache_entry.is_dirty());
+  EXPECT_TRUE(base::ContentsEqual(src_file_path, cache_file_path));
+
+  // MD5 is left empty when the file is moved.
+  const base::FilePath src_file_path2 = temp_dir_.path().Append("test2.dat");
+  ASSERT_TRUE(base::CopyFile(src_file_path, src_file_path2));
+  EXPECT_EQ(FILE_ERROR_OK, cache_->Store(
+      id, std::string(), src_file_path2, FileCache::FILE_OPERATION_MOVE));
+
+  EXPECT_TRUE(cache_->GetCacheEntry(id, &cache_entry));
   EXPECT_TRUE(cache_entry.md5().empty());
   EXPECT_TRUE(cache_entry.is_dirty());
 
@@ -11,10 +11,18 @@
 
 namespace drive {
 
+JobQueue::Stats::Stats()
+    : num_queued(0),
+      num_running(0),
+      num_started(0) {
+}
+
 JobQueue::JobQueue(size_t num_max_concurrent_jobs,
                    size_t num_priority_levels)
     : num_max_concurrent_jobs_(num_max_concurrent_jobs),
-      queue_(num_priority_levels) {
+      num_max_concurrent_low_priority_jobs_(num_max_concurrent_jobs),
+      queue_(num_priority_levels),
+      stats_(num_priority_levels) {
 }
 
 JobQueue::~JobQueue() {
@@ -27,12 +35,31 @@ bool JobQueue::PopForRun(int accepted_priority, JobID* id) {
   if (running_.size() >= num_max_concurrent_jobs_)
     return false;
 
+  size_t num_running_low_priority_jobs = 0;
+  for (std::map<JobID, int>::const_iterator it = running_.begin();
+       it != running_.end(); ++it) {
+    if (it->second > 0)
+      ++num_running_low_priority_jobs;
+  }
+
   // Looks up the queue in the order of priority upto |accepted_priority|.
   for (int priority = 0; priority <= accepted_priority; ++priority) {
+    if (priority > 0 &&
+        num_running_low_priority_jobs >= num_max_concurrent_low_priority_jobs_)
+      return false;
+
     if (!queue_[priority].empty()) {
-      *id = queue_[priority].front();
+      const QueuedJob& job = queue_[priority].front();
+      const base::TimeDelta wait_time =
+          base::TimeTicks::Now() - job.queued_time;
+      Stats* stats = &stats_[priority];
+      ++stats->num_started;
+      stats->total_wait_time += wait_time;
+      stats->max_wait_time = std::max(stats->max_wait_time, wait_time);
+
+      *id = job.id;
       queue_[priority].pop_front();
-      running_.insert(*id);
+      running_[*id] = priority;
       return true;
     }
   }
@@ -42,13 +69,18 @@ bool JobQueue::PopForRun(int accepted_priority, JobID* id) {
 void JobQueue::GetQueuedJobs(int priority, std::vector<JobID>* jobs) const {
   DCHECK_LT(priority, static_cast<int>(queue_.size()));
 
-  jobs->assign(queue_[priority].begin(), queue_[priority].end());
+  jobs->clear();
+  for (size_t i = 0; i < queue_[priority].size(); ++i)
+    jobs->push_back(queue_[priority][i].id);
 }
 
 void JobQueue::Push(JobID id, int priority) {
   DCHECK_LT(priority, static_cast<int>(queue_.size()));
 
-  queue_[priority].push_back(id);
+  QueuedJob job;
+  job.id = id;
+  job.queued_time = base::TimeTicks::Now();
+  queue_[priority].push_back(job);
 }
 
 void JobQueue::MarkFinished(JobID id) {
@@ -74,13 +106,40 @@ size_t JobQueue::GetNumberOfJobs() const {
 
 void JobQueue::Remove(JobID id) {
   for (size_t i = 0; i < queue_.size(); ++i) {
-    std::deque<JobID>::iterator iter =
-        std::find(queue_[i].begin(), queue_[i].end(), id);
-    if (iter != queue_[i].end()) {
-      queue_[i].erase(iter);
-      break;
+    for (std::deque<QueuedJob>::iterator iter = queue_[i].begin();
+         iter != queue_[i].end(); ++iter) {
+      if (iter->id == id) {
+        queue_[i].erase(iter);
+        return;
+      }
     }
   }
 }
 
+void JobQueue::SetMaxConcurrentLowPriorityJobs(
+    size_t num_max_concurrent_jobs) {
+  num_max_concurrent_low_priority_jobs_ = num_max_concurrent_jobs;
+}
+
+JobQueue::Stats JobQueue::GetStats(int priority) const {
+  DCHECK_LT(priority, static_cast<int>(queue_.size()));
+
+  Stats stats = stats_[priority];
+  stats.num_queued = queue_[priority].size();
+  for (std::map<JobID, int>::const_iterator it = running_.begin();
+       it != running_.end(); ++it) {
+    if (it->second == priority)
+      ++stats.num_running;
+  }
+  return stats;
+}
+
+base::TimeTicks JobQueue::GetOldestQueuedTime(int priority) const {
+  DCHECK_LT(priority, static_cast<int>(queue_.size()));
+
+  if (queue_[priority].empty())
+    return base::TimeTicks();
+  return queue_[priority].front().queued_time;
+}
+
 }  // namespace drive
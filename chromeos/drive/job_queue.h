@@ -6,9 +6,10 @@
 #define CHROME_BROWSER_CHROMEOS_DRIVE_JOB_QUEUE_H_
 
 #include <deque>
-#include <set>
+#include <map>
 #include <vector>
 
+#include "base/time/time.h"
 #include "chrome/browser/chromeos/drive/job_list.h"
 
 namespace drive {
@@ -16,6 +17,20 @@ namespace drive {
 // Priority queue for managing jobs in JobScheduler.
 class JobQueue {
  public:
+  // Statistics of the jobs of a priority level, for debugging.
+  struct Stats {
+    Stats();
+
+    size_t num_queued;
+    size_t num_running;
+
+    // The number of jobs popped for run so far, and how long they waited in
+    // the queue in total and at the longest.
+    size_t num_started;
+    base::TimeDelta total_wait_time;
+    base::TimeDelta max_wait_time;
+  };
+
   // Creates a queue that allows |num_max_concurrent_jobs| concurrent job
   // execution and has |num_priority_levels| levels of priority.
   JobQueue(size_t num_max_concurrent_jobs, size_t num_priority_levels);
@@ -28,7 +43,8 @@ class JobQueue {
 
   // Pops the first job which meets |accepted_priority| (i.e. the first job in
   // the queue with equal or higher priority (lower value)), and the limit of
-  // concurrent job count is satisfied.
+  // concurrent job count is satisfied. Jobs other than the highest priority
+  // are also subject to the limit set by SetMaxConcurrentLowPriorityJobs().
   //
   // For instance, if |accepted_priority| is 1, the first job with priority 0
   // (higher priority) in the queue is picked even if a job with priority 1 was
@@ -52,10 +68,31 @@ class JobQueue {
   // Removes the job from the queue.
   void Remove(JobID id);
 
+  // Limits the number of running jobs with priority lower than the highest,
+  // so that the remaining slots are kept for the highest priority jobs.
+  // By default, the limit is the same as |num_max_concurrent_jobs|.
+  void SetMaxConcurrentLowPriorityJobs(size_t num_max_concurrent_jobs);
+
+  // Returns the statistics of the jobs of |priority|.
+  Stats GetStats(int priority) const;
+
+  // Returns when the job of |priority| that has been queued the longest was
+  // pushed, or a null time if no job of |priority| is queued.
+  base::TimeTicks GetOldestQueuedTime(int priority) const;
+
  private:
+  struct QueuedJob {
+    JobID id;
+    base::TimeTicks queued_time;
+  };
+
   size_t num_max_concurrent_jobs_;
-  std::vector<std::deque<JobID> > queue_;
-  std::set<JobID> running_;
+  size_t num_max_concurrent_low_priority_jobs_;
+  std::vector<std::deque<QueuedJob> > queue_;
+
+  // Maps a running job to its priority.
+  std::map<JobID, int> running_;
+  std::vector<Stats> stats_;
 
   DISALLOW_COPY_AND_ASSIGN(JobQueue);
 };
@@ -101,4 +101,81 @@ TEST(JobQueueTest, JobQueueRemove) {
   EXPECT_FALSE(queue.PopForRun(LOW_PRIORITY, &id));
 }
 
+TEST(JobQueueTest, MaxConcurrentLowPriorityJobs) {
+  const int kNumMaxConcurrentJobs = 2;
+  const int kNumPriorityLevels = 2;
+  enum {HIGH_PRIORITY, LOW_PRIORITY};
+
+  // Keep one of the two slots for high priority jobs.
+  JobQueue queue(kNumMaxConcurrentJobs, kNumPriorityLevels);
+  queue.SetMaxConcurrentLowPriorityJobs(1);
+
+  queue.Push(101, LOW_PRIORITY);
+  queue.Push(102, LOW_PRIORITY);
+
+  // Only one low priority job can run.
+  JobID id;
+  EXPECT_TRUE(queue.PopForRun(LOW_PRIORITY, &id));
+  EXPECT_EQ(101, id);
+  EXPECT_FALSE(queue.PopForRun(LOW_PRIORITY, &id));
+
+  // A high priority job can still run.
+  queue.Push(103, HIGH_PRIORITY);
+  EXPECT_TRUE(queue.PopForRun(LOW_PRIORITY, &id));
+  EXPECT_EQ(103, id);
+
+  // Finishing the high priority job doesn't let the low priority job run.
+  queue.MarkFinished(103);
+  EXPECT_FALSE(queue.PopForRun(LOW_PRIORITY, &id));
+
+  // Finishing the low priority job does.
+  queue.MarkFinished(101);
+  EXPECT_TRUE(queue.PopForRun(LOW_PRIORITY, &id));
+  EXPECT_EQ(102, id);
+}
+
+TEST(JobQueueTest, Stats) {
+  const int kNumMaxConcurrentJobs = 3;
+  const int kNumPriorityLevels = 2;
+  enum {HIGH_PRIORITY, LOW_PRIORITY};
+
+  JobQueue queue(kNumMaxConcurrentJobs, kNumPriorityLevels);
+  queue.Push(101, LOW_PRIORITY);
+  queue.Push(102, HIGH_PRIORITY);
+  queue.Push(103, LOW_PRIORITY);
+
+  EXPECT_FALSE(queue.GetOldestQueuedTime(HIGH_PRIORITY).is_null());
+  EXPECT_LE(queue.GetOldestQueuedTime(LOW_PRIORITY),
+            queue.GetOldestQueuedTime(HIGH_PRIORITY));
+
+  JobQueue::Stats stats = queue.GetStats(LOW_PRIORITY);
+  EXPECT_EQ(2U, stats.num_queued);
+  EXPECT_EQ(0U, stats.num_running);
+  EXPECT_EQ(0U, stats.num_started);
+
+  JobID id;
+  EXPECT_TRUE(queue.PopForRun(LOW_PRIORITY, &id));
+  EXPECT_EQ(102, id);
+  EXPECT_TRUE(queue.PopForRun(LOW_PRIORITY, &id));
+  EXPECT_EQ(101, id);
+
+  EXPECT_TRUE(queue.GetOldestQueuedTime(HIGH_PRIORITY).is_null());
+  stats = queue.GetStats(HIGH_PRIORITY);
+  EXPECT_EQ(0U, stats.num_queued);
+  EXPECT_EQ(1U, stats.num_running);
+  EXPECT_EQ(1U, stats.num_started);
+  EXPECT_LE(stats.total_wait_time, stats.max_wait_time);
+
+  stats = queue.GetStats(LOW_PRIORITY);
+  EXPECT_EQ(1U, stats.num_queued);
+  EXPECT_EQ(1U, stats.num_running);
+  EXPECT_EQ(1U, stats.num_started);
+
+  // Finished jobs are still counted as started.
+  queue.MarkFinished(101);
+  stats = queue.GetStats(LOW_PRIORITY);
+  EXPECT_EQ(0U, stats.num_running);
+  EXPECT_EQ(1U, stats.num_started);
+}
+
 }  // namespace drive
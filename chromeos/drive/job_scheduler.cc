@@ -136,12 +136,21 @@ google_apis::CancelCallback RunResumeUploadFile(
 
 }  // namespace
 
-// Metadata jobs are cheap, so we run them concurrently. File jobs run serially.
+// Metadata jobs are cheap, so we run them concurrently. File jobs run serially
+// except that a USER_INITIATED file job doesn't wait for a BACKGROUND one,
+// which may be a long running upload, to finish.
 const int JobScheduler::kMaxJobCount[] = {
+  5,  // METADATA_QUEUE
+  2,  // FILE_QUEUE
+};
+
+const int JobScheduler::kMaxBackgroundJobCount[] = {
   5,  // METADATA_QUEUE
   1,  // FILE_QUEUE
 };
 
+const int JobScheduler::kMaxBackgroundFileJobDelaySeconds = 30;
+
 JobScheduler::JobEntry::JobEntry(JobType type)
     : job_info(type),
       context(ClientContext(USER_INITIATED)),
@@ -167,6 +176,9 @@ JobScheduler::JobScheduler(
     : throttle_count_(0),
       wait_until_(base::Time::Now()),
       disable_throttling_(false),
+      max_background_file_job_delay_(
+          base::TimeDelta::FromSeconds(kMaxBackgroundFileJobDelaySeconds)),
+      background_file_job_loop_pending_(false),
       logger_(logger),
       drive_service_(drive_service),
       uploader_(new DriveUploader(drive_service, blocking_task_runner)),
@@ -174,8 +186,10 @@ JobScheduler::JobScheduler(
       weak_ptr_factory_(this) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
 
-  for (int i = 0; i < NUM_QUEUES; ++i)
+  for (int i = 0; i < NUM_QUEUES; ++i) {
     queue_[i].reset(new JobQueue(kMaxJobCount[i], NUM_CONTEXT_TYPES));
+    queue_[i]->SetMaxConcurrentLowPriorityJobs(kMaxBackgroundJobCount[i]);
+  }
 
   net::NetworkChangeNotifier::AddConnectionTypeObserver(this);
 }
@@ -234,6 +248,22 @@ void JobScheduler::CancelAllJobs() {
     CancelJob(iter.GetCurrentKey());
 }
 
+std::vector<JobScheduler::QueueStats> JobScheduler::GetQueueStats() const {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+
+  std::vector<QueueStats> stats_list;
+  for (int i = METADATA_QUEUE; i < NUM_QUEUES; ++i) {
+    for (int j = USER_INITIATED; j < NUM_CONTEXT_TYPES; ++j) {
+      QueueStats stats;
+      stats.queue_name = QueueTypeToString(static_cast<QueueType>(i));
+      stats.context_type = static_cast<ContextType>(j);
+      stats.stats = queue_[i]->GetStats(j);
+      stats_list.push_back(stats);
+    }
+  }
+  return stats_list;
+}
+
 void JobScheduler::GetAboutResource(
     const google_apis::AboutResourceCallback& callback) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
@@ -822,10 +852,53 @@ int JobScheduler::GetCurrentAcceptedPriority(QueueType queue_type) {
           net::NetworkChangeNotifier::GetConnectionType()))
     return USER_INITIATED;
 
+  // Background file transfers yield the bandwidth to metadata operations a user
+  // is waiting for.
+  if (queue_type == FILE_QUEUE && ShouldHoldBackgroundFileJobs())
+    return USER_INITIATED;
+
   // Otherwise, every operations including background tasks are allowed.
   return BACKGROUND;
 }
 
+bool JobScheduler::ShouldHoldBackgroundFileJobs() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+
+  const JobQueue::Stats stats =
+      queue_[METADATA_QUEUE]->GetStats(USER_INITIATED);
+  if (stats.num_queued == 0 && stats.num_running == 0)
+    return false;
+
+  const base::TimeTicks oldest_queued_time =
+      queue_[FILE_QUEUE]->GetOldestQueuedTime(BACKGROUND);
+  if (oldest_queued_time.is_null())
+    return false;
+
+  // A steady stream of USER_INITIATED metadata jobs must not starve the file
+  // jobs, so they are held for |max_background_file_job_delay_| at most.
+  const base::TimeDelta wait_time =
+      base::TimeTicks::Now() - oldest_queued_time;
+  if (wait_time >= max_background_file_job_delay_)
+    return false;
+
+  if (!background_file_job_loop_pending_) {
+    background_file_job_loop_pending_ = true;
+    base::MessageLoopProxy::current()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&JobScheduler::OnBackgroundFileJobDelayElapsed,
+                   weak_ptr_factory_.GetWeakPtr()),
+        max_background_file_job_delay_ - wait_time);
+  }
+  return true;
+}
+
+void JobScheduler::OnBackgroundFileJobDelayElapsed() {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+
+  background_file_job_loop_pending_ = false;
+  DoJobLoop(FILE_QUEUE);
+}
+
 void JobScheduler::UpdateWait() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
 
@@ -895,6 +968,13 @@ bool JobScheduler::OnJobDone(JobID job_id, google_apis::GDataErrorCode error) {
       base::Bind(&JobScheduler::DoJobLoop,
                  weak_ptr_factory_.GetWeakPtr(),
                  queue_type));
+  // BACKGROUND file jobs may have been held for the metadata job.
+  if (queue_type == METADATA_QUEUE) {
+    base::MessageLoopProxy::current()->PostTask(FROM_HERE,
+        base::Bind(&JobScheduler::DoJobLoop,
+                   weak_ptr_factory_.GetWeakPtr(),
+                   FILE_QUEUE));
+  }
   return !should_retry;
 }
 
@@ -52,7 +52,10 @@ struct ClientContext {
 // Orthogonally, jobs are grouped into two types:
 //   - "File jobs" transfer the contents of files.
 //   - "Metadata jobs" operates on file metadata or the directory structure.
-// On WiFi or Ethernet connections, all types of jobs just run.
+// On WiFi or Ethernet connections, all types of jobs just run, except that
+// BACKGROUND file jobs don't start while USER_INITIATED metadata jobs are
+// pending, unless they have waited for 30 seconds already, and leave a slot of
+// the file queue for USER_INITIATED file jobs.
 // On mobile connections (2G/3G/4G), we don't want large background traffic.
 // USER_INITIATED jobs or metadata jobs will run. BACKGROUND file jobs wait
 // in the queue until the network type changes.
@@ -62,6 +65,13 @@ class JobScheduler
     : public net::NetworkChangeNotifier::ConnectionTypeObserver,
       public JobListInterface {
  public:
+  // Statistics of the jobs of a context type in one of the job queues.
+  struct QueueStats {
+    std::string queue_name;
+    ContextType context_type;
+    JobQueue::Stats stats;
+  };
+
   JobScheduler(PrefService* pref_service,
                EventLogger* logger,
                DriveServiceInterface* drive_service,
@@ -213,6 +223,9 @@ class JobScheduler
                      google_apis::drive::PermissionRole role,
                      const google_apis::EntryActionCallback& callback);
 
+  // Returns the statistics of all the job queues for debugging.
+  std::vector<QueueStats> GetQueueStats() const;
+
  private:
   friend class JobSchedulerTest;
 
@@ -224,6 +237,13 @@ class JobScheduler
 
   static const int kMaxJobCount[NUM_QUEUES];
 
+  // The number of slots of each queue BACKGROUND jobs can use at once.
+  static const int kMaxBackgroundJobCount[NUM_QUEUES];
+
+  // How long BACKGROUND file jobs are held for USER_INITIATED metadata jobs at
+  // most.
+  static const int kMaxBackgroundFileJobDelaySeconds;
+
   // Represents a single entry in the job map.
   struct JobEntry {
     explicit JobEntry(JobType type);
@@ -269,6 +289,15 @@ class JobScheduler
   // currently allowed to start for the |queue_type|.
   int GetCurrentAcceptedPriority(QueueType queue_type);
 
+  // Returns true if BACKGROUND file jobs should wait for the USER_INITIATED
+  // metadata jobs, because none of them has waited for
+  // |max_background_file_job_delay_| yet. If so, makes sure that the file job
+  // loop runs again once the oldest of them has.
+  bool ShouldHoldBackgroundFileJobs();
+
+  // Runs the file job loop for BACKGROUND jobs that were held long enough.
+  void OnBackgroundFileJobDelayElapsed();
+
   // Updates |wait_until_| to throttle requests.
   void UpdateWait();
 
@@ -379,6 +408,11 @@ class JobScheduler
   // Disables throttling for testing.
   bool disable_throttling_;
 
+  // How long BACKGROUND file jobs are held for USER_INITIATED metadata jobs at
+  // most, and whether a file job loop is posted for when that time elapses.
+  base::TimeDelta max_background_file_job_delay_;
+  bool background_file_job_loop_pending_;
+
   // The queues of jobs.
   scoped_ptr<JobQueue> queue_[NUM_QUEUES];
 
@@ -180,6 +180,40 @@ class JobSchedulerTest : public testing::Test {
     return JobScheduler::kMaxJobCount[JobScheduler::METADATA_QUEUE];
   }
 
+  void SetMaxBackgroundFileJobDelay(base::TimeDelta delay) {
+    scheduler_->max_background_file_job_delay_ = delay;
+  }
+
+  // Starts a USER_INITIATED metadata job, then a BACKGROUND file job, and
+  // returns the state of the file job right after it was added.
+  JobState StartMetadataJobThenBackgroundFileJob(
+      const base::FilePath& output_file_path,
+      google_apis::GDataErrorCode* metadata_error,
+      google_apis::GDataErrorCode* download_error) {
+    scheduler_->GetResourceEntry(
+        "file:2_file_resource_id",
+        ClientContext(USER_INITIATED),
+        google_apis::test_util::CreateCopyResultCallback(metadata_error,
+                                                         &entry_dontcare_));
+    scheduler_->DownloadFile(
+        base::FilePath::FromUTF8Unsafe("drive/whatever.txt"),  // virtual path
+        kDummyDownloadFileSize,
+        output_file_path,
+        "file:2_file_resource_id",
+        ClientContext(BACKGROUND),
+        google_apis::test_util::CreateCopyResultCallback(
+            download_error, &output_file_path_dontcare_),
+        google_apis::GetContentCallback());
+
+    const std::vector<JobInfo> jobs = scheduler_->GetJobInfoList();
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      if (jobs[i].job_type == TYPE_DOWNLOAD_FILE)
+        return jobs[i].state;
+    }
+    ADD_FAILURE() << "No download job.";
+    return STATE_NONE;
+  }
+
   content::TestBrowserThreadBundle thread_bundle_;
   scoped_ptr<TestingPrefServiceSimple> pref_service_;
   scoped_ptr<test_util::FakeNetworkChangeNotifier>
@@ -187,6 +221,8 @@ class JobSchedulerTest : public testing::Test {
   scoped_ptr<EventLogger> logger_;
   scoped_ptr<CancelTestableFakeDriveService> fake_drive_service_;
   scoped_ptr<JobScheduler> scheduler_;
+  scoped_ptr<google_apis::ResourceEntry> entry_dontcare_;
+  base::FilePath output_file_path_dontcare_;
 };
 
 TEST_F(JobSchedulerTest, GetAboutResource) {
@@ -566,6 +602,42 @@ TEST_F(JobSchedulerTest, PriorityHandling) {
   EXPECT_EQ(title_3, titles[3]);
 }
 
+TEST_F(JobSchedulerTest, BackgroundFileJobWaitsForUserInitiatedMetadataJob) {
+  ConnectToWifi();
+
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  google_apis::GDataErrorCode metadata_error = google_apis::GDATA_OTHER_ERROR;
+  google_apis::GDataErrorCode download_error = google_apis::GDATA_OTHER_ERROR;
+  EXPECT_EQ(STATE_NONE, StartMetadataJobThenBackgroundFileJob(
+      temp_dir.path().AppendASCII("whatever.txt"),
+      &metadata_error, &download_error));
+
+  // The download starts once the metadata job is done.
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(google_apis::HTTP_SUCCESS, metadata_error);
+  EXPECT_EQ(google_apis::HTTP_SUCCESS, download_error);
+}
+
+TEST_F(JobSchedulerTest, BackgroundFileJobIsHeldForLimitedTime) {
+  ConnectToWifi();
+
+  // The BACKGROUND file job has waited long enough as soon as it is queued.
+  SetMaxBackgroundFileJobDelay(base::TimeDelta());
+
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  google_apis::GDataErrorCode metadata_error = google_apis::GDATA_OTHER_ERROR;
+  google_apis::GDataErrorCode download_error = google_apis::GDATA_OTHER_ERROR;
+  EXPECT_EQ(STATE_RUNNING, StartMetadataJobThenBackgroundFileJob(
+      temp_dir.path().AppendASCII("whatever.txt"),
+      &metadata_error, &download_error));
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(google_apis::HTTP_SUCCESS, metadata_error);
+  EXPECT_EQ(google_apis::HTTP_SUCCESS, download_error);
+}
+
 TEST_F(JobSchedulerTest, NoConnectionUserInitiated) {
   ConnectToNone();
 
@@ -6,11 +6,13 @@
 
 #include "base/bind.h"
 #include "base/file_util.h"
+#include "base/format_macros.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/metrics/histogram.h"
 #include "base/metrics/sparse_histogram.h"
 #include "base/sequenced_task_runner.h"
+#include "base/strings/stringprintf.h"
 #include "base/threading/thread_restrictions.h"
 #include "chrome/browser/chromeos/drive/drive.pb.h"
 #include "third_party/leveldatabase/src/include/leveldb/db.h"
@@ -57,6 +59,9 @@ const char kCacheEntryKeySuffix[] = "CACHE";
 // String used as a prefix of a key for a resource-ID-to-local-ID entry.
 const char kIdEntryKeyPrefix[] = "ID";
 
+// String used as a prefix of a key for a cache eviction index entry.
+const char kEvictionIndexKeyPrefix[] = "LRU";
+
 // Returns a string to be used as the key for the header.
 std::string GetHeaderDBKey() {
   std::string key;
@@ -125,6 +130,56 @@ bool IsIdEntryKey(const leveldb::Slice& key) {
       key[expected_prefix.size() + 1] == kDBKeyDelimeter;
 }
 
+// Returns a string to be used as the common prefix of the keys for cache
+// eviction index entries.
+std::string GetEvictionIndexKeyPrefix() {
+  std::string key;
+  key.push_back(kDBKeyDelimeter);
+  key.append(kEvictionIndexKeyPrefix);
+  key.push_back(kDBKeyDelimeter);
+  return key;
+}
+
+// Returns a string to be used as a key for a cache eviction index entry.
+// The last access time is encoded as fixed width hex digits so that the keys
+// are sorted by the time.
+std::string GetEvictionIndexKey(int64 last_access_time,
+                                const std::string& id) {
+  std::string key = GetEvictionIndexKeyPrefix();
+  key.append(base::StringPrintf("%016" PRIx64,
+                                static_cast<uint64>(last_access_time)));
+  key.push_back(kDBKeyDelimeter);
+  key.append(id);
+  return key;
+}
+
+// Returns true if |key| is a key for a cache eviction index entry.
+bool IsEvictionIndexKey(const leveldb::Slice& key) {
+  return key.starts_with(leveldb::Slice(GetEvictionIndexKeyPrefix()));
+}
+
+// Returns true if the cache entry should be on the eviction index.
+bool IsEvictable(const FileCacheEntry& entry) {
+  return entry.is_present() && !entry.is_pinned() && !entry.is_dirty();
+}
+
+// Adds the eviction index entry for |entry| to |batch| if needed.
+void PutEvictionIndexEntry(const std::string& id,
+                           const FileCacheEntry& entry,
+                           leveldb::WriteBatch* batch) {
+  if (IsEvictable(entry))
+    batch->Put(GetEvictionIndexKey(entry.last_access_time(), id), id);
+}
+
+// Adds the deletion of the eviction index entry for |entry| to |batch| if
+// needed.
+void DeleteEvictionIndexEntry(const std::string& id,
+                              const FileCacheEntry& entry,
+                              leveldb::WriteBatch* batch) {
+  if (IsEvictable(entry))
+    batch->Delete(GetEvictionIndexKey(entry.last_access_time(), id));
+}
+
 // Converts leveldb::Status to DBInitStatus.
 DBInitStatus LevelDBStatusToDBInitStatus(const leveldb::Status status) {
   if (status.ok())
@@ -212,6 +267,7 @@ void ResourceMetadataStorage::Iterator::Advance() {
     if (!IsChildEntryKey(it_->key()) &&
         !IsCacheEntryKey(it_->key()) &&
         !IsIdEntryKey(it_->key()) &&
+        !IsEvictionIndexKey(it_->key()) &&
         entry_.ParseFromArray(it_->value().data(), it_->value().size()))
       break;
   }
@@ -278,13 +334,60 @@ void ResourceMetadataStorage::CacheEntryIterator::AdvanceInternal() {
   }
 }
 
+ResourceMetadataStorage::EvictableCacheEntryIterator::
+EvictableCacheEntryIterator(scoped_ptr<leveldb::Iterator> it)
+    : it_(it.Pass()) {
+  base::ThreadRestrictions::AssertIOAllowed();
+  DCHECK(it_);
+
+  it_->Seek(leveldb::Slice(GetEvictionIndexKeyPrefix()));
+  AdvanceInternal();
+}
+
+ResourceMetadataStorage::EvictableCacheEntryIterator::
+~EvictableCacheEntryIterator() {
+  base::ThreadRestrictions::AssertIOAllowed();
+}
+
+bool ResourceMetadataStorage::EvictableCacheEntryIterator::IsAtEnd() const {
+  base::ThreadRestrictions::AssertIOAllowed();
+  // Index entries are stored contiguously, the first key out of them marks
+  // the end.
+  return !it_->Valid() || !IsEvictionIndexKey(it_->key());
+}
+
+const std::string&
+ResourceMetadataStorage::EvictableCacheEntryIterator::GetID() const {
+  base::ThreadRestrictions::AssertIOAllowed();
+  DCHECK(!IsAtEnd());
+  return id_;
+}
+
+void ResourceMetadataStorage::EvictableCacheEntryIterator::Advance() {
+  base::ThreadRestrictions::AssertIOAllowed();
+  DCHECK(!IsAtEnd());
+
+  it_->Next();
+  AdvanceInternal();
+}
+
+bool ResourceMetadataStorage::EvictableCacheEntryIterator::HasError() const {
+  base::ThreadRestrictions::AssertIOAllowed();
+  return !it_->status().ok();
+}
+
+void ResourceMetadataStorage::EvictableCacheEntryIterator::AdvanceInternal() {
+  if (!IsAtEnd())
+    id_ = it_->value().ToString();
+}
+
 // static
 bool ResourceMetadataStorage::UpgradeOldDB(
     const base::FilePath& directory_path,
     const ResourceIdCanonicalizer& id_canonicalizer) {
   base::ThreadRestrictions::AssertIOAllowed();
   COMPILE_ASSERT(
-      kDBVersion == 12,
+      kDBVersion == 13,
       db_version_and_this_function_should_be_updated_at_the_same_time);
 
   const base::FilePath resource_map_path =
@@ -346,6 +449,11 @@ bool ResourceMetadataStorage::UpgradeOldDB(
         // Before v11, resource ID was directly used as local ID. Such entries
         // can be migrated by adding an identity ID mapping.
         batch.Put(GetIdEntryKey(id_new), id_new);
+
+        // Before v13, there was no eviction index.
+        FileCacheEntry cache_entry;
+        if (cache_entry.ParseFromArray(it->value().data(), it->value().size()))
+          PutEvictionIndexEntry(id_new, cache_entry, &batch);
       } else {  // Remove all entries except cache entries.
         batch.Delete(it->key());
       }
@@ -367,8 +475,43 @@ bool ResourceMetadataStorage::UpgradeOldDB(
 
     leveldb::WriteBatch batch;
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-      if (!IsCacheEntryKey(it->key()) && !IsIdEntryKey(it->key()))
+      if (IsCacheEntryKey(it->key())) {
+        // Before v13, there was no eviction index.
+        FileCacheEntry cache_entry;
+        if (cache_entry.ParseFromArray(it->value().data(),
+                                       it->value().size())) {
+          PutEvictionIndexEntry(GetIdFromCacheEntryKey(it->key()), cache_entry,
+                                &batch);
+        }
+      } else if (!IsIdEntryKey(it->key())) {
         batch.Delete(it->key());
+      }
+    }
+    if (!it->status().ok())
+      return false;
+
+    // Put header with the latest version number.
+    std::string serialized_header;
+    if (!GetDefaultHeaderEntry().SerializeToString(&serialized_header))
+      return false;
+    batch.Put(GetHeaderDBKey(), serialized_header);
+
+    return resource_map->Write(leveldb::WriteOptions(), &batch).ok();
+  } else if (header.version() < 13) {  // All entries are reusable.
+    leveldb::ReadOptions options;
+    options.verify_checksums = true;
+    scoped_ptr<leveldb::Iterator> it(resource_map->NewIterator(options));
+
+    // Build the eviction index. Files which were cached before are treated as
+    // the least recently used ones.
+    leveldb::WriteBatch batch;
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+      FileCacheEntry cache_entry;
+      if (IsCacheEntryKey(it->key()) &&
+          cache_entry.ParseFromArray(it->value().data(), it->value().size())) {
+        PutEvictionIndexEntry(GetIdFromCacheEntryKey(it->key()), cache_entry,
+                              &batch);
+      }
     }
     if (!it->status().ok())
       return false;
@@ -726,16 +869,30 @@ bool ResourceMetadataStorage::PutCacheEntry(const std::string& id,
   base::ThreadRestrictions::AssertIOAllowed();
   DCHECK(!id.empty());
 
+  // Try to get existing entry to refresh the eviction index.
   std::string serialized_entry;
+  leveldb::Status status = resource_map_->Get(
+      leveldb::ReadOptions(),
+      leveldb::Slice(GetCacheEntryKey(id)),
+      &serialized_entry);
+  if (!status.ok() && !status.IsNotFound())  // Unexpected errors.
+    return false;
+
+  FileCacheEntry old_entry;
+  if (status.ok() && !old_entry.ParseFromString(serialized_entry))
+    return false;
+
   if (!entry.SerializeToString(&serialized_entry)) {
     DLOG(ERROR) << "Failed to serialize the entry.";
     return false;
   }
 
-  const leveldb::Status status = resource_map_->Put(
-      leveldb::WriteOptions(),
-      leveldb::Slice(GetCacheEntryKey(id)),
-      leveldb::Slice(serialized_entry));
+  leveldb::WriteBatch batch;
+  DeleteEvictionIndexEntry(id, old_entry, &batch);
+  PutEvictionIndexEntry(id, entry, &batch);
+  batch.Put(GetCacheEntryKey(id), serialized_entry);
+
+  status = resource_map_->Write(leveldb::WriteOptions(), &batch);
   return status.ok();
 }
 
@@ -756,9 +913,18 @@ bool ResourceMetadataStorage::RemoveCacheEntry(const std::string& id) {
   base::ThreadRestrictions::AssertIOAllowed();
   DCHECK(!id.empty());
 
-  const leveldb::Status status = resource_map_->Delete(
-      leveldb::WriteOptions(),
-      leveldb::Slice(GetCacheEntryKey(id)));
+  leveldb::WriteBatch batch;
+
+  // Remove from the eviction index.
+  FileCacheEntry entry;
+  if (GetCacheEntry(id, &entry))
+    DeleteEvictionIndexEntry(id, entry, &batch);
+
+  // Remove the entry itself.
+  batch.Delete(GetCacheEntryKey(id));
+
+  const leveldb::Status status = resource_map_->Write(leveldb::WriteOptions(),
+                                                      &batch);
   return status.ok();
 }
 
@@ -771,6 +937,15 @@ ResourceMetadataStorage::GetCacheEntryIterator() {
   return make_scoped_ptr(new CacheEntryIterator(it.Pass()));
 }
 
+scoped_ptr<ResourceMetadataStorage::EvictableCacheEntryIterator>
+ResourceMetadataStorage::GetEvictableCacheEntryIterator() {
+  base::ThreadRestrictions::AssertIOAllowed();
+
+  scoped_ptr<leveldb::Iterator> it(
+      resource_map_->NewIterator(leveldb::ReadOptions()));
+  return make_scoped_ptr(new EvictableCacheEntryIterator(it.Pass()));
+}
+
 ResourceMetadataStorage::RecoveredCacheInfo::RecoveredCacheInfo()
     : is_dirty(false) {}
 
@@ -856,6 +1031,9 @@ bool ResourceMetadataStorage::CheckValidity() {
   // "\0ID\0|resource ID 1|"        : Local ID associated to resource ID 1.
   // "\0ID\0|resource ID 2|"        : Local ID associated to resource ID 2.
   // ...
+  // "\0LRU\0|time 1|\0|ID of A|"    : ID of evictable cache entry A.
+  // "\0LRU\0|time 2|\0|ID of B|"    : ID of evictable cache entry B.
+  // ...
   // "|ID of A|"                    : ResourceEntry for entry A.
   // "|ID of A|\0CACHE"             : FileCacheEntry for entry A.
   // "|ID of A|\0|child name 1|\0"  : ID of the 1st child entry of entry A.
@@ -879,7 +1057,10 @@ bool ResourceMetadataStorage::CheckValidity() {
   // Check all entries.
   size_t num_entries_with_parent = 0;
   size_t num_child_entries = 0;
+  size_t num_evictable_cache_entries = 0;
+  size_t num_eviction_index_entries = 0;
   ResourceEntry entry;
+  FileCacheEntry cache_entry;
   std::string serialized_entry;
   std::string child_id;
   for (it->Next(); it->Valid(); it->Next()) {
@@ -889,9 +1070,35 @@ bool ResourceMetadataStorage::CheckValidity() {
       continue;
     }
 
-    // Ignore cache entries.
-    if (IsCacheEntryKey(it->key()))
+    // Count evictable cache entries.
+    if (IsCacheEntryKey(it->key())) {
+      if (cache_entry.ParseFromArray(it->value().data(), it->value().size()) &&
+          IsEvictable(cache_entry))
+        ++num_evictable_cache_entries;
+      continue;
+    }
+
+    // Check if eviction index entries point to evictable cache entries.
+    if (IsEvictionIndexKey(it->key())) {
+      std::string serialized_cache_entry;
+      leveldb::Status status = resource_map_->Get(
+          options,
+          leveldb::Slice(GetCacheEntryKey(it->value().ToString())),
+          &serialized_cache_entry);
+      const bool ok = status.ok() &&
+          cache_entry.ParseFromString(serialized_cache_entry) &&
+          IsEvictable(cache_entry) &&
+          leveldb::Slice(GetEvictionIndexKey(cache_entry.last_access_time(),
+                                             it->value().ToString())) ==
+              it->key();
+      if (!ok) {
+        DLOG(ERROR) << "Broken eviction index entry. status = "
+                    << status.ToString();
+        return false;
+      }
+      ++num_eviction_index_entries;
       continue;
+    }
 
     // Check if resource-ID-to-local-ID mapping is stored correctly.
     if (IsIdEntryKey(it->key())) {
@@ -942,7 +1149,9 @@ bool ResourceMetadataStorage::CheckValidity() {
       ++num_entries_with_parent;
     }
   }
-  if (!it->status().ok() || num_child_entries != num_entries_with_parent) {
+  if (!it->status().ok() ||
+      num_child_entries != num_entries_with_parent ||
+      num_eviction_index_entries != num_evictable_cache_entries) {
     DLOG(ERROR) << "Error during checking resource map. status = "
                 << it->status().ToString();
     return false;
@@ -37,7 +37,7 @@ class ResourceMetadataStorage {
  public:
   // This should be incremented when incompatibility change is made to DB
   // format.
-  static const int kDBVersion = 12;
+  static const int kDBVersion = 13;
 
   // Object to iterate over entries stored in this storage.
   class Iterator {
@@ -105,6 +105,38 @@ class ResourceMetadataStorage {
     DISALLOW_COPY_AND_ASSIGN(CacheEntryIterator);
   };
 
+  // Object to iterate over IDs of evictable cache entries (i.e. present, and
+  // neither pinned nor dirty) in the ascending order of their last access
+  // time.
+  class EvictableCacheEntryIterator {
+   public:
+    explicit EvictableCacheEntryIterator(scoped_ptr<leveldb::Iterator> it);
+    ~EvictableCacheEntryIterator();
+
+    // Returns true if this iterator cannot advance any more and does not point
+    // to a valid entry. GetID() and Advance() should not be called in such
+    // cases.
+    bool IsAtEnd() const;
+
+    // Returns the ID of the entry currently pointed by this object.
+    const std::string& GetID() const;
+
+    // Advances to the next entry.
+    void Advance();
+
+    // Returns true if this object has encountered any error.
+    bool HasError() const;
+
+   private:
+    // Used to implement Advance().
+    void AdvanceInternal();
+
+    scoped_ptr<leveldb::Iterator> it_;
+    std::string id_;
+
+    DISALLOW_COPY_AND_ASSIGN(EvictableCacheEntryIterator);
+  };
+
   // Cache information recovered from trashed DB.
   struct RecoveredCacheInfo {
     RecoveredCacheInfo();
@@ -176,6 +208,10 @@ class ResourceMetadataStorage {
   // Returns an object to iterate over cache entries stored in this storage.
   scoped_ptr<CacheEntryIterator> GetCacheEntryIterator();
 
+  // Returns an object to iterate over evictable cache entries, the least
+  // recently used one first.
+  scoped_ptr<EvictableCacheEntryIterator> GetEvictableCacheEntryIterator();
+
   // Returns the local ID associated with the given resource ID.
   bool GetIdByResourceId(const std::string& resource_id, std::string* out_id);
 
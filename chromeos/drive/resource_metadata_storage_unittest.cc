@@ -250,6 +250,58 @@ TEST_F(ResourceMetadataStorageTest, CacheEntryIterator) {
   EXPECT_EQ(entries.size(), num_entries);
 }
 
+TEST_F(ResourceMetadataStorageTest, EvictableCacheEntryIterator) {
+  FileCacheEntry cache_entry;
+  cache_entry.set_is_present(true);
+
+  // Put evictable entries in random order of the last access time.
+  cache_entry.set_last_access_time(300);
+  EXPECT_TRUE(storage_->PutCacheEntry("entry3", cache_entry));
+  cache_entry.set_last_access_time(100);
+  EXPECT_TRUE(storage_->PutCacheEntry("entry1", cache_entry));
+  cache_entry.set_last_access_time(200);
+  EXPECT_TRUE(storage_->PutCacheEntry("entry2", cache_entry));
+
+  // Put non-evictable entries.
+  cache_entry.set_last_access_time(0);
+  cache_entry.set_is_pinned(true);
+  EXPECT_TRUE(storage_->PutCacheEntry("pinned", cache_entry));
+  cache_entry.set_is_pinned(false);
+  cache_entry.set_is_dirty(true);
+  EXPECT_TRUE(storage_->PutCacheEntry("dirty", cache_entry));
+
+  // Update the last access time of an existing entry.
+  cache_entry.set_is_dirty(false);
+  cache_entry.set_last_access_time(400);
+  EXPECT_TRUE(storage_->PutCacheEntry("entry1", cache_entry));
+
+  // Insert some dummy entries.
+  ResourceEntry entry;
+  entry.set_local_id("entry1");
+  EXPECT_TRUE(storage_->PutEntry(entry));
+
+  // Iterate and check the result.
+  std::vector<std::string> ids;
+  scoped_ptr<ResourceMetadataStorage::EvictableCacheEntryIterator> it =
+      storage_->GetEvictableCacheEntryIterator();
+  ASSERT_TRUE(it);
+  for (; !it->IsAtEnd(); it->Advance())
+    ids.push_back(it->GetID());
+  EXPECT_FALSE(it->HasError());
+  ASSERT_EQ(3U, ids.size());
+  EXPECT_EQ("entry2", ids[0]);
+  EXPECT_EQ("entry3", ids[1]);
+  EXPECT_EQ("entry1", ids[2]);
+
+  // Removed entries are removed from the index.
+  EXPECT_TRUE(storage_->RemoveCacheEntry("entry2"));
+  it = storage_->GetEvictableCacheEntryIterator();
+  ASSERT_FALSE(it->IsAtEnd());
+  EXPECT_EQ("entry3", it->GetID());
+
+  EXPECT_TRUE(CheckValidity());
+}
+
 TEST_F(ResourceMetadataStorageTest, GetIdByResourceId) {
   const std::string local_id = "local_id";
   const std::string resource_id = "resource_id";
@@ -445,6 +497,44 @@ TEST_F(ResourceMetadataStorageTest, IncompatibleDB_M32) {
   EXPECT_TRUE(storage_->GetCacheEntry(id, &cache_entry));
 }
 
+TEST_F(ResourceMetadataStorageTest, IncompatibleDB_M36) {
+  const int64 kLargestChangestamp = 1234567890;
+  const std::string local_id = "local-abcd";
+
+  // Construct M36 version DB, which doesn't have the eviction index.
+  SetDBVersion(12);
+  EXPECT_TRUE(storage_->SetLargestChangestamp(kLargestChangestamp));
+
+  ResourceEntry entry;
+  entry.set_local_id(local_id);
+  EXPECT_TRUE(storage_->PutEntry(entry));
+
+  FileCacheEntry cache_entry;
+  cache_entry.set_is_present(true);
+  std::string serialized_entry;
+  EXPECT_TRUE(cache_entry.SerializeToString(&serialized_entry));
+  EXPECT_TRUE(resource_map()->Put(leveldb::WriteOptions(),
+                                  local_id + '\0' + "CACHE",
+                                  serialized_entry).ok());
+
+  // Upgrade and reopen.
+  storage_.reset();
+  EXPECT_TRUE(ResourceMetadataStorage::UpgradeOldDB(
+      temp_dir_.path(), base::Bind(&util::CanonicalizeResourceId)));
+  storage_.reset(new ResourceMetadataStorage(
+      temp_dir_.path(), base::MessageLoopProxy::current().get()));
+  ASSERT_TRUE(storage_->Initialize());
+
+  // No data is erased, and the cache entry is on the eviction index.
+  EXPECT_EQ(kLargestChangestamp, storage_->GetLargestChangestamp());
+  EXPECT_TRUE(storage_->GetEntry(local_id, &entry));
+  EXPECT_TRUE(storage_->GetCacheEntry(local_id, &cache_entry));
+  scoped_ptr<ResourceMetadataStorage::EvictableCacheEntryIterator> it =
+      storage_->GetEvictableCacheEntryIterator();
+  ASSERT_FALSE(it->IsAtEnd());
+  EXPECT_EQ(local_id, it->GetID());
+}
+
 TEST_F(ResourceMetadataStorageTest, IncompatibleDB_Unknown) {
   const int64 kLargestChangestamp = 1234567890;
   const std::string key1 = "abcd";
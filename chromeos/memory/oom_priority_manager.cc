@@ -5,7 +5,9 @@
 #include "chrome/browser/chromeos/memory/oom_priority_manager.h"
 
 #include <algorithm>
+#include <map>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "ash/multi_profile_uma.h"
@@ -17,6 +19,7 @@
 #include "base/metrics/field_trial.h"
 #include "base/metrics/histogram.h"
 #include "base/process/process.h"
+#include "base/process/process_metrics.h"
 #include "base/strings/string16.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
@@ -80,12 +83,38 @@ const int kSuspendThresholdSeconds = kAdjustmentIntervalSeconds * 4;
 // a little while before doing the adjustment.
 const int kFocusedTabScoreAdjustIntervalMs = 500;
 
+// Tabs are discarded proactively when the memory available to the system
+// (free memory plus file-backed pages) falls below this share of the total.
+// This is somewhat above the margin at which the kernel signals low memory.
+const int kProactiveDiscardAvailablePercent = 10;
+
+// The minimum time between two proactive discards.  While memory stays low
+// after a discard the interval doubles, up to the maximum, which leaves time
+// for the memory freed by the discards to be reclaimed.
+const int kMinProactiveDiscardIntervalSeconds = 30;
+const int kMaxProactiveDiscardIntervalSeconds = 10 * 60;
+
+// The idle time after which a tab is as likely as not to be revisited soon.
+const double kRevisitHalfLifeMinutes = 30.0;
+
+// The memory credited to a tab whose renderer has not been sampled yet.
+const double kDefaultTabMemoryMB = 50.0;
+
+// The cost of reloading reloadable web UI, relative to a regular page.
+const double kReloadableUIReloadCost = 0.25;
+
 // Returns a unique ID for a WebContents.  Do not cast back to a pointer, as
 // the WebContents could be deleted if the user closed the tab.
 int64 IdFromWebContents(WebContents* web_contents) {
   return reinterpret_cast<int64>(web_contents);
 }
 
+// Orders (utility, tab id) pairs by decreasing utility.
+bool CompareDiscardUtility(const std::pair<double, int64>& first,
+                           const std::pair<double, int64>& second) {
+  return first.first > second.first;
+}
+
 // Records a statistics |sample| for UMA histogram |name| using a linear
 // distribution of buckets.
 void RecordLinearHistogram(const std::string& name,
@@ -164,6 +193,8 @@ OomPriorityManager::TabStats::TabStats()
     is_selected(false),
     is_discarded(false),
     renderer_handle(0),
+    renderer_tab_count(1),
+    private_memory_kb(0),
     tab_contents_id(0) {
 }
 
@@ -173,6 +204,8 @@ OomPriorityManager::TabStats::~TabStats() {
 OomPriorityManager::OomPriorityManager()
     : focused_tab_pid_(0),
       low_memory_observer_(new LowMemoryObserver),
+      proactive_discard_interval_(
+          TimeDelta::FromSeconds(kMinProactiveDiscardIntervalSeconds)),
       discard_count_(0),
       recent_tab_discard_(false) {
   registrar_.Add(this,
@@ -243,19 +276,7 @@ std::vector<base::string16> OomPriorityManager::GetTabTitles() {
 // such as tabs created with JavaScript window.open().  We might want to
 // discard the entire set together, or use that in the priority computation.
 bool OomPriorityManager::DiscardTab() {
-  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
-  TabStatsList stats = GetTabStatsOnUIThread();
-  if (stats.empty())
-    return false;
-  // Loop until we find a non-discarded tab to kill.
-  for (TabStatsList::const_reverse_iterator stats_rit = stats.rbegin();
-       stats_rit != stats.rend();
-       ++stats_rit) {
-    int64 least_important_tab_id = stats_rit->tab_contents_id;
-    if (DiscardTabById(least_important_tab_id))
-      return true;
-  }
-  return false;
+  return DiscardTabWithRendererMemory(ProcessMemoryMap());
 }
 
 void OomPriorityManager::LogMemoryAndDiscardTab() {
@@ -268,6 +289,28 @@ void OomPriorityManager::LogMemoryAndDiscardTab() {
 ///////////////////////////////////////////////////////////////////////////////
 // OomPriorityManager, private:
 
+bool OomPriorityManager::DiscardTabWithRendererMemory(
+    const ProcessMemoryMap& renderer_memory) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  TabStatsList stats = GetTabStatsOnUIThread();
+  if (stats.empty())
+    return false;
+  for (TabStatsList::iterator it = stats.begin(); it != stats.end(); ++it) {
+    ProcessMemoryMap::const_iterator memory =
+        renderer_memory.find(it->renderer_handle);
+    if (memory != renderer_memory.end())
+      it->private_memory_kb = memory->second;
+  }
+  // Loop until we find a tab we can kill.
+  std::vector<int64> discard_order = GetDiscardOrder(stats, TimeTicks::Now());
+  for (std::vector<int64>::const_iterator it = discard_order.begin();
+       it != discard_order.end(); ++it) {
+    if (DiscardTabById(*it))
+      return true;
+  }
+  return false;
+}
+
 // static
 bool OomPriorityManager::IsReloadableUI(const GURL& url) {
   // There are many chrome:// UI URLs, but only look for the ones that users
@@ -453,6 +496,111 @@ bool OomPriorityManager::CompareTabStats(TabStats first,
   return first.last_active > second.last_active;
 }
 
+// static
+double OomPriorityManager::GetDiscardUtility(const TabStats& stats,
+                                             const TimeTicks& now) {
+  // Estimate how likely the user is to come back to the tab soon, decaying
+  // with the time since it was last active.
+  double idle_minutes =
+      std::max(0.0, (now - stats.last_active).InSecondsF() / 60.0);
+  double revisit_probability =
+      kRevisitHalfLifeMinutes / (kRevisitHalfLifeMinutes + idle_minutes);
+
+  // The renderer only exits once all of its tabs are discarded, so each tab
+  // is credited with its share of the renderer's memory.
+  double reclaimable_mb = kDefaultTabMemoryMB;
+  if (stats.private_memory_kb > 0) {
+    reclaimable_mb = stats.private_memory_kb / 1024.0 /
+                     std::max(1, stats.renderer_tab_count);
+  }
+
+  double reload_cost = stats.is_reloadable_ui ? kReloadableUIReloadCost : 1.0;
+  return reclaimable_mb * (1.0 - revisit_probability) / reload_cost;
+}
+
+// static
+std::vector<int64> OomPriorityManager::GetDiscardOrder(
+    const TabStatsList& stats_list,
+    const TimeTicks& now) {
+  std::vector<std::pair<double, int64> > candidates;
+  std::vector<int64> protected_tabs;
+  for (TabStatsList::const_reverse_iterator it = stats_list.rbegin();
+       it != stats_list.rend(); ++it) {
+    if (it->is_discarded)
+      continue;
+    // Tabs CompareTabStats protects are only discarded when no other tab can
+    // be.
+    if (it->is_selected || it->is_pinned || it->is_app ||
+        it->is_playing_audio) {
+      protected_tabs.push_back(it->tab_contents_id);
+    } else {
+      candidates.push_back(
+          std::make_pair(GetDiscardUtility(*it, now), it->tab_contents_id));
+    }
+  }
+  // Ties keep the least important tab first.
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   CompareDiscardUtility);
+
+  std::vector<int64> discard_order;
+  discard_order.reserve(candidates.size() + protected_tabs.size());
+  for (size_t i = 0; i < candidates.size(); ++i)
+    discard_order.push_back(candidates[i].second);
+  discard_order.insert(
+      discard_order.end(), protected_tabs.begin(), protected_tabs.end());
+  return discard_order;
+}
+
+// static
+bool OomPriorityManager::ShouldDiscardProactively(
+    const base::SystemMemoryInfoKB& memory) {
+  if (memory.total <= 0)
+    return false;
+  int64 available_kb =
+      memory.active_file + memory.inactive_file + memory.free;
+  return available_kb * 100 <
+      static_cast<int64>(memory.total) * kProactiveDiscardAvailablePercent;
+}
+
+// static
+TimeDelta OomPriorityManager::GetNextProactiveDiscardInterval(
+    const TimeDelta& interval,
+    const TimeDelta& time_since_last_discard) {
+  // Memory is reported low on every adjustment while it stays low.  If it
+  // was reported low again as soon as the interval expired, the previous
+  // discard did not free enough memory: wait longer before the next one.
+  // Otherwise memory recovered in between, and the interval starts over.
+  if (time_since_last_discard <
+      interval + TimeDelta::FromSeconds(2 * kAdjustmentIntervalSeconds)) {
+    return std::min(
+        interval * 2,
+        TimeDelta::FromSeconds(kMaxProactiveDiscardIntervalSeconds));
+  }
+  return TimeDelta::FromSeconds(kMinProactiveDiscardIntervalSeconds);
+}
+
+bool OomPriorityManager::CanDiscardProactively(const TimeTicks& now) const {
+  return last_proactive_discard_time_.is_null() ||
+      now - last_proactive_discard_time_ >= proactive_discard_interval_;
+}
+
+void OomPriorityManager::DiscardTabProactively(
+    const ProcessMemoryMap& renderer_memory) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
+  TimeTicks now = TimeTicks::Now();
+  if (!CanDiscardProactively(now))
+    return;
+  if (!last_proactive_discard_time_.is_null()) {
+    proactive_discard_interval_ = GetNextProactiveDiscardInterval(
+        proactive_discard_interval_, now - last_proactive_discard_time_);
+  }
+  last_proactive_discard_time_ = now;
+
+  LOG(WARNING) << "Memory is running low.  Discarding a tab.";
+  PurgeBrowserMemory();
+  DiscardTabWithRendererMemory(renderer_memory);
+}
+
 void OomPriorityManager::AdjustFocusedTabScoreOnFileThread() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
   base::AutoLock pid_to_oom_score_autolock(pid_to_oom_score_lock_);
@@ -542,15 +690,29 @@ void OomPriorityManager::AdjustOomPriorities() {
       start_time_ += suspend_time;
       if (!last_discard_time_.is_null())
         last_discard_time_ += suspend_time;
+      if (!last_proactive_discard_time_.is_null())
+        last_proactive_discard_time_ += suspend_time;
     }
   }
   last_adjust_time_ = TimeTicks::Now();
 
+  // The scores only depend on the order of the renderers, so there is nothing
+  // to write if it is the same as last time.
   TabStatsList stats_list = GetTabStatsOnUIThread();
+  std::vector<base::ProcessHandle> process_handles =
+      GetProcessHandles(stats_list);
+  bool rank_changed = process_handles != last_process_handles_;
+  last_process_handles_.swap(process_handles);
+
+  // Memory is only checked when a proactive discard could follow.
+  bool check_memory = low_memory_observer_.get() &&
+      CanDiscardProactively(last_adjust_time_);
+
   BrowserThread::PostTask(
       BrowserThread::FILE, FROM_HERE,
       base::Bind(&OomPriorityManager::AdjustOomPrioritiesOnFileThread,
-                 base::Unretained(this), stats_list));
+                 base::Unretained(this), stats_list, rank_changed,
+                 check_memory));
 }
 
 OomPriorityManager::TabStatsList OomPriorityManager::GetTabStatsOnUIThread() {
@@ -588,6 +750,15 @@ OomPriorityManager::TabStatsList OomPriorityManager::GetTabStatsOnUIThread() {
     // We process the active browser window in the first iteration.
     browser_active = false;
   }
+  std::map<base::ProcessHandle, int> tabs_per_renderer;
+  for (TabStatsList::const_iterator it = stats_list.begin();
+       it != stats_list.end(); ++it) {
+    ++tabs_per_renderer[it->renderer_handle];
+  }
+  for (TabStatsList::iterator it = stats_list.begin();
+       it != stats_list.end(); ++it) {
+    it->renderer_tab_count = tabs_per_renderer[it->renderer_handle];
+  }
   // Sort the data we collected so that least desirable to be
   // killed is first, most desirable is last.
   std::sort(stats_list.begin(), stats_list.end(), CompareTabStats);
@@ -618,9 +789,10 @@ std::vector<base::ProcessHandle> OomPriorityManager::GetProcessHandles(
 }
 
 void OomPriorityManager::AdjustOomPrioritiesOnFileThread(
-    TabStatsList stats_list) {
+    TabStatsList stats_list,
+    bool rank_changed,
+    bool check_memory) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
-  base::AutoLock pid_to_oom_score_autolock(pid_to_oom_score_lock_);
 
   // Remove any duplicate PIDs. Order of the list is maintained, so each
   // renderer process will take on the oom_score_adj of the most important
@@ -628,6 +800,33 @@ void OomPriorityManager::AdjustOomPrioritiesOnFileThread(
   std::vector<base::ProcessHandle> process_handles =
       GetProcessHandles(stats_list);
 
+  // Check whether we are getting close to the kernel low memory signal.  The
+  // renderers are only measured then, to pick the tab whose discard frees the
+  // most memory.
+  base::SystemMemoryInfoKB memory;
+  if (check_memory && base::GetSystemMemoryInfo(&memory) &&
+      ShouldDiscardProactively(memory)) {
+    ProcessMemoryMap renderer_memory;
+    for (std::vector<base::ProcessHandle>::const_iterator it =
+             process_handles.begin();
+         it != process_handles.end(); ++it) {
+      scoped_ptr<base::ProcessMetrics> metrics(
+          base::ProcessMetrics::CreateProcessMetrics(*it));
+      base::WorkingSetKBytes working_set;
+      if (metrics->GetWorkingSetKBytes(&working_set))
+        renderer_memory[*it] = static_cast<int>(working_set.priv);
+    }
+    BrowserThread::PostTask(
+        BrowserThread::UI, FROM_HERE,
+        base::Bind(&OomPriorityManager::DiscardTabProactively,
+                   base::Unretained(this), renderer_memory));
+  }
+
+  if (!rank_changed)
+    return;
+
+  base::AutoLock pid_to_oom_score_autolock(pid_to_oom_score_lock_);
+
   // Now we assign priorities based on the sorted list.  We're
   // assigning priorities in the range of kLowestRendererOomScore to
   // kHighestRendererOomScore (defined in chrome_constants.h).
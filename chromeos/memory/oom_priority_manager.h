@@ -12,6 +12,7 @@
 #include "base/gtest_prod_util.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/process/process.h"
+#include "base/process/process_metrics.h"
 #include "base/strings/string16.h"
 #include "base/synchronization/lock.h"
 #include "base/time/time.h"
@@ -34,6 +35,12 @@ class LowMemoryObserver;
 //
 // The algorithm used favors killing tabs that are not selected, not pinned,
 // and have been idle for longest, in that order of priority.
+//
+// When picking a tab to discard, the tabs that are not protected by the
+// rules above are instead ranked by the memory a discard would free, weighed
+// against the chance the user returns to the tab soon and the cost of
+// reloading it.  When system memory runs low the manager discards tabs
+// proactively, before the kernel low memory signal fires.
 class OomPriorityManager : public content::NotificationObserver {
  public:
   OomPriorityManager();
@@ -67,6 +74,11 @@ class OomPriorityManager : public content::NotificationObserver {
   FRIEND_TEST_ALL_PREFIXES(OomPriorityManagerTest, Comparator);
   FRIEND_TEST_ALL_PREFIXES(OomPriorityManagerTest, IsReloadableUI);
   FRIEND_TEST_ALL_PREFIXES(OomPriorityManagerTest, GetProcessHandles);
+  FRIEND_TEST_ALL_PREFIXES(OomPriorityManagerTest, GetDiscardUtility);
+  FRIEND_TEST_ALL_PREFIXES(OomPriorityManagerTest, GetDiscardOrder);
+  FRIEND_TEST_ALL_PREFIXES(OomPriorityManagerTest, ShouldDiscardProactively);
+  FRIEND_TEST_ALL_PREFIXES(OomPriorityManagerTest,
+                           GetNextProactiveDiscardInterval);
 
   struct TabStats {
     TabStats();
@@ -79,11 +91,16 @@ class OomPriorityManager : public content::NotificationObserver {
     bool is_discarded;
     base::TimeTicks last_active;
     base::ProcessHandle renderer_handle;
+    int renderer_tab_count;  // number of tabs sharing the renderer process
+    int private_memory_kb;  // of the renderer process, or 0 if not sampled
     base::string16 title;
     int64 tab_contents_id;  // unique ID per WebContents
   };
   typedef std::vector<TabStats> TabStatsList;
 
+  // Maps a renderer process to its private memory, in kilobytes.
+  typedef base::hash_map<base::ProcessHandle, int> ProcessMemoryMap;
+
   // Returns true if the |url| represents an internal Chrome web UI page that
   // can be easily reloaded and hence makes a good choice to discard.
   static bool IsReloadableUI(const GURL& url);
@@ -117,8 +134,12 @@ class OomPriorityManager : public content::NotificationObserver {
   static std::vector<base::ProcessHandle> GetProcessHandles(
       const TabStatsList& stats_list);
 
-  // Called by AdjustOomPriorities.
-  void AdjustOomPrioritiesOnFileThread(TabStatsList stats_list);
+  // Called by AdjustOomPriorities.  Only updates the oom_score_adj values
+  // if |rank_changed|, and only checks whether memory is running low if
+  // |check_memory|.
+  void AdjustOomPrioritiesOnFileThread(TabStatsList stats_list,
+                                       bool rank_changed,
+                                       bool check_memory);
 
   // Posts AdjustFocusedTabScore task to the file thread.
   void OnFocusTabScoreAdjustmentTimeout();
@@ -128,6 +149,40 @@ class OomPriorityManager : public content::NotificationObserver {
 
   static bool CompareTabStats(TabStats first, TabStats second);
 
+  // Returns the expected benefit of discarding the tab described by |stats|
+  // at time |now|.  Higher values make better candidates.
+  static double GetDiscardUtility(const TabStats& stats,
+                                  const base::TimeTicks& now);
+
+  // Returns the IDs of the tabs in |stats_list|, which must be sorted with
+  // CompareTabStats, in the order they should be discarded.  Tabs which
+  // CompareTabStats protects come last, least important first; the other
+  // tabs are ordered by GetDiscardUtility.  Discarded tabs are left out.
+  static std::vector<int64> GetDiscardOrder(const TabStatsList& stats_list,
+                                            const base::TimeTicks& now);
+
+  // Returns true if |memory| is low enough that a tab should be discarded
+  // before the kernel signals a low memory condition.
+  static bool ShouldDiscardProactively(const base::SystemMemoryInfoKB& memory);
+
+  // Returns the interval to wait after a proactive discard, given the
+  // previous |interval| and the time since the previous proactive discard.
+  static base::TimeDelta GetNextProactiveDiscardInterval(
+      const base::TimeDelta& interval,
+      const base::TimeDelta& time_since_last_discard);
+
+  // Returns true if enough time has passed since the last proactive discard
+  // for another one to happen at |now|.
+  bool CanDiscardProactively(const base::TimeTicks& now) const;
+
+  // Called on the UI thread with the private memory of each renderer when
+  // AdjustOomPrioritiesOnFileThread finds that memory is running low.
+  void DiscardTabProactively(const ProcessMemoryMap& renderer_memory);
+
+  // Like DiscardTab(), crediting the renderers in |renderer_memory| with
+  // their private memory when ranking the tabs.
+  bool DiscardTabWithRendererMemory(const ProcessMemoryMap& renderer_memory);
+
   virtual void Observe(int type,
                        const content::NotificationSource& source,
                        const content::NotificationDetails& details) OVERRIDE;
@@ -148,6 +203,15 @@ class OomPriorityManager : public content::NotificationObserver {
   // disabled.
   scoped_ptr<LowMemoryObserver> low_memory_observer_;
 
+  // The renderer processes in the order of the last priority adjustment.
+  // Only used on the UI thread.
+  std::vector<base::ProcessHandle> last_process_handles_;
+
+  // Wall-clock time of the last proactive discard, or 0 if none happened, and
+  // the minimum time until the next one.  Only used on the UI thread.
+  base::TimeTicks last_proactive_discard_time_;
+  base::TimeDelta proactive_discard_interval_;
+
   // Wall-clock time when the priority manager started running.
   base::TimeTicks start_time_;
 
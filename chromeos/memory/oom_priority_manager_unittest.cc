@@ -184,4 +184,141 @@ TEST_F(OomPriorityManagerTest, GetProcessHandles) {
   EXPECT_EQ(101, handles[1]);
 }
 
+TEST_F(OomPriorityManagerTest, GetDiscardUtility) {
+  const base::TimeTicks now = base::TimeTicks::Now();
+  OomPriorityManager::TabStats stats;
+  stats.last_active = now - base::TimeDelta::FromHours(1);
+  stats.private_memory_kb = 100 * 1024;
+  const double utility = OomPriorityManager::GetDiscardUtility(stats, now);
+  EXPECT_GT(utility, 0.0);
+
+  // A tab that was just used is not worth discarding.
+  OomPriorityManager::TabStats recent = stats;
+  recent.last_active = now;
+  EXPECT_EQ(0.0, OomPriorityManager::GetDiscardUtility(recent, now));
+
+  // Idle tabs are better candidates.
+  OomPriorityManager::TabStats idle = stats;
+  idle.last_active = now - base::TimeDelta::FromDays(1);
+  EXPECT_GT(OomPriorityManager::GetDiscardUtility(idle, now), utility);
+
+  // Discarding one of several tabs sharing a renderer frees less memory.
+  OomPriorityManager::TabStats shared = stats;
+  shared.renderer_tab_count = 4;
+  EXPECT_DOUBLE_EQ(utility / 4,
+                   OomPriorityManager::GetDiscardUtility(shared, now));
+
+  // Reloadable web UI is cheap to bring back.
+  OomPriorityManager::TabStats reloadable = stats;
+  reloadable.is_reloadable_ui = true;
+  EXPECT_GT(OomPriorityManager::GetDiscardUtility(reloadable, now), utility);
+}
+
+TEST_F(OomPriorityManagerTest, GetDiscardOrder) {
+  const base::TimeTicks now = base::TimeTicks::Now();
+  OomPriorityManager::TabStatsList test_list;
+
+  // The list is sorted with CompareTabStats, most important first.
+  {
+    OomPriorityManager::TabStats stats;
+    stats.is_selected = true;
+    stats.tab_contents_id = kSelected;
+    test_list.push_back(stats);
+  }
+
+  {
+    OomPriorityManager::TabStats stats;
+    stats.is_pinned = true;
+    stats.last_active = now - base::TimeDelta::FromDays(365);
+    stats.private_memory_kb = 500 * 1024;
+    stats.tab_contents_id = kOldButPinned;
+    test_list.push_back(stats);
+  }
+
+  // Uses a lot of memory, but was used recently.
+  {
+    OomPriorityManager::TabStats stats;
+    stats.last_active = now - base::TimeDelta::FromMinutes(1);
+    stats.private_memory_kb = 200 * 1024;
+    stats.tab_contents_id = kRecent;
+    test_list.push_back(stats);
+  }
+
+  // Shares its renderer with three other tabs.
+  {
+    OomPriorityManager::TabStats stats;
+    stats.last_active = now - base::TimeDelta::FromHours(2);
+    stats.private_memory_kb = 200 * 1024;
+    stats.renderer_tab_count = 4;
+    stats.tab_contents_id = kOld;
+    test_list.push_back(stats);
+  }
+
+  {
+    OomPriorityManager::TabStats stats;
+    stats.last_active = now - base::TimeDelta::FromHours(3);
+    stats.private_memory_kb = 100 * 1024;
+    stats.tab_contents_id = kReallyOld;
+    test_list.push_back(stats);
+  }
+
+  // Discarded tabs can't be discarded again.
+  {
+    OomPriorityManager::TabStats stats;
+    stats.is_discarded = true;
+    stats.tab_contents_id = kReloadableUI;
+    test_list.push_back(stats);
+  }
+
+  std::vector<int64> order =
+      OomPriorityManager::GetDiscardOrder(test_list, now);
+  ASSERT_EQ(5u, order.size());
+  int index = 0;
+  EXPECT_EQ(kReallyOld, order[index++]);
+  EXPECT_EQ(kOld, order[index++]);
+  EXPECT_EQ(kRecent, order[index++]);
+  EXPECT_EQ(kOldButPinned, order[index++]);
+  EXPECT_EQ(kSelected, order[index++]);
+}
+
+TEST_F(OomPriorityManagerTest, ShouldDiscardProactively) {
+  base::SystemMemoryInfoKB memory;
+  memory.total = 2 * 1024 * 1024;
+  memory.free = 1024 * 1024;
+  EXPECT_FALSE(OomPriorityManager::ShouldDiscardProactively(memory));
+
+  // File-backed pages can be reclaimed, so they count as available.
+  memory.free = 50 * 1024;
+  memory.active_file = 100 * 1024;
+  memory.inactive_file = 100 * 1024;
+  EXPECT_FALSE(OomPriorityManager::ShouldDiscardProactively(memory));
+
+  memory.active_file = 50 * 1024;
+  memory.inactive_file = 50 * 1024;
+  EXPECT_TRUE(OomPriorityManager::ShouldDiscardProactively(memory));
+
+  // No information, no discard.
+  EXPECT_FALSE(OomPriorityManager::ShouldDiscardProactively(
+      base::SystemMemoryInfoKB()));
+}
+
+// Tests that proactive discards back off while memory stays low.
+TEST_F(OomPriorityManagerTest, GetNextProactiveDiscardInterval) {
+  const base::TimeDelta kMinInterval = base::TimeDelta::FromSeconds(30);
+  const base::TimeDelta kMaxInterval = base::TimeDelta::FromMinutes(10);
+
+  // Memory was still low as soon as the interval expired.
+  EXPECT_EQ(kMinInterval * 2,
+            OomPriorityManager::GetNextProactiveDiscardInterval(
+                kMinInterval, kMinInterval + base::TimeDelta::FromSeconds(10)));
+  EXPECT_EQ(kMaxInterval,
+            OomPriorityManager::GetNextProactiveDiscardInterval(
+                kMaxInterval, kMaxInterval));
+
+  // Memory recovered in between.
+  EXPECT_EQ(kMinInterval,
+            OomPriorityManager::GetNextProactiveDiscardInterval(
+                kMinInterval * 8, base::TimeDelta::FromHours(1)));
+}
+
 }  // namespace chromeos
@@ -11,7 +11,8 @@
 #include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/json/json_file_value_serializer.h"
-#include "base/memory/weak_ptr.h"
+#include "base/location.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "base/values.h"
 #include "chrome/browser/component_updater/component_patcher_operation.h"
 #include "chrome/browser/component_updater/component_updater_service.h"
@@ -38,6 +39,8 @@ base::ListValue* ReadCommands(const base::FilePath& unpack_path) {
 
 }  // namespace
 
+const size_t ComponentPatcher::kMaxParallelOperations = 4;
+
 ComponentPatcher::ComponentPatcher(
     const base::FilePath& input_dir,
     const base::FilePath& unpack_dir,
@@ -48,6 +51,10 @@ ComponentPatcher::ComponentPatcher(
       unpack_dir_(unpack_dir),
       installer_(installer),
       in_process_(in_process),
+      next_operation_(0),
+      running_operations_(0),
+      error_(ComponentUnpacker::kNone),
+      extended_error_(0),
       task_runner_(task_runner) {
 }
 
@@ -65,29 +72,52 @@ void ComponentPatcher::StartPatching() {
   commands_.reset(ReadCommands(input_dir_));
   if (!commands_.get()) {
     DonePatching(ComponentUnpacker::kDeltaBadCommands, 0);
-  } else {
-    next_command_ = commands_->begin();
-    PatchNextFile();
-  }
-}
-
-void ComponentPatcher::PatchNextFile() {
-  if (next_command_ == commands_->end()) {
-    DonePatching(ComponentUnpacker::kNone, 0);
     return;
   }
-  if (!(*next_command_)->IsType(base::Value::TYPE_DICTIONARY)) {
-    DonePatching(ComponentUnpacker::kDeltaBadCommands, 0);
-    return;
+
+  // Check all the commands before patching any file.
+  for (base::ListValue::const_iterator it = commands_->begin();
+       it != commands_->end(); ++it) {
+    if (!(*it)->IsType(base::Value::TYPE_DICTIONARY)) {
+      DonePatching(ComponentUnpacker::kDeltaBadCommands, 0);
+      return;
+    }
+    scoped_refptr<DeltaUpdateOp> operation =
+        CreateDeltaUpdateOp(*static_cast<base::DictionaryValue*>(*it));
+    if (!operation) {
+      DonePatching(ComponentUnpacker::kDeltaUnsupportedCommand, 0);
+      return;
+    }
+    operations_.push_back(operation);
   }
-  const base::DictionaryValue* command_args =
-      static_cast<base::DictionaryValue*>(*next_command_);
-  current_operation_ = CreateDeltaUpdateOp(*command_args);
-  if (!current_operation_) {
-    DonePatching(ComponentUnpacker::kDeltaUnsupportedCommand, 0);
-    return;
+
+  if (operations_.empty())
+    DonePatching(ComponentUnpacker::kNone, 0);
+  else
+    PatchNextFiles();
+}
+
+void ComponentPatcher::PatchNextFiles() {
+  base::SequencedWorkerPool* pool = content::BrowserThread::GetBlockingPool();
+  while (error_ == ComponentUnpacker::kNone &&
+         next_operation_ < operations_.size() &&
+         running_operations_ < kMaxParallelOperations) {
+    ++running_operations_;
+    pool->PostWorkerTaskWithShutdownBehavior(
+        FROM_HERE,
+        base::Bind(&ComponentPatcher::RunOperation,
+                   scoped_refptr<ComponentPatcher>(this),
+                   next_operation_++),
+        base::SequencedWorkerPool::SKIP_ON_SHUTDOWN);
   }
-  current_operation_->Run(
+}
+
+void ComponentPatcher::RunOperation(size_t index) {
+  // |commands_| and |operations_| don't change while operations run. The
+  // operation reports back on |task_runner_|.
+  const base::DictionaryValue* command_args = NULL;
+  commands_->GetDictionary(index, &command_args);
+  operations_[index]->Run(
       command_args,
       input_dir_,
       unpack_dir_,
@@ -100,17 +130,27 @@ void ComponentPatcher::PatchNextFile() {
 
 void ComponentPatcher::DonePatchingFile(ComponentUnpacker::Error error,
                                         int extended_error) {
-  if (error != ComponentUnpacker::kNone) {
-    DonePatching(error, extended_error);
-  } else {
-    ++next_command_;
-    PatchNextFile();
+  DCHECK_GT(running_operations_, 0U);
+  --running_operations_;
+  if (error != ComponentUnpacker::kNone &&
+      error_ == ComponentUnpacker::kNone) {
+    error_ = error;
+    extended_error_ = extended_error;
+  }
+
+  if (error_ == ComponentUnpacker::kNone &&
+      next_operation_ < operations_.size()) {
+    PatchNextFiles();
+  } else if (running_operations_ == 0) {
+    // All the operations are done, or the ones still running after an error
+    // finished: their output is discarded with the unpack directory.
+    DonePatching(error_, extended_error_);
   }
 }
 
 void ComponentPatcher::DonePatching(ComponentUnpacker::Error error,
                                     int extended_error) {
-  current_operation_ = NULL;
+  operations_.clear();
   task_runner_->PostTask(FROM_HERE, base::Bind(callback_,
                                                error,
                                                extended_error));
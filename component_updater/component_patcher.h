@@ -28,6 +28,8 @@
 #ifndef CHROME_BROWSER_COMPONENT_UPDATER_COMPONENT_PATCHER_H_
 #define CHROME_BROWSER_COMPONENT_UPDATER_COMPONENT_PATCHER_H_
 
+#include <vector>
+
 #include "base/callback_forward.h"
 #include "base/memory/ref_counted.h"
 #include "base/values.h"
@@ -63,10 +65,18 @@ class ComponentPatcher : public base::RefCountedThreadSafe<ComponentPatcher> {
                    bool in_process,
                    scoped_refptr<base::SequencedTaskRunner> task_runner);
 
+  // The most operations run at the same time.
+  static const size_t kMaxParallelOperations;
+
   // Starts patching files. This member function returns immediately, after
   // posting a task to do the patching. When patching has been completed,
   // |callback| will be called with the error codes if any error codes were
   // encountered.
+  //
+  // Each command of a delta update produces its own output file from files of
+  // the existing installation or of |input_dir|, so operations are independent
+  // of each other: they run in parallel on the blocking pool. The installer's
+  // GetInstalledFile() may therefore be called from several threads at once.
   void Start(const ComponentUnpacker::Callback& callback);
 
  private:
@@ -76,7 +86,12 @@ class ComponentPatcher : public base::RefCountedThreadSafe<ComponentPatcher> {
 
   void StartPatching();
 
-  void PatchNextFile();
+  // Starts operations until |kMaxParallelOperations| are running or all of
+  // them were started.
+  void PatchNextFiles();
+
+  // Runs the operation at |index| of |operations_|, on the blocking pool.
+  void RunOperation(size_t index);
 
   void DonePatchingFile(ComponentUnpacker::Error error, int extended_error);
 
@@ -88,8 +103,13 @@ class ComponentPatcher : public base::RefCountedThreadSafe<ComponentPatcher> {
   const bool in_process_;
   ComponentUnpacker::Callback callback_;
   scoped_ptr<base::ListValue> commands_;
-  base::ValueVector::const_iterator next_command_;
-  scoped_refptr<DeltaUpdateOp> current_operation_;
+  std::vector<scoped_refptr<DeltaUpdateOp> > operations_;
+  size_t next_operation_;
+  size_t running_operations_;
+  // The first error reported by an operation. No operation is started once it
+  // is set.
+  ComponentUnpacker::Error error_;
+  int extended_error_;
   scoped_refptr<base::SequencedTaskRunner> task_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(ComponentPatcher);
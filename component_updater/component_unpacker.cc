@@ -9,11 +9,11 @@
 
 #include "base/bind.h"
 #include "base/file_util.h"
+#include "base/files/file.h"
 #include "base/files/file_path.h"
 #include "base/json/json_file_value_serializer.h"
 #include "base/location.h"
 #include "base/logging.h"
-#include "base/memory/scoped_handle.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/stringprintf.h"
 #include "base/values.h"
@@ -23,7 +23,7 @@
 #include "crypto/signature_verifier.h"
 #include "extensions/common/constants.h"
 #include "extensions/common/crx_file.h"
-#include "third_party/zlib/google/zip.h"
+#include "third_party/zlib/google/zip_reader.h"
 
 using crypto::SecureHash;
 
@@ -31,13 +31,30 @@ namespace component_updater {
 
 namespace {
 
+// Reads up to |size| bytes from the current position of |file| into |data|.
+// Returns the number of bytes read, which is only less than |size| at the end
+// of the file or on error.
+size_t ReadFully(base::File* file, void* data, size_t size) {
+  char* buffer = static_cast<char*>(data);
+  size_t total = 0;
+  while (total < size) {
+    const int len = file->ReadAtCurrentPos(buffer + total,
+                                           static_cast<int>(size - total));
+    if (len <= 0)
+      break;
+    total += len;
+  }
+  return total;
+}
+
 // This class makes sure that the CRX digital signature is valid
 // and well formed.
 class CRXValidator {
  public:
-  explicit CRXValidator(FILE* crx_file) : valid_(false), is_delta_(false) {
+  explicit CRXValidator(base::File* crx_file)
+      : valid_(false), is_delta_(false) {
     extensions::CrxFile::Header header;
-    size_t len = fread(&header, 1, sizeof(header), crx_file);
+    size_t len = ReadFully(crx_file, &header, sizeof(header));
     if (len < sizeof(header))
       return;
 
@@ -49,12 +66,12 @@ class CRXValidator {
     is_delta_ = extensions::CrxFile::HeaderIsDelta(header);
 
     std::vector<uint8> key(header.key_size);
-    len = fread(&key[0], sizeof(uint8), header.key_size, crx_file);
+    len = ReadFully(crx_file, &key[0], header.key_size);
     if (len < header.key_size)
       return;
 
     std::vector<uint8> signature(header.signature_size);
-    len = fread(&signature[0], sizeof(uint8), header.signature_size, crx_file);
+    len = ReadFully(crx_file, &signature[0], header.signature_size);
     if (len < header.signature_size)
       return;
 
@@ -68,9 +85,10 @@ class CRXValidator {
       return;
     }
 
-    const size_t kBufSize = 8 * 1024;
+    // Components can be large: read them in big blocks.
+    const size_t kBufSize = 64 * 1024;
     scoped_ptr<uint8[]> buf(new uint8[kBufSize]);
-    while ((len = fread(buf.get(), 1, kBufSize, crx_file)) > 0)
+    while ((len = ReadFully(crx_file, buf.get(), kBufSize)) > 0)
       verifier.VerifyUpdate(buf.get(), len);
 
     if (!verifier.VerifyFinal())
@@ -133,7 +151,16 @@ scoped_ptr<base::DictionaryValue> ReadManifest(
 }
 
 bool ComponentUnpacker::UnpackInternal() {
-  return Verify() && Unzip() && BeginPatching();
+  if (pk_hash_.empty() || path_.empty()) {
+    error_ = kInvalidParams;
+    return false;
+  }
+  base::File crx_file(path_, base::File::FLAG_OPEN | base::File::FLAG_READ);
+  if (!crx_file.IsValid()) {
+    error_ = kInvalidFile;
+    return false;
+  }
+  return Verify(&crx_file) && Unzip(&crx_file) && BeginPatching();
 }
 
 void ComponentUnpacker::Unpack(const Callback& callback) {
@@ -142,20 +169,12 @@ void ComponentUnpacker::Unpack(const Callback& callback) {
     Finish();
 }
 
-bool ComponentUnpacker::Verify() {
-  if (pk_hash_.empty() || path_.empty()) {
-    error_ = kInvalidParams;
-    return false;
-  }
+bool ComponentUnpacker::Verify(base::File* crx_file) {
+  const base::TimeTicks start_time = base::TimeTicks::Now();
   // First, validate the CRX header and signature. As of today
   // this is SHA1 with RSA 1024.
-  ScopedStdioHandle file(base::OpenFile(path_, "rb"));
-  if (!file.get()) {
-    error_ = kInvalidFile;
-    return false;
-  }
-  CRXValidator validator(file.get());
-  file.Close();
+  CRXValidator validator(crx_file);
+  metrics_.verify_time = base::TimeTicks::Now() - start_time;
   if (!validator.valid()) {
     error_ = kInvalidFile;
     return false;
@@ -177,22 +196,43 @@ bool ComponentUnpacker::Verify() {
   return true;
 }
 
-bool ComponentUnpacker::Unzip() {
+bool ComponentUnpacker::Unzip(base::File* crx_file) {
+  const base::TimeTicks start_time = base::TimeTicks::Now();
   base::FilePath& destination = is_delta_ ? unpack_diff_path_ : unpack_path_;
   if (!base::CreateNewTempDirectory(base::FilePath::StringType(),
                                     &destination)) {
     error_ = kUnzipPathError;
     return false;
   }
-  if (!zip::Unzip(path_, destination)) {
+  // The zip reader finds the archive after the CRX header by itself.
+  zip::ZipReader reader;
+  if (!reader.OpenFromPlatformFile(crx_file->GetPlatformFile())) {
     error_ = kUnzipFailed;
     return false;
   }
+  while (reader.HasMore()) {
+    if (!reader.OpenCurrentEntryInZip() ||
+        reader.current_entry_info()->is_unsafe()) {
+      error_ = kUnzipFailed;
+      return false;
+    }
+    const base::FilePath entry_path =
+        destination.Append(reader.current_entry_info()->file_path());
+    const bool extracted = reader.current_entry_info()->is_directory() ?
+        base::CreateDirectory(entry_path) :
+        reader.ExtractCurrentEntryToFilePath(entry_path);
+    if (!extracted || !reader.AdvanceToNextEntry()) {
+      error_ = kUnzipFailed;
+      return false;
+    }
+  }
+  metrics_.unzip_time = base::TimeTicks::Now() - start_time;
   return true;
 }
 
 
 bool ComponentUnpacker::BeginPatching() {
+  patch_start_time_ = base::TimeTicks::Now();
   if (is_delta_) {  // Package is a diff package.
     // Use a different temp directory for the patch output files.
     if (!base::CreateNewTempDirectory(base::FilePath::StringType(),
@@ -222,6 +262,7 @@ bool ComponentUnpacker::BeginPatching() {
 }
 
 void ComponentUnpacker::EndPatching(Error error, int extended_error) {
+  metrics_.patch_time = base::TimeTicks::Now() - patch_start_time_;
   error_ = error;
   extended_error_ = extended_error;
   patcher_ = NULL;
@@ -235,7 +276,9 @@ void ComponentUnpacker::EndPatching(Error error, int extended_error) {
     base::DeleteFile(unpack_diff_path_, true);
     unpack_diff_path_.clear();
   }
+  const base::TimeTicks install_start_time = base::TimeTicks::Now();
   Install();
+  metrics_.install_time = base::TimeTicks::Now() - install_start_time;
   Finish();
 }
 
@@ -15,6 +15,11 @@
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/sequenced_task_runner.h"
+#include "base/time/time.h"
+
+namespace base {
+class File;
+}
 
 namespace component_updater {
 
@@ -49,6 +54,10 @@ scoped_ptr<base::DictionaryValue> ReadManifest(
 //     \_ Install
 //     \_ Finish
 //
+// The CRX file is opened once: it is verified and unzipped through the same
+// handle, so that unzipping mostly reads data the verification just brought
+// into the page cache. The patch operations of a delta CRX run in parallel.
+//
 // For a full CRX, the flow is:
 //   [ComponentUpdater]
 //   Unpack
@@ -90,6 +99,15 @@ class ComponentUnpacker : public base::RefCountedThreadSafe<ComponentUnpacker> {
 
   typedef base::Callback<void(Error, int)> Callback;
 
+  // The time spent in each step of unpacking. Steps which didn't run have a
+  // zero duration.
+  struct Metrics {
+    base::TimeDelta verify_time;
+    base::TimeDelta unzip_time;
+    base::TimeDelta patch_time;
+    base::TimeDelta install_time;
+  };
+
   // Constructs an unpacker for a specific component unpacking operation.
   // |pk_hash| is the expected/ public key SHA256 hash. |path| is the current
   // location of the CRX.
@@ -104,6 +122,10 @@ class ComponentUnpacker : public base::RefCountedThreadSafe<ComponentUnpacker> {
   // package is a differential update. Calls |callback| with the result.
   void Unpack(const Callback& callback);
 
+  // Returns the step timings of the unpacking. Only meaningful once the
+  // callback passed to Unpack() has been called.
+  const Metrics& metrics() const { return metrics_; }
+
  private:
   friend class base::RefCountedThreadSafe<ComponentUnpacker>;
 
@@ -111,14 +133,14 @@ class ComponentUnpacker : public base::RefCountedThreadSafe<ComponentUnpacker> {
 
   bool UnpackInternal();
 
-  // The first step of unpacking is to verify the file. Returns false if an
+  // The first step of unpacking is to verify |crx_file|. Returns false if an
   // error is encountered, the file is malformed, or the file is incorrectly
   // signed.
-  bool Verify();
+  bool Verify(base::File* crx_file);
 
-  // The second step of unpacking is to unzip. Returns false if an error
-  // occurs as part of unzipping.
-  bool Unzip();
+  // The second step of unpacking is to unzip |crx_file|. Returns false if an
+  // error occurs as part of unzipping.
+  bool Unzip(base::File* crx_file);
 
   // The third step is to optionally patch files - this is a no-op for full
   // (non-differential) updates. This step is asynchronous. Returns false if an
@@ -151,6 +173,8 @@ class ComponentUnpacker : public base::RefCountedThreadSafe<ComponentUnpacker> {
   Error error_;
   int extended_error_;
   scoped_refptr<base::SequencedTaskRunner> task_runner_;
+  Metrics metrics_;
+  base::TimeTicks patch_start_time_;
 
   DISALLOW_COPY_AND_ASSIGN(ComponentUnpacker);
 };
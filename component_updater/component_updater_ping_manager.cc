@@ -11,6 +11,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
+#include "base/time/time.h"
 #include "chrome/browser/component_updater/component_updater_utils.h"
 #include "chrome/browser/component_updater/crx_update_item.h"
 #include "net/url_request/url_fetcher.h"
@@ -49,6 +50,9 @@ class PingSender : public net::URLFetcherDelegate {
   static std::string BuildDownloadCompleteEventElements(
       const CrxUpdateItem* item);
   static std::string BuildUpdateCompleteEventElement(const CrxUpdateItem* item);
+  static void AppendTimeAttribute(const char* name,
+                                  const base::TimeDelta& time,
+                                  std::string* event);
 
   scoped_ptr<net::URLFetcher> url_fetcher_;
 
@@ -167,10 +171,30 @@ std::string PingSender::BuildUpdateCompleteEventElement(
     StringAppendF(&ping_event, " previousfp=\"%s\"", item->previous_fp.c_str());
   if (!item->next_fp.empty())
     StringAppendF(&ping_event, " nextfp=\"%s\"", item->next_fp.c_str());
+
+  // The unpacking steps which didn't run have no time.
+  const ComponentUnpacker::Metrics& unpack_metrics = item->unpack_metrics;
+  AppendTimeAttribute("verify_time_ms", unpack_metrics.verify_time,
+                      &ping_event);
+  AppendTimeAttribute("unzip_time_ms", unpack_metrics.unzip_time, &ping_event);
+  AppendTimeAttribute("patch_time_ms", unpack_metrics.patch_time, &ping_event);
+  AppendTimeAttribute("install_time_ms", unpack_metrics.install_time,
+                      &ping_event);
   StringAppendF(&ping_event, "/>");
   return ping_event;
 }
 
+// Appends the attribute |name| with the value of |time| in milliseconds to
+// |event|, unless |time| is zero.
+void PingSender::AppendTimeAttribute(const char* name,
+                                     const base::TimeDelta& time,
+                                     std::string* event) {
+  if (time == base::TimeDelta())
+    return;
+  base::StringAppendF(event, " %s=\"%s\"", name,
+                      base::Int64ToString(time.InMilliseconds()).c_str());
+}
+
 PingManager::PingManager(
     const GURL& ping_url,
     net::URLRequestContextGetter* url_request_context_getter)
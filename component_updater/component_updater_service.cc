@@ -16,6 +16,7 @@
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/weak_ptr.h"
+#include "base/metrics/histogram.h"
 #include "base/sequenced_task_runner.h"
 #include "base/stl_util.h"
 #include "base/threading/sequenced_worker_pool.h"
@@ -64,6 +65,18 @@ void AppendDownloadMetrics(
   destination->insert(destination->end(), source.begin(), source.end());
 }
 
+// Records the step timings of a successful unpacking.
+void RecordUnpackMetrics(const ComponentUnpacker::Metrics& metrics) {
+  UMA_HISTOGRAM_MEDIUM_TIMES("ComponentUpdater.UnpackVerifyTime",
+                             metrics.verify_time);
+  UMA_HISTOGRAM_MEDIUM_TIMES("ComponentUpdater.UnpackUnzipTime",
+                             metrics.unzip_time);
+  UMA_HISTOGRAM_MEDIUM_TIMES("ComponentUpdater.UnpackPatchTime",
+                             metrics.patch_time);
+  UMA_HISTOGRAM_MEDIUM_TIMES("ComponentUpdater.UnpackInstallTime",
+                             metrics.install_time);
+}
+
 }  // namespace
 
 CrxUpdateItem::CrxUpdateItem()
@@ -232,7 +245,8 @@ class CrxUpdateService : public ComponentUpdateService {
 
   void DoneInstalling(const std::string& component_id,
                       ComponentUnpacker::Error error,
-                      int extended_error);
+                      int extended_error,
+                      const ComponentUnpacker::Metrics& metrics);
 
   void ChangeItemState(CrxUpdateItem* item, CrxUpdateItem::Status to);
 
@@ -630,6 +644,7 @@ bool CrxUpdateService::CheckForUpdates() {
     item->diff_error_code = 0;
     item->diff_extra_code1 = 0;
     item->download_metrics.clear();
+    item->unpack_metrics = ComponentUnpacker::Metrics();
 
     items_to_check.push_back(item);
   }
@@ -874,7 +889,7 @@ void CrxUpdateService::EndUnpacking(const std::string& component_id,
       BrowserThread::UI,
       FROM_HERE,
       base::Bind(&CrxUpdateService::DoneInstalling, base::Unretained(this),
-                 component_id, error, extended_error),
+                 component_id, error, extended_error, unpacker_->metrics()),
       base::TimeDelta::FromMilliseconds(config_->StepDelay()));
   // Reset the unpacker last, otherwise we free our own arguments.
   unpacker_ = NULL;
@@ -883,9 +898,11 @@ void CrxUpdateService::EndUnpacking(const std::string& component_id,
 // Installation has been completed. Adjust the component status and
 // schedule the next check. Schedule a short delay before trying the full
 // update when the differential update failed.
-void CrxUpdateService::DoneInstalling(const std::string& component_id,
-                                      ComponentUnpacker::Error error,
-                                      int extra_code) {
+void CrxUpdateService::DoneInstalling(
+    const std::string& component_id,
+    ComponentUnpacker::Error error,
+    int extra_code,
+    const ComponentUnpacker::Metrics& metrics) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
 
   ErrorCategory error_category = kErrorNone;
@@ -903,6 +920,9 @@ void CrxUpdateService::DoneInstalling(const std::string& component_id,
   const bool is_success = error == ComponentUnpacker::kNone;
 
   CrxUpdateItem* item = FindUpdateItemById(component_id);
+  item->unpack_metrics = metrics;
+  if (is_success)
+    RecordUnpackMetrics(metrics);
   if (item->status == CrxUpdateItem::kUpdatingDiff && !is_success) {
     item->diff_error_category = error_category;
     item->diff_error_code = error;
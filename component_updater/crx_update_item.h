@@ -12,6 +12,7 @@
 #include "base/memory/weak_ptr.h"
 #include "base/time/time.h"
 #include "base/version.h"
+#include "chrome/browser/component_updater/component_unpacker.h"
 #include "chrome/browser/component_updater/component_updater_service.h"
 #include "chrome/browser/component_updater/crx_downloader.h"
 
@@ -110,6 +111,10 @@ struct CrxUpdateItem {
 
   std::vector<CrxDownloader::DownloadMetrics> download_metrics;
 
+  // The step timings of the last unpacking of the current update cycle. This
+  // is the full update if the differential update failed.
+  ComponentUnpacker::Metrics unpack_metrics;
+
   std::vector<base::WeakPtr<CUResourceThrottle> > throttles;
 
   CrxUpdateItem();
@@ -7,9 +7,12 @@
 #include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/files/scoped_temp_dir.h"
+#include "base/json/json_file_value_serializer.h"
 #include "base/message_loop/message_loop.h"
 #include "base/path_service.h"
 #include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "base/values.h"
 #include "chrome/browser/component_updater/component_patcher.h"
 #include "chrome/browser/component_updater/component_patcher_operation.h"
@@ -61,6 +64,40 @@ base::FilePath test_file(const char* file) {
   return path.AppendASCII("components").AppendASCII(file);
 }
 
+// Writes a commands.json file into |input_dir| with |count| 'create'
+// operations of copies of binary_output.bin. The operation at |bad_index|, if
+// any, expects the wrong hash.
+void WriteCreateCommands(const base::FilePath& input_dir,
+                         size_t count,
+                         size_t bad_index) {
+  base::ListValue commands;
+  for (size_t i = 0; i < count; ++i) {
+    const std::string name = base::StringPrintf("output%d.bin",
+                                                static_cast<int>(i));
+    EXPECT_TRUE(base::CopyFile(test_file("binary_output.bin"),
+                               input_dir.AppendASCII(name)));
+    base::DictionaryValue* command = new base::DictionaryValue();
+    command->SetString("output", name);
+    command->SetString("sha256", i == bad_index ?
+        std::string(64, '0') : std::string(binary_output_hash));
+    command->SetString("op", "create");
+    command->SetString("patch", name);
+    commands.Append(command);
+  }
+  JSONFileValueSerializer serializer(
+      input_dir.Append(FILE_PATH_LITERAL("commands.json")));
+  EXPECT_TRUE(serializer.Serialize(commands));
+}
+
+// Runs the tasks of the current thread and of the blocking pool until
+// |callback| is called.
+void RunUntilCalled(TestCallback* callback) {
+  while (!callback->called_) {
+    base::RunLoop().RunUntilIdle();
+    content::BrowserThread::GetBlockingPool()->FlushForTesting();
+  }
+}
+
 }  // namespace
 
 ComponentPatcherOperationTest::ComponentPatcherOperationTest() {
@@ -208,4 +245,47 @@ TEST_F(ComponentPatcherOperationTest, CheckBsdiffOperation) {
       test_file("binary_output.bin")));
 }
 
+// Verify that more operations than run in parallel all complete.
+TEST_F(ComponentPatcherOperationTest, CheckParallelOperations) {
+  const size_t kOperationCount = 2 * ComponentPatcher::kMaxParallelOperations;
+  WriteCreateCommands(input_dir_.path(), kOperationCount, kOperationCount);
+
+  TestCallback callback;
+  scoped_refptr<ComponentPatcher> patcher =
+      new ComponentPatcher(input_dir_.path(),
+                           unpack_dir_.path(),
+                           installer_.get(),
+                           true,
+                           task_runner_);
+  patcher->Start(base::Bind(&TestCallback::Set, base::Unretained(&callback)));
+  RunUntilCalled(&callback);
+
+  EXPECT_EQ(ComponentUnpacker::kNone, callback.error_);
+  EXPECT_EQ(0, callback.extra_code_);
+  for (size_t i = 0; i < kOperationCount; ++i) {
+    EXPECT_TRUE(base::ContentsEqual(
+        unpack_dir_.path().AppendASCII(
+            base::StringPrintf("output%d.bin", static_cast<int>(i))),
+        test_file("binary_output.bin")));
+  }
+}
+
+// Verify that a failed operation fails the whole patch.
+TEST_F(ComponentPatcherOperationTest, CheckParallelOperationFailure) {
+  const size_t kOperationCount = 2 * ComponentPatcher::kMaxParallelOperations;
+  WriteCreateCommands(input_dir_.path(), kOperationCount, 1);
+
+  TestCallback callback;
+  scoped_refptr<ComponentPatcher> patcher =
+      new ComponentPatcher(input_dir_.path(),
+                           unpack_dir_.path(),
+                           installer_.get(),
+                           true,
+                           task_runner_);
+  patcher->Start(base::Bind(&TestCallback::Set, base::Unretained(&callback)));
+  RunUntilCalled(&callback);
+
+  EXPECT_EQ(ComponentUnpacker::kDeltaVerificationFailure, callback.error_);
+}
+
 }  // namespace component_updater
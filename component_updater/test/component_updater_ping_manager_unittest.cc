@@ -172,6 +172,27 @@ TEST_F(ComponentUpdaterPingManagerTest, DISABLED_PingManagerTest) {
       "download_time_ms=\"9870\"/></app>"))
       << interceptor->GetRequestsAsString();
   interceptor->Reset();
+
+  // Test the unpack metrics. The steps which didn't run aren't reported.
+  item = CrxUpdateItem();
+  item.id = "abc";
+  item.status = CrxUpdateItem::kUpdated;
+  item.previous_version = base::Version("1.0");
+  item.next_version = base::Version("2.0");
+  item.unpack_metrics.verify_time = base::TimeDelta::FromMilliseconds(12);
+  item.unpack_metrics.unzip_time = base::TimeDelta::FromMilliseconds(34);
+  item.unpack_metrics.install_time = base::TimeDelta::FromMilliseconds(56);
+
+  ping_manager_->OnUpdateComplete(&item);
+  base::RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(1, interceptor->GetCount()) << interceptor->GetRequestsAsString();
+  EXPECT_NE(string::npos, interceptor->GetRequests()[0].find(
+      "<app appid=\"abc\" version=\"1.0\" nextversion=\"2.0\">"
+      "<event eventtype=\"3\" eventresult=\"1\" verify_time_ms=\"12\" "
+      "unzip_time_ms=\"34\" install_time_ms=\"56\"/></app>"))
+      << interceptor->GetRequestsAsString();
+  interceptor->Reset();
 }
 
 }  // namespace component_updater
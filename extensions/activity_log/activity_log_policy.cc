@@ -16,6 +16,7 @@
 #include "chrome/browser/profiles/profile.h"
 #include "content/public/browser/browser_thread.h"
 #include "extensions/common/extension.h"
+#include "sql/statement.h"
 #include "url/gurl.h"
 
 using content::BrowserThread;
@@ -27,6 +28,10 @@ namespace {
 // found.
 const char* kObsoleteTables[] = {"activitylog_apis", "activitylog_blocked",
                                  "activitylog_urls"};
+
+// Delay between cleaning passes (to delete old action records) through the
+// database.
+const int kCleaningDelayInHours = 12;
 }  // namespace
 
 namespace extensions {
@@ -70,6 +75,34 @@ sql::Connection* ActivityLogDatabasePolicy::GetDatabaseConnection() const {
   return db_->GetSqlConnection();
 }
 
+bool ActivityLogDatabasePolicy::ShouldCleanDatabase() const {
+  if (retention_time_ == base::TimeDelta())
+    return false;
+  return last_database_cleaning_time_.is_null() ||
+         Now() - last_database_cleaning_time_ >
+             base::TimeDelta::FromHours(kCleaningDelayInHours);
+}
+
+bool ActivityLogDatabasePolicy::CleanOlderThanRetentionTime(
+    sql::Connection* db,
+    const std::string& table_name,
+    bool* rows_deleted) {
+  *rows_deleted = false;
+  if (retention_time_ == base::TimeDelta())
+    return true;
+
+  base::Time cutoff = (Now() - retention_time_).LocalMidnight();
+  std::string clean_statement =
+      "DELETE FROM " + table_name + " WHERE time < ?";
+  sql::Statement cleaner(db->GetUniqueStatement(clean_statement.c_str()));
+  cleaner.BindInt64(0, cutoff.ToInternalValue());
+  if (!cleaner.Run())
+    return false;
+  *rows_deleted = db->GetLastChangeCount() > 0;
+  last_database_cleaning_time_ = Now();
+  return true;
+}
+
 // static
 std::string ActivityLogPolicy::Util::Serialize(const base::Value* value) {
   std::string value_as_text;
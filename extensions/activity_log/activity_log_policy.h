@@ -190,6 +190,13 @@ class ActivityLogDatabasePolicy : public ActivityLogPolicy,
   // Deletes everything in the database.
   virtual void DeleteDatabase() = 0;
 
+  // Gets or sets the amount of time that old records are kept in the database.
+  // A zero retention time, the default, keeps records forever.
+  const base::TimeDelta& retention_time() const { return retention_time_; }
+  void set_retention_time(const base::TimeDelta& delta) {
+    retention_time_ = delta;
+  }
+
  protected:
   // The Schedule methods dispatch the calls to the database on a
   // separate thread.
@@ -226,11 +233,35 @@ class ActivityLogDatabasePolicy : public ActivityLogPolicy,
   // valid.
   sql::Connection* GetDatabaseConnection() const;
 
+  // Returns true if a database flush should also clean out old records.  This
+  // is done much less frequently than flushes since it is expensive, but
+  // always on the first flush (since there might be a large amount of data to
+  // clear).  Returns false if records are kept forever.
+  bool ShouldCleanDatabase() const;
+
+  // Deletes the rows of |table_name| older than the retention time, rounded
+  // down to midnight, and records the time of the cleaning.  Sets
+  // |*rows_deleted| to whether any row was deleted.  This must only run on the
+  // database thread.  Returns false on database error.
+  bool CleanOlderThanRetentionTime(sql::Connection* db,
+                                   const std::string& table_name,
+                                   bool* rows_deleted);
+
+  // The time at which old activity log records were last cleaned out of the
+  // database (only tracked for this browser session).
+  base::Time last_database_cleaning_time_;
+
  private:
   // See the comments for the ActivityDatabase class for a discussion of how
   // database cleanup runs.
   ActivityDatabase* db_;
   base::FilePath database_path_;
+
+  // The amount of time old activity log records should be kept in the
+  // database, or zero to keep them forever.  This time is subtracted from the
+  // current time, rounded down to midnight, and rows older than this are
+  // deleted from the database when cleaning runs.
+  base::TimeDelta retention_time_;
 };
 
 }  // namespace extensions
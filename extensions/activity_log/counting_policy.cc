@@ -48,10 +48,6 @@ namespace {
 
 using extensions::Action;
 
-// Delay between cleaning passes (to delete old action records) through the
-// database.
-const int kCleaningDelayInHours = 12;
-
 // We should log the arguments to these API calls.  Be careful when
 // constructing this whitelist to not keep arguments that might compromise
 // privacy by logging too much data to the activity log.
@@ -127,7 +123,11 @@ static const char kPolicyMiscSetup[] =
     // the one in the right time range).
     "CREATE INDEX IF NOT EXISTS activitylog_compressed_index\n"
     "ON activitylog_compressed(extension_id_x, action_type, api_name_x,\n"
-    "    args_x, page_url_x, page_title_x, arg_url_x, other_x)";
+    "    args_x, page_url_x, page_title_x, arg_url_x, other_x);\n"
+    // An index on time, so that expiring old rows only visits the rows being
+    // dropped instead of scanning the whole table.
+    "CREATE INDEX IF NOT EXISTS activitylog_compressed_time_index\n"
+    "ON activitylog_compressed(time)";
 
 // SQL statements to clean old, unused entries out of the string and URL id
 // tables.
@@ -162,8 +162,8 @@ CountingPolicy::CountingPolicy(Profile* profile)
           profile,
           base::FilePath(chrome::kExtensionActivityLogFilename)),
       string_table_("string_ids"),
-      url_table_("url_ids"),
-      retention_time_(base::TimeDelta::FromHours(60)) {
+      url_table_("url_ids") {
+  set_retention_time(base::TimeDelta::FromHours(60));
   for (size_t i = 0; i < arraysize(kAlwaysLog); i++) {
     api_arg_whitelist_.insert(
         std::make_pair(kAlwaysLog[i].type, kAlwaysLog[i].name));
@@ -236,13 +236,8 @@ bool CountingPolicy::FlushDatabase(sql::Connection* db) {
   ActionQueue queue;
   queue.swap(queued_actions_);
 
-  // Whether to clean old records out of the activity log database.  Do this
-  // much less frequently than database flushes since it is expensive, but
-  // always check on the first database flush (since there might be a large
-  // amount of data to clear).
-  bool clean_database = (last_database_cleaning_time_.is_null() ||
-                         Now() - last_database_cleaning_time_ >
-                             base::TimeDelta::FromHours(kCleaningDelayInHours));
+  // Whether to clean old records out of the activity log database.
+  bool clean_database = ShouldCleanDatabase();
 
   if (queue.empty() && !clean_database)
     return true;
@@ -403,12 +398,8 @@ bool CountingPolicy::FlushDatabase(sql::Connection* db) {
     }
   }
 
-  if (clean_database) {
-    base::Time cutoff = (Now() - retention_time()).LocalMidnight();
-    if (!CleanOlderThan(db, cutoff))
-      return false;
-    last_database_cleaning_time_ = Now();
-  }
+  if (clean_database && !CleanOldRecords(db))
+    return false;
 
   if (!transaction.Commit())
     return false;
@@ -760,15 +751,14 @@ void CountingPolicy::OnDatabaseClose() {
 }
 
 // Cleans old records from the activity log database.
-bool CountingPolicy::CleanOlderThan(sql::Connection* db,
-                                    const base::Time& cutoff) {
-  std::string clean_statement =
-      "DELETE FROM " + std::string(kTableName) + " WHERE time < ?";
-  sql::Statement cleaner(db->GetCachedStatement(sql::StatementID(SQL_FROM_HERE),
-                                                clean_statement.c_str()));
-  cleaner.BindInt64(0, cutoff.ToInternalValue());
-  if (!cleaner.Run())
+bool CountingPolicy::CleanOldRecords(sql::Connection* db) {
+  bool rows_deleted = false;
+  if (!CleanOlderThanRetentionTime(db, kTableName, &rows_deleted))
     return false;
+  // The string table cleanup scans the whole log table, so skip it if no rows
+  // expired (the common case when cleaning runs several times per day).
+  if (!rows_deleted)
+    return true;
   return CleanStringTables(db);
 }
 
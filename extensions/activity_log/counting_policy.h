@@ -39,12 +39,6 @@ class CountingPolicy : public ActivityLogDatabasePolicy {
 
   virtual void Close() OVERRIDE;
 
-  // Gets or sets the amount of time that old records are kept in the database.
-  const base::TimeDelta& retention_time() const { return retention_time_; }
-  void set_retention_time(const base::TimeDelta& delta) {
-    retention_time_ = delta;
-  }
-
   // Remove actions (rows) which IDs are specified in the action_ids array.
   virtual void RemoveActions(const std::vector<int64>& action_ids) OVERRIDE;
 
@@ -109,8 +103,9 @@ class CountingPolicy : public ActivityLogDatabasePolicy {
   // The implementation of DeleteDatabase; called on the database thread.
   void DoDeleteDatabase();
 
-  // Cleans old records from the activity log database.
-  bool CleanOlderThan(sql::Connection* db, const base::Time& cutoff);
+  // Cleans records older than the retention time from the activity log
+  // database, and the strings they used.
+  bool CleanOldRecords(sql::Connection* db);
 
   // Cleans unused interned strings from the database.  This should be run
   // after deleting rows from the main log table to clean out stale values.
@@ -135,17 +130,6 @@ class CountingPolicy : public ActivityLogDatabasePolicy {
   // actions in queued_actions_.
   base::Time queued_actions_date_;
 
-  // The amount of time old activity log records should be kept in the
-  // database.  This time is subtracted from the current time, rounded down to
-  // midnight, and rows older than this are deleted from the database when
-  // cleaning runs.
-  base::TimeDelta retention_time_;
-
-  // The time at which old activity log records were last cleaned out of the
-  // database (only tracked for this browser session).  Old records are deleted
-  // on the first database flush, and then every 12 hours subsequently.
-  base::Time last_database_cleaning_time_;
-
   friend class CountingPolicyTest;
   FRIEND_TEST_ALL_PREFIXES(CountingPolicyTest, EarlyFlush);
   FRIEND_TEST_ALL_PREFIXES(CountingPolicyTest, MergingAndExpiring);
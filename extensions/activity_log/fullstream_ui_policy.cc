@@ -45,6 +45,16 @@ const char* FullStreamUIPolicy::kTableFieldTypes[] = {
 const int FullStreamUIPolicy::kTableFieldCount =
     arraysize(FullStreamUIPolicy::kTableContentFields);
 
+namespace {
+
+// Index on the time column, so that expiring old records and reading recent
+// ones are range scans rather than scans over the whole table.
+const char kTimeIndexSetup[] =
+    "CREATE INDEX IF NOT EXISTS activitylog_full_time_index\n"
+    "ON activitylog_full(time)";
+
+}  // namespace
+
 FullStreamUIPolicy::FullStreamUIPolicy(Profile* profile)
     : ActivityLogDatabasePolicy(
           profile,
@@ -57,15 +67,22 @@ bool FullStreamUIPolicy::InitDatabase(sql::Connection* db) {
     return false;
 
   // Create the unified activity log entry table.
-  return ActivityDatabase::InitializeTable(db,
-                                           kTableName,
-                                           kTableContentFields,
-                                           kTableFieldTypes,
-                                           arraysize(kTableContentFields));
+  if (!ActivityDatabase::InitializeTable(db,
+                                         kTableName,
+                                         kTableContentFields,
+                                         kTableFieldTypes,
+                                         arraysize(kTableContentFields)))
+    return false;
+
+  return db->Execute(kTimeIndexSetup);
 }
 
 bool FullStreamUIPolicy::FlushDatabase(sql::Connection* db) {
-  if (queued_actions_.empty())
+  // Whether to clean old records out of the activity log database.  The full
+  // stream is kept forever unless a retention time was set.
+  bool clean_database = ShouldCleanDatabase();
+
+  if (queued_actions_.empty() && !clean_database)
     return true;
 
   sql::Transaction transaction(db);
@@ -111,6 +128,14 @@ bool FullStreamUIPolicy::FlushDatabase(sql::Connection* db) {
     }
   }
 
+  // Expired records are located through the time index, so the cost of a
+  // cleaning pass is proportional to the amount of data dropped rather than to
+  // the size of the table.
+  bool rows_deleted = false;
+  if (clean_database &&
+      !CleanOlderThanRetentionTime(db, kTableName, &rows_deleted))
+    return false;
+
   if (!transaction.Commit())
     return false;
 
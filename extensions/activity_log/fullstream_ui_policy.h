@@ -110,6 +110,8 @@ class FullStreamUIPolicy : public ActivityLogDatabasePolicy {
       const std::string& page_url,
       const std::string& arg_url,
       const int days_ago);
+
+  FRIEND_TEST_ALL_PREFIXES(FullStreamUIPolicyTest, Expiring);
 };
 
 }  // namespace extensions
@@ -178,6 +178,11 @@ class FullStreamUIPolicyTest : public testing::Test {
                 "[\"woof\"]", "", "", "");
   }
 
+  static void CheckActionCount(int count,
+                               scoped_ptr<Action::ActionVector> actions) {
+    ASSERT_EQ(count, static_cast<int>(actions->size()));
+  }
+
   static void AllURLsRemoved(scoped_ptr<Action::ActionVector> actions) {
     ASSERT_EQ(2, static_cast<int>(actions->size()));
     CheckAction(*actions->at(0), "punky", Action::ACTION_API_CALL, "lets",
@@ -671,6 +676,98 @@ TEST_F(FullStreamUIPolicyTest, GetOlderActions) {
   policy->Close();
 }
 
+// Check that records older than the retention time are dropped when cleaning
+// runs.
+TEST_F(FullStreamUIPolicyTest, Expiring) {
+  FullStreamUIPolicy* policy = new FullStreamUIPolicy(profile_.get());
+  policy->Init();
+  // Initially disable expiration by setting a retention time before any
+  // actions we generate.
+  policy->set_retention_time(base::TimeDelta::FromDays(14));
+
+  base::SimpleTestClock* mock_clock = new base::SimpleTestClock();
+  mock_clock->SetNow(base::Time::Now().LocalMidnight() +
+                     base::TimeDelta::FromHours(12));
+  policy->SetClockForTesting(scoped_ptr<base::Clock>(mock_clock));
+
+  scoped_refptr<Action> action =
+      new Action("punky",
+                 mock_clock->Now() - base::TimeDelta::FromDays(7),
+                 Action::ACTION_API_CALL,
+                 "brewster");
+  policy->ProcessAction(action);
+
+  action = new Action("punky",
+                      mock_clock->Now() - base::TimeDelta::FromDays(1),
+                      Action::ACTION_API_CALL,
+                      "brewster");
+  policy->ProcessAction(action);
+
+  CheckReadData(policy,
+                "punky",
+                -1,
+                base::Bind(&FullStreamUIPolicyTest::CheckActionCount, 2));
+
+  // Clean actions before midnight two days ago.  Force expiration to run by
+  // clearing last_database_cleaning_time_ and submitting a new action.
+  policy->set_retention_time(base::TimeDelta::FromDays(2));
+  policy->last_database_cleaning_time_ = base::Time();
+  action = new Action("punky",
+                      mock_clock->Now(),
+                      Action::ACTION_API_CALL,
+                      "brewster");
+  policy->ProcessAction(action);
+
+  CheckReadData(policy,
+                "punky",
+                -1,
+                base::Bind(&FullStreamUIPolicyTest::CheckActionCount, 2));
+  CheckReadData(policy,
+                "punky",
+                7,
+                base::Bind(&FullStreamUIPolicyTest::CheckActionCount, 0));
+
+  policy->Close();
+}
+
+// Check that records are kept forever unless a retention time is set.
+TEST_F(FullStreamUIPolicyTest, NoExpiringByDefault) {
+  FullStreamUIPolicy* policy = new FullStreamUIPolicy(profile_.get());
+  policy->Init();
+  EXPECT_EQ(base::TimeDelta(), policy->retention_time());
+
+  base::SimpleTestClock* mock_clock = new base::SimpleTestClock();
+  mock_clock->SetNow(base::Time::Now().LocalMidnight() +
+                     base::TimeDelta::FromHours(12));
+  policy->SetClockForTesting(scoped_ptr<base::Clock>(mock_clock));
+
+  scoped_refptr<Action> action =
+      new Action("punky",
+                 mock_clock->Now() - base::TimeDelta::FromDays(400),
+                 Action::ACTION_API_CALL,
+                 "brewster");
+  policy->ProcessAction(action);
+
+  // The first flush of the session would clean old records if a retention
+  // time were set.
+  action = new Action("punky",
+                      mock_clock->Now(),
+                      Action::ACTION_API_CALL,
+                      "brewster");
+  policy->ProcessAction(action);
+
+  CheckReadData(policy,
+                "punky",
+                -1,
+                base::Bind(&FullStreamUIPolicyTest::CheckActionCount, 2));
+  CheckReadData(policy,
+                "punky",
+                400,
+                base::Bind(&FullStreamUIPolicyTest::CheckActionCount, 1));
+
+  policy->Close();
+}
+
 TEST_F(FullStreamUIPolicyTest, RemoveAllURLs) {
   ActivityLogDatabasePolicy* policy = new FullStreamUIPolicy(profile_.get());
   policy->Init();
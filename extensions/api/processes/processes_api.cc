@@ -36,6 +36,7 @@
 #include "extensions/browser/extension_function_util.h"
 #include "extensions/browser/extension_system.h"
 #include "extensions/common/error_utils.h"
+#include "grit/generated_resources.h"
 
 namespace extensions {
 
@@ -248,6 +249,8 @@ void ProcessesEventRouter::ListenerAdded() {
   // The task manager has its own ref count to balance other callers of
   // StartUpdating/StopUpdating.
   model_->StartUpdating();
+  // Listeners of onUpdatedWithMemory need private memory to be sampled.
+  model_->StartGatheringColumn(IDS_TASK_MANAGER_PRIVATE_MEM_COLUMN);
 #endif  // defined(ENABLE_TASK_MANAGER)
   ++listeners_;
 }
@@ -258,6 +261,7 @@ void ProcessesEventRouter::ListenerRemoved() {
 #if defined(ENABLE_TASK_MANAGER)
   // The task manager has its own ref count to balance other callers of
   // StartUpdating/StopUpdating.
+  model_->StopGatheringColumn(IDS_TASK_MANAGER_PRIVATE_MEM_COLUMN);
   model_->StopUpdating();
 #endif  // defined(ENABLE_TASK_MANAGER)
 }
@@ -322,7 +326,7 @@ void ProcessesEventRouter::OnItemsAdded(int start, int length) {
 #endif  // defined(ENABLE_TASK_MANAGER)
 }
 
-void ProcessesEventRouter::OnItemsChanged(int start, int length) {
+void ProcessesEventRouter::OnItemsRefreshed() {
 #if defined(ENABLE_TASK_MANAGER)
   // If we don't have any listeners, return immediately.
   if (listeners_ == 0)
@@ -340,8 +344,10 @@ void ProcessesEventRouter::OnItemsChanged(int start, int length) {
 
   DCHECK(updated || updated_memory);
 
+  // The model only reports the rows which changed in OnItemsChanged, while
+  // listeners expect every process in each update.
   IDMap<base::DictionaryValue> processes_map;
-  for (int i = start; i < start + length; i++) {
+  for (int i = 0; i < model_->ResourceCount(); i++) {
     if (model_->IsResourceFirstInGroup(i)) {
       int id = model_->GetUniqueChildProcessId(i);
       base::DictionaryValue* process = CreateProcessFromModel(id, model_, i,
@@ -700,6 +706,15 @@ bool GetProcessInfoFunction::RunImpl() {
   // around and allow for the callback to be invoked.
   AddRef();
 
+  // Private memory is only sampled while its column is gathered, so gather it
+  // and keep the model updating until a sample including it is published.
+  // Balanced in GatherProcessInfo.
+  if (memory_) {
+    TaskManagerModel* model = TaskManager::GetInstance()->model();
+    model->StartGatheringColumn(IDS_TASK_MANAGER_PRIVATE_MEM_COLUMN);
+    model->StartUpdating();
+  }
+
   // If the task manager is already listening, just post a task to execute
   // which will invoke the callback once we have returned from this function.
   // Otherwise, wait for the notification that the task manager is done with
@@ -708,10 +723,10 @@ bool GetProcessInfoFunction::RunImpl() {
           ->processes_event_router()
           ->is_task_manager_listening()) {
     base::MessageLoop::current()->PostTask(FROM_HERE, base::Bind(
-        &GetProcessInfoFunction::GatherProcessInfo, this));
+        &GetProcessInfoFunction::OnTaskManagerReady, this));
   } else {
     TaskManager::GetInstance()->model()->RegisterOnDataReadyCallback(
-        base::Bind(&GetProcessInfoFunction::GatherProcessInfo, this));
+        base::Bind(&GetProcessInfoFunction::OnTaskManagerReady, this));
 
     ProcessesAPI::Get(GetProfile())
         ->processes_event_router()
@@ -725,6 +740,17 @@ bool GetProcessInfoFunction::RunImpl() {
 #endif  // defined(ENABLE_TASK_MANAGER)
 }
 
+void GetProcessInfoFunction::OnTaskManagerReady() {
+#if defined(ENABLE_TASK_MANAGER)
+  if (memory_) {
+    TaskManager::GetInstance()->model()->RegisterOnSampledCallback(
+        base::Bind(&GetProcessInfoFunction::GatherProcessInfo, this));
+    return;
+  }
+  GatherProcessInfo();
+#endif  // defined(ENABLE_TASK_MANAGER)
+}
+
 void GetProcessInfoFunction::GatherProcessInfo() {
 #if defined(ENABLE_TASK_MANAGER)
   TaskManagerModel* model = TaskManager::GetInstance()->model();
@@ -769,6 +795,11 @@ void GetProcessInfoFunction::GatherProcessInfo() {
   SetResult(processes);
   SendResponse(true);
 
+  if (memory_) {
+    model->StopGatheringColumn(IDS_TASK_MANAGER_PRIVATE_MEM_COLUMN);
+    model->StopUpdating();
+  }
+
   // Balance the AddRef in the RunImpl.
   Release();
 #endif  // defined(ENABLE_TASK_MANAGER)
@@ -58,9 +58,10 @@ class ProcessesEventRouter : public TaskManagerModelObserver,
   // TaskManagerModelObserver methods.
   virtual void OnItemsAdded(int start, int length) OVERRIDE;
   virtual void OnModelChanged() OVERRIDE {}
-  virtual void OnItemsChanged(int start, int length) OVERRIDE;
+  virtual void OnItemsChanged(int start, int length) OVERRIDE {}
   virtual void OnItemsRemoved(int start, int length) OVERRIDE {}
   virtual void OnItemsToBeRemoved(int start, int length) OVERRIDE;
+  virtual void OnItemsRefreshed() OVERRIDE;
 
   // Internal helpers for processing notifications.
   void ProcessHangEvent(content::RenderWidgetHost* widget);
@@ -183,6 +184,10 @@ class GetProcessInfoFunction : public ChromeAsyncExtensionFunction {
   virtual ~GetProcessInfoFunction();
   virtual bool RunImpl() OVERRIDE;
 
+  // Called once the task manager has enumerated the processes. Waits for a
+  // sample including private memory if |memory_| is set.
+  void OnTaskManagerReady();
+
   void GatherProcessInfo();
 
   // Member variables to store the function parameters
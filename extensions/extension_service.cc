@@ -16,6 +16,7 @@
 #include "base/logging.h"
 #include "base/metrics/histogram.h"
 #include "base/prefs/pref_service.h"
+#include "base/run_loop.h"
 #include "base/stl_util.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
@@ -453,70 +454,75 @@ void ExtensionService::Init() {
     // extension listens to onStartup and opens a window).
     SetReadyAndNotifyListeners();
   } else {
-    // LoadAllExtensions() calls OnLoadedInstalledExtensions().
+    // LoadAllExtensions() calls OnLoadedInstalledExtensions(), and then
+    // FinishInit(), once all installed extensions are added. Extensions whose
+    // manifest is reloaded from disk are only added after it returns.
     component_loader_->LoadAll();
-    extensions::InstalledLoader(this).LoadAllExtensions();
-
-    ReconcileKnownDisabled();
-
-    // Attempt to re-enable extensions whose only disable reason is reloading.
-    std::vector<std::string> extensions_to_enable;
-    const ExtensionSet& disabled_extensions = registry_->disabled_extensions();
-    for (ExtensionSet::const_iterator iter = disabled_extensions.begin();
-        iter != disabled_extensions.end(); ++iter) {
-      const Extension* e = iter->get();
-      if (extension_prefs_->GetDisableReasons(e->id()) ==
-          Extension::DISABLE_RELOAD) {
-        extensions_to_enable.push_back(e->id());
-      }
-    }
-    for (std::vector<std::string>::iterator it = extensions_to_enable.begin();
-         it != extensions_to_enable.end(); ++it) {
-      EnableExtension(*it);
-    }
+    extensions::InstalledLoader(this).LoadAllExtensions(
+        base::Bind(&ExtensionService::FinishInit, AsWeakPtr()));
+  }
 
-    // Finish install (if possible) of extensions that were still delayed while
-    // the browser was shut down.
-    scoped_ptr<extensions::ExtensionPrefs::ExtensionsInfo> delayed_info(
-        extension_prefs_->GetAllDelayedInstallInfo());
-    for (size_t i = 0; i < delayed_info->size(); ++i) {
-      ExtensionInfo* info = delayed_info->at(i).get();
-      scoped_refptr<const Extension> extension(NULL);
-      if (info->extension_manifest) {
-        std::string error;
-        extension = Extension::Create(
-            info->extension_path,
-            info->extension_location,
-            *info->extension_manifest,
-            extension_prefs_->GetDelayedInstallCreationFlags(
-                info->extension_id),
-            info->extension_id,
-            &error);
-        if (extension.get())
-          delayed_installs_.Insert(extension);
-      }
-    }
-    MaybeFinishDelayedInstallations();
+  UMA_HISTOGRAM_TIMES("Extensions.ExtensionServiceInitTime",
+                      base::Time::Now() - begin_time);
+}
 
-    scoped_ptr<extensions::ExtensionPrefs::ExtensionsInfo> delayed_info2(
-        extension_prefs_->GetAllDelayedInstallInfo());
-    UMA_HISTOGRAM_COUNTS_100("Extensions.UpdateOnLoad",
-                             delayed_info2->size() - delayed_info->size());
+void ExtensionService::FinishInit() {
+  ReconcileKnownDisabled();
 
-    SetReadyAndNotifyListeners();
+  // Attempt to re-enable extensions whose only disable reason is reloading.
+  std::vector<std::string> extensions_to_enable;
+  const ExtensionSet& disabled_extensions = registry_->disabled_extensions();
+  for (ExtensionSet::const_iterator iter = disabled_extensions.begin();
+      iter != disabled_extensions.end(); ++iter) {
+    const Extension* e = iter->get();
+    if (extension_prefs_->GetDisableReasons(e->id()) ==
+        Extension::DISABLE_RELOAD) {
+      extensions_to_enable.push_back(e->id());
+    }
+  }
+  for (std::vector<std::string>::iterator it = extensions_to_enable.begin();
+       it != extensions_to_enable.end(); ++it) {
+    EnableExtension(*it);
+  }
+
+  // Finish install (if possible) of extensions that were still delayed while
+  // the browser was shut down.
+  scoped_ptr<extensions::ExtensionPrefs::ExtensionsInfo> delayed_info(
+      extension_prefs_->GetAllDelayedInstallInfo());
+  for (size_t i = 0; i < delayed_info->size(); ++i) {
+    ExtensionInfo* info = delayed_info->at(i).get();
+    scoped_refptr<const Extension> extension(NULL);
+    if (info->extension_manifest) {
+      std::string error;
+      extension = Extension::Create(
+          info->extension_path,
+          info->extension_location,
+          *info->extension_manifest,
+          extension_prefs_->GetDelayedInstallCreationFlags(
+              info->extension_id),
+          info->extension_id,
+          &error);
+      if (extension.get())
+        delayed_installs_.Insert(extension);
+    }
+  }
+  MaybeFinishDelayedInstallations();
 
-    // TODO(erikkay) this should probably be deferred to a future point
-    // rather than running immediately at startup.
-    CheckForExternalUpdates();
+  scoped_ptr<extensions::ExtensionPrefs::ExtensionsInfo> delayed_info2(
+      extension_prefs_->GetAllDelayedInstallInfo());
+  UMA_HISTOGRAM_COUNTS_100("Extensions.UpdateOnLoad",
+                           delayed_info2->size() - delayed_info->size());
 
-    system_->management_policy()->RegisterProvider(
-        shared_module_policy_provider_.get());
+  SetReadyAndNotifyListeners();
 
-    LoadGreylistFromPrefs();
-  }
+  // TODO(erikkay) this should probably be deferred to a future point
+  // rather than running immediately at startup.
+  CheckForExternalUpdates();
 
-  UMA_HISTOGRAM_TIMES("Extensions.ExtensionServiceInitTime",
-                      base::Time::Now() - begin_time);
+  system_->management_policy()->RegisterProvider(
+      shared_module_policy_provider_.get());
+
+  LoadGreylistFromPrefs();
 }
 
 void ExtensionService::LoadGreylistFromPrefs() {
@@ -1448,7 +1454,11 @@ void ExtensionService::ReloadExtensionsForTest() {
   // warning about calling test code in production.
   UnloadAllExtensionsInternal();
   component_loader_->LoadAll();
-  extensions::InstalledLoader(this).LoadAllExtensions();
+  // Wait for the extensions whose manifest is reloaded from disk.
+  base::RunLoop run_loop;
+  extensions::InstalledLoader(this).LoadAllExtensions(
+      run_loop.QuitClosure());
+  run_loop.Run();
   // Don't call SetReadyAndNotifyListeners() since tests call this multiple
   // times.
 }
@@ -256,7 +256,8 @@ class ExtensionService
   // Unload all extensions. Does not send notifications.
   void UnloadAllExtensionsForTest();
 
-  // Reloads all extensions. Does not notify that extensions are ready.
+  // Reloads all extensions, and waits for those whose manifest is reloaded
+  // from disk. Does not notify that extensions are ready.
   void ReloadExtensionsForTest();
 
   // Called when the initial extensions load has completed.
@@ -483,6 +484,9 @@ class ExtensionService
   void RemoveUpdateObserver(extensions::UpdateObserver* observer);
 
  private:
+  // Finishes Init() once the installed extensions are loaded.
+  void FinishInit();
+
   // Populates greylist_.
   void LoadGreylistFromPrefs();
 
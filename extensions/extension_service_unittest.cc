@@ -11,6 +11,7 @@
 #include "base/at_exit.h"
 #include "base/basictypes.h"
 #include "base/bind.h"
+#include "base/bind_helpers.h"
 #include "base/command_line.h"
 #include "base/file_util.h"
 #include "base/files/file_enumerator.h"
@@ -2415,6 +2416,59 @@ TEST_F(ExtensionServiceTest, UnpackedExtensionCanChangeID) {
   // we should also test that preferences are preserved.
 }
 
+// Tests that the manifests of several unpacked extensions are all reloaded
+// from disk by InstalledLoader, and that a reload failure is reported.
+TEST_F(ExtensionServiceTest, ReloadUnpackedExtensionManifests) {
+  InitializeEmptyExtensionService();
+
+  const int kNumExtensions = 4;
+  base::ScopedTempDir temp;
+  ASSERT_TRUE(temp.CreateUniqueTempDir());
+  std::vector<base::FilePath> manifest_paths;
+  for (int i = 0; i < kNumExtensions; ++i) {
+    base::FilePath extension_path =
+        temp.path().AppendASCII("extension" + base::IntToString(i));
+    ASSERT_TRUE(base::CreateDirectory(extension_path));
+    base::FilePath manifest_path =
+        extension_path.Append(extensions::kManifestFilename);
+    std::string manifest = "{\"name\": \"Extension " + base::IntToString(i) +
+        "\", \"version\": \"1.0\", \"manifest_version\": 2}";
+    ASSERT_EQ(static_cast<int>(manifest.size()),
+              base::WriteFile(manifest_path, manifest.data(),
+                              manifest.size()));
+    manifest_paths.push_back(manifest_path);
+    extensions::UnpackedInstaller::Create(service_)->Load(extension_path);
+  }
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(0u, GetErrors().size());
+  ASSERT_EQ(static_cast<size_t>(kNumExtensions), loaded_.size());
+
+  // Rename all extensions but the last one, whose manifest is broken.
+  for (int i = 0; i < kNumExtensions; ++i) {
+    std::string manifest = "{\"name\": \"Renamed " + base::IntToString(i) +
+        "\", \"version\": \"1.0\", \"manifest_version\": 2}";
+    if (i == kNumExtensions - 1)
+      manifest = "{";
+    ASSERT_EQ(static_cast<int>(manifest.size()),
+              base::WriteFile(manifest_paths[i], manifest.data(),
+                              manifest.size()));
+  }
+  loaded_.clear();
+
+  service_->ReloadExtensionsForTest();
+  ASSERT_EQ(1u, GetErrors().size());
+  EXPECT_TRUE(MatchPattern(base::UTF16ToUTF8(GetErrors()[0]),
+      std::string("Could not load extension from '*'. ") +
+      extensions::manifest_errors::kManifestParseError + "*")) <<
+      base::UTF16ToUTF8(GetErrors()[0]);
+  ASSERT_EQ(static_cast<size_t>(kNumExtensions - 1), loaded_.size());
+  std::set<std::string> names;
+  for (size_t i = 0; i < loaded_.size(); ++i)
+    names.insert(loaded_[i]->name());
+  for (int i = 0; i < kNumExtensions - 1; ++i)
+    EXPECT_EQ(1u, names.count("Renamed " + base::IntToString(i)));
+}
+
 #if defined(OS_POSIX)
 TEST_F(ExtensionServiceTest, UnpackedExtensionMayContainSymlinkedFiles) {
   base::FilePath source_data_dir = data_dir_.
@@ -4757,7 +4811,8 @@ void ExtensionServiceTest::TestExternalProvider(
 
     // Should still be at 0.
     loaded_.clear();
-    extensions::InstalledLoader(service_).LoadAllExtensions();
+    extensions::InstalledLoader(service_).LoadAllExtensions(
+        base::Bind(&base::DoNothing));
     base::RunLoop().RunUntilIdle();
     ASSERT_EQ(0u, loaded_.size());
     ValidatePrefKeyCount(1);
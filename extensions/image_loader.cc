@@ -11,12 +11,14 @@
 #include "base/compiler_specific.h"
 #include "base/file_util.h"
 #include "base/lazy_instance.h"
+#include "base/metrics/histogram.h"
 #include "base/path_service.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/threading/sequenced_worker_pool.h"
 #include "chrome/browser/extensions/image_loader_factory.h"
 #include "chrome/common/chrome_paths.h"
 #include "content/public/browser/browser_thread.h"
+#include "extensions/browser/extension_registry.h"
 #include "extensions/common/extension.h"
 #include "grit/chrome_unscaled_resources.h"
 #include "grit/component_extension_resources_map.h"
@@ -191,6 +193,69 @@ ImageLoader::LoadResult::LoadResult(
 ImageLoader::LoadResult::~LoadResult() {
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// ImageLoader::CacheKey
+
+ImageLoader::CacheKey::CacheKey(const std::string& extension_id,
+                                const std::string& version,
+                                const ImageRepresentation& image_info)
+    : extension_id(extension_id),
+      version(version),
+      relative_path(image_info.resource.relative_path()),
+      resize_condition(image_info.resize_condition),
+      desired_size(image_info.desired_size) {
+}
+
+ImageLoader::CacheKey::~CacheKey() {
+}
+
+bool ImageLoader::CacheKey::operator<(const CacheKey& other) const {
+  if (extension_id != other.extension_id)
+    return extension_id < other.extension_id;
+  if (version != other.version)
+    return version < other.version;
+  if (relative_path != other.relative_path)
+    return relative_path < other.relative_path;
+  if (resize_condition != other.resize_condition)
+    return resize_condition < other.resize_condition;
+  if (desired_size.width() != other.desired_size.width())
+    return desired_size.width() < other.desired_size.width();
+  return desired_size.height() < other.desired_size.height();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ImageLoader::Request
+
+struct ImageLoader::Request {
+  Request(const std::vector<ImageRepresentation>& info_list,
+          const ReplyCallback& reply);
+  ~Request();
+
+  std::vector<ImageRepresentation> info_list;
+
+  // The cache key of each entry of |info_list|.
+  std::vector<CacheKey> keys;
+
+  // The images available so far.
+  ImageMap images;
+
+  // The number of images still being loaded.
+  int pending_count;
+
+  ReplyCallback reply;
+};
+
+ImageLoader::Request::Request(
+    const std::vector<ImageRepresentation>& info_list,
+    const ReplyCallback& reply)
+    : info_list(info_list),
+      pending_count(0),
+      reply(reply) {
+}
+
+ImageLoader::Request::~Request() {
+}
+
 namespace {
 
 // Need to be after ImageRepresentation and LoadResult are defined.
@@ -232,8 +297,26 @@ std::vector<ImageLoader::LoadResult> LoadImagesOnBlockingPool(
 ////////////////////////////////////////////////////////////////////////////////
 // ImageLoader
 
+// static
+const size_t ImageLoader::kMaxCacheBytes = 8 * 1024 * 1024;
+
 ImageLoader::ImageLoader()
-    : weak_ptr_factory_(this) {
+    : cache_(ImageCache::NO_AUTO_EVICT),
+      cache_bytes_(0),
+      cache_hit_count_(0),
+      cache_miss_count_(0),
+      registry_observer_(this),
+      weak_ptr_factory_(this) {
+}
+
+ImageLoader::ImageLoader(content::BrowserContext* context)
+    : cache_(ImageCache::NO_AUTO_EVICT),
+      cache_bytes_(0),
+      cache_hit_count_(0),
+      cache_miss_count_(0),
+      registry_observer_(this),
+      weak_ptr_factory_(this) {
+  registry_observer_.Add(ExtensionRegistry::Get(context));
 }
 
 ImageLoader::~ImageLoader() {
@@ -320,33 +403,183 @@ void ImageLoader::LoadImagesAsync(
     const Extension* extension,
     const std::vector<ImageRepresentation>& info_list,
     const ImageLoaderImageCallback& callback) {
-  DCHECK_CURRENTLY_ON(BrowserThread::UI);
-  DCHECK(!BrowserThread::GetBlockingPool()->RunsTasksOnCurrentThread());
-  base::PostTaskAndReplyWithResult(
-      BrowserThread::GetBlockingPool(),
-      FROM_HERE,
-      base::Bind(LoadImagesOnBlockingPool,
-                 info_list,
-                 LoadResourceBitmaps(extension, info_list)),
-      base::Bind(
-          &ImageLoader::ReplyBack, weak_ptr_factory_.GetWeakPtr(), callback));
+  LoadImages(extension, info_list,
+             base::Bind(&ImageLoader::ReplyBack,
+                        weak_ptr_factory_.GetWeakPtr(),
+                        callback));
 }
 
 void ImageLoader::LoadImageFamilyAsync(
     const extensions::Extension* extension,
     const std::vector<ImageRepresentation>& info_list,
     const ImageLoaderImageFamilyCallback& callback) {
+  LoadImages(extension, info_list,
+             base::Bind(&ImageLoader::ReplyBackWithImageFamily,
+                        weak_ptr_factory_.GetWeakPtr(),
+                        callback));
+}
+
+void ImageLoader::LoadImages(const Extension* extension,
+                             const std::vector<ImageRepresentation>& info_list,
+                             const ReplyCallback& reply) {
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
   DCHECK(!BrowserThread::GetBlockingPool()->RunsTasksOnCurrentThread());
-  base::PostTaskAndReplyWithResult(
-      BrowserThread::GetBlockingPool(),
-      FROM_HERE,
-      base::Bind(LoadImagesOnBlockingPool,
-                 info_list,
-                 LoadResourceBitmaps(extension, info_list)),
-      base::Bind(&ImageLoader::ReplyBackWithImageFamily,
-                 weak_ptr_factory_.GetWeakPtr(),
-                 callback));
+
+  linked_ptr<Request> request(new Request(info_list, reply));
+  std::vector<ImageRepresentation> load_list;
+  std::vector<CacheKey> load_keys;
+  for (size_t i = 0; i < info_list.size(); ++i) {
+    const CacheKey key(extension->id(), extension->VersionString(),
+                       info_list[i]);
+    request->keys.push_back(key);
+
+    // If we don't have a path there isn't anything we can do, just skip it.
+    if (info_list[i].resource.relative_path().empty())
+      continue;
+
+    ImageCache::iterator cached = cache_.Get(key);
+    RequestMap::iterator pending = pending_requests_.find(key);
+    const bool hit =
+        cached != cache_.end() || pending != pending_requests_.end();
+    UMA_HISTOGRAM_BOOLEAN("Extensions.ImageLoaderCacheHit", hit);
+    if (hit)
+      ++cache_hit_count_;
+    else
+      ++cache_miss_count_;
+
+    if (cached != cache_.end()) {
+      request->images[key] = cached->second;
+    } else if (pending != pending_requests_.end()) {
+      // The image is already being loaded for another request.
+      pending->second.push_back(request);
+      ++request->pending_count;
+    } else {
+      pending_requests_[key].push_back(request);
+      ++request->pending_count;
+      load_list.push_back(info_list[i]);
+      load_keys.push_back(key);
+    }
+  }
+
+  if (!load_list.empty()) {
+    base::PostTaskAndReplyWithResult(
+        BrowserThread::GetBlockingPool(),
+        FROM_HERE,
+        base::Bind(LoadImagesOnBlockingPool,
+                   load_list,
+                   LoadResourceBitmaps(extension, load_list)),
+        base::Bind(&ImageLoader::OnImagesLoaded,
+                   weak_ptr_factory_.GetWeakPtr(),
+                   extension->id(),
+                   extension->VersionString(),
+                   GetUnloadCount(extension->id()),
+                   load_keys));
+  }
+
+  if (request->pending_count == 0)
+    FinishRequest(*request);
+}
+
+void ImageLoader::OnImagesLoaded(const std::string& extension_id,
+                                 const std::string& version,
+                                 int unload_count,
+                                 const std::vector<CacheKey>& keys,
+                                 const std::vector<LoadResult>& load_result) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+
+  // If the extension was unloaded while loading, its images were dropped from
+  // the cache and the loaded ones may be stale, so only the waiting requests
+  // get them.
+  const bool cache_images = unload_count == GetUnloadCount(extension_id);
+
+  // Images which failed to load have no result.
+  ImageMap loaded_images;
+  for (std::vector<LoadResult>::const_iterator it = load_result.begin();
+       it != load_result.end(); ++it) {
+    const CacheKey key(extension_id, version, it->image_representation);
+    CachedImage& image = loaded_images[key];
+    image.bitmap = it->bitmap;
+    image.original_size = it->original_size;
+    if (cache_images)
+      AddToCache(key, image);
+  }
+
+  std::vector<linked_ptr<Request> > finished_requests;
+  for (std::vector<CacheKey>::const_iterator key = keys.begin();
+       key != keys.end(); ++key) {
+    RequestMap::iterator pending = pending_requests_.find(*key);
+    if (pending == pending_requests_.end())
+      continue;
+    ImageMap::const_iterator image = loaded_images.find(*key);
+    for (size_t i = 0; i < pending->second.size(); ++i) {
+      Request* request = pending->second[i].get();
+      if (image != loaded_images.end())
+        request->images[*key] = image->second;
+      if (--request->pending_count == 0)
+        finished_requests.push_back(pending->second[i]);
+    }
+    pending_requests_.erase(pending);
+  }
+
+  for (size_t i = 0; i < finished_requests.size(); ++i)
+    FinishRequest(*finished_requests[i]);
+}
+
+int ImageLoader::GetUnloadCount(const std::string& extension_id) const {
+  std::map<std::string, int>::const_iterator it =
+      unload_counts_.find(extension_id);
+  return it == unload_counts_.end() ? 0 : it->second;
+}
+
+void ImageLoader::FinishRequest(const Request& request) {
+  std::vector<LoadResult> load_result;
+  for (size_t i = 0; i < request.info_list.size(); ++i) {
+    ImageMap::const_iterator image = request.images.find(request.keys[i]);
+    if (image == request.images.end())
+      continue;
+    load_result.push_back(LoadResult(image->second.bitmap,
+                                     image->second.original_size,
+                                     request.info_list[i]));
+  }
+  request.reply.Run(load_result);
+}
+
+void ImageLoader::AddToCache(const CacheKey& key, const CachedImage& image) {
+  const size_t bytes = image.bitmap.getSize();
+  if (bytes > kMaxCacheBytes)
+    return;
+
+  ImageCache::iterator existing = cache_.Peek(key);
+  if (existing != cache_.end()) {
+    cache_bytes_ -= existing->second.bitmap.getSize();
+    cache_.Erase(existing);
+  }
+  cache_.Put(key, image);
+  cache_bytes_ += bytes;
+
+  while (cache_bytes_ > kMaxCacheBytes) {
+    ImageCache::reverse_iterator oldest = cache_.rbegin();
+    cache_bytes_ -= oldest->second.bitmap.getSize();
+    cache_.Erase(oldest);
+  }
+}
+
+void ImageLoader::RemoveFromCache(const std::string& extension_id) {
+  ImageCache::iterator it = cache_.begin();
+  while (it != cache_.end()) {
+    if (it->first.extension_id == extension_id) {
+      cache_bytes_ -= it->second.bitmap.getSize();
+      it = cache_.Erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ImageLoader::OnExtensionUnloaded(content::BrowserContext* browser_context,
+                                      const Extension* extension) {
+  ++unload_counts_[extension->id()];
+  RemoveFromCache(extension->id());
 }
 
 void ImageLoader::ReplyBack(const ImageLoaderImageCallback& callback,
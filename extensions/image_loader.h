@@ -5,12 +5,19 @@
 #ifndef CHROME_BROWSER_EXTENSIONS_IMAGE_LOADER_H_
 #define CHROME_BROWSER_EXTENSIONS_IMAGE_LOADER_H_
 
+#include <map>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "base/callback_forward.h"
+#include "base/containers/mru_cache.h"
 #include "base/gtest_prod_util.h"
+#include "base/memory/linked_ptr.h"
 #include "base/memory/weak_ptr.h"
+#include "base/scoped_observer.h"
 #include "components/keyed_service/core/keyed_service.h"
+#include "extensions/browser/extension_registry_observer.h"
 #include "extensions/common/extension_resource.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "ui/base/layout.h"
@@ -28,6 +35,7 @@ class ImageFamily;
 namespace extensions {
 
 class Extension;
+class ExtensionRegistry;
 
 typedef base::Callback<void(const gfx::Image&)> ImageLoaderImageCallback;
 typedef base::Callback<void(const gfx::ImageFamily&)>
@@ -38,7 +46,15 @@ typedef base::Callback<void(const gfx::ImageFamily&)>
 // The views need to load their icons asynchronously might be deleted before
 // the images have loaded. If you pass your callback using a weak_ptr, this
 // will make sure the callback won't be called after the view is deleted.
-class ImageLoader : public KeyedService {
+//
+// Decoded images are kept in a cache bounded by |kMaxCacheBytes|, keyed by
+// the extension, its version, the resource and the requested size, and
+// concurrent loads of the same image are only done once. The images of an
+// extension are dropped from the cache when it is unloaded, and thus when it
+// is updated. Loads which were started before the extension was unloaded
+// still answer their requests, but their images aren't cached.
+class ImageLoader : public KeyedService,
+                    public ExtensionRegistryObserver {
  public:
   // Information about a singe image representation to load from an extension
   // resource.
@@ -68,11 +84,17 @@ class ImageLoader : public KeyedService {
 
   struct LoadResult;
 
+  // The most bytes of decoded images kept in the cache.
+  static const size_t kMaxCacheBytes;
+
   // Returns the instance for the given |context| or NULL if none. This is
   // a convenience wrapper around ImageLoaderFactory::GetForBrowserContext.
   static ImageLoader* Get(content::BrowserContext* context);
 
+  // An ImageLoader created without a |context| doesn't observe extensions
+  // being unloaded.
   ImageLoader();
+  explicit ImageLoader(content::BrowserContext* context);
   virtual ~ImageLoader();
 
   // Checks whether image is a component extension resource. Returns false
@@ -113,13 +135,97 @@ class ImageLoader : public KeyedService {
                             const std::vector<ImageRepresentation>& info_list,
                             const ImageLoaderImageFamilyCallback& callback);
 
+  // The number of requested images which were found in the cache or already
+  // being loaded, and the number which had to be loaded.
+  int cache_hit_count() const { return cache_hit_count_; }
+  int cache_miss_count() const { return cache_miss_count_; }
+
  private:
+  // Identifies a decoded image in the cache.
+  struct CacheKey {
+    CacheKey(const std::string& extension_id,
+             const std::string& version,
+             const ImageRepresentation& image_info);
+    ~CacheKey();
+
+    bool operator<(const CacheKey& other) const;
+
+    std::string extension_id;
+    std::string version;
+    base::FilePath relative_path;
+    int resize_condition;
+    gfx::Size desired_size;
+  };
+
+  // A decoded image and the size of the image before it was resized.
+  struct CachedImage {
+    SkBitmap bitmap;
+    gfx::Size original_size;
+  };
+
+  // A request waiting for some of its images to load.
+  struct Request;
+
+  typedef base::Callback<void(const std::vector<LoadResult>&)> ReplyCallback;
+  typedef base::MRUCache<CacheKey, CachedImage> ImageCache;
+  typedef std::map<CacheKey, std::vector<linked_ptr<Request> > > RequestMap;
+  typedef std::map<CacheKey, CachedImage> ImageMap;
+
+  // Loads the images of |info_list| which aren't cached or already being
+  // loaded, and passes all images to |reply| once they are available.
+  void LoadImages(const Extension* extension,
+                  const std::vector<ImageRepresentation>& info_list,
+                  const ReplyCallback& reply);
+
+  // Called with the images loaded for |keys|, which belong to the extension
+  // |extension_id| at |version|. |unload_count| is the number of times the
+  // extension had been unloaded when the load started.
+  void OnImagesLoaded(const std::string& extension_id,
+                      const std::string& version,
+                      int unload_count,
+                      const std::vector<CacheKey>& keys,
+                      const std::vector<LoadResult>& load_result);
+
+  // Returns the number of times |extension_id| was unloaded.
+  int GetUnloadCount(const std::string& extension_id) const;
+
+  // Passes the images of |request| to its reply.
+  void FinishRequest(const Request& request);
+
+  // Adds |image| to the cache, evicting the least recently used images if
+  // the cache grows too large.
+  void AddToCache(const CacheKey& key, const CachedImage& image);
+
+  // Drops the images of |extension_id| from the cache.
+  void RemoveFromCache(const std::string& extension_id);
+
+  // ExtensionRegistryObserver implementation.
+  virtual void OnExtensionUnloaded(content::BrowserContext* browser_context,
+                                   const Extension* extension) OVERRIDE;
+
   void ReplyBack(const ImageLoaderImageCallback& callback,
                  const std::vector<LoadResult>& load_result);
 
   void ReplyBackWithImageFamily(const ImageLoaderImageFamilyCallback& callback,
                                 const std::vector<LoadResult>& load_result);
 
+  // Decoded images, most recently used first.
+  ImageCache cache_;
+  size_t cache_bytes_;
+
+  // Requests waiting for each image being loaded.
+  RequestMap pending_requests_;
+
+  // The number of times each extension was unloaded. A load which finishes
+  // after its extension was unloaded doesn't add its images to the cache.
+  std::map<std::string, int> unload_counts_;
+
+  int cache_hit_count_;
+  int cache_miss_count_;
+
+  ScopedObserver<ExtensionRegistry, ExtensionRegistryObserver>
+      registry_observer_;
+
   base::WeakPtrFactory<ImageLoader> weak_ptr_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(ImageLoader);
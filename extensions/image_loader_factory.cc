@@ -6,6 +6,7 @@
 
 #include "chrome/browser/extensions/image_loader.h"
 #include "components/keyed_service/content/browser_context_dependency_manager.h"
+#include "extensions/browser/extension_registry_factory.h"
 #include "extensions/browser/extensions_browser_client.h"
 
 namespace extensions {
@@ -25,6 +26,7 @@ ImageLoaderFactory::ImageLoaderFactory()
     : BrowserContextKeyedServiceFactory(
         "ImageLoader",
         BrowserContextDependencyManager::GetInstance()) {
+  DependsOn(ExtensionRegistryFactory::GetInstance());
 }
 
 ImageLoaderFactory::~ImageLoaderFactory() {
@@ -32,7 +34,7 @@ ImageLoaderFactory::~ImageLoaderFactory() {
 
 KeyedService* ImageLoaderFactory::BuildServiceInstanceFor(
     content::BrowserContext* context) const {
-  return new ImageLoader;
+  return new ImageLoader(context);
 }
 
 bool ImageLoaderFactory::ServiceIsCreatedWithBrowserContext() const {
@@ -201,6 +201,130 @@ TEST_F(ImageLoaderTest, DeleteExtensionWhileWaitingForCache) {
             image_.ToSkBitmap()->width());
 }
 
+// Tests that a loaded image is cached, and that loading it again calls back
+// synchronously.
+TEST_F(ImageLoaderTest, LoadCachedImage) {
+  scoped_refptr<Extension> extension(CreateExtension(
+      "image_loading_tracker", Manifest::INVALID_LOCATION));
+  ASSERT_TRUE(extension.get() != NULL);
+
+  ExtensionResource image_resource = extensions::IconsInfo::GetIconResource(
+      extension.get(),
+      extension_misc::EXTENSION_ICON_SMALLISH,
+      ExtensionIconSet::MATCH_EXACTLY);
+  gfx::Size max_size(extension_misc::EXTENSION_ICON_SMALLISH,
+                     extension_misc::EXTENSION_ICON_SMALLISH);
+  ImageLoader loader;
+  loader.LoadImageAsync(extension.get(),
+                        image_resource,
+                        max_size,
+                        base::Bind(&ImageLoaderTest::OnImageLoaded,
+                                   base::Unretained(this)));
+  EXPECT_EQ(0, image_loaded_count());
+  WaitForImageLoad();
+  EXPECT_EQ(1, image_loaded_count());
+  EXPECT_EQ(0, loader.cache_hit_count());
+  EXPECT_EQ(1, loader.cache_miss_count());
+
+  image_ = gfx::Image();
+  loader.LoadImageAsync(extension.get(),
+                        image_resource,
+                        max_size,
+                        base::Bind(&ImageLoaderTest::OnImageLoaded,
+                                   base::Unretained(this)));
+
+  // The image is cached, so we got it right away.
+  EXPECT_EQ(1, image_loaded_count());
+  EXPECT_EQ(1, loader.cache_hit_count());
+  EXPECT_EQ(1, loader.cache_miss_count());
+  ASSERT_FALSE(image_.IsEmpty());
+  EXPECT_EQ(extension_misc::EXTENSION_ICON_SMALLISH,
+            image_.ToSkBitmap()->width());
+}
+
+// Tests that concurrent requests for the same image only load it once.
+TEST_F(ImageLoaderTest, LoadSameImageConcurrently) {
+  scoped_refptr<Extension> extension(CreateExtension(
+      "image_loading_tracker", Manifest::INVALID_LOCATION));
+  ASSERT_TRUE(extension.get() != NULL);
+
+  ExtensionResource image_resource = extensions::IconsInfo::GetIconResource(
+      extension.get(),
+      extension_misc::EXTENSION_ICON_SMALLISH,
+      ExtensionIconSet::MATCH_EXACTLY);
+  gfx::Size max_size(extension_misc::EXTENSION_ICON_SMALLISH,
+                     extension_misc::EXTENSION_ICON_SMALLISH);
+  ImageLoader loader;
+  for (int i = 0; i < 2; ++i) {
+    loader.LoadImageAsync(extension.get(),
+                          image_resource,
+                          max_size,
+                          base::Bind(&ImageLoaderTest::OnImageLoaded,
+                                     base::Unretained(this)));
+  }
+  EXPECT_EQ(0, image_loaded_count());
+
+  // Both requests are answered when the image is loaded.
+  WaitForImageLoad();
+  EXPECT_EQ(2, image_loaded_count());
+  EXPECT_EQ(1, loader.cache_hit_count());
+  EXPECT_EQ(1, loader.cache_miss_count());
+  EXPECT_EQ(extension_misc::EXTENSION_ICON_SMALLISH,
+            image_.ToSkBitmap()->width());
+}
+
+// Tests that an image which finishes loading after its extension was unloaded
+// is passed to the request, but not cached.
+TEST_F(ImageLoaderTest, UnloadExtensionWhileLoading) {
+  scoped_refptr<Extension> extension(CreateExtension(
+      "image_loading_tracker", Manifest::INVALID_LOCATION));
+  ASSERT_TRUE(extension.get() != NULL);
+
+  ExtensionResource image_resource = extensions::IconsInfo::GetIconResource(
+      extension.get(),
+      extension_misc::EXTENSION_ICON_SMALLISH,
+      ExtensionIconSet::MATCH_EXACTLY);
+  gfx::Size max_size(extension_misc::EXTENSION_ICON_SMALLISH,
+                     extension_misc::EXTENSION_ICON_SMALLISH);
+  ImageLoader loader;
+  loader.LoadImageAsync(extension.get(),
+                        image_resource,
+                        max_size,
+                        base::Bind(&ImageLoaderTest::OnImageLoaded,
+                                   base::Unretained(this)));
+  EXPECT_EQ(0, image_loaded_count());
+
+  // |loader| has no ExtensionRegistry to observe, so tell it directly.
+  static_cast<extensions::ExtensionRegistryObserver*>(&loader)
+      ->OnExtensionUnloaded(NULL, extension.get());
+
+  WaitForImageLoad();
+  EXPECT_EQ(1, image_loaded_count());
+  EXPECT_EQ(extension_misc::EXTENSION_ICON_SMALLISH,
+            image_.ToSkBitmap()->width());
+
+  // The image wasn't cached, so it is loaded again.
+  loader.LoadImageAsync(extension.get(),
+                        image_resource,
+                        max_size,
+                        base::Bind(&ImageLoaderTest::OnImageLoaded,
+                                   base::Unretained(this)));
+  EXPECT_EQ(0, image_loaded_count());
+  WaitForImageLoad();
+  EXPECT_EQ(1, image_loaded_count());
+  EXPECT_EQ(0, loader.cache_hit_count());
+  EXPECT_EQ(2, loader.cache_miss_count());
+
+  // Loads started after the unload are cached.
+  loader.LoadImageAsync(extension.get(),
+                        image_resource,
+                        max_size,
+                        base::Bind(&ImageLoaderTest::OnImageLoaded,
+                                   base::Unretained(this)));
+  EXPECT_EQ(1, image_loaded_count());
+  EXPECT_EQ(1, loader.cache_hit_count());
+}
+
 // Tests loading multiple dimensions of the same image.
 TEST_F(ImageLoaderTest, MultipleImages) {
   scoped_refptr<Extension> extension(CreateExtension(
@@ -4,11 +4,16 @@
 
 #include "chrome/browser/extensions/installed_loader.h"
 
+#include "base/bind.h"
+#include "base/callback.h"
 #include "base/files/file_path.h"
+#include "base/memory/scoped_vector.h"
 #include "base/metrics/histogram.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "base/threading/thread_restrictions.h"
+#include "base/time/time.h"
 #include "base/values.h"
 #include "chrome/browser/browser_process.h"
 #include "chrome/browser/extensions/api/runtime/runtime_api.h"
@@ -39,6 +44,51 @@ namespace extensions {
 
 namespace errors = manifest_errors;
 
+// An installed extension whose manifest is reloaded from disk.
+struct ManifestReload {
+  ManifestReload(ExtensionInfo* info, int creation_flags)
+      : info(info),
+        extension_id(info->extension_id),
+        extension_path(info->extension_path),
+        extension_location(info->extension_location),
+        creation_flags(creation_flags) {
+  }
+
+  // Only used on the UI thread.
+  ExtensionInfo* info;
+
+  const std::string extension_id;
+  const base::FilePath extension_path;
+  const Manifest::Location extension_location;
+  const int creation_flags;
+
+  // The results of the reload.
+  scoped_refptr<const Extension> extension;
+  std::string error;
+};
+
+// The installed extensions being loaded while some of them are reloaded from
+// disk. Only used on the UI thread, except for the ManifestReload being
+// reloaded by each blocking pool task.
+struct ManifestReloads : public base::RefCountedThreadSafe<ManifestReloads> {
+  ManifestReloads() : pending_reloads(0) {}
+
+  // Owns the ExtensionInfo of each reload.
+  scoped_ptr<ExtensionPrefs::ExtensionsInfo> extensions_info;
+  ScopedVector<ManifestReload> reloads;
+  size_t pending_reloads;
+
+  // Passed to InstalledLoader::FinishLoadingAllExtensions().
+  base::TimeTicks start_time;
+  std::vector<int> reload_reason_counts;
+  base::Closure done;
+
+ private:
+  friend class base::RefCountedThreadSafe<ManifestReloads>;
+
+  ~ManifestReloads() {}
+};
+
 namespace {
 
 // The following enumeration is used in histograms matching
@@ -106,6 +156,16 @@ ManifestReloadReason ShouldReloadExtensionManifest(const ExtensionInfo& info) {
   return NOT_NEEDED;
 }
 
+// Reloads the extension of |reload| from disk. This is called on the blocking
+// pool.
+void ReloadExtension(ManifestReload* reload) {
+  reload->extension = extension_file_util::LoadExtension(
+      reload->extension_path,
+      reload->extension_location,
+      reload->creation_flags,
+      &reload->error);
+}
+
 BackgroundPageType GetBackgroundPageType(const Extension* extension) {
   if (!BackgroundInfo::HasBackgroundPage(extension))
     return NO_BACKGROUND_PAGE;
@@ -182,17 +242,17 @@ void InstalledLoader::Load(const ExtensionInfo& info, bool write_to_prefs) {
   extension_service_->AddExtension(extension.get());
 }
 
-void InstalledLoader::LoadAllExtensions() {
+void InstalledLoader::LoadAllExtensions(const base::Closure& done) {
   CHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
 
-  base::TimeTicks start_time = base::TimeTicks::Now();
-
-  scoped_ptr<ExtensionPrefs::ExtensionsInfo> extensions_info(
-      extension_prefs_->GetInstalledExtensionsInfo());
-
-  std::vector<int> reload_reason_counts(NUM_MANIFEST_RELOAD_REASONS, 0);
-  bool should_write_prefs = false;
+  scoped_refptr<ManifestReloads> reloads(new ManifestReloads);
+  reloads->start_time = base::TimeTicks::Now();
+  reloads->extensions_info = extension_prefs_->GetInstalledExtensionsInfo();
+  reloads->reload_reason_counts.resize(NUM_MANIFEST_RELOAD_REASONS, 0);
+  reloads->done = done;
 
+  ExtensionPrefs::ExtensionsInfo* extensions_info =
+      reloads->extensions_info.get();
   for (size_t i = 0; i < extensions_info->size(); ++i) {
     ExtensionInfo* info = extensions_info->at(i).get();
 
@@ -202,46 +262,90 @@ void InstalledLoader::LoadAllExtensions() {
       continue;
 
     ManifestReloadReason reload_reason = ShouldReloadExtensionManifest(*info);
-    ++reload_reason_counts[reload_reason];
+    ++reloads->reload_reason_counts[reload_reason];
     UMA_HISTOGRAM_ENUMERATION("Extensions.ManifestReloadEnumValue",
                               reload_reason, 100);
 
-    if (reload_reason != NOT_NEEDED) {
-      // Reloading an extension reads files from disk.  We do this on the
-      // UI thread because reloads should be very rare, and the complexity
-      // added by delaying the time when the extensions service knows about
-      // all extensions is significant.  See crbug.com/37548 for details.
-      // |allow_io| disables tests that file operations run on the file
-      // thread.
-      base::ThreadRestrictions::ScopedAllowIO allow_io;
-
-      std::string error;
-      scoped_refptr<const Extension> extension(
-          extension_file_util::LoadExtension(
-              info->extension_path,
-              info->extension_location,
-              GetCreationFlags(info),
-              &error));
-
-      if (!extension.get()) {
-        extension_service_->ReportExtensionLoadError(
-            info->extension_path, error, false);
-        continue;
-      }
+    // Extensions whose manifest in the prefs can be used are added right
+    // away; the others once they are reloaded.
+    if (reload_reason == NOT_NEEDED) {
+      Load(*info, false);
+      continue;
+    }
+    reloads->reloads.push_back(
+        new ManifestReload(info, GetCreationFlags(info)));
+  }
 
-      extensions_info->at(i)->extension_manifest.reset(
-          static_cast<base::DictionaryValue*>(
-              extension->manifest()->value()->DeepCopy()));
-      should_write_prefs = true;
+  if (!reloads->reloads.empty()) {
+    ReloadExtensions(extension_service_->AsWeakPtr(), reloads);
+    return;
+  }
+
+  FinishLoadingAllExtensions(reloads->start_time,
+                             reloads->reload_reason_counts);
+  done.Run();
+}
+
+// static
+void InstalledLoader::ReloadExtensions(
+    base::WeakPtr<ExtensionService> extension_service,
+    const scoped_refptr<ManifestReloads>& reloads) {
+  // Reloading an extension reads files from disk, so the reloads run in
+  // parallel on the blocking pool and cost about as much as the slowest one.
+  // Reloads are rare: they are needed for unpacked extensions and after the
+  // locale changed.
+  reloads->pending_reloads = reloads->reloads.size();
+  base::SequencedWorkerPool* pool = BrowserThread::GetBlockingPool();
+  for (size_t i = 0; i < reloads->reloads.size(); ++i) {
+    base::Closure task = base::Bind(&ReloadExtension, reloads->reloads[i]);
+    base::Closure reply = base::Bind(&InstalledLoader::OnExtensionReloaded,
+                                     extension_service, reloads);
+    if (!pool->PostTaskAndReply(FROM_HERE, task, reply)) {
+      // The pool is shutting down; reload on this thread instead.
+      {
+        base::ThreadRestrictions::ScopedAllowIO allow_io;
+        task.Run();
+      }
+      reply.Run();
     }
   }
+}
 
-  for (size_t i = 0; i < extensions_info->size(); ++i) {
-    if (extensions_info->at(i)->extension_location == Manifest::COMMAND_LINE)
+// static
+void InstalledLoader::OnExtensionReloaded(
+    base::WeakPtr<ExtensionService> extension_service,
+    const scoped_refptr<ManifestReloads>& reloads) {
+  DCHECK_GT(reloads->pending_reloads, 0u);
+  if (--reloads->pending_reloads > 0 || !extension_service)
+    return;
+
+  UMA_HISTOGRAM_TIMES("Extensions.ManifestReloadTime",
+                      base::TimeTicks::Now() - reloads->start_time);
+
+  InstalledLoader loader(extension_service.get());
+  for (size_t i = 0; i < reloads->reloads.size(); ++i) {
+    ManifestReload* reload = reloads->reloads[i];
+    if (!reload->extension.get()) {
+      extension_service->ReportExtensionLoadError(
+          reload->extension_path, reload->error, false);
+      loader.Load(*reload->info, false);
       continue;
-    Load(*extensions_info->at(i), should_write_prefs);
+    }
+
+    reload->info->extension_manifest.reset(
+        static_cast<base::DictionaryValue*>(
+            reload->extension->manifest()->value()->DeepCopy()));
+    loader.Load(*reload->info, true);
   }
 
+  loader.FinishLoadingAllExtensions(reloads->start_time,
+                                    reloads->reload_reason_counts);
+  reloads->done.Run();
+}
+
+void InstalledLoader::FinishLoadingAllExtensions(
+    const base::TimeTicks& start_time,
+    const std::vector<int>& reload_reason_counts) {
   extension_service_->OnLoadedInstalledExtensions();
 
   // The histograms Extensions.ManifestReload* allow us to validate
@@ -5,13 +5,24 @@
 #ifndef CHROME_BROWSER_EXTENSIONS_INSTALLED_LOADER_H_
 #define CHROME_BROWSER_EXTENSIONS_INSTALLED_LOADER_H_
 
+#include <vector>
+
+#include "base/callback_forward.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+
 class ExtensionService;
 
+namespace base {
+class TimeTicks;
+}
+
 namespace extensions {
 
 class ExtensionPrefs;
 class ExtensionRegistry;
 struct ExtensionInfo;
+struct ManifestReloads;
 
 // Loads installed extensions from the prefs.
 class InstalledLoader {
@@ -22,10 +33,31 @@ class InstalledLoader {
   // Loads extension from prefs.
   void Load(const ExtensionInfo& info, bool write_to_prefs);
 
-  // Loads all installed extensions (used by startup and testing code).
-  void LoadAllExtensions();
+  // Loads all installed extensions (used by startup and testing code), and
+  // runs |done| once they are added. Extensions whose manifest must be
+  // reloaded from disk are reloaded on the blocking pool, without waiting for
+  // them on this thread, and are only added once all of them are reloaded.
+  void LoadAllExtensions(const base::Closure& done);
 
  private:
+  // Starts reloading the extensions of |reloads| from disk, in parallel on the
+  // blocking pool.
+  static void ReloadExtensions(
+      base::WeakPtr<ExtensionService> extension_service,
+      const scoped_refptr<ManifestReloads>& reloads);
+
+  // Called on the UI thread as each reload of |reloads| is done. Once all of
+  // them are, adds the reloaded extensions and finishes loading.
+  static void OnExtensionReloaded(
+      base::WeakPtr<ExtensionService> extension_service,
+      const scoped_refptr<ManifestReloads>& reloads);
+
+  // Tells the service that all installed extensions are loaded, and records
+  // histograms about them.
+  void FinishLoadingAllExtensions(
+      const base::TimeTicks& start_time,
+      const std::vector<int>& reload_reason_counts);
+
   // Returns the flags that should be used with Extension::Create() for an
   // extension that is already installed.
   int GetCreationFlags(const ExtensionInfo* info);
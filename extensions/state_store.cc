@@ -5,7 +5,10 @@
 #include "chrome/browser/extensions/state_store.h"
 
 #include "base/bind.h"
+#include "base/json/json_writer.h"
 #include "base/message_loop/message_loop.h"
+#include "base/metrics/histogram.h"
+#include "base/values.h"
 #include "chrome/browser/chrome_notification_types.h"
 #include "content/public/browser/notification_service.h"
 #include "content/public/browser/notification_types.h"
@@ -17,15 +20,36 @@ namespace {
 // defer it to avoid slowing down startup. See http://crbug.com/161848
 const int kInitDelaySeconds = 1;
 
+// Default delay, in seconds, before buffered values are written to the
+// database. Extensions which save their state on every tab event write the
+// same keys many times within this delay.
+const int kFlushDelaySeconds = 2;
+
+scoped_ptr<base::Value> CopyValue(const base::Value* value) {
+  return make_scoped_ptr(value ? value->DeepCopy() : NULL);
+}
+
 std::string GetFullKey(const std::string& extension_id,
                        const std::string& key) {
   return extension_id + "." + key;
 }
 
+// Returns roughly how many bytes keeping |value| for |full_key| in memory
+// takes.
+size_t EstimateCachedBytes(const std::string& full_key,
+                           const base::Value* value) {
+  std::string json;
+  if (value)
+    base::JSONWriter::Write(value, &json);
+  return full_key.size() + json.size();
+}
+
 }  // namespace
 
 namespace extensions {
 
+const size_t StateStore::kMaxCachedBytes = 256 * 1024;
+
 // Helper class to delay tasks until we're ready to start executing them.
 class StateStore::DelayedTaskQueue {
  public:
@@ -66,7 +90,14 @@ void StateStore::DelayedTaskQueue::SetReady() {
 StateStore::StateStore(Profile* profile,
                        const base::FilePath& db_path,
                        bool deferred_load)
-    : db_path_(db_path), task_queue_(new DelayedTaskQueue()) {
+    : db_path_(db_path),
+      task_queue_(new DelayedTaskQueue()),
+      cached_values_(ValueCache::NO_AUTO_EVICT),
+      cached_bytes_(0),
+      write_generation_(0),
+      flush_delay_(base::TimeDelta::FromSeconds(kFlushDelaySeconds)),
+      flushed_write_count_(0),
+      coalesced_write_count_(0) {
   registrar_.Add(this, chrome::NOTIFICATION_EXTENSION_INSTALLED,
                  content::Source<Profile>(profile));
   registrar_.Add(this, chrome::NOTIFICATION_EXTENSION_UNINSTALLED,
@@ -86,7 +117,13 @@ StateStore::StateStore(Profile* profile,
 }
 
 StateStore::StateStore(Profile* profile, scoped_ptr<ValueStore> value_store)
-    : store_(value_store.Pass()), task_queue_(new DelayedTaskQueue()) {
+    : store_(value_store.Pass()),
+      task_queue_(new DelayedTaskQueue()),
+      cached_values_(ValueCache::NO_AUTO_EVICT),
+      cached_bytes_(0),
+      write_generation_(0),
+      flushed_write_count_(0),
+      coalesced_write_count_(0) {
   registrar_.Add(this, chrome::NOTIFICATION_EXTENSION_INSTALLED,
                  content::Source<Profile>(profile));
   registrar_.Add(this, chrome::NOTIFICATION_EXTENSION_UNINSTALLED,
@@ -97,6 +134,11 @@ StateStore::StateStore(Profile* profile, scoped_ptr<ValueStore> value_store)
 }
 
 StateStore::~StateStore() {
+  FlushPendingWrites();
+  UMA_HISTOGRAM_COUNTS("Extensions.StateStoreFlushedWrites",
+                       flushed_write_count_);
+  UMA_HISTOGRAM_COUNTS("Extensions.StateStoreCoalescedWrites",
+                       coalesced_write_count_);
 }
 
 void StateStore::RegisterKey(const std::string& key) {
@@ -106,29 +148,68 @@ void StateStore::RegisterKey(const std::string& key) {
 void StateStore::GetExtensionValue(const std::string& extension_id,
                                    const std::string& key,
                                    ReadCallback callback) {
+  const std::string full_key = GetFullKey(extension_id, key);
+  const base::Value* known_value = NULL;
+  bool is_known = false;
+  ValueMap::const_iterator pending = pending_writes_.find(full_key);
+  if (pending != pending_writes_.end()) {
+    known_value = pending->second.get();
+    is_known = true;
+  } else {
+    ValueCache::iterator cached = cached_values_.Get(full_key);
+    if (cached != cached_values_.end()) {
+      known_value = cached->second.value.get();
+      is_known = true;
+    }
+  }
+  if (is_known) {
+    // Reads are always answered asynchronously.
+    base::MessageLoop::current()->PostTask(
+        FROM_HERE,
+        base::Bind(callback, base::Passed(CopyValue(known_value))));
+    return;
+  }
+
   task_queue_->InvokeWhenReady(
       base::Bind(&ValueStoreFrontend::Get, base::Unretained(&store_),
-                 GetFullKey(extension_id, key), callback));
+                 full_key,
+                 base::Bind(&StateStore::OnValueRead, AsWeakPtr(), full_key,
+                            write_generation_, callback)));
 }
 
 void StateStore::SetExtensionValue(
     const std::string& extension_id,
     const std::string& key,
     scoped_ptr<base::Value> value) {
-  task_queue_->InvokeWhenReady(
-      base::Bind(&ValueStoreFrontend::Set, base::Unretained(&store_),
-                 GetFullKey(extension_id, key), base::Passed(&value)));
+  WriteValue(GetFullKey(extension_id, key), value.Pass());
 }
 
 void StateStore::RemoveExtensionValue(const std::string& extension_id,
                                       const std::string& key) {
-  task_queue_->InvokeWhenReady(
-      base::Bind(&ValueStoreFrontend::Remove, base::Unretained(&store_),
-                 GetFullKey(extension_id, key)));
+  WriteValue(GetFullKey(extension_id, key), scoped_ptr<base::Value>());
 }
 
 bool StateStore::IsInitialized() const { return task_queue_->ready(); }
 
+void StateStore::FlushPendingWrites() {
+  flush_timer_.Stop();
+  for (ValueMap::iterator it = pending_writes_.begin();
+       it != pending_writes_.end(); ++it) {
+    scoped_ptr<base::Value> value(it->second.release());
+    if (value.get()) {
+      task_queue_->InvokeWhenReady(
+          base::Bind(&ValueStoreFrontend::Set, base::Unretained(&store_),
+                     it->first, base::Passed(&value)));
+    } else {
+      task_queue_->InvokeWhenReady(
+          base::Bind(&ValueStoreFrontend::Remove, base::Unretained(&store_),
+                     it->first));
+    }
+    ++flushed_write_count_;
+  }
+  pending_writes_.clear();
+}
+
 void StateStore::Observe(int type,
                          const content::NotificationSource& source,
                          const content::NotificationDetails& details) {
@@ -167,10 +248,73 @@ void StateStore::Init() {
 void StateStore::RemoveKeysForExtension(const std::string& extension_id) {
   for (std::set<std::string>::iterator key = registered_keys_.begin();
        key != registered_keys_.end(); ++key) {
-    task_queue_->InvokeWhenReady(
-        base::Bind(&ValueStoreFrontend::Remove, base::Unretained(&store_),
-                   GetFullKey(extension_id, *key)));
+    RemoveExtensionValue(extension_id, *key);
   }
 }
 
+void StateStore::WriteValue(const std::string& full_key,
+                            scoped_ptr<base::Value> value) {
+  // Removed keys are forgotten rather than cached, so that the keys of
+  // uninstalled extensions don't stay in memory.
+  ++write_generation_;
+  if (value.get())
+    CacheValue(full_key, CopyValue(value.get()));
+  else
+    UncacheValue(full_key);
+
+  ValueMap::iterator it = pending_writes_.find(full_key);
+  if (it != pending_writes_.end()) {
+    // The flush is already scheduled.
+    it->second.reset(value.release());
+    ++coalesced_write_count_;
+    return;
+  }
+  pending_writes_[full_key] = make_linked_ptr(value.release());
+
+  if (flush_delay_ == base::TimeDelta()) {
+    FlushPendingWrites();
+  } else if (!flush_timer_.IsRunning()) {
+    flush_timer_.Start(FROM_HERE, flush_delay_, this,
+                       &StateStore::FlushPendingWrites);
+  }
+}
+
+void StateStore::OnValueRead(const std::string& full_key,
+                             int write_generation,
+                             const ReadCallback& callback,
+                             scoped_ptr<base::Value> value) {
+  // A value written while the read was in flight is newer.
+  if (write_generation == write_generation_)
+    CacheValue(full_key, CopyValue(value.get()));
+  callback.Run(value.Pass());
+}
+
+void StateStore::CacheValue(const std::string& full_key,
+                            scoped_ptr<base::Value> value) {
+  UncacheValue(full_key);
+  const size_t bytes = EstimateCachedBytes(full_key, value.get());
+  if (bytes > kMaxCachedBytes)
+    return;
+
+  CachedValue cached;
+  cached.value = make_linked_ptr(value.release());
+  cached.bytes = bytes;
+  cached_values_.Put(full_key, cached);
+  cached_bytes_ += bytes;
+
+  while (cached_bytes_ > kMaxCachedBytes) {
+    ValueCache::reverse_iterator oldest = cached_values_.rbegin();
+    cached_bytes_ -= oldest->second.bytes;
+    cached_values_.Erase(oldest);
+  }
+}
+
+void StateStore::UncacheValue(const std::string& full_key) {
+  ValueCache::iterator cached = cached_values_.Peek(full_key);
+  if (cached == cached_values_.end())
+    return;
+  cached_bytes_ -= cached->second.bytes;
+  cached_values_.Erase(cached);
+}
+
 }  // namespace extensions
@@ -5,11 +5,16 @@
 #ifndef CHROME_BROWSER_EXTENSIONS_STATE_STORE_H_
 #define CHROME_BROWSER_EXTENSIONS_STATE_STORE_H_
 
+#include <map>
 #include <set>
 #include <string>
 
+#include "base/containers/mru_cache.h"
 #include "base/files/file_path.h"
+#include "base/memory/linked_ptr.h"
 #include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
 #include "content/public/browser/notification_observer.h"
 #include "content/public/browser/notification_registrar.h"
 #include "extensions/browser/value_store/value_store_frontend.h"
@@ -19,17 +24,26 @@ class Profile;
 namespace extensions {
 
 // A storage area for per-extension state that needs to be persisted to disk.
+//
+// Writes are buffered for up to a flush delay, so that repeated writes of the
+// same key only reach the database once. The most recently read or written
+// values are kept in memory, up to |kMaxCachedBytes|, and later reads of them
+// are served from there.
 class StateStore
     : public base::SupportsWeakPtr<StateStore>,
       public content::NotificationObserver {
  public:
   typedef ValueStoreFrontend::ReadCallback ReadCallback;
 
+  // The most bytes of keys and serialized values kept in memory.
+  static const size_t kMaxCachedBytes;
+
   // If |deferred_load| is true, we won't load the database until the first
   // page has been loaded.
   StateStore(Profile* profile, const base::FilePath& db_path,
              bool deferred_load);
-  // This variant is useful for testing (using a mock ValueStore).
+  // This variant is useful for testing (using a mock ValueStore). Writes are
+  // not buffered, unless set_flush_delay() is called.
   StateStore(Profile* profile, scoped_ptr<ValueStore> store);
   virtual ~StateStore();
 
@@ -55,9 +69,32 @@ class StateStore
   // Return whether or not the StateStore has initialized itself.
   bool IsInitialized() const;
 
+  // Writes all buffered values to the database.
+  void FlushPendingWrites();
+
+  // Sets the longest time a write is buffered before it is written to the
+  // database, which bounds the writes lost on a crash. A zero |delay| writes
+  // every value immediately.
+  void set_flush_delay(const base::TimeDelta& delay) { flush_delay_ = delay; }
+
+  // The number of writes which reached the database, and the number of
+  // writes saved because a later write of the same key replaced them.
+  int flushed_write_count() const { return flushed_write_count_; }
+  int coalesced_write_count() const { return coalesced_write_count_; }
+
  private:
   class DelayedTaskQueue;
 
+  // Maps full keys to values. A NULL value means the key was removed.
+  typedef std::map<std::string, linked_ptr<base::Value> > ValueMap;
+
+  // A value kept in memory. A NULL value means the key has no value.
+  struct CachedValue {
+    linked_ptr<base::Value> value;
+    size_t bytes;
+  };
+  typedef base::MRUCache<std::string, CachedValue> ValueCache;
+
   // content::NotificationObserver
   virtual void Observe(int type,
                        const content::NotificationSource& source,
@@ -68,6 +105,24 @@ class StateStore
   // Removes all keys registered for the given extension.
   void RemoveKeysForExtension(const std::string& extension_id);
 
+  // Buffers |value|, which may be NULL, as the new value of |full_key|.
+  void WriteValue(const std::string& full_key, scoped_ptr<base::Value> value);
+
+  // Caches the value of |full_key| read from the database, unless a value
+  // was written since the read started at |write_generation|, and passes it
+  // on to |callback|.
+  void OnValueRead(const std::string& full_key,
+                   int write_generation,
+                   const ReadCallback& callback,
+                   scoped_ptr<base::Value> value);
+
+  // Keeps |value| as the value of |full_key| in memory, evicting the least
+  // recently used values beyond |kMaxCachedBytes|.
+  void CacheValue(const std::string& full_key, scoped_ptr<base::Value> value);
+
+  // Forgets the value of |full_key| kept in memory, if any.
+  void UncacheValue(const std::string& full_key);
+
   // Path to our database, on disk. Empty during testing.
   base::FilePath db_path_;
 
@@ -81,6 +136,24 @@ class StateStore
   // Keeps track of tasks we have delayed while starting up.
   scoped_ptr<DelayedTaskQueue> task_queue_;
 
+  // Values written since the last flush.
+  ValueMap pending_writes_;
+
+  // The most recently used values of keys. Those in |pending_writes_| take
+  // precedence.
+  ValueCache cached_values_;
+  size_t cached_bytes_;
+
+  // Incremented on every write, so that reads started before it don't cache
+  // stale values.
+  int write_generation_;
+
+  base::TimeDelta flush_delay_;
+  base::OneShotTimer<StateStore> flush_timer_;
+
+  int flushed_write_count_;
+  int coalesced_write_count_;
+
   content::NotificationRegistrar registrar_;
 };
 
@@ -0,0 +1,156 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/extensions/state_store.h"
+
+#include "base/bind.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/run_loop.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "chrome/test/base/testing_profile.h"
+#include "content/public/test/test_browser_thread_bundle.h"
+#include "extensions/browser/value_store/testing_value_store.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace extensions {
+
+namespace {
+
+const char kExtensionId[] = "behllobkkfkfnphdnhnkndlbkcpglgmj";
+
+void SaveValue(scoped_ptr<base::Value>* result,
+               scoped_ptr<base::Value> value) {
+  *result = value.Pass();
+}
+
+class StateStoreTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    scoped_ptr<TestingValueStore> value_store(new TestingValueStore());
+    value_store_ = value_store.get();
+    store_.reset(new StateStore(&profile_, value_store.PassAs<ValueStore>()));
+  }
+
+  scoped_ptr<base::Value> GetValue(const std::string& key) {
+    scoped_ptr<base::Value> value;
+    store_->GetExtensionValue(kExtensionId, key,
+                              base::Bind(&SaveValue, &value));
+    base::RunLoop().RunUntilIdle();
+    return value.Pass();
+  }
+
+  content::TestBrowserThreadBundle thread_bundle_;
+  TestingProfile profile_;
+  // Owned by |store_|.
+  TestingValueStore* value_store_;
+  scoped_ptr<StateStore> store_;
+};
+
+}  // namespace
+
+TEST_F(StateStoreTest, WritesThrough) {
+  const int write_count = value_store_->write_count();
+  store_->SetExtensionValue(kExtensionId, "key",
+                            make_scoped_ptr(new base::FundamentalValue(1))
+                                .PassAs<base::Value>());
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(write_count + 1, value_store_->write_count());
+  EXPECT_EQ(1, store_->flushed_write_count());
+  EXPECT_EQ(0, store_->coalesced_write_count());
+}
+
+TEST_F(StateStoreTest, CoalescesWrites) {
+  store_->set_flush_delay(base::TimeDelta::FromHours(1));
+  const int write_count = value_store_->write_count();
+  for (int i = 0; i < 3; ++i) {
+    store_->SetExtensionValue(kExtensionId, "key",
+                              make_scoped_ptr(new base::FundamentalValue(i))
+                                  .PassAs<base::Value>());
+  }
+  store_->RemoveExtensionValue(kExtensionId, "removed");
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(write_count, value_store_->write_count());
+
+  // Buffered values are read from memory.
+  base::FundamentalValue expected(2);
+  scoped_ptr<base::Value> value = GetValue("key");
+  ASSERT_TRUE(value.get());
+  EXPECT_TRUE(expected.Equals(value.get()));
+  EXPECT_FALSE(GetValue("removed").get());
+
+  // Only the last write of each key reaches the database.
+  store_->FlushPendingWrites();
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(write_count + 2, value_store_->write_count());
+  EXPECT_EQ(2, store_->flushed_write_count());
+  EXPECT_EQ(2, store_->coalesced_write_count());
+}
+
+TEST_F(StateStoreTest, CachesReads) {
+  const std::string full_key = std::string(kExtensionId) + ".key";
+  base::StringValue stored("stored");
+  value_store_->Set(ValueStore::DEFAULTS, full_key, stored);
+
+  scoped_ptr<base::Value> value = GetValue("key");
+  ASSERT_TRUE(value.get());
+  EXPECT_TRUE(stored.Equals(value.get()));
+
+  // The value isn't read from the database again.
+  value_store_->Set(ValueStore::DEFAULTS, full_key,
+                    base::StringValue("changed"));
+  value = GetValue("key");
+  ASSERT_TRUE(value.get());
+  EXPECT_TRUE(stored.Equals(value.get()));
+}
+
+TEST_F(StateStoreTest, EvictsLeastRecentlyUsedValues) {
+  // Each value takes more than half of the cache.
+  const std::string large(StateStore::kMaxCachedBytes / 2 + 1, 'x');
+  store_->SetExtensionValue(kExtensionId, "first",
+                            make_scoped_ptr(new base::StringValue(large))
+                                .PassAs<base::Value>());
+  store_->SetExtensionValue(kExtensionId, "second",
+                            make_scoped_ptr(new base::StringValue(large))
+                                .PassAs<base::Value>());
+  base::RunLoop().RunUntilIdle();
+
+  // The first value was evicted, so it is read from the database again.
+  base::StringValue changed("changed");
+  value_store_->Set(ValueStore::DEFAULTS,
+                    std::string(kExtensionId) + ".first", changed);
+  value_store_->Set(ValueStore::DEFAULTS,
+                    std::string(kExtensionId) + ".second", changed);
+  scoped_ptr<base::Value> value = GetValue("first");
+  ASSERT_TRUE(value.get());
+  EXPECT_TRUE(changed.Equals(value.get()));
+
+  // The second value is still read from memory.
+  value = GetValue("second");
+  ASSERT_TRUE(value.get());
+  EXPECT_TRUE(base::StringValue(large).Equals(value.get()));
+}
+
+TEST_F(StateStoreTest, ForgetsRemovedValues) {
+  store_->set_flush_delay(base::TimeDelta::FromHours(1));
+  store_->SetExtensionValue(kExtensionId, "key",
+                            make_scoped_ptr(new base::FundamentalValue(1))
+                                .PassAs<base::Value>());
+  store_->RemoveExtensionValue(kExtensionId, "key");
+
+  // The pending removal answers reads until it is flushed.
+  EXPECT_FALSE(GetValue("key").get());
+  store_->FlushPendingWrites();
+  base::RunLoop().RunUntilIdle();
+
+  // Then the key is no longer kept in memory, and is read from the database.
+  base::FundamentalValue stored(2);
+  value_store_->Set(ValueStore::DEFAULTS, std::string(kExtensionId) + ".key",
+                    stored);
+  scoped_ptr<base::Value> value = GetValue("key");
+  ASSERT_TRUE(value.get());
+  EXPECT_TRUE(stored.Equals(value.get()));
+}
+
+}  // namespace extensions
@@ -54,6 +54,13 @@ class ExtensionCache {
                             const std::string& version,
                             const PutExtensionCallback& callback) = 0;
 
+  // Returns the path the .crx file of extension |id| and |version| should be
+  // downloaded to, so that PutExtension can move it into the cache without
+  // copying it. Returns an empty path if the extension won't be cached, in
+  // which case it should be downloaded to a temporary file.
+  virtual base::FilePath GetDownloadPath(const std::string& id,
+                                         const std::string& version) = 0;
+
  protected:
   virtual ~ExtensionCache() {}
 
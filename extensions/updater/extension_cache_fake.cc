@@ -67,4 +67,9 @@ void ExtensionCacheFake::PutExtension(const std::string& id,
   }
 }
 
+base::FilePath ExtensionCacheFake::GetDownloadPath(const std::string& id,
+                                                   const std::string& version) {
+  return base::FilePath();
+}
+
 }  // namespace extensions
@@ -30,6 +30,8 @@ class ExtensionCacheFake : public ExtensionCache {
                             const base::FilePath& file_path,
                             const std::string& version,
                             const PutExtensionCallback& callback) OVERRIDE;
+  virtual base::FilePath GetDownloadPath(const std::string& id,
+                                         const std::string& version) OVERRIDE;
 
  private:
   typedef std::map<std::string, std::pair<std::string, base::FilePath> > Map;
@@ -99,6 +99,14 @@ void ExtensionCacheImpl::PutExtension(const std::string& id,
     callback.Run(file_path, true);
 }
 
+base::FilePath ExtensionCacheImpl::GetDownloadPath(const std::string& id,
+                                                   const std::string& version) {
+  if (cache_ && ContainsKey(allowed_extensions_, id))
+    return cache_->GetDownloadPath(id, version);
+  else
+    return base::FilePath();
+}
+
 void ExtensionCacheImpl::OnCacheInitialized() {
   for (std::vector<base::Closure>::iterator it = init_callbacks_.begin();
        it != init_callbacks_.end(); ++it) {
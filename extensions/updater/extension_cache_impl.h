@@ -41,6 +41,8 @@ class ExtensionCacheImpl : public ExtensionCache,
                             const base::FilePath& file_path,
                             const std::string& version,
                             const PutExtensionCallback& callback) OVERRIDE;
+  virtual base::FilePath GetDownloadPath(const std::string& id,
+                                         const std::string& version) OVERRIDE;
 
   // Implementation of content::NotificationObserver:
   virtual void Observe(int type,
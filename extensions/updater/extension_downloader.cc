@@ -45,6 +45,8 @@ using content::BrowserThread;
 namespace extensions {
 
 const char ExtensionDownloader::kBlacklistAppID[] = "com.google.crx.blacklist";
+const size_t ExtensionDownloader::kMaxActiveFetches;
+const size_t ExtensionDownloader::kMaxActiveFetchesPerHost;
 
 namespace {
 
@@ -125,16 +127,27 @@ ExtensionDownloader::ExtensionDownloader(
       weak_ptr_factory_(this),
       manifests_queue_(&kDefaultBackoffPolicy,
           base::Bind(&ExtensionDownloader::CreateManifestFetcher,
-                     base::Unretained(this))),
+                     base::Unretained(this)),
+          base::Bind(&ExtensionDownloader::GetManifestFetchHost)),
       extensions_queue_(&kDefaultBackoffPolicy,
           base::Bind(&ExtensionDownloader::CreateExtensionFetcher,
-                     base::Unretained(this))),
+                     base::Unretained(this)),
+          base::Bind(&ExtensionDownloader::GetExtensionFetchHost)),
       extension_cache_(NULL) {
   DCHECK(delegate_);
   DCHECK(request_context_);
+  manifests_queue_.set_max_active_requests(kMaxActiveFetches,
+                                           kMaxActiveFetchesPerHost);
+  extensions_queue_.set_max_active_requests(kMaxActiveFetches,
+                                            kMaxActiveFetchesPerHost);
 }
 
-ExtensionDownloader::~ExtensionDownloader() {}
+ExtensionDownloader::~ExtensionDownloader() {
+  STLDeleteContainerPairFirstPointers(manifest_fetchers_.begin(),
+                                      manifest_fetchers_.end());
+  STLDeleteContainerPairFirstPointers(extension_fetchers_.begin(),
+                                      extension_fetchers_.end());
+}
 
 bool ExtensionDownloader::AddExtension(const Extension& extension,
                                        int request_id) {
@@ -368,66 +381,100 @@ void ExtensionDownloader::StartUpdateCheck(
     }
   }
 
-  if (manifests_queue_.active_request() &&
-      manifests_queue_.active_request()->full_url() == fetch_data->full_url()) {
-    manifests_queue_.active_request()->Merge(*fetch_data);
-  } else {
-    UMA_HISTOGRAM_COUNTS("Extensions.UpdateCheckUrlLength",
-        fetch_data->full_url().possibly_invalid_spec().length());
-
-    manifests_queue_.ScheduleRequest(fetch_data.Pass());
+  for (i = manifests_queue_.active_begin(); i != manifests_queue_.active_end();
+       ++i) {
+    if (fetch_data->full_url() == i->full_url()) {
+      // This url is already being fetched.
+      i->Merge(*fetch_data);
+      return;
+    }
   }
+
+  UMA_HISTOGRAM_COUNTS("Extensions.UpdateCheckUrlLength",
+      fetch_data->full_url().possibly_invalid_spec().length());
+
+  manifests_queue_.ScheduleRequest(fetch_data.Pass());
 }
 
-void ExtensionDownloader::CreateManifestFetcher() {
+void ExtensionDownloader::CreateManifestFetcher(
+    ManifestFetchData* fetch_data) {
   if (VLOG_IS_ON(2)) {
     std::vector<std::string> id_vector(
-        manifests_queue_.active_request()->extension_ids().begin(),
-        manifests_queue_.active_request()->extension_ids().end());
+        fetch_data->extension_ids().begin(),
+        fetch_data->extension_ids().end());
     std::string id_list = JoinString(id_vector, ',');
-    VLOG(2) << "Fetching " << manifests_queue_.active_request()->full_url()
+    VLOG(2) << "Fetching " << fetch_data->full_url()
             << " for " << id_list;
   }
 
-  manifest_fetcher_.reset(net::URLFetcher::Create(
-      kManifestFetcherId, manifests_queue_.active_request()->full_url(),
-      net::URLFetcher::GET, this));
-  manifest_fetcher_->SetRequestContext(request_context_);
-  manifest_fetcher_->SetLoadFlags(net::LOAD_DO_NOT_SEND_COOKIES |
-                                  net::LOAD_DO_NOT_SAVE_COOKIES |
-                                  net::LOAD_DISABLE_CACHE);
+  net::URLFetcher* manifest_fetcher = net::URLFetcher::Create(
+      kManifestFetcherId, fetch_data->full_url(), net::URLFetcher::GET, this);
+  manifest_fetchers_[manifest_fetcher] = fetch_data;
+  manifest_fetcher->SetRequestContext(request_context_);
+  manifest_fetcher->SetLoadFlags(net::LOAD_DO_NOT_SEND_COOKIES |
+                                 net::LOAD_DO_NOT_SAVE_COOKIES |
+                                 net::LOAD_DISABLE_CACHE);
   // Update checks can be interrupted if a network change is detected; this is
   // common for the retail mode AppPack on ChromeOS. Retrying once should be
   // enough to recover in those cases; let the fetcher retry up to 3 times
   // just in case. http://crosbug.com/130602
-  manifest_fetcher_->SetAutomaticallyRetryOnNetworkChanges(3);
-  manifest_fetcher_->Start();
+  manifest_fetcher->SetAutomaticallyRetryOnNetworkChanges(3);
+  manifest_fetcher->Start();
+}
+
+// static
+std::string ExtensionDownloader::GetManifestFetchHost(
+    const ManifestFetchData& fetch_data) {
+  return fetch_data.base_url().host();
+}
+
+// static
+std::string ExtensionDownloader::GetExtensionFetchHost(
+    const ExtensionFetch& fetch_data) {
+  return fetch_data.url.host();
 }
 
 void ExtensionDownloader::OnURLFetchComplete(
     const net::URLFetcher* source) {
   VLOG(2) << source->GetResponseCode() << " " << source->GetURL();
 
-  if (source == manifest_fetcher_.get()) {
+  // The fetcher is deleted once its response is handled.
+  ManifestFetcherMap::iterator manifest_it = manifest_fetchers_.find(source);
+  if (manifest_it != manifest_fetchers_.end()) {
+    scoped_ptr<const net::URLFetcher> fetcher(source);
+    ManifestFetchData* fetch_data = manifest_it->second;
+    manifest_fetchers_.erase(manifest_it);
     std::string data;
     source->GetResponseAsString(&data);
-    OnManifestFetchComplete(source->GetURL(),
+    OnManifestFetchComplete(fetch_data,
+                            source->GetURL(),
                             source->GetStatus(),
                             source->GetResponseCode(),
                             source->GetBackoffDelay(),
                             data);
-  } else if (source == extension_fetcher_.get()) {
-    OnCRXFetchComplete(source,
+    return;
+  }
+
+  ExtensionFetcherMap::iterator extension_it =
+      extension_fetchers_.find(source);
+  if (extension_it != extension_fetchers_.end()) {
+    scoped_ptr<const net::URLFetcher> fetcher(source);
+    ExtensionFetch* fetch_data = extension_it->second;
+    extension_fetchers_.erase(extension_it);
+    OnCRXFetchComplete(fetch_data,
+                       source,
                        source->GetURL(),
                        source->GetStatus(),
                        source->GetResponseCode(),
                        source->GetBackoffDelay());
-  } else {
-    NOTREACHED();
+    return;
   }
+
+  NOTREACHED();
 }
 
 void ExtensionDownloader::OnManifestFetchComplete(
+    ManifestFetchData* fetch_data,
     const GURL& url,
     const net::URLRequestStatus& status,
     int response_code,
@@ -438,12 +485,13 @@ void ExtensionDownloader::OnManifestFetchComplete(
   if (status.status() == net::URLRequestStatus::SUCCESS &&
       (response_code == 200 || (url.SchemeIsFile() && data.length() > 0))) {
     RETRY_HISTOGRAM("ManifestFetchSuccess",
-                    manifests_queue_.active_request_failure_count(), url);
+                    manifests_queue_.active_request_failure_count(fetch_data),
+                    url);
     VLOG(2) << "beginning manifest parse for " << url;
     scoped_refptr<SafeManifestParser> safe_parser(
         new SafeManifestParser(
             data,
-            manifests_queue_.reset_active_request().release(),
+            manifests_queue_.reset_active_request(fetch_data).release(),
             base::Bind(&ExtensionDownloader::HandleManifestResults,
                        weak_ptr_factory_.GetWeakPtr())));
     safe_parser->Start();
@@ -451,21 +499,22 @@ void ExtensionDownloader::OnManifestFetchComplete(
     VLOG(1) << "Failed to fetch manifest '" << url.possibly_invalid_spec()
             << "' response code:" << response_code;
     if (ShouldRetryRequest(status, response_code) &&
-        manifests_queue_.active_request_failure_count() < kMaxRetries) {
-      manifests_queue_.RetryRequest(backoff_delay);
+        manifests_queue_.active_request_failure_count(fetch_data) <
+            kMaxRetries) {
+      manifests_queue_.RetryRequest(fetch_data, backoff_delay);
     } else {
       RETRY_HISTOGRAM("ManifestFetchFailure",
-                      manifests_queue_.active_request_failure_count(), url);
+                      manifests_queue_.active_request_failure_count(fetch_data),
+                      url);
       NotifyExtensionsDownloadFailed(
-          manifests_queue_.active_request()->extension_ids(),
-          manifests_queue_.active_request()->request_ids(),
+          fetch_data->extension_ids(),
+          fetch_data->request_ids(),
           ExtensionDownloaderDelegate::MANIFEST_FETCH_FAILED);
+      manifests_queue_.reset_active_request(fetch_data);
     }
   }
-  manifest_fetcher_.reset();
-  manifests_queue_.reset_active_request();
 
-  // If we have any pending manifest requests, fire off the next one.
+  // If we have any pending manifest requests, fire off the next ones.
   manifests_queue_.StartNextRequest();
 }
 
@@ -629,23 +678,27 @@ void ExtensionDownloader::FetchUpdatedExtension(
     }
   }
 
-  if (extensions_queue_.active_request() &&
-      extensions_queue_.active_request()->url == fetch_data->url) {
-    extensions_queue_.active_request()->request_ids.insert(
-        fetch_data->request_ids.begin(), fetch_data->request_ids.end());
-  } else {
-    std::string version;
-    if (extension_cache_ &&
-        extension_cache_->GetExtension(fetch_data->id, NULL, &version) &&
-        version == fetch_data->version) {
-      base::FilePath crx_path;
-      // Now get .crx file path and mark extension as used.
-      extension_cache_->GetExtension(fetch_data->id, &crx_path, &version);
-      NotifyDelegateDownloadFinished(fetch_data.Pass(), crx_path, false);
-    } else {
-      extensions_queue_.ScheduleRequest(fetch_data.Pass());
+  for (RequestQueue<ExtensionFetch>::iterator iter =
+           extensions_queue_.active_begin();
+       iter != extensions_queue_.active_end(); ++iter) {
+    if (iter->url == fetch_data->url) {
+      iter->request_ids.insert(fetch_data->request_ids.begin(),
+                               fetch_data->request_ids.end());
+      return;  // already being fetched
     }
   }
+
+  std::string version;
+  if (extension_cache_ &&
+      extension_cache_->GetExtension(fetch_data->id, NULL, &version) &&
+      version == fetch_data->version) {
+    base::FilePath crx_path;
+    // Now get .crx file path and mark extension as used.
+    extension_cache_->GetExtension(fetch_data->id, &crx_path, &version);
+    NotifyDelegateDownloadFinished(fetch_data.Pass(), crx_path, false);
+  } else {
+    extensions_queue_.ScheduleRequest(fetch_data.Pass());
+  }
 }
 
 void ExtensionDownloader::NotifyDelegateDownloadFinished(
@@ -658,46 +711,60 @@ void ExtensionDownloader::NotifyDelegateDownloadFinished(
   ping_results_.erase(fetch_data->id);
 }
 
-void ExtensionDownloader::CreateExtensionFetcher() {
-  const ExtensionFetch* fetch = extensions_queue_.active_request();
+void ExtensionDownloader::CreateExtensionFetcher(ExtensionFetch* fetch) {
   int load_flags = net::LOAD_DISABLE_CACHE;
   if (!fetch->is_protected || !fetch->url.SchemeIs("https")) {
       load_flags |= net::LOAD_DO_NOT_SEND_COOKIES |
                     net::LOAD_DO_NOT_SAVE_COOKIES;
   }
-  extension_fetcher_.reset(net::URLFetcher::Create(
-      kExtensionFetcherId, fetch->url, net::URLFetcher::GET, this));
-  extension_fetcher_->SetRequestContext(request_context_);
-  extension_fetcher_->SetLoadFlags(load_flags);
-  extension_fetcher_->SetAutomaticallyRetryOnNetworkChanges(3);
-  // Download CRX files to a temp file. The blacklist is small and will be
+  net::URLFetcher* extension_fetcher = net::URLFetcher::Create(
+      kExtensionFetcherId, fetch->url, net::URLFetcher::GET, this);
+  extension_fetchers_[extension_fetcher] = fetch;
+  extension_fetcher->SetRequestContext(request_context_);
+  extension_fetcher->SetLoadFlags(load_flags);
+  extension_fetcher->SetAutomaticallyRetryOnNetworkChanges(3);
+  // Download CRX files to a file. The blacklist is small and will be
   // processed in memory, so it is fetched into a string.
   if (fetch->id != kBlacklistAppID) {
-    extension_fetcher_->SaveResponseToTemporaryFile(
-        BrowserThread::GetMessageLoopProxyForThread(BrowserThread::FILE));
+    // Extensions which will be cached are downloaded into the cache
+    // directory, so that putting them in the cache doesn't copy them.
+    base::FilePath download_path;
+    if (extension_cache_) {
+      download_path =
+          extension_cache_->GetDownloadPath(fetch->id, fetch->version);
+    }
+    scoped_refptr<base::SequencedTaskRunner> file_task_runner =
+        BrowserThread::GetMessageLoopProxyForThread(BrowserThread::FILE);
+    if (download_path.empty())
+      extension_fetcher->SaveResponseToTemporaryFile(file_task_runner);
+    else
+      extension_fetcher->SaveResponseToFileAtPath(download_path,
+                                                  file_task_runner);
   }
 
   VLOG(2) << "Starting fetch of " << fetch->url << " for " << fetch->id;
 
-  extension_fetcher_->Start();
+  extension_fetcher->Start();
 }
 
 void ExtensionDownloader::OnCRXFetchComplete(
+    ExtensionFetch* fetch,
     const net::URLFetcher* source,
     const GURL& url,
     const net::URLRequestStatus& status,
     int response_code,
     const base::TimeDelta& backoff_delay) {
-  const std::string& id = extensions_queue_.active_request()->id;
+  const std::string id = fetch->id;
   if (status.status() == net::URLRequestStatus::SUCCESS &&
       (response_code == 200 || url.SchemeIsFile())) {
     RETRY_HISTOGRAM("CrxFetchSuccess",
-                    extensions_queue_.active_request_failure_count(), url);
+                    extensions_queue_.active_request_failure_count(fetch),
+                    url);
     base::FilePath crx_path;
     // Take ownership of the file at |crx_path|.
     CHECK(source->GetResponseAsFilePath(true, &crx_path));
     scoped_ptr<ExtensionFetch> fetch_data =
-        extensions_queue_.reset_active_request();
+        extensions_queue_.reset_active_request(fetch);
     if (extension_cache_) {
       const std::string& version = fetch_data->version;
       extension_cache_->PutExtension(id, crx_path, version,
@@ -709,35 +776,33 @@ void ExtensionDownloader::OnCRXFetchComplete(
     }
   } else if (status.status() == net::URLRequestStatus::SUCCESS &&
              (response_code == 401 || response_code == 403) &&
-             !extensions_queue_.active_request()->is_protected) {
+             !fetch->is_protected) {
     // On 401 or 403, requeue this fetch with cookies enabled.
-    extensions_queue_.active_request()->is_protected = true;
-    extensions_queue_.RetryRequest(backoff_delay);
+    fetch->is_protected = true;
+    extensions_queue_.RetryRequest(fetch, backoff_delay);
   } else {
-    const std::set<int>& request_ids =
-        extensions_queue_.active_request()->request_ids;
     const ExtensionDownloaderDelegate::PingResult& ping = ping_results_[id];
 
     VLOG(1) << "Failed to fetch extension '" << url.possibly_invalid_spec()
             << "' response code:" << response_code;
     if (ShouldRetryRequest(status, response_code) &&
-        extensions_queue_.active_request_failure_count() < kMaxRetries) {
-      extensions_queue_.RetryRequest(backoff_delay);
+        extensions_queue_.active_request_failure_count(fetch) < kMaxRetries) {
+      extensions_queue_.RetryRequest(fetch, backoff_delay);
     } else {
       RETRY_HISTOGRAM("CrxFetchFailure",
-                      extensions_queue_.active_request_failure_count(), url);
+                      extensions_queue_.active_request_failure_count(fetch),
+                      url);
       // status.error() is 0 (net::OK) or negative. (See net/base/net_errors.h)
       UMA_HISTOGRAM_SPARSE_SLOWLY("Extensions.CrxFetchError", -status.error());
       delegate_->OnExtensionDownloadFailed(
-          id, ExtensionDownloaderDelegate::CRX_FETCH_FAILED, ping, request_ids);
+          id, ExtensionDownloaderDelegate::CRX_FETCH_FAILED, ping,
+          fetch->request_ids);
+      extensions_queue_.reset_active_request(fetch);
     }
     ping_results_.erase(id);
-    extensions_queue_.reset_active_request();
   }
 
-  extension_fetcher_.reset();
-
-  // If there are any pending downloads left, start the next one.
+  // If there are any pending downloads left, start the next ones.
   extensions_queue_.StartNextRequest();
 }
 
@@ -49,6 +49,10 @@ class ExtensionUpdaterTest;
 // the crx file when updates are found. It uses a |ExtensionDownloaderDelegate|
 // that takes ownership of the downloaded crx files, and handles events during
 // the update check.
+//
+// Several manifests and crx files are fetched at once, with a limit on the
+// fetches to each host. Fetches to a host which fails are backed off
+// together.
 class ExtensionDownloader : public net::URLFetcherDelegate {
  public:
   // |delegate| is stored as a raw pointer and must outlive the
@@ -94,6 +98,11 @@ class ExtensionDownloader : public net::URLFetcherDelegate {
 
   static const int kMaxRetries = 10;
 
+  // The most manifest or crx fetches in flight at once, in total and to each
+  // host.
+  static const size_t kMaxActiveFetches = 6;
+  static const size_t kMaxActiveFetchesPerHost = 2;
+
  private:
   friend class ExtensionUpdaterTest;
 
@@ -148,14 +157,20 @@ class ExtensionDownloader : public net::URLFetcherDelegate {
   // Begins an update check.
   void StartUpdateCheck(scoped_ptr<ManifestFetchData> fetch_data);
 
-  // Called by RequestQueue when a new manifest fetch request is started.
-  void CreateManifestFetcher();
+  // Called by RequestQueue when the manifest fetch request |fetch_data| is
+  // started.
+  void CreateManifestFetcher(ManifestFetchData* fetch_data);
+
+  // Return the host of fetch requests, for RequestQueue.
+  static std::string GetManifestFetchHost(const ManifestFetchData& fetch_data);
+  static std::string GetExtensionFetchHost(const ExtensionFetch& fetch_data);
 
   // net::URLFetcherDelegate implementation.
   virtual void OnURLFetchComplete(const net::URLFetcher* source) OVERRIDE;
 
-  // Handles the result of a manifest fetch.
-  void OnManifestFetchComplete(const GURL& url,
+  // Handles the result of the manifest fetch of |fetch_data|.
+  void OnManifestFetchComplete(ManifestFetchData* fetch_data,
+                               const GURL& url,
                                const net::URLRequestStatus& status,
                                int response_code,
                                const base::TimeDelta& backoff_delay,
@@ -175,11 +190,13 @@ class ExtensionDownloader : public net::URLFetcherDelegate {
   // Begins (or queues up) download of an updated extension.
   void FetchUpdatedExtension(scoped_ptr<ExtensionFetch> fetch_data);
 
-  // Called by RequestQueue when a new extension fetch request is started.
-  void CreateExtensionFetcher();
+  // Called by RequestQueue when the extension fetch request |fetch_data| is
+  // started.
+  void CreateExtensionFetcher(ExtensionFetch* fetch_data);
 
-  // Handles the result of a crx fetch.
-  void OnCRXFetchComplete(const net::URLFetcher* source,
+  // Handles the result of the crx fetch of |fetch_data|.
+  void OnCRXFetchComplete(ExtensionFetch* fetch_data,
+                          const net::URLFetcher* source,
                           const GURL& url,
                           const net::URLRequestStatus& status,
                           int response_code,
@@ -225,9 +242,14 @@ class ExtensionDownloader : public net::URLFetcherDelegate {
                    std::vector<linked_ptr<ManifestFetchData> > > FetchMap;
   FetchMap fetches_preparing_;
 
-  // Outstanding url fetch requests for manifests and updates.
-  scoped_ptr<net::URLFetcher> manifest_fetcher_;
-  scoped_ptr<net::URLFetcher> extension_fetcher_;
+  // Outstanding url fetch requests for manifests and updates, mapped to the
+  // active request of the queue they fetch. The fetchers are owned.
+  typedef std::map<const net::URLFetcher*, ManifestFetchData*>
+      ManifestFetcherMap;
+  typedef std::map<const net::URLFetcher*, ExtensionFetch*>
+      ExtensionFetcherMap;
+  ManifestFetcherMap manifest_fetchers_;
+  ExtensionFetcherMap extension_fetchers_;
 
   // Pending manifests and extensions to be fetched when the appropriate fetcher
   // is available.
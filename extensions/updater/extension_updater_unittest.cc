@@ -559,7 +559,7 @@ class ExtensionUpdaterTest : public testing::Test {
 
   size_t ManifestFetchersCount(ExtensionDownloader* downloader) {
     return downloader->manifests_queue_.size() +
-           (downloader->manifest_fetcher_.get() ? 1 : 0);
+           downloader->manifests_queue_.active_request_count();
   }
 
   void TestExtensionUpdateCheckRequests(bool pending) {
@@ -796,6 +796,8 @@ class ExtensionUpdaterTest : public testing::Test {
     MockExtensionDownloaderDelegate delegate;
     ExtensionDownloader downloader(&delegate, service.request_context());
     downloader.manifests_queue_.set_backoff_policy(&kNoBackoffPolicy);
+    // Fetch the manifests one at a time, to control the order of responses.
+    downloader.manifests_queue_.set_max_active_requests(1, 1);
 
     GURL kUpdateUrl("http://localhost/manifest1");
 
@@ -984,6 +986,74 @@ class ExtensionUpdaterTest : public testing::Test {
     Mock::VerifyAndClearExpectations(&delegate);
   }
 
+  void TestConcurrentManifestDownloading() {
+    net::TestURLFetcherFactory factory;
+    MockService service(prefs_.get());
+    MockExtensionDownloaderDelegate delegate;
+    ExtensionDownloader downloader(&delegate, service.request_context());
+    RequestQueue<ManifestFetchData>& manifests_queue =
+        downloader.manifests_queue_;
+    ManifestFetchData::PingData zeroDays(0, 0, true);
+    int next_id = 0;
+
+    // Only a few manifests are fetched at once from the same host.
+    const size_t kPerHost = ExtensionDownloader::kMaxActiveFetchesPerHost;
+    for (size_t i = 0; i <= kPerHost; ++i) {
+      ManifestFetchData* fetch =
+          new ManifestFetchData(GURL("http://localhost/manifest"), 0);
+      fetch->AddExtension(base::IntToString(next_id++), "1.0", &zeroDays,
+                          kEmptyUpdateUrlData, std::string());
+      StartUpdateCheck(&downloader, fetch);
+    }
+    EXPECT_EQ(kPerHost, manifests_queue.active_request_count());
+    EXPECT_EQ(1u, manifests_queue.size());
+
+    // Other hosts are fetched from at the same time, up to the total limit.
+    const size_t kOtherHosts = ExtensionDownloader::kMaxActiveFetches;
+    for (size_t i = 0; i < kOtherHosts; ++i) {
+      ManifestFetchData* fetch = new ManifestFetchData(
+          GURL(base::StringPrintf("http://host%d.com/manifest",
+                                  static_cast<int>(i))),
+          0);
+      fetch->AddExtension(base::IntToString(next_id++), "1.0", &zeroDays,
+                          kEmptyUpdateUrlData, std::string());
+      StartUpdateCheck(&downloader, fetch);
+    }
+    const size_t kPending = kPerHost + 1 + kOtherHosts -
+                            ExtensionDownloader::kMaxActiveFetches;
+    EXPECT_EQ(ExtensionDownloader::kMaxActiveFetches,
+              manifests_queue.active_request_count());
+    EXPECT_EQ(kPending, manifests_queue.size());
+
+    // When a fetch completes, a request to another host takes its place. The
+    // request to localhost is still waiting for its host.
+    net::TestURLFetcher* fetcher =
+        factory.GetFetcherByID(ExtensionDownloader::kManifestFetcherId);
+    ASSERT_TRUE(fetcher != NULL && fetcher->delegate() != NULL);
+    EXPECT_CALL(delegate, OnExtensionDownloadFailed(
+        _, ExtensionDownloaderDelegate::MANIFEST_FETCH_FAILED, _, _));
+    fetcher->set_url(fetcher->GetOriginalURL());
+    fetcher->set_status(net::URLRequestStatus());
+    fetcher->set_response_code(400);
+    fetcher->delegate()->OnURLFetchComplete(fetcher);
+    Mock::VerifyAndClearExpectations(&delegate);
+    EXPECT_EQ(ExtensionDownloader::kMaxActiveFetches,
+              manifests_queue.active_request_count());
+    EXPECT_EQ(kPending - 1, manifests_queue.size());
+    EXPECT_EQ(kPerHost, ActiveRequestsToHost(&manifests_queue, "localhost"));
+  }
+
+  size_t ActiveRequestsToHost(RequestQueue<ManifestFetchData>* queue,
+                              const std::string& host) {
+    size_t count = 0;
+    for (RequestQueue<ManifestFetchData>::iterator it = queue->active_begin();
+         it != queue->active_end(); ++it) {
+      if (it->base_url().host() == host)
+        ++count;
+    }
+    return count;
+  }
+
   void TestSingleExtensionDownloading(bool pending, bool retry, bool fail) {
     net::TestURLFetcherFactory factory;
     net::TestURLFetcher* fetcher = NULL;
@@ -1146,7 +1216,8 @@ class ExtensionUpdaterTest : public testing::Test {
       fetcher->set_response_code(403);
       fetcher->delegate()->OnURLFetchComplete(fetcher);
       RunUntilIdle();
-      EXPECT_EQ(0U, updater.downloader_->extensions_queue_.active_request());
+      EXPECT_EQ(0U,
+                updater.downloader_->extensions_queue_.active_request_count());
     } else {
       // Succeed
       base::FilePath extension_file_path(FILE_PATH_LITERAL("/whatever"));
@@ -1183,6 +1254,8 @@ class ExtensionUpdaterTest : public testing::Test {
         new ExtensionDownloader(&updater, service.request_context()));
     updater.downloader_->extensions_queue_.set_backoff_policy(
         &kNoBackoffPolicy);
+    // Fetch the extensions one at a time, to control the order of responses.
+    updater.downloader_->extensions_queue_.set_max_active_requests(1, 1);
 
     EXPECT_FALSE(updater.crx_install_is_running_);
 
@@ -1396,21 +1469,17 @@ class ExtensionUpdaterTest : public testing::Test {
     updater.CheckNow(params);
 
     // Make the updater do manifest fetching, and note the urls it tries to
-    // fetch.
+    // fetch. The manifests are on different hosts, so both are fetched at
+    // once.
     std::vector<GURL> fetched_urls;
-    net::TestURLFetcher* fetcher =
-      factory.GetFetcherByID(ExtensionDownloader::kManifestFetcherId);
-    EXPECT_TRUE(fetcher != NULL && fetcher->delegate() != NULL);
-    fetched_urls.push_back(fetcher->GetOriginalURL());
-
-    fetcher->set_url(fetched_urls[0]);
-    fetcher->set_status(net::URLRequestStatus());
-    fetcher->set_response_code(500);
-    fetcher->SetResponseString(std::string());
-    fetcher->delegate()->OnURLFetchComplete(fetcher);
-
-    fetcher = factory.GetFetcherByID(ExtensionDownloader::kManifestFetcherId);
-    fetched_urls.push_back(fetcher->GetOriginalURL());
+    RequestQueue<ManifestFetchData>& manifests_queue =
+        updater.downloader_->manifests_queue_;
+    ASSERT_EQ(2u, manifests_queue.active_request_count());
+    for (RequestQueue<ManifestFetchData>::iterator it =
+             manifests_queue.active_begin();
+         it != manifests_queue.active_end(); ++it) {
+      fetched_urls.push_back(it->full_url());
+    }
 
     // The urls could have been fetched in either order, so use the host to
     // tell them apart and note the query each used.
@@ -1616,6 +1685,10 @@ TEST_F(ExtensionUpdaterTest, TestManifestRetryDownloading) {
   TestManifestRetryDownloading();
 }
 
+TEST_F(ExtensionUpdaterTest, TestConcurrentManifestDownloading) {
+  TestConcurrentManifestDownloading();
+}
+
 TEST_F(ExtensionUpdaterTest, TestGalleryRequestsWithOrganicBrand) {
   TestGalleryRequestsWithBrand(true);
 }
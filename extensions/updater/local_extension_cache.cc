@@ -20,6 +20,9 @@ namespace {
 // File name extension for CRX files (not case sensitive).
 const char kCRXFileExtension[] = ".crx";
 
+// Suffix of .crx files being downloaded into the cache directory.
+const char kDownloadFileExtension[] = ".download";
+
 // Delay between checks for flag file presence when waiting for the cache to
 // become ready.
 const int64_t kCacheStatusPollingDelayMs = 1000;
@@ -135,6 +138,16 @@ void LocalExtensionCache::PutExtension(const std::string& id,
                   callback));
 }
 
+base::FilePath LocalExtensionCache::GetDownloadPath(
+    const std::string& id,
+    const std::string& version) const {
+  if (state_ != kReady || !Version(version).IsValid())
+    return base::FilePath();
+
+  return cache_dir_.AppendASCII(
+      id + "-" + version + kCRXFileExtension + kDownloadFileExtension);
+}
+
 bool LocalExtensionCache::RemoveExtension(const std::string& id) {
   if (state_ != kReady)
     return false;
@@ -69,6 +69,13 @@ class LocalExtensionCache {
                     const std::string& version,
                     const PutExtensionCallback& callback);
 
+  // Returns a path in the cache directory that the .crx file of extension
+  // |id| and |version| can be downloaded to, so that PutExtension only has to
+  // rename it. Returns an empty path if the cache is not ready. Downloads left
+  // over in the cache directory are erased on the next start.
+  base::FilePath GetDownloadPath(const std::string& id,
+                                 const std::string& version) const;
+
   // Remove extension with |id| from local cache, corresponding crx file will be
   // removed from disk too.
   bool RemoveExtension(const std::string& id);
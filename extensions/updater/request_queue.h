@@ -6,6 +6,8 @@
 #define CHROME_BROWSER_EXTENSIONS_UPDATER_REQUEST_QUEUE_H_
 
 #include <deque>
+#include <map>
+#include <string>
 #include <utility>
 
 #include "base/callback.h"
@@ -19,40 +21,52 @@ namespace extensions {
 
 // This class keeps track of a queue of requests, and contains the logic to
 // retry requests with some backoff policy. Each request has a
-// net::BackoffEntry instance associated with it.
+// net::BackoffEntry instance associated with it. Several requests can be
+// processed at once, with a limit on the total and on the requests to each
+// host. Requests to the same host also share a net::BackoffEntry, so that a
+// failing host is backed off as a whole instead of request by request.
 //
 // The general flow when using this class would be something like this:
 //   - requests are queued up by calling ScheduleRequest.
 //   - when a request is ready to be executed, RequestQueue removes the
-//     request from the queue, assigns it as active request, and calls
-//     the callback that was passed to the constructor.
+//     request from the queue, makes it an active request, and calls
+//     the callback that was passed to the constructor with it.
 //   - (optionally) when a request has completed unsuccessfully call
 //     RetryRequest to put the request back in the queue, using the
 //     backoff policy and minimum backoff delay to determine when to
 //     next schedule this request.
-//   - call reset_active_request() to indicate that the active request has
-//     been dealt with.
-//   - call StartNextRequest to schedule the next pending request (if any).
+//   - otherwise call reset_active_request() to indicate that the active
+//     request has been dealt with.
+//   - call StartNextRequest to schedule the next pending requests (if any).
 template<typename T>
 class RequestQueue {
  public:
   class iterator;
 
+  // Called with each request as it becomes active.
+  typedef base::Callback<void(T*)> StartRequestCallback;
+
+  // Returns the host of a request.
+  typedef base::Callback<std::string(const T&)> HostCallback;
+
   RequestQueue(const net::BackoffEntry::Policy* backoff_policy,
-               const base::Closure& start_request_callback);
+               const StartRequestCallback& start_request_callback,
+               const HostCallback& host_callback);
   ~RequestQueue();
 
-  // Returns the request that is currently being processed.
-  T* active_request();
+  // Returns the number of requests currently being processed.
+  size_t active_request_count() const;
 
-  // Returns the number of times the current request has been retried already.
-  int active_request_failure_count();
+  // Returns the number of times the active |request| has been retried already.
+  int active_request_failure_count(const T* request);
 
-  // Signals RequestQueue that processing of the current request has completed.
-  scoped_ptr<T> reset_active_request();
+  // Signals RequestQueue that processing of the active |request| has
+  // completed. The host of a request which completes without being retried,
+  // even unsuccessfully, is responsive: this relaxes its shared backoff.
+  scoped_ptr<T> reset_active_request(const T* request);
 
-  // Add the given request to the queue, and starts the next request if no
-  // request is currently being processed.
+  // Add the given request to the queue, and starts the next requests if the
+  // limits on active requests allow it.
   void ScheduleRequest(scoped_ptr<T> request);
 
   bool empty() const;
@@ -61,24 +75,34 @@ class RequestQueue {
   // Returns the earliest release time of all requests currently in the queue.
   base::TimeTicks NextReleaseTime() const;
 
-  // Starts the next request, if no request is currently active. This will
-  // synchronously call the start_request_callback if the release time of the
-  // earliest available request is in the past, otherwise it will call that
-  // callback asynchronously after enough time has passed.
+  // Starts pending requests until the limits on active requests are reached.
+  // This will synchronously call the start_request_callback for each request
+  // whose release time, and the release time of its host, are in the past.
+  // If no other request can be started yet, it will call this method again
+  // asynchronously after enough time has passed.
   void StartNextRequest();
 
-  // Tell RequestQueue to put the current request back in the queue, after
-  // applying the backoff policy to determine when to next try this request.
-  // If the policy results in a backoff delay smaller than |min_backoff_delay|,
-  // that delay is used instead.
-  void RetryRequest(const base::TimeDelta& min_backoff_delay);
+  // Tell RequestQueue to put the active |request| back in the queue, after
+  // applying the backoff policy to determine when to next try this request
+  // and its host. If the policy results in a backoff delay smaller than
+  // |min_backoff_delay|, that delay is used instead.
+  void RetryRequest(const T* request, const base::TimeDelta& min_backoff_delay);
 
   iterator begin();
   iterator end();
 
+  // Iterates over the active requests.
+  iterator active_begin();
+  iterator active_end();
+
   // Change the backoff policy used by the queue.
   void set_backoff_policy(const net::BackoffEntry::Policy* backoff_policy);
 
+  // Change the limits on the number of requests processed at once, in total
+  // and for each host. Both must be at least 1.
+  void set_max_active_requests(size_t max_active_requests,
+                               size_t max_active_requests_per_host);
+
  private:
   struct Request {
     Request(net::BackoffEntry* backoff_entry, T* request)
@@ -95,22 +119,40 @@ class RequestQueue {
   void PushImpl(scoped_ptr<T> request,
                 scoped_ptr<net::BackoffEntry> backoff_entry);
 
+  // Returns the shared backoff entry of |host|, creating it if needed.
+  net::BackoffEntry* GetHostBackoffEntry(const std::string& host);
+
+  // Returns the number of active requests to |host|.
+  size_t ActiveRequestCount(const std::string& host) const;
+
+  // Returns the active request entry of |request|.
+  typename std::deque<Request>::iterator FindActiveRequest(const T* request);
+
   // The backoff policy used to determine backoff delays.
   const net::BackoffEntry::Policy* backoff_policy_;
 
-  // Callback to call when a new request has become the active request.
-  base::Closure start_request_callback_;
+  // Callback to call when a new request has become an active request.
+  StartRequestCallback start_request_callback_;
+
+  // Returns the host of a request.
+  HostCallback host_callback_;
+
+  // Limits on the number of active requests.
+  size_t max_active_requests_;
+  size_t max_active_requests_per_host_;
 
   // Priority queue of pending requests. Not using std::priority_queue since
   // the code needs to be able to iterate over all pending requests.
   std::deque<Request> pending_requests_;
 
-  // Active request and its associated backoff entry.
-  scoped_ptr<T> active_request_;
-  scoped_ptr<net::BackoffEntry> active_backoff_entry_;
+  // Active requests and their associated backoff entries.
+  std::deque<Request> active_requests_;
+
+  // Backoff entries shared by the requests to each host.
+  std::map<std::string, linked_ptr<net::BackoffEntry> > host_backoff_entries_;
 
-  // Timer to schedule calls to StartNextRequest, if the first pending request
-  // hasn't passed its release time yet.
+  // Timer to schedule calls to StartNextRequest, if no pending request has
+  // passed its release time yet.
   base::Timer timer_;
 };
 
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 
+#include "base/basictypes.h"
 #include "base/bind.h"
 #include "base/compiler_specific.h"
 #include "base/message_loop/message_loop.h"
@@ -18,9 +19,13 @@ namespace extensions {
 template<typename T>
 RequestQueue<T>::RequestQueue(
     const net::BackoffEntry::Policy* const backoff_policy,
-    const base::Closure& start_request_callback)
+    const StartRequestCallback& start_request_callback,
+    const HostCallback& host_callback)
     : backoff_policy_(backoff_policy),
       start_request_callback_(start_request_callback),
+      host_callback_(host_callback),
+      max_active_requests_(1),
+      max_active_requests_per_host_(1),
       timer_(false, false) {
 }
 
@@ -28,19 +33,22 @@ template<typename T>
 RequestQueue<T>::~RequestQueue() {}
 
 template<typename T>
-T* RequestQueue<T>::active_request() {
-  return active_request_.get();
+size_t RequestQueue<T>::active_request_count() const {
+  return active_requests_.size();
 }
 
 template<typename T>
-int RequestQueue<T>::active_request_failure_count() {
-  return active_backoff_entry_->failure_count();
+int RequestQueue<T>::active_request_failure_count(const T* request) {
+  return FindActiveRequest(request)->backoff_entry->failure_count();
 }
 
 template<typename T>
-scoped_ptr<T> RequestQueue<T>::reset_active_request() {
-  active_backoff_entry_.reset();
-  return active_request_.Pass();
+scoped_ptr<T> RequestQueue<T>::reset_active_request(const T* request) {
+  typename std::deque<Request>::iterator it = FindActiveRequest(request);
+  GetHostBackoffEntry(host_callback_.Run(*request))->InformOfRequest(true);
+  scoped_ptr<T> result(it->request.release());
+  active_requests_.erase(it);
+  return result.Pass();
 }
 
 template<typename T>
@@ -59,6 +67,37 @@ void RequestQueue<T>::PushImpl(scoped_ptr<T> request,
                  CompareRequests);
 }
 
+template<typename T>
+net::BackoffEntry* RequestQueue<T>::GetHostBackoffEntry(
+    const std::string& host) {
+  linked_ptr<net::BackoffEntry>& entry = host_backoff_entries_[host];
+  if (!entry.get())
+    entry.reset(new net::BackoffEntry(backoff_policy_));
+  return entry.get();
+}
+
+template<typename T>
+size_t RequestQueue<T>::ActiveRequestCount(const std::string& host) const {
+  size_t count = 0;
+  for (typename std::deque<Request>::const_iterator it =
+           active_requests_.begin();
+       it != active_requests_.end(); ++it) {
+    if (host_callback_.Run(*it->request) == host)
+      ++count;
+  }
+  return count;
+}
+
+template<typename T>
+typename std::deque<typename RequestQueue<T>::Request>::iterator
+RequestQueue<T>::FindActiveRequest(const T* request) {
+  typename std::deque<Request>::iterator it = active_requests_.begin();
+  while (it != active_requests_.end() && it->request.get() != request)
+    ++it;
+  CHECK(it != active_requests_.end());
+  return it;
+}
+
 template<typename T>
 bool RequestQueue<T>::empty() const {
   return pending_requests_.empty();
@@ -76,52 +115,72 @@ base::TimeTicks RequestQueue<T>::NextReleaseTime() const {
 
 template<typename T>
 void RequestQueue<T>::StartNextRequest() {
-  if (active_request_)
-    // Already running a request, assume this method will be called again when
-    // the request is done.
-    return;
-
-  if (empty())
-    // No requests in the queue, so we're done.
-    return;
-
-  base::TimeTicks next_release = NextReleaseTime();
-  base::TimeTicks now = base::TimeTicks::Now();
-  if (next_release > now) {
-    // Not ready for the next update check yet, call this method when it is
-    // time.
+  const base::TimeTicks now = base::TimeTicks::Now();
+  base::TimeTicks next_release;
+  typename std::deque<Request>::iterator it = pending_requests_.begin();
+  while (active_requests_.size() < max_active_requests_ &&
+         it != pending_requests_.end()) {
+    const std::string host = host_callback_.Run(*it->request);
+    if (ActiveRequestCount(host) >= max_active_requests_per_host_) {
+      // Assume this method will be called again when a request to |host| is
+      // done.
+      ++it;
+      continue;
+    }
+
+    const base::TimeTicks release = std::max(
+        it->backoff_entry->GetReleaseTime(),
+        GetHostBackoffEntry(host)->GetReleaseTime());
+    if (release > now) {
+      if (next_release.is_null() || release < next_release)
+        next_release = release;
+      ++it;
+      continue;
+    }
+
+    // Move the request from the heap to the active requests, and restore the
+    // heap. Requests are few, so this doesn't need to be clever.
+    active_requests_.push_back(*it);
+    T* request = it->request.get();
+    pending_requests_.erase(it);
+    std::make_heap(pending_requests_.begin(), pending_requests_.end(),
+                   CompareRequests);
+
+    start_request_callback_.Run(request);
+
+    // The callback may have changed the queue: start over.
+    it = pending_requests_.begin();
+    next_release = base::TimeTicks();
+  }
+
+  if (!next_release.is_null() &&
+      active_requests_.size() < max_active_requests_) {
+    // Not ready for the next request yet, call this method when it is time.
     timer_.Start(FROM_HERE, next_release - now,
           base::Bind(&RequestQueue<T>::StartNextRequest,
                      base::Unretained(this)));
-    return;
   }
-
-  // pop_heap swaps the first and last elements of pending_requests_, and after
-  // that assures that the rest of pending_requests_ (excluding the
-  // now last/formerly first element) forms a proper heap. After pop_heap
-  // [begin, end-1) is a valid heap, and *(end - 1) contains the element that
-  // used to be at the top of the heap. Since no elements are actually
-  // removed from the container it is safe to read the entry being removed after
-  // pop_heap is called (but before pop_back is called).
-  std::pop_heap(pending_requests_.begin(), pending_requests_.end(),
-                CompareRequests);
-
-  active_backoff_entry_.reset(pending_requests_.back().backoff_entry.release());
-  active_request_.reset(pending_requests_.back().request.release());
-
-  pending_requests_.pop_back();
-
-  start_request_callback_.Run();
 }
 
 template<typename T>
-void RequestQueue<T>::RetryRequest(const base::TimeDelta& min_backoff_delay) {
-  active_backoff_entry_->InformOfRequest(false);
-  if (active_backoff_entry_->GetTimeUntilRelease() < min_backoff_delay) {
-    active_backoff_entry_->SetCustomReleaseTime(
-        base::TimeTicks::Now() + min_backoff_delay);
+void RequestQueue<T>::RetryRequest(const T* request,
+                                   const base::TimeDelta& min_backoff_delay) {
+  typename std::deque<Request>::iterator it = FindActiveRequest(request);
+  net::BackoffEntry* host_backoff_entry =
+      GetHostBackoffEntry(host_callback_.Run(*request));
+  net::BackoffEntry* entries[] = { it->backoff_entry.get(),
+                                   host_backoff_entry };
+  for (size_t i = 0; i < arraysize(entries); ++i) {
+    entries[i]->InformOfRequest(false);
+    if (entries[i]->GetTimeUntilRelease() < min_backoff_delay) {
+      entries[i]->SetCustomReleaseTime(
+          base::TimeTicks::Now() + min_backoff_delay);
+    }
   }
-  PushImpl(active_request_.Pass(), active_backoff_entry_.Pass());
+  scoped_ptr<net::BackoffEntry> backoff_entry(it->backoff_entry.release());
+  scoped_ptr<T> retried_request(it->request.release());
+  active_requests_.erase(it);
+  PushImpl(retried_request.Pass(), backoff_entry.Pass());
 }
 
 template<typename T>
@@ -134,10 +193,32 @@ typename RequestQueue<T>::iterator RequestQueue<T>::end() {
   return iterator(pending_requests_.end());
 }
 
+template<typename T>
+typename RequestQueue<T>::iterator RequestQueue<T>::active_begin() {
+  return iterator(active_requests_.begin());
+}
+
+template<typename T>
+typename RequestQueue<T>::iterator RequestQueue<T>::active_end() {
+  return iterator(active_requests_.end());
+}
+
 template<typename T>
 void RequestQueue<T>::set_backoff_policy(
     const net::BackoffEntry::Policy* backoff_policy) {
   backoff_policy_ = backoff_policy;
+  // Host backoff entries are created with the policy.
+  host_backoff_entries_.clear();
+}
+
+template<typename T>
+void RequestQueue<T>::set_max_active_requests(
+    size_t max_active_requests,
+    size_t max_active_requests_per_host) {
+  DCHECK_GE(max_active_requests, 1U);
+  DCHECK_GE(max_active_requests_per_host, 1U);
+  max_active_requests_ = max_active_requests;
+  max_active_requests_per_host_ = max_active_requests_per_host;
 }
 
 // static
@@ -3,7 +3,10 @@
 // found in the LICENSE file.
 
 #include "chrome/browser/memory_details.h"
+#include "chrome/browser/memory_details_linux.h"
 
+#include <fcntl.h>
+#include <stdio.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -12,11 +15,15 @@
 
 #include "base/bind.h"
 #include "base/file_util.h"
+#include "base/lazy_instance.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/posix/eintr_wrapper.h"
 #include "base/process/process_iterator.h"
 #include "base/process/process_metrics.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/threading/thread_checker.h"
 #include "chrome/common/chrome_constants.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/common/process_type.h"
@@ -25,6 +32,9 @@
 
 using base::ProcessEntry;
 using content::BrowserThread;
+using memory_details_linux::ChildrenMap;
+using memory_details_linux::Process;
+using memory_details_linux::ProcessMap;
 
 // Known browsers which we collect details for.
 enum BrowserType {
@@ -76,13 +86,175 @@ ProcessData* MemoryDetails::ChromeBrowser() {
   return &process_data_[0];
 }
 
-struct Process {
-  pid_t pid;
-  pid_t parent;
-  std::string name;
+namespace memory_details_linux {
+
+bool ParseStatm(const char* statm,
+                int page_size_kb,
+                base::WorkingSetKBytes* working_set) {
+  uint64 fields[3];
+  const char* current = statm;
+  for (size_t i = 0; i < arraysize(fields); ++i) {
+    if (*current < '0' || *current > '9')
+      return false;
+    fields[i] = 0;
+    while (*current >= '0' && *current <= '9')
+      fields[i] = fields[i] * 10 + (*current++ - '0');
+    if (*current == ' ')
+      ++current;
+  }
+  const uint64 resident = fields[1];
+  const uint64 shared = fields[2];
+  if (shared > resident)
+    return false;
+  working_set->priv = (resident - shared) * page_size_kb;
+  working_set->shared = shared * page_size_kb;
+  // Sharable is not calculated, as it does not provide interesting data.
+  working_set->shareable = 0;
+  return true;
+}
+
+ChildrenMap GetChildrenMap(const ProcessMap& processes) {
+  ChildrenMap children;
+  for (ProcessMap::const_iterator iter = processes.begin();
+       iter != processes.end();
+       ++iter) {
+    children.insert(std::make_pair(iter->second.parent, iter->second.pid));
+  }
+  return children;
+}
+
+std::vector<pid_t> GetAllChildren(const ChildrenMap& children_map,
+                                  pid_t root) {
+  std::vector<pid_t> children;
+  std::set<pid_t> seen;
+  children.push_back(root);
+  seen.insert(root);
+
+  for (size_t i = 0; i < children.size(); ++i) {
+    std::pair<ChildrenMap::const_iterator, ChildrenMap::const_iterator> range =
+        children_map.equal_range(children[i]);
+    for (ChildrenMap::const_iterator iter = range.first; iter != range.second;
+         ++iter) {
+      if (seen.insert(iter->second).second)
+        children.push_back(iter->second);
+    }
+  }
+  return children;
+}
+
+}  // namespace memory_details_linux
+
+#if !defined(OS_CHROMEOS)
+// Samples the working set of processes from /proc/<pid>/statm, as
+// base::ProcessMetrics does outside of ChromeOS. The files of the processes
+// sampled by the last fetch are kept open, so that the next fetch only needs a
+// pread() and a parse of the numbers in place for each of them. They are all
+// closed once no fetch has followed for |kIdleFileTimeoutSeconds|. Only used
+// on the file thread.
+class StatmSampler {
+ public:
+  StatmSampler() : page_size_kb_(getpagesize() >> 10), fetches_(0) {}
+
+  // Fills |working_set| with the current usage of |pid|. Returns false if the
+  // process can't be sampled, e.g. because it has exited.
+  bool Sample(pid_t pid, base::WorkingSetKBytes* working_set) {
+    DCHECK(thread_checker_.CalledOnValidThread());
+    sampled_pids_.insert(pid);
+    std::map<pid_t, int>::iterator iter = fds_.find(pid);
+    if (iter != fds_.end()) {
+      if (SampleFile(iter->second, working_set))
+        return true;
+      // Once a process exits its statm can't be read anymore, even if the pid
+      // gets reused. Retry with the file of the current process.
+      IGNORE_EINTR(close(iter->second));
+      fds_.erase(iter);
+    }
+
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/statm", static_cast<int>(pid));
+    int fd = HANDLE_EINTR(open(path, O_RDONLY | O_CLOEXEC));
+    if (fd < 0)
+      return false;
+    if (!SampleFile(fd, working_set)) {
+      IGNORE_EINTR(close(fd));
+      return false;
+    }
+    fds_[pid] = fd;
+    return true;
+  }
+
+  // Closes the files of the processes which were not sampled since the last
+  // call, so that only the processes of the current fetch keep a file open,
+  // and schedules closing the rest if no other fetch follows. Called at the
+  // end of each fetch.
+  void EndFetch() {
+    DCHECK(thread_checker_.CalledOnValidThread());
+    std::map<pid_t, int>::iterator iter = fds_.begin();
+    while (iter != fds_.end()) {
+      if (sampled_pids_.count(iter->first)) {
+        ++iter;
+        continue;
+      }
+      IGNORE_EINTR(close(iter->second));
+      fds_.erase(iter++);
+    }
+    sampled_pids_.clear();
+
+    ++fetches_;
+    if (fds_.empty())
+      return;
+    // The sampler is leaked, so it outlives the task.
+    BrowserThread::PostDelayedTask(
+        BrowserThread::FILE, FROM_HERE,
+        base::Bind(&StatmSampler::CloseFilesIfIdle, base::Unretained(this),
+                   fetches_),
+        base::TimeDelta::FromSeconds(kIdleFileTimeoutSeconds));
+  }
+
+ private:
+  static const int kIdleFileTimeoutSeconds = 60;
+
+  bool SampleFile(int fd, base::WorkingSetKBytes* working_set) {
+    char buffer[128];
+    ssize_t length = HANDLE_EINTR(pread(fd, buffer, sizeof(buffer) - 1, 0));
+    if (length <= 0)
+      return false;
+    buffer[length] = '\0';
+    return memory_details_linux::ParseStatm(buffer, page_size_kb_,
+                                            working_set);
+  }
+
+  // Closes all files if the fetch numbered |fetch| was the last one.
+  void CloseFilesIfIdle(int fetch) {
+    DCHECK(thread_checker_.CalledOnValidThread());
+    if (fetch != fetches_)
+      return;
+    for (std::map<pid_t, int>::iterator iter = fds_.begin();
+         iter != fds_.end(); ++iter) {
+      IGNORE_EINTR(close(iter->second));
+    }
+    fds_.clear();
+  }
+
+  const int page_size_kb_;
+
+  // The number of fetches ended so far.
+  int fetches_;
+
+  // Open statm files, by pid.
+  std::map<pid_t, int> fds_;
+
+  // The processes sampled since the last EndFetch().
+  std::set<pid_t> sampled_pids_;
+
+  base::ThreadChecker thread_checker_;
+
+  DISALLOW_COPY_AND_ASSIGN(StatmSampler);
 };
 
-typedef std::map<pid_t, Process> ProcessMap;
+static base::LazyInstance<StatmSampler>::Leaky g_statm_sampler =
+    LAZY_INSTANCE_INITIALIZER;
+#endif  // !defined(OS_CHROMEOS)
 
 // Get information on all the processes running on the system.
 static ProcessMap GetProcesses() {
@@ -127,47 +299,27 @@ static ProcessData GetProcessDataMemoryInformation(
     else
       pmi.process_type = content::PROCESS_TYPE_UNKNOWN;
 
-    base::ProcessMetrics* metrics =
-        base::ProcessMetrics::CreateProcessMetrics(*iter);
+#if defined(OS_CHROMEOS)
+    // ChromeOS reads smaps to account for swapped memory.
+    scoped_ptr<base::ProcessMetrics> metrics(
+        base::ProcessMetrics::CreateProcessMetrics(*iter));
     metrics->GetWorkingSetKBytes(&pmi.working_set);
-    delete metrics;
+#else
+    g_statm_sampler.Get().Sample(*iter, &pmi.working_set);
+#endif
 
     process_data.processes.push_back(pmi);
   }
   return process_data;
 }
 
-// Find all children of the given process with pid |root|.
-static std::vector<pid_t> GetAllChildren(const ProcessMap& processes,
-                                         const pid_t root) {
-  std::vector<pid_t> children;
-  children.push_back(root);
-
-  std::set<pid_t> wavefront, next_wavefront;
-  wavefront.insert(root);
-
-  while (wavefront.size()) {
-    for (ProcessMap::const_iterator iter = processes.begin();
-         iter != processes.end();
-         ++iter) {
-      const Process& process = iter->second;
-      if (wavefront.count(process.parent)) {
-        children.push_back(process.pid);
-        next_wavefront.insert(process.pid);
-      }
-    }
-
-    wavefront.clear();
-    wavefront.swap(next_wavefront);
-  }
-  return children;
-}
-
 void MemoryDetails::CollectProcessData(
     const std::vector<ProcessMemoryInformation>& child_info) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
 
   ProcessMap process_map = GetProcesses();
+  ChildrenMap children_map =
+      memory_details_linux::GetChildrenMap(process_map);
   std::set<pid_t> browsers_found;
 
   // For each process on the system, if it appears to be a browser process and
@@ -195,8 +347,10 @@ void MemoryDetails::CollectProcessData(
     }
   }
 
+  std::vector<pid_t> current_browser_processes =
+      memory_details_linux::GetAllChildren(children_map, getpid());
   ProcessData current_browser =
-      GetProcessDataMemoryInformation(GetAllChildren(process_map, getpid()));
+      GetProcessDataMemoryInformation(current_browser_processes);
   current_browser.name = l10n_util::GetStringUTF16(IDS_SHORT_PRODUCT_NAME);
   current_browser.process_name = base::ASCIIToUTF16("chrome");
 
@@ -221,7 +375,8 @@ void MemoryDetails::CollectProcessData(
   for (std::set<pid_t>::const_iterator iter = browsers_found.begin();
        iter != browsers_found.end();
        ++iter) {
-    std::vector<pid_t> browser_processes = GetAllChildren(process_map, *iter);
+    std::vector<pid_t> browser_processes =
+        memory_details_linux::GetAllChildren(children_map, *iter);
     ProcessData browser = GetProcessDataMemoryInformation(browser_processes);
 
     ProcessMap::const_iterator process_iter = process_map.find(*iter);
@@ -235,6 +390,8 @@ void MemoryDetails::CollectProcessData(
 
 #if defined(OS_CHROMEOS)
   base::GetSwapInfo(&swap_info_);
+#else
+  g_statm_sampler.Get().EndFetch();
 #endif
 
   // Finally return to the browser thread.
@@ -0,0 +1,49 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_MEMORY_DETAILS_LINUX_H_
+#define CHROME_BROWSER_MEMORY_DETAILS_LINUX_H_
+
+#include <sys/types.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace base {
+struct WorkingSetKBytes;
+}
+
+// Helpers of MemoryDetails on Linux, exposed for testing.
+namespace memory_details_linux {
+
+struct Process {
+  pid_t pid;
+  pid_t parent;
+  std::string name;
+};
+
+typedef std::map<pid_t, Process> ProcessMap;
+
+typedef std::multimap<pid_t, pid_t> ChildrenMap;
+
+// Parses |statm|, the contents of a /proc/<pid>/statm file, into
+// |working_set|. statm holds "size resident shared text lib data dt", in pages
+// of |page_size_kb|. Returns false if |statm| is malformed or truncated, in
+// which case |working_set| is left untouched.
+bool ParseStatm(const char* statm,
+                int page_size_kb,
+                base::WorkingSetKBytes* working_set);
+
+// Maps each process in |processes| to its children.
+ChildrenMap GetChildrenMap(const ProcessMap& processes);
+
+// Returns |root| and all of its descendants in |children_map|, breadth first.
+// Each process is returned once, even if a pid was reused by a process which
+// now looks like an ancestor of its own parent.
+std::vector<pid_t> GetAllChildren(const ChildrenMap& children_map, pid_t root);
+
+}  // namespace memory_details_linux
+
+#endif  // CHROME_BROWSER_MEMORY_DETAILS_LINUX_H_
@@ -0,0 +1,121 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/memory_details_linux.h"
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/process/process_metrics.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace memory_details_linux {
+
+namespace {
+
+void AddProcess(pid_t pid, pid_t parent, ProcessMap* processes) {
+  Process process;
+  process.pid = pid;
+  process.parent = parent;
+  (*processes)[pid] = process;
+}
+
+}  // namespace
+
+TEST(MemoryDetailsLinuxTest, ParseStatm) {
+  base::WorkingSetKBytes working_set;
+  ASSERT_TRUE(ParseStatm("1000 300 100 20 0 400 0\n", 4, &working_set));
+  EXPECT_EQ(800u, working_set.priv);
+  EXPECT_EQ(400u, working_set.shared);
+  EXPECT_EQ(0u, working_set.shareable);
+
+  // Only the first three fields are needed.
+  ASSERT_TRUE(ParseStatm("1000 300 100", 4, &working_set));
+  EXPECT_EQ(800u, working_set.priv);
+  EXPECT_EQ(400u, working_set.shared);
+}
+
+TEST(MemoryDetailsLinuxTest, ParseMalformedStatm) {
+  const char* const kMalformed[] = {
+    "",
+    "\n",
+    "abc",
+    " 1000 300 100",
+    "1000",
+    "1000 300",
+    "1000 300 ",
+    "1000 300 x",
+    "1000 -300 100",
+    // More shared than resident pages, as a torn read could give.
+    "1000 100 300",
+  };
+  for (size_t i = 0; i < arraysize(kMalformed); ++i) {
+    base::WorkingSetKBytes working_set;
+    working_set.priv = 1;
+    working_set.shared = 2;
+    EXPECT_FALSE(ParseStatm(kMalformed[i], 4, &working_set)) << kMalformed[i];
+    EXPECT_EQ(1u, working_set.priv) << kMalformed[i];
+    EXPECT_EQ(2u, working_set.shared) << kMalformed[i];
+  }
+}
+
+TEST(MemoryDetailsLinuxTest, GetAllChildren) {
+  ProcessMap processes;
+  AddProcess(1, 0, &processes);
+  AddProcess(10, 1, &processes);
+  AddProcess(11, 10, &processes);
+  AddProcess(12, 10, &processes);
+  AddProcess(13, 11, &processes);
+  AddProcess(20, 1, &processes);
+
+  std::vector<pid_t> expected;
+  expected.push_back(10);
+  expected.push_back(11);
+  expected.push_back(12);
+  expected.push_back(13);
+  EXPECT_EQ(expected, GetAllChildren(GetChildrenMap(processes), 10));
+
+  expected.clear();
+  expected.push_back(13);
+  EXPECT_EQ(expected, GetAllChildren(GetChildrenMap(processes), 13));
+
+  // A pid which is not running still comes back as its own tree.
+  expected.clear();
+  expected.push_back(30);
+  EXPECT_EQ(expected, GetAllChildren(GetChildrenMap(processes), 30));
+}
+
+TEST(MemoryDetailsLinuxTest, GetAllChildrenAfterReparenting) {
+  ProcessMap processes;
+  AddProcess(1, 0, &processes);
+  AddProcess(10, 1, &processes);
+  // 12 was a child of 11, which exited, so 12 now belongs to init.
+  AddProcess(12, 1, &processes);
+  AddProcess(13, 12, &processes);
+  // 14 lists itself as its parent.
+  AddProcess(14, 14, &processes);
+  AddProcess(15, 10, &processes);
+
+  std::vector<pid_t> expected;
+  expected.push_back(10);
+  expected.push_back(15);
+  EXPECT_EQ(expected, GetAllChildren(GetChildrenMap(processes), 10));
+
+  expected.clear();
+  expected.push_back(14);
+  EXPECT_EQ(expected, GetAllChildren(GetChildrenMap(processes), 14));
+
+  // The parent of 20 exited, and its pid was reused by a child of 20, so the
+  // processes look like each other's parents.
+  AddProcess(20, 21, &processes);
+  AddProcess(21, 20, &processes);
+  AddProcess(22, 21, &processes);
+  expected.clear();
+  expected.push_back(20);
+  expected.push_back(21);
+  expected.push_back(22);
+  EXPECT_EQ(expected, GetAllChildren(GetChildrenMap(processes), 20));
+}
+
+}  // namespace memory_details_linux
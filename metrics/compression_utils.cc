@@ -14,6 +14,10 @@ namespace {
 // The difference in bytes between a zlib header and a gzip header.
 const size_t kGzipZlibHeaderDifferenceBytes = 16;
 
+// The gzip footer ends with the size of the uncompressed data, modulo 2^32,
+// as a 4 byte little-endian integer.
+const size_t kGzipFooterSizeBytes = 4;
+
 // Pass an integer greater than the following get a gzip header instead of a
 // zlib header when calling deflateInit2_.
 const int kWindowBitsToGetGzipHeader = 16;
@@ -70,6 +74,44 @@ int GzipCompressHelper(Bytef* dest,
     err = deflateEnd(&stream);
     return err;
 }
+
+// Like GzipCompressHelper, but inflates the gzip data in |source| into
+// |dest|, which must be exactly as large as the uncompressed data.
+int GzipUncompressHelper(Bytef* dest,
+                         uLongf* dest_length,
+                         const Bytef* source,
+                         uLong source_length) {
+    z_stream stream;
+
+    stream.next_in = bit_cast<Bytef*>(source);
+    stream.avail_in = static_cast<uInt>(source_length);
+    if (static_cast<uLong>(stream.avail_in) != source_length)
+      return Z_BUF_ERROR;
+
+    stream.next_out = dest;
+    stream.avail_out = static_cast<uInt>(*dest_length);
+    if (static_cast<uLong>(stream.avail_out) != *dest_length)
+      return Z_BUF_ERROR;
+
+    stream.zalloc = static_cast<alloc_func>(0);
+    stream.zfree = static_cast<free_func>(0);
+    stream.opaque = static_cast<voidpf>(0);
+
+    int err = inflateInit2(&stream, MAX_WBITS + kWindowBitsToGetGzipHeader);
+    if (err != Z_OK)
+      return err;
+
+    err = inflate(&stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        inflateEnd(&stream);
+        return err == Z_OK ? Z_BUF_ERROR : err;
+    }
+    *dest_length = stream.total_out;
+
+    err = inflateEnd(&stream);
+    return err;
+}
+
 }  // namespace
 
 namespace chrome {
@@ -89,4 +131,30 @@ bool GzipCompress(const std::string& input, std::string* output) {
   output->assign(compressed_data.begin(), compressed_data.end());
   return true;
 }
+
+bool GzipUncompress(const std::string& input, std::string* output) {
+  if (input.size() < kGzipFooterSizeBytes)
+    return false;
+
+  uLongf uncompressed_size = 0;
+  for (size_t i = 0; i < kGzipFooterSizeBytes; ++i) {
+    uncompressed_size |=
+        static_cast<uLongf>(static_cast<uint8>(input[input.size() - 1 - i]))
+        << (8 * (kGzipFooterSizeBytes - 1 - i));
+  }
+
+  // One extra byte keeps the buffer non-empty for empty inputs.
+  std::vector<Bytef> uncompressed_data(uncompressed_size + 1);
+  uLongf length = uncompressed_size;
+  if (GzipUncompressHelper(&uncompressed_data.front(),
+                           &length,
+                           bit_cast<const Bytef*>(input.data()),
+                           input.size()) != Z_OK ||
+      length != uncompressed_size)
+    return false;
+
+  output->assign(uncompressed_data.begin(),
+                 uncompressed_data.begin() + uncompressed_size);
+  return true;
+}
 }  // namespace chrome
@@ -12,6 +12,10 @@ namespace chrome {
 // Compresses the text in |input| using gzip storing the result in |output|.
 bool GzipCompress(const std::string& input, std::string* output);
 
+// Uncompresses the gzip data in |input| storing the result in |output|.
+// |input| must hold exactly one gzip member, as produced by GzipCompress().
+bool GzipUncompress(const std::string& input, std::string* output);
+
 }  // namespace chrome
 
 #endif  // CHROME_BROWSER_METRICS_COMPRESSION_UTILS_H_
@@ -45,4 +45,33 @@ TEST(CompressionUtilsTest, GzipCompression) {
   EXPECT_EQ(golden_compressed_data, compressed_data);
 }
 
+TEST(CompressionUtilsTest, GzipUncompression) {
+  std::string compressed_data(reinterpret_cast<const char*>(kCompressedData),
+                              arraysize(kCompressedData));
+  std::string uncompressed_data;
+  EXPECT_TRUE(chrome::GzipUncompress(compressed_data, &uncompressed_data));
+  std::string golden_data(reinterpret_cast<const char*>(kData),
+                          arraysize(kData));
+  EXPECT_EQ(golden_data, uncompressed_data);
+}
+
+TEST(CompressionUtilsTest, GzipRoundTrip) {
+  std::string data;
+  for (int i = 0; i < 1000; ++i)
+    data.append("metrics log ");
+  std::string compressed_data;
+  EXPECT_TRUE(chrome::GzipCompress(data, &compressed_data));
+  EXPECT_LT(compressed_data.size(), data.size());
+  std::string uncompressed_data;
+  EXPECT_TRUE(chrome::GzipUncompress(compressed_data, &uncompressed_data));
+  EXPECT_EQ(data, uncompressed_data);
+
+  // Empty and truncated input.
+  EXPECT_TRUE(chrome::GzipCompress(std::string(), &compressed_data));
+  EXPECT_TRUE(chrome::GzipUncompress(compressed_data, &uncompressed_data));
+  EXPECT_TRUE(uncompressed_data.empty());
+  EXPECT_FALSE(chrome::GzipUncompress(std::string("\x1f\x8b"),
+                                      &uncompressed_data));
+}
+
 }  // namespace
@@ -0,0 +1,307 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/metrics/jank_sampler.h"
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/lazy_instance.h"
+#include "base/message_loop/message_loop.h"
+#include "base/metrics/field_trial.h"
+#include "base/metrics/histogram.h"
+#include "base/pending_task.h"
+#include "base/process/process_handle.h"
+#include "base/strings/string_util.h"
+
+using base::subtle::Atomic32;
+using content::BrowserThread;
+
+namespace {
+
+// Enables sampling regardless of the field trial.
+const char kEnableJankSampler[] = "enable-jank-sampler";
+
+// Sampling is enabled for field trial groups starting with this prefix.
+const char kFieldTrialName[] = "JankSampler";
+const char kEnabledGroupPrefix[] = "Enabled";
+
+base::LazyInstance<JankSampler>::Leaky g_jank_sampler =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+// Times the tasks of the thread it is attached to.
+class JankSampler::ThreadSampler : public base::MessageLoop::TaskObserver {
+ public:
+  ThreadSampler() {}
+  virtual ~ThreadSampler() {}
+
+  RingBuffer* ring_buffer() { return &ring_buffer_; }
+
+  // Must be called on the sampled thread.
+  void AttachToCurrentThread() {
+    base::MessageLoop::current()->AddTaskObserver(this);
+  }
+
+  // Must be called on the sampled thread.
+  void DetachFromCurrentThread() {
+    base::MessageLoop::current()->RemoveTaskObserver(this);
+  }
+
+  // base::MessageLoop::TaskObserver:
+  virtual void WillProcessTask(const base::PendingTask& pending_task) OVERRIDE {
+    task_start_time_ = base::TimeTicks::Now();
+  }
+
+  virtual void DidProcessTask(const base::PendingTask& pending_task) OVERRIDE {
+    // The task which attached this sampler didn't get a WillProcessTask().
+    if (task_start_time_.is_null())
+      return;
+
+    Sample sample;
+    sample.posted_from = pending_task.posted_from;
+    sample.start_time = task_start_time_;
+    // A delayed task is only late once its delay has expired.
+    const base::TimeTicks ready_time =
+        pending_task.delayed_run_time.is_null() ? pending_task.time_posted :
+                                                  pending_task.delayed_run_time;
+    if (task_start_time_ > ready_time)
+      sample.queue_duration = task_start_time_ - ready_time;
+    sample.run_duration = base::TimeTicks::Now() - task_start_time_;
+    ring_buffer_.Append(sample);
+  }
+
+ private:
+  RingBuffer ring_buffer_;
+
+  // When the task being run started. Only used on the sampled thread.
+  base::TimeTicks task_start_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadSampler);
+};
+
+// static
+const int JankSampler::kSlowTaskThresholdMs = 50;
+
+// static
+const int JankSampler::kCollectIntervalMs = 500;
+
+// static
+const char JankSampler::kProcessTypeName[] = "Browser (slow tasks)";
+
+JankSampler::Sample::Sample() {}
+
+JankSampler::RingBuffer::RingBuffer() : write_count_(0), read_count_(0) {
+  for (uint32 i = 0; i < kCapacity; ++i)
+    slots_[i].sequence = 0;
+}
+
+JankSampler::RingBuffer::~RingBuffer() {}
+
+void JankSampler::RingBuffer::Append(const Sample& sample) {
+  // Only this thread writes, so nothing can change |write_count_| under us.
+  const uint32 count =
+      static_cast<uint32>(base::subtle::NoBarrier_Load(&write_count_));
+  Slot* slot = &slots_[count % kCapacity];
+
+  // Mark the slot as being written before touching the sample, so that a
+  // reader copying it concurrently discards the copy.
+  base::subtle::NoBarrier_Store(&slot->sequence,
+                                static_cast<Atomic32>(2 * count + 1));
+  base::subtle::MemoryBarrier();
+  slot->sample = sample;
+  base::subtle::Release_Store(&slot->sequence,
+                              static_cast<Atomic32>(2 * count + 2));
+  base::subtle::Release_Store(&write_count_, static_cast<Atomic32>(count + 1));
+}
+
+uint32 JankSampler::RingBuffer::ReadNewSamples(std::vector<Sample>* samples) {
+  const uint32 count =
+      static_cast<uint32>(base::subtle::Acquire_Load(&write_count_));
+  uint32 dropped = 0;
+  if (count - read_count_ > kCapacity) {
+    dropped = count - read_count_ - kCapacity;
+    read_count_ = count - kCapacity;
+  }
+
+  for (; read_count_ != count; ++read_count_) {
+    const Slot& slot = slots_[read_count_ % kCapacity];
+    const Atomic32 expected = static_cast<Atomic32>(2 * read_count_ + 2);
+    if (base::subtle::Acquire_Load(&slot.sequence) != expected) {
+      // The writer has wrapped around and is overwriting this sample.
+      ++dropped;
+      continue;
+    }
+    Sample sample = slot.sample;
+    base::subtle::MemoryBarrier();
+    if (base::subtle::NoBarrier_Load(&slot.sequence) != expected) {
+      ++dropped;
+      continue;
+    }
+    samples->push_back(sample);
+  }
+  return dropped;
+}
+
+JankSampler::SlowTaskStats::SlowTaskStats() : count(0) {}
+
+// static
+JankSampler* JankSampler::GetInstance() {
+  return g_jank_sampler.Pointer();
+}
+
+// static
+bool JankSampler::ShouldEnable(const base::CommandLine& command_line) {
+  if (command_line.HasSwitch(kEnableJankSampler))
+    return true;
+  return StartsWithASCII(base::FieldTrialList::FindFullName(kFieldTrialName),
+                         kEnabledGroupPrefix, true);
+}
+
+JankSampler::JankSampler() : dropped_samples_(0) {}
+
+JankSampler::~JankSampler() {
+#ifndef NDEBUG
+  for (int i = 0; i < BrowserThread::ID_COUNT; ++i)
+    DCHECK(!thread_samplers_[i]) << "Still sampling thread " << i;
+#endif
+}
+
+void JankSampler::StartSampling(BrowserThread::ID thread_id,
+                                const std::string& thread_name) {
+  base::AutoLock lock(lock_);
+  if (thread_samplers_[thread_id])
+    return;
+
+  ThreadSampler* thread_sampler = new ThreadSampler;
+  // If the thread is already gone there is nothing to sample.
+  if (!BrowserThread::PostTask(
+          thread_id, FROM_HERE,
+          base::Bind(&ThreadSampler::AttachToCurrentThread,
+                     base::Unretained(thread_sampler)))) {
+    delete thread_sampler;
+    return;
+  }
+  thread_samplers_[thread_id].reset(thread_sampler);
+  thread_names_[thread_id] = thread_name;
+}
+
+void JankSampler::StopSampling(BrowserThread::ID thread_id) {
+  base::AutoLock lock(lock_);
+  if (!thread_samplers_[thread_id])
+    return;
+
+  CollectSamplesLocked(thread_id);
+  // The thread sampler is deleted on its thread once it is detached, or right
+  // away if the thread is gone, along with its observer list.
+  BrowserThread::PostTask(
+      thread_id, FROM_HERE,
+      base::Bind(&ThreadSampler::DetachFromCurrentThread,
+                 base::Owned(thread_samplers_[thread_id].release())));
+}
+
+bool JankSampler::IsSampling(BrowserThread::ID thread_id) const {
+  base::AutoLock lock(lock_);
+  return thread_samplers_[thread_id].get() != NULL;
+}
+
+void JankSampler::StartCollecting(base::TimeDelta interval) {
+  collect_timer_.Start(FROM_HERE, interval, this,
+                       &JankSampler::CollectAllSamples);
+}
+
+void JankSampler::StopCollecting() {
+  collect_timer_.Stop();
+}
+
+void JankSampler::GetSnapshot(
+    tracked_objects::ProcessDataSnapshot* process_data) {
+  base::AutoLock lock(lock_);
+  for (int i = 0; i < BrowserThread::ID_COUNT; ++i) {
+    const BrowserThread::ID thread_id = static_cast<BrowserThread::ID>(i);
+    CollectSamplesLocked(thread_id);
+
+    for (SlowTaskMap::const_iterator it = slow_tasks_[i].begin();
+         it != slow_tasks_[i].end(); ++it) {
+      tracked_objects::TaskSnapshot task;
+      task.birth.location.file_name = it->first.file_name();
+      task.birth.location.function_name = it->first.function_name();
+      task.birth.location.line_number = it->first.line_number();
+      // The posting thread isn't recorded, only the thread the task ran on.
+      task.birth.thread_name = thread_names_[i];
+      task.death_thread_name = "Slow tasks on " + thread_names_[i];
+
+      const SlowTaskStats& stats = it->second;
+      task.death_data.count = stats.count;
+      task.death_data.run_duration_sum =
+          static_cast<int>(stats.run_duration_sum.InMilliseconds());
+      task.death_data.run_duration_max =
+          static_cast<int>(stats.run_duration_max.InMilliseconds());
+      task.death_data.run_duration_sample =
+          static_cast<int>(stats.run_duration_sample.InMilliseconds());
+      task.death_data.queue_duration_sum =
+          static_cast<int>(stats.queue_duration_sum.InMilliseconds());
+      task.death_data.queue_duration_max =
+          static_cast<int>(stats.queue_duration_max.InMilliseconds());
+      task.death_data.queue_duration_sample =
+          static_cast<int>(stats.queue_duration_sample.InMilliseconds());
+      process_data->tasks.push_back(task);
+    }
+  }
+  process_data->process_id = base::GetCurrentProcId();
+}
+
+void JankSampler::Reset() {
+  base::AutoLock lock(lock_);
+  for (int i = 0; i < BrowserThread::ID_COUNT; ++i) {
+    CollectSamplesLocked(static_cast<BrowserThread::ID>(i));
+    slow_tasks_[i].clear();
+  }
+  dropped_samples_ = 0;
+}
+
+uint32 JankSampler::dropped_samples() const {
+  base::AutoLock lock(lock_);
+  return dropped_samples_;
+}
+
+void JankSampler::CollectAllSamples() {
+  base::AutoLock lock(lock_);
+  for (int i = 0; i < BrowserThread::ID_COUNT; ++i)
+    CollectSamplesLocked(static_cast<BrowserThread::ID>(i));
+}
+
+void JankSampler::CollectSamplesLocked(BrowserThread::ID thread_id) {
+  lock_.AssertAcquired();
+  if (!thread_samplers_[thread_id])
+    return;
+
+  std::vector<Sample> samples;
+  const uint32 dropped =
+      thread_samplers_[thread_id]->ring_buffer()->ReadNewSamples(&samples);
+  if (dropped) {
+    dropped_samples_ += dropped;
+    UMA_HISTOGRAM_COUNTS("JankSampler.DroppedSamples", dropped);
+  }
+
+  const base::TimeDelta threshold =
+      base::TimeDelta::FromMilliseconds(kSlowTaskThresholdMs);
+  for (std::vector<Sample>::const_iterator it = samples.begin();
+       it != samples.end(); ++it) {
+    if (it->run_duration < threshold)
+      continue;
+    SlowTaskStats& stats = slow_tasks_[thread_id][it->posted_from];
+    ++stats.count;
+    stats.run_duration_sum += it->run_duration;
+    stats.run_duration_max = std::max(stats.run_duration_max,
+                                      it->run_duration);
+    stats.run_duration_sample = it->run_duration;
+    stats.queue_duration_sum += it->queue_duration;
+    stats.queue_duration_max = std::max(stats.queue_duration_max,
+                                        it->queue_duration);
+    stats.queue_duration_sample = it->queue_duration;
+  }
+}
@@ -0,0 +1,194 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// JankSampler times every task run on the UI, IO, FILE and DB browser threads
+// so that short janks (a few hundred milliseconds), which are far below what
+// ThreadWatcher reports as a hang, can be attributed to the code that posted
+// the slow task.
+//
+// Each sampled thread writes a sample (queue time, run time and posting
+// location) per task into its own fixed size ring buffer. Writing never takes
+// a lock or allocates, so the cost per task is two TimeTicks::Now() calls and
+// a few stores. The ring buffers are drained every |kCollectIntervalMs| on the
+// WatchDogThread, and tasks that ran for at least |kSlowTaskThresholdMs| are
+// aggregated by their tracked_objects::Location. Samples overwritten before
+// they were drained are counted in the JankSampler.DroppedSamples histogram.
+// The aggregated data is exported as a tracked_objects::ProcessDataSnapshot,
+// so it can be serialized by task_profiler::TaskProfilerDataSerializer and
+// shown in about:profiler under its own process type, |kProcessTypeName|.
+//
+// Sampling is opt-in: it is enabled with --enable-jank-sampler or by the
+// "JankSampler" field trial.
+
+#ifndef CHROME_BROWSER_METRICS_JANK_SAMPLER_H_
+#define CHROME_BROWSER_METRICS_JANK_SAMPLER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/location.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "base/tracked_objects.h"
+#include "content/public/browser/browser_thread.h"
+
+namespace base {
+class CommandLine;
+}
+
+class JankSampler {
+ public:
+  // Tasks running at least this long are attributed to their location.
+  static const int kSlowTaskThresholdMs;
+
+  // How often the ring buffers are drained once StartCollecting() is called.
+  static const int kCollectIntervalMs;
+
+  // The process type the slow tasks are reported as in about:profiler. They
+  // are a second view of tasks the browser process reports too, so they must
+  // not be added to its data.
+  static const char kProcessTypeName[];
+
+  // A single task run on a sampled thread.
+  struct Sample {
+    Sample();
+
+    // Where the task was posted from.
+    tracked_objects::Location posted_from;
+
+    // When the task started running.
+    base::TimeTicks start_time;
+
+    // How long the task waited to run after it was posted (or after its delay
+    // expired) and how long it ran.
+    base::TimeDelta queue_duration;
+    base::TimeDelta run_duration;
+  };
+
+  // A single-producer ring buffer of the most recent samples of a thread. Only
+  // the sampled thread appends, without locking; readers must be serialized
+  // by the caller. Samples overwritten before they were read are counted as
+  // dropped.
+  class RingBuffer {
+   public:
+    static const uint32 kCapacity = 1024;
+
+    RingBuffer();
+    ~RingBuffer();
+
+    // Appends |sample|. Must only be called on the sampled thread.
+    void Append(const Sample& sample);
+
+    // Appends the samples written since the last call to |samples| and
+    // returns how many samples were overwritten before they could be read.
+    uint32 ReadNewSamples(std::vector<Sample>* samples);
+
+   private:
+    struct Slot {
+      // The number of the sample in this slot, times two, plus two once the
+      // sample is fully written. Odd while the sample is being written.
+      base::subtle::Atomic32 sequence;
+      Sample sample;
+    };
+
+    Slot slots_[kCapacity];
+
+    // The number of samples appended so far.
+    base::subtle::Atomic32 write_count_;
+
+    // The number of the next sample to read. Only accessed by readers.
+    uint32 read_count_;
+
+    DISALLOW_COPY_AND_ASSIGN(RingBuffer);
+  };
+
+  // Returns the process wide sampler, which is leaked so that sampled threads
+  // can outlive it. Other instances must stop sampling before destruction.
+  static JankSampler* GetInstance();
+
+  // Returns true if sampling was requested on |command_line| or by the field
+  // trial.
+  static bool ShouldEnable(const base::CommandLine& command_line);
+
+  JankSampler();
+  ~JankSampler();
+
+  // Starts sampling the tasks of |thread_id|, which is reported as
+  // |thread_name|. May be called on any thread.
+  void StartSampling(content::BrowserThread::ID thread_id,
+                     const std::string& thread_name);
+
+  // Stops sampling the tasks of |thread_id|. The samples recorded so far are
+  // kept. May be called on any thread.
+  void StopSampling(content::BrowserThread::ID thread_id);
+
+  // Returns true if StartSampling() was called for |thread_id|.
+  bool IsSampling(content::BrowserThread::ID thread_id) const;
+
+  // Starts draining the ring buffers of all sampled threads every |interval|,
+  // which should be short enough to keep them from wrapping on busy threads.
+  // Must be called on a thread with a message loop, which StopCollecting()
+  // must then be called on too.
+  void StartCollecting(base::TimeDelta interval);
+  void StopCollecting();
+
+  // Drains all ring buffers and fills |process_data| with one task per
+  // location that posted slow tasks.
+  void GetSnapshot(tracked_objects::ProcessDataSnapshot* process_data);
+
+  // Forgets the slow tasks aggregated so far.
+  void Reset();
+
+  // Returns the number of samples that were overwritten before they were
+  // collected.
+  uint32 dropped_samples() const;
+
+ private:
+  class ThreadSampler;
+
+  // Statistics of the slow tasks posted from one location.
+  struct SlowTaskStats {
+    SlowTaskStats();
+
+    int count;
+    base::TimeDelta run_duration_sum;
+    base::TimeDelta run_duration_max;
+    base::TimeDelta run_duration_sample;
+    base::TimeDelta queue_duration_sum;
+    base::TimeDelta queue_duration_max;
+    base::TimeDelta queue_duration_sample;
+  };
+  typedef std::map<tracked_objects::Location, SlowTaskStats> SlowTaskMap;
+
+  // Drains the ring buffers of all sampled threads.
+  void CollectAllSamples();
+
+  // Drains the ring buffer of |thread_id| into |slow_tasks_|.
+  void CollectSamplesLocked(content::BrowserThread::ID thread_id);
+
+  // Drains the ring buffers while collecting. Only used on the thread that
+  // called StartCollecting().
+  base::RepeatingTimer<JankSampler> collect_timer_;
+
+  // Guards everything below. Sampled threads never take it.
+  mutable base::Lock lock_;
+
+  // The sampler of each browser thread, or NULL if it isn't sampled.
+  scoped_ptr<ThreadSampler> thread_samplers_[content::BrowserThread::ID_COUNT];
+
+  // The name and slow tasks of each browser thread that was sampled.
+  std::string thread_names_[content::BrowserThread::ID_COUNT];
+  SlowTaskMap slow_tasks_[content::BrowserThread::ID_COUNT];
+
+  uint32 dropped_samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(JankSampler);
+};
+
+#endif  // CHROME_BROWSER_METRICS_JANK_SAMPLER_H_
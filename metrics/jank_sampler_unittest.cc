@@ -0,0 +1,159 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/metrics/jank_sampler.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/threading/platform_thread.h"
+#include "base/tracked_objects.h"
+#include "content/public/browser/browser_thread.h"
+#include "content/public/test/test_browser_thread_bundle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using content::BrowserThread;
+
+namespace {
+
+JankSampler::Sample SampleFromLine(int line_number) {
+  JankSampler::Sample sample;
+  sample.posted_from =
+      tracked_objects::Location("Function", "file.cc", line_number, NULL);
+  sample.run_duration = base::TimeDelta::FromMilliseconds(1);
+  return sample;
+}
+
+void SleepFor(base::TimeDelta duration) {
+  base::PlatformThread::Sleep(duration);
+}
+
+}  // namespace
+
+TEST(JankSamplerTest, RingBufferReadsNewSamples) {
+  JankSampler::RingBuffer ring_buffer;
+  for (int i = 0; i < 3; ++i)
+    ring_buffer.Append(SampleFromLine(i));
+
+  std::vector<JankSampler::Sample> samples;
+  EXPECT_EQ(0U, ring_buffer.ReadNewSamples(&samples));
+  ASSERT_EQ(3U, samples.size());
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(i, samples[i].posted_from.line_number());
+
+  // Samples are only read once.
+  samples.clear();
+  EXPECT_EQ(0U, ring_buffer.ReadNewSamples(&samples));
+  EXPECT_TRUE(samples.empty());
+
+  ring_buffer.Append(SampleFromLine(3));
+  EXPECT_EQ(0U, ring_buffer.ReadNewSamples(&samples));
+  ASSERT_EQ(1U, samples.size());
+  EXPECT_EQ(3, samples[0].posted_from.line_number());
+}
+
+TEST(JankSamplerTest, RingBufferCountsDroppedSamples) {
+  JankSampler::RingBuffer ring_buffer;
+  const int kOverflow = 10;
+  const int kAppended = JankSampler::RingBuffer::kCapacity + kOverflow;
+  for (int i = 0; i < kAppended; ++i)
+    ring_buffer.Append(SampleFromLine(i));
+
+  // The oldest samples were overwritten.
+  std::vector<JankSampler::Sample> samples;
+  EXPECT_EQ(static_cast<uint32>(kOverflow),
+            ring_buffer.ReadNewSamples(&samples));
+  ASSERT_EQ(JankSampler::RingBuffer::kCapacity, samples.size());
+  EXPECT_EQ(kOverflow, samples.front().posted_from.line_number());
+  EXPECT_EQ(kAppended - 1, samples.back().posted_from.line_number());
+}
+
+TEST(JankSamplerTest, AttributesSlowTasks) {
+  content::TestBrowserThreadBundle thread_bundle;
+  JankSampler jank_sampler;
+  jank_sampler.StartSampling(BrowserThread::UI, "UI");
+  EXPECT_TRUE(jank_sampler.IsSampling(BrowserThread::UI));
+  EXPECT_FALSE(jank_sampler.IsSampling(BrowserThread::IO));
+  base::RunLoop().RunUntilIdle();
+
+  const tracked_objects::Location slow_location(
+      "SlowFunction", "slow.cc", 17, NULL);
+  const tracked_objects::Location fast_location(
+      "FastFunction", "fast.cc", 23, NULL);
+  const base::TimeDelta slow_duration = base::TimeDelta::FromMilliseconds(
+      JankSampler::kSlowTaskThresholdMs + 10);
+  base::MessageLoop::current()->PostTask(
+      slow_location, base::Bind(&SleepFor, slow_duration));
+  base::MessageLoop::current()->PostTask(
+      fast_location, base::Bind(&SleepFor, base::TimeDelta()));
+  base::MessageLoop::current()->PostTask(
+      slow_location, base::Bind(&SleepFor, slow_duration));
+  base::RunLoop().RunUntilIdle();
+
+  // Only the slow tasks are reported, aggregated by location.
+  tracked_objects::ProcessDataSnapshot process_data;
+  jank_sampler.GetSnapshot(&process_data);
+  ASSERT_EQ(1U, process_data.tasks.size());
+  const tracked_objects::TaskSnapshot& task = process_data.tasks[0];
+  EXPECT_EQ("slow.cc", task.birth.location.file_name);
+  EXPECT_EQ("SlowFunction", task.birth.location.function_name);
+  EXPECT_EQ(17, task.birth.location.line_number);
+  EXPECT_EQ("UI", task.birth.thread_name);
+  EXPECT_EQ(2, task.death_data.count);
+  EXPECT_GE(task.death_data.run_duration_max,
+            slow_duration.InMilliseconds());
+  EXPECT_GE(task.death_data.run_duration_sum,
+            2 * slow_duration.InMilliseconds());
+  // The second slow task waited for the first one.
+  EXPECT_GE(task.death_data.queue_duration_max,
+            slow_duration.InMilliseconds());
+  EXPECT_EQ(0U, jank_sampler.dropped_samples());
+
+  // Stopping keeps the samples; resetting drops them.
+  jank_sampler.StopSampling(BrowserThread::UI);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(jank_sampler.IsSampling(BrowserThread::UI));
+  process_data.tasks.clear();
+  jank_sampler.GetSnapshot(&process_data);
+  EXPECT_EQ(1U, process_data.tasks.size());
+
+  jank_sampler.Reset();
+  process_data.tasks.clear();
+  jank_sampler.GetSnapshot(&process_data);
+  EXPECT_TRUE(process_data.tasks.empty());
+}
+
+TEST(JankSamplerTest, CollectsSamplesPeriodically) {
+  content::TestBrowserThreadBundle thread_bundle;
+  JankSampler jank_sampler;
+  jank_sampler.StartSampling(BrowserThread::UI, "UI");
+  jank_sampler.StartCollecting(base::TimeDelta::FromMilliseconds(1));
+  base::RunLoop().RunUntilIdle();
+
+  // Run more tasks than the ring buffer holds, with pauses long enough for the
+  // timer to drain it in between.
+  const tracked_objects::Location location("Function", "file.cc", 1, NULL);
+  const int kBatchSize = JankSampler::RingBuffer::kCapacity / 2;
+  for (int batch = 0; batch < 4; ++batch) {
+    for (int i = 0; i < kBatchSize; ++i) {
+      base::MessageLoop::current()->PostTask(
+          location, base::Bind(&SleepFor, base::TimeDelta()));
+    }
+    base::MessageLoop::current()->PostTask(
+        location,
+        base::Bind(&SleepFor, base::TimeDelta::FromMilliseconds(5)));
+    base::RunLoop().RunUntilIdle();
+  }
+  jank_sampler.StopCollecting();
+
+  tracked_objects::ProcessDataSnapshot process_data;
+  jank_sampler.GetSnapshot(&process_data);
+  EXPECT_EQ(0U, jank_sampler.dropped_samples());
+
+  jank_sampler.StopSampling(BrowserThread::UI);
+  base::RunLoop().RunUntilIdle();
+}
@@ -4,14 +4,24 @@
 
 #include "chrome/browser/metrics/metrics_log_serializer.h"
 
-#include <string>
-
 #include "base/base64.h"
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/location.h"
 #include "base/md5.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/metrics/histogram.h"
 #include "base/prefs/pref_service.h"
 #include "base/prefs/scoped_user_pref_update.h"
+#include "base/sequenced_task_runner.h"
+#include "base/task_runner_util.h"
+#include "base/values.h"
 #include "chrome/browser/browser_process.h"
+#include "chrome/browser/metrics/compression_utils.h"
 #include "chrome/common/pref_names.h"
 
 namespace {
@@ -40,6 +50,36 @@ const size_t kStorageByteLimitPerLogType = 300000;
 // checksum of the elements.
 const size_t kChecksumEntryCount = 2;
 
+// The number of compressed bytes of each type of log files. Once the logs of a
+// type exceed it, the oldest ones are evicted. The newest log is always kept.
+const size_t kLogFilesByteBudgetPerLogType = 1000000;
+
+// The types of logs stored in files.
+const MetricsLogManager::LogType kLogTypes[] = {
+  MetricsLogBase::INITIAL_STABILITY_LOG,
+  MetricsLogBase::ONGOING_LOG,
+};
+
+// Keys of the entries of a manifest.
+const char kHashKey[] = "hash";
+const char kChecksumKey[] = "checksum";
+const char kSizeKey[] = "size";
+
+// The log text of the logs to be written, by hash.
+typedef std::map<std::string, std::string> LogTextMap;
+
+// An entry of a manifest, describing one log file.
+struct LogFileInfo {
+  LogFileInfo() : size(0) {}
+
+  // The MD5 of the log text, which names the file.
+  std::string hash;
+  // The MD5 of the compressed log, as stored in the file.
+  std::string checksum;
+  // The size of the file.
+  size_t size;
+};
+
 MetricsLogSerializer::LogReadStatus MakeRecallStatusHistogram(
     MetricsLogSerializer::LogReadStatus status) {
   UMA_HISTOGRAM_ENUMERATION("PrefService.PersistentLogRecallProtobufs",
@@ -47,13 +87,251 @@ MetricsLogSerializer::LogReadStatus MakeRecallStatusHistogram(
   return status;
 }
 
-}  // namespace
+const char* GetFilePrefix(MetricsLogManager::LogType log_type) {
+  return log_type == MetricsLogBase::INITIAL_STABILITY_LOG ?
+      "initial" : "ongoing";
+}
+
+base::FilePath GetManifestPath(const base::FilePath& directory,
+                               const std::string& prefix) {
+  return directory.AppendASCII(prefix + ".manifest");
+}
+
+base::FilePath GetLogFilePath(const base::FilePath& directory,
+                              const std::string& prefix,
+                              const std::string& hash) {
+  return directory.AppendASCII(prefix + "-" + hash + ".gz");
+}
+
+// Reads the entries of the manifest at |path|. Returns false if the manifest
+// is missing or corrupt.
+bool ReadManifest(const base::FilePath& path,
+                  std::vector<LogFileInfo>* entries) {
+  std::string json;
+  if (!base::ReadFileToString(path, &json))
+    return false;
+  scoped_ptr<base::Value> value(base::JSONReader::Read(json));
+  base::ListValue* list = NULL;
+  if (!value || !value->GetAsList(&list))
+    return false;
+
+  for (size_t i = 0; i < list->GetSize(); ++i) {
+    const base::DictionaryValue* entry = NULL;
+    LogFileInfo info;
+    int size = 0;
+    if (!list->GetDictionary(i, &entry) ||
+        !entry->GetString(kHashKey, &info.hash) ||
+        !entry->GetString(kChecksumKey, &info.checksum) ||
+        !entry->GetInteger(kSizeKey, &size) || size < 0) {
+      return false;
+    }
+    info.size = size;
+    entries->push_back(info);
+  }
+  return true;
+}
+
+// Runs on the task runner. Reads the log files of |log_type| listed in its
+// manifest, appending the logs to |logs| and their hashes to |hashes|.
+MetricsLogSerializer::LogReadStatus ReadLogFiles(
+    const base::FilePath& directory,
+    MetricsLogManager::LogType log_type,
+    std::vector<MetricsLogManager::SerializedLog>* logs,
+    std::vector<std::string>* hashes) {
+  const std::string prefix = GetFilePrefix(log_type);
+  const base::FilePath manifest_path = GetManifestPath(directory, prefix);
+  if (!base::PathExists(manifest_path))
+    return MakeRecallStatusHistogram(MetricsLogSerializer::LIST_EMPTY);
+  std::vector<LogFileInfo> entries;
+  if (!ReadManifest(manifest_path, &entries)) {
+    return MakeRecallStatusHistogram(
+        MetricsLogSerializer::MANIFEST_CORRUPTION);
+  }
+
+  // Each log is verified on its own, so a corrupt file only loses its log.
+  MetricsLogSerializer::LogReadStatus status =
+      MetricsLogSerializer::RECALL_SUCCESS;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    std::string compressed_log;
+    if (!base::ReadFileToString(
+            GetLogFilePath(directory, prefix, entries[i].hash),
+            &compressed_log)) {
+      status = MetricsLogSerializer::LOG_FILE_READ_FAIL;
+      continue;
+    }
+    if (base::MD5String(compressed_log) != entries[i].checksum) {
+      status = MetricsLogSerializer::CHECKSUM_CORRUPTION;
+      continue;
+    }
+    std::string log_text;
+    if (!chrome::GzipUncompress(compressed_log, &log_text)) {
+      status = MetricsLogSerializer::DECODE_FAIL;
+      continue;
+    }
+    logs->push_back(MetricsLogManager::SerializedLog());
+    logs->back().SwapLogText(&log_text);
+    hashes->push_back(entries[i].hash);
+  }
+  return MakeRecallStatusHistogram(status);
+}
 
+// Runs on the task runner. Writes the manifest of the logs with |hashes|,
+// from oldest to newest. As for prefs, the newest |list_length_limit| logs
+// are kept, and older ones until |byte_limit| bytes are used; in any case no
+// more than the byte budget is used. Logs in |new_logs| are compressed and
+// written to their own file; the others are expected to be in the current
+// manifest already. The files of evicted logs are deleted. Returns false if
+// a log or the manifest could not be written.
+bool WriteLogFiles(const base::FilePath& directory,
+                   const std::string& prefix,
+                   const std::vector<std::string>& hashes,
+                   scoped_ptr<LogTextMap> new_logs,
+                   size_t list_length_limit,
+                   size_t byte_limit) {
+  if (!base::CreateDirectory(directory)) {
+    DVLOG(1) << "Failed to create " << directory.value();
+    return false;
+  }
 
-MetricsLogSerializer::MetricsLogSerializer() {}
+  const base::FilePath manifest_path = GetManifestPath(directory, prefix);
+  std::vector<LogFileInfo> stored_entries;
+  if (!ReadManifest(manifest_path, &stored_entries))
+    stored_entries.clear();
+  std::map<std::string, LogFileInfo> stored_logs;
+  for (size_t i = 0; i < stored_entries.size(); ++i)
+    stored_logs[stored_entries[i].hash] = stored_entries[i];
+
+  // Keep the newest logs until the limits are reached.
+  std::vector<LogFileInfo> kept_logs;
+  std::set<std::string> kept_hashes;
+  size_t bytes_used = 0;
+  bool success = true;
+  for (std::vector<std::string>::const_reverse_iterator it = hashes.rbegin();
+       it != hashes.rend(); ++it) {
+    LogFileInfo info;
+    std::string compressed_log;
+    std::map<std::string, LogFileInfo>::const_iterator stored =
+        stored_logs.find(*it);
+    if (stored != stored_logs.end()) {
+      info = stored->second;
+    } else {
+      // Logs which are neither stored nor new were evicted by an earlier write.
+      LogTextMap::const_iterator log = new_logs->find(*it);
+      if (log == new_logs->end() ||
+          !chrome::GzipCompress(log->second, &compressed_log)) {
+        continue;
+      }
+      info.hash = *it;
+      info.checksum = base::MD5String(compressed_log);
+      info.size = compressed_log.size();
+    }
+
+    if (!kept_logs.empty() &&
+        (bytes_used + info.size > kLogFilesByteBudgetPerLogType ||
+         (kept_logs.size() >= list_length_limit && bytes_used >= byte_limit))) {
+      break;
+    }
+
+    if (!compressed_log.empty()) {
+      const base::FilePath path = GetLogFilePath(directory, prefix, info.hash);
+      if (base::WriteFile(path, compressed_log.data(), compressed_log.size()) !=
+          static_cast<int>(compressed_log.size())) {
+        DVLOG(1) << "Failed to write " << path.value();
+        base::DeleteFile(path, false);
+        success = false;
+        continue;
+      }
+    }
+    bytes_used += info.size;
+    kept_logs.push_back(info);
+    kept_hashes.insert(info.hash);
+  }
+
+  base::ListValue manifest;
+  for (std::vector<LogFileInfo>::const_reverse_iterator it =
+           kept_logs.rbegin();
+       it != kept_logs.rend(); ++it) {
+    base::DictionaryValue* entry = new base::DictionaryValue;
+    entry->SetString(kHashKey, it->hash);
+    entry->SetString(kChecksumKey, it->checksum);
+    entry->SetInteger(kSizeKey, static_cast<int>(it->size));
+    manifest.Append(entry);
+  }
+  std::string json;
+  base::JSONWriter::Write(&manifest, &json);
+  if (!base::ImportantFileWriter::WriteFileAtomically(manifest_path, json)) {
+    DVLOG(1) << "Failed to write " << manifest_path.value();
+    return false;
+  }
+
+  for (size_t i = 0; i < stored_entries.size(); ++i) {
+    if (!kept_hashes.count(stored_entries[i].hash)) {
+      base::DeleteFile(
+          GetLogFilePath(directory, prefix, stored_entries[i].hash), false);
+    }
+  }
+  return success;
+}
+
+}  // namespace
+
+struct MetricsLogSerializer::LogFiles {
+  std::map<MetricsLogManager::LogType,
+           std::vector<MetricsLogManager::SerializedLog> > logs;
+  std::map<MetricsLogManager::LogType, std::vector<std::string> > hashes;
+};
+
+MetricsLogSerializer::MetricsLogSerializer(
+    const base::FilePath& directory,
+    const scoped_refptr<base::SequencedTaskRunner>& task_runner)
+    : directory_(directory),
+      task_runner_(task_runner),
+      log_files_loaded_(directory.empty()),
+      weak_ptr_factory_(this) {
+}
 
 MetricsLogSerializer::~MetricsLogSerializer() {}
 
+void MetricsLogSerializer::LoadLogFiles(const base::Closure& callback) {
+  DCHECK(!callback.is_null());
+  if (log_files_loaded_) {
+    callback.Run();
+    return;
+  }
+
+  load_callbacks_.push_back(callback);
+  if (load_callbacks_.size() > 1)
+    return;
+  LogFiles* log_files = new LogFiles;
+  task_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(&MetricsLogSerializer::ReadAllLogFiles, directory_,
+                 log_files),
+      base::Bind(&MetricsLogSerializer::OnLogFilesLoaded,
+                 weak_ptr_factory_.GetWeakPtr(), base::Owned(log_files)));
+}
+
+// static
+void MetricsLogSerializer::ReadAllLogFiles(const base::FilePath& directory,
+                                           LogFiles* log_files) {
+  for (size_t i = 0; i < arraysize(kLogTypes); ++i) {
+    ReadLogFiles(directory, kLogTypes[i], &log_files->logs[kLogTypes[i]],
+                 &log_files->hashes[kLogTypes[i]]);
+  }
+}
+
+void MetricsLogSerializer::OnLogFilesLoaded(LogFiles* log_files) {
+  log_files_.reset(new LogFiles);
+  log_files_->logs.swap(log_files->logs);
+  log_files_->hashes.swap(log_files->hashes);
+  log_files_loaded_ = true;
+
+  std::vector<base::Closure> callbacks;
+  callbacks.swap(load_callbacks_);
+  for (size_t i = 0; i < callbacks.size(); ++i)
+    callbacks[i].Run();
+}
+
 void MetricsLogSerializer::SerializeLogs(
     const std::vector<MetricsLogManager::SerializedLog>& logs,
     MetricsLogManager::LogType log_type) {
@@ -75,9 +353,54 @@ void MetricsLogSerializer::SerializeLogs(
       return;
   };
 
-  ListPrefUpdate update(local_state, pref);
-  WriteLogsToPrefList(logs, store_length_limit, kStorageByteLimitPerLogType,
-                      update.Get());
+  if (directory_.empty()) {
+    ListPrefUpdate update(local_state, pref);
+    WriteLogsToPrefList(logs, store_length_limit, kStorageByteLimitPerLogType,
+                        update.Get());
+    return;
+  }
+
+  // Writing before the files are read would evict the logs in them.
+  DCHECK(log_files_loaded_);
+
+  // Only the text of logs which were not stored yet is copied.
+  std::set<std::string>& stored_logs = stored_logs_[log_type];
+  std::vector<std::string> hashes;
+  scoped_ptr<LogTextMap> new_logs(new LogTextMap);
+  for (std::vector<MetricsLogManager::SerializedLog>::const_iterator it =
+           logs.begin();
+       it != logs.end(); ++it) {
+    hashes.push_back(base::MD5String(it->log_text()));
+    if (!stored_logs.count(hashes.back()))
+      (*new_logs)[hashes.back()] = it->log_text();
+  }
+  stored_logs.clear();
+  stored_logs.insert(hashes.begin(), hashes.end());
+
+  base::PostTaskAndReplyWithResult(
+      task_runner_.get(),
+      FROM_HERE,
+      base::Bind(&WriteLogFiles, directory_,
+                 std::string(GetFilePrefix(log_type)), hashes,
+                 base::Passed(&new_logs), store_length_limit,
+                 kStorageByteLimitPerLogType),
+      base::Bind(&MetricsLogSerializer::OnLogFilesWritten,
+                 weak_ptr_factory_.GetWeakPtr(), log_type));
+}
+
+void MetricsLogSerializer::OnLogFilesWritten(
+    MetricsLogManager::LogType log_type,
+    bool success) {
+  if (!success)
+    return;
+
+  // Logs persisted to prefs by previous versions were moved to the logs by
+  // DeserializeLogs(), and are now in files.
+  PrefService* local_state = g_browser_process->local_state();
+  const char* pref = log_type == MetricsLogBase::INITIAL_STABILITY_LOG ?
+      prefs::kMetricsInitialLogs : prefs::kMetricsOngoingLogs;
+  if (!local_state->GetList(pref)->empty())
+    ListPrefUpdate(local_state, pref)->Clear();
 }
 
 void MetricsLogSerializer::DeserializeLogs(
@@ -93,8 +416,41 @@ void MetricsLogSerializer::DeserializeLogs(
   else
     pref = prefs::kMetricsOngoingLogs;
 
+  // Logs in prefs are older than any log file, and persisted logs are older
+  // than any log already in |logs|, e.g. an initial stability log prepared
+  // while the files were being read.
+  std::vector<MetricsLogManager::SerializedLog> persisted_logs;
   const base::ListValue* unsent_logs = local_state->GetList(pref);
-  ReadLogsFromPrefList(*unsent_logs, logs);
+  ReadLogsFromPrefList(*unsent_logs, &persisted_logs);
+
+  if (!directory_.empty()) {
+    DCHECK(log_files_loaded_);
+    std::vector<MetricsLogManager::SerializedLog>& file_logs =
+        log_files_->logs[log_type];
+    const std::vector<std::string>& hashes = log_files_->hashes[log_type];
+
+    // Logs left in prefs may also be in files if the browser exited before
+    // the prefs were cleared.
+    std::set<std::string> pref_hashes;
+    for (size_t i = 0; i < persisted_logs.size(); ++i)
+      pref_hashes.insert(base::MD5String(persisted_logs[i].log_text()));
+    for (size_t i = 0; i < file_logs.size(); ++i) {
+      stored_logs_[log_type].insert(hashes[i]);
+      if (pref_hashes.count(hashes[i]))
+        continue;
+      persisted_logs.push_back(MetricsLogManager::SerializedLog());
+      persisted_logs.back().Swap(&file_logs[i]);
+    }
+    // The logs are only handed over once.
+    log_files_->logs.erase(log_type);
+    log_files_->hashes.erase(log_type);
+  }
+
+  for (size_t i = 0; i < logs->size(); ++i) {
+    persisted_logs.push_back(MetricsLogManager::SerializedLog());
+    persisted_logs.back().Swap(&(*logs)[i]);
+  }
+  logs->swap(persisted_logs);
 }
 
 // static
@@ -5,17 +5,36 @@
 #ifndef CHROME_BROWSER_METRICS_METRICS_LOG_SERIALIZER_H_
 #define CHROME_BROWSER_METRICS_METRICS_LOG_SERIALIZER_H_
 
+#include <map>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/files/file_path.h"
 #include "base/gtest_prod_util.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
 #include "chrome/common/metrics/metrics_log_manager.h"
 
 namespace base {
 class ListValue;
+class SequencedTaskRunner;
 }
 
-// Serializer for persisting metrics logs to prefs.
+// Serializer for persisting metrics logs. Each unsent log is stored as its
+// own gzip-compressed file in a dedicated directory, next to a manifest which
+// lists the logs of each type from oldest to newest. Only logs which were not
+// stored yet are written, and the oldest logs are evicted once a type exceeds
+// its length and byte limits. The files are only read on the writing sequence
+// once LoadLogFiles() is called, and logs must not be serialized or
+// deserialized before they are read.
+//
+// Logs persisted to prefs by previous versions are read once and then moved
+// to files; they are only cleared from prefs once the files are written. If
+// no directory is given, logs are persisted to prefs instead.
 class MetricsLogSerializer : public MetricsLogManager::LogSerializer {
  public:
   // Used to produce a histogram that keeps track of the status of recalling
@@ -33,12 +52,27 @@ class MetricsLogSerializer : public MetricsLogManager::LogSerializer {
     DECODE_FAIL,            // Failed to decode log.
     DEPRECATED_XML_PROTO_MISMATCH,  // The XML and protobuf logs have
                                     // inconsistent data.
+    MANIFEST_CORRUPTION,    // Failed to parse the manifest of the log files.
+    LOG_FILE_READ_FAIL,     // Failed to read a log file.
     END_RECALL_STATUS       // Number of bins to use to create the histogram.
   };
 
-  MetricsLogSerializer();
+  // Log files are stored in |directory|, and read and written on
+  // |task_runner|. Logs are persisted to prefs if |directory| is empty.
+  MetricsLogSerializer(
+      const base::FilePath& directory,
+      const scoped_refptr<base::SequencedTaskRunner>& task_runner);
   virtual ~MetricsLogSerializer();
 
+  // Reads the log files on the task runner, and runs |callback| once they
+  // are read. The files are only read once; |callback| is run right away if
+  // they were read already, or if logs are persisted to prefs.
+  void LoadLogFiles(const base::Closure& callback);
+
+  // Whether the log files were read, so that logs can be serialized and
+  // deserialized.
+  bool log_files_loaded() const { return log_files_loaded_; }
+
   // Implementation of MetricsLogManager::LogSerializer
   virtual void SerializeLogs(
       const std::vector<MetricsLogManager::SerializedLog>& logs,
@@ -48,6 +82,23 @@ class MetricsLogSerializer : public MetricsLogManager::LogSerializer {
       std::vector<MetricsLogManager::SerializedLog>* logs) OVERRIDE;
 
  private:
+  // The logs read from files and their hashes, by type.
+  struct LogFiles;
+
+  // Runs on the task runner. Reads the log files of each type in |directory|
+  // into |log_files|.
+  static void ReadAllLogFiles(const base::FilePath& directory,
+                              LogFiles* log_files);
+
+  // Takes the logs read into |log_files|, and runs the callbacks waiting for
+  // them.
+  void OnLogFilesLoaded(LogFiles* log_files);
+
+  // Called once the log files of |log_type| have been written. Logs left in
+  // prefs by previous versions are only cleared if |success|, so that they are
+  // not lost if the files could not be written.
+  void OnLogFilesWritten(MetricsLogManager::LogType log_type, bool success);
+
   // Encodes the textual log data from |local_list| and writes it to the given
   // pref list, along with list size and checksum.  Logs will be stored starting
   // with the most recent, and working backward until at least
@@ -75,6 +126,30 @@ class MetricsLogSerializer : public MetricsLogManager::LogSerializer {
   FRIEND_TEST_ALL_PREFIXES(MetricsLogSerializerTest, RemoveSizeFromLogList);
   FRIEND_TEST_ALL_PREFIXES(MetricsLogSerializerTest, CorruptSizeOfLogList);
   FRIEND_TEST_ALL_PREFIXES(MetricsLogSerializerTest, CorruptChecksumOfLogList);
+  FRIEND_TEST_ALL_PREFIXES(MetricsLogSerializerFilesTest,
+                           MigratesLogsFromPrefs);
+
+  // The directory holding the log files and their manifests.
+  const base::FilePath directory_;
+
+  // The sequence on which log files are read, written and deleted.
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  // Whether the log files were read. Always true if |directory_| is empty.
+  bool log_files_loaded_;
+
+  // The callbacks to run once the log files are read. Not empty while the
+  // files are being read.
+  std::vector<base::Closure> load_callbacks_;
+
+  // Holds the logs read from files, until they are deserialized.
+  scoped_ptr<LogFiles> log_files_;
+
+  // The hashes of the logs of each type which were read from or written to
+  // files, so that they are not written again.
+  std::map<MetricsLogManager::LogType, std::set<std::string> > stored_logs_;
+
+  base::WeakPtrFactory<MetricsLogSerializer> weak_ptr_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(MetricsLogSerializer);
 };
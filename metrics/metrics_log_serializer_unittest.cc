@@ -3,9 +3,19 @@
 // found in the LICENSE file.
 
 #include "base/base64.h"
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/md5.h"
+#include "base/message_loop/message_loop.h"
+#include "base/prefs/pref_service.h"
+#include "base/prefs/scoped_user_pref_update.h"
+#include "base/rand_util.h"
 #include "base/values.h"
 #include "chrome/browser/metrics/metrics_log_serializer.h"
+#include "chrome/common/pref_names.h"
+#include "chrome/test/base/scoped_testing_local_state.h"
+#include "chrome/test/base/testing_browser_process.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace {
@@ -19,6 +29,10 @@ void SetLogText(const std::string& log_text,
   log->SwapLogText(&log_text_copy);
 }
 
+void Increment(int* count) {
+  ++*count;
+}
+
 }  // namespace
 
 // Store and retrieve empty list.
@@ -270,3 +284,191 @@ TEST(MetricsLogSerializerTest, CorruptChecksumOfLogList) {
       MetricsLogSerializer::CHECKSUM_CORRUPTION,
       MetricsLogSerializer::ReadLogsFromPrefList(list, &local_list));
 }
+
+class MetricsLogSerializerFilesTest : public testing::Test {
+ protected:
+  MetricsLogSerializerFilesTest()
+      : testing_local_state_(TestingBrowserProcess::GetGlobal()) {}
+
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+  }
+
+  // Creates a serializer without reading the log files.
+  scoped_ptr<MetricsLogSerializer> CreateUnloadedSerializer() {
+    return make_scoped_ptr(new MetricsLogSerializer(
+        temp_dir_.path(), message_loop_.message_loop_proxy()));
+  }
+
+  // Creates a serializer and waits for it to read the log files.
+  scoped_ptr<MetricsLogSerializer> CreateSerializer() {
+    scoped_ptr<MetricsLogSerializer> serializer(CreateUnloadedSerializer());
+    serializer->LoadLogFiles(base::Bind(&base::DoNothing));
+    message_loop_.RunUntilIdle();
+    EXPECT_TRUE(serializer->log_files_loaded());
+    return serializer.Pass();
+  }
+
+  // Serializes |log_texts| as ongoing logs without waiting for the files.
+  void StartSerializingLogs(MetricsLogSerializer* serializer,
+                            const std::vector<std::string>& log_texts) {
+    std::vector<MetricsLogManager::SerializedLog> logs(log_texts.size());
+    for (size_t i = 0; i < log_texts.size(); ++i)
+      SetLogText(log_texts[i], &logs[i]);
+    serializer->SerializeLogs(logs, MetricsLogBase::ONGOING_LOG);
+  }
+
+  // Serializes |log_texts| as ongoing logs and waits for the files.
+  void SerializeLogs(MetricsLogSerializer* serializer,
+                     const std::vector<std::string>& log_texts) {
+    StartSerializingLogs(serializer, log_texts);
+    message_loop_.RunUntilIdle();
+  }
+
+  // Returns the text of the ongoing logs read by a new serializer.
+  std::vector<std::string> DeserializeLogs() {
+    std::vector<MetricsLogManager::SerializedLog> logs;
+    CreateSerializer()->DeserializeLogs(MetricsLogBase::ONGOING_LOG, &logs);
+    std::vector<std::string> log_texts;
+    for (size_t i = 0; i < logs.size(); ++i)
+      log_texts.push_back(logs[i].log_text());
+    return log_texts;
+  }
+
+  // Writes |log_text| to prefs as a previous version did.
+  void WriteLogToPrefs(const std::string& log_text) {
+    std::vector<MetricsLogManager::SerializedLog> pref_logs(1);
+    SetLogText(log_text, &pref_logs[0]);
+    ListPrefUpdate update(local_state(), prefs::kMetricsOngoingLogs);
+    MetricsLogSerializer::WriteLogsToPrefList(pref_logs, kListLengthLimit,
+                                              kLogByteLimit, update.Get());
+  }
+
+  PrefService* local_state() { return testing_local_state_.Get(); }
+
+  base::MessageLoop* message_loop() { return &message_loop_; }
+
+ private:
+  base::MessageLoop message_loop_;
+  base::ScopedTempDir temp_dir_;
+  ScopedTestingLocalState testing_local_state_;
+};
+
+// Logs written to files are read back in order, without using prefs.
+TEST_F(MetricsLogSerializerFilesTest, RoundTrip) {
+  std::vector<std::string> log_texts;
+  log_texts.push_back("Hello world!");
+  log_texts.push_back(std::string(10000, 'x'));
+  scoped_ptr<MetricsLogSerializer> serializer(CreateSerializer());
+  SerializeLogs(serializer.get(), log_texts);
+  EXPECT_TRUE(local_state()->GetList(prefs::kMetricsOngoingLogs)->empty());
+  EXPECT_EQ(log_texts, DeserializeLogs());
+
+  // Adding a log keeps the stored ones, and removing one deletes it.
+  log_texts.push_back("Goodbye world!");
+  SerializeLogs(serializer.get(), log_texts);
+  EXPECT_EQ(log_texts, DeserializeLogs());
+  log_texts.erase(log_texts.begin());
+  SerializeLogs(serializer.get(), log_texts);
+  EXPECT_EQ(log_texts, DeserializeLogs());
+}
+
+// The oldest logs are evicted once the byte budget is exceeded.
+TEST_F(MetricsLogSerializerFilesTest, EvictsOldestLogs) {
+  // Random logs don't compress, so only two fit in the 1000000 byte budget.
+  std::vector<std::string> log_texts;
+  for (int i = 0; i < 3; ++i)
+    log_texts.push_back(base::RandBytesAsString(400000));
+  scoped_ptr<MetricsLogSerializer> serializer(CreateSerializer());
+  SerializeLogs(serializer.get(), log_texts);
+
+  std::vector<std::string> recovered_log_texts = DeserializeLogs();
+  ASSERT_EQ(2U, recovered_log_texts.size());
+  EXPECT_EQ(log_texts[1], recovered_log_texts[0]);
+  EXPECT_EQ(log_texts[2], recovered_log_texts[1]);
+}
+
+// Once enough bytes are stored, only the newest logs up to the length limit
+// are kept.
+TEST_F(MetricsLogSerializerFilesTest, EvictsLogsOverLengthLimit) {
+  // Nine random logs would fit in the byte budget, but only the newest eight
+  // ongoing logs are kept since they hold more than 300000 bytes.
+  std::vector<std::string> log_texts;
+  for (int i = 0; i < 9; ++i)
+    log_texts.push_back(base::RandBytesAsString(100000));
+  scoped_ptr<MetricsLogSerializer> serializer(CreateSerializer());
+  SerializeLogs(serializer.get(), log_texts);
+
+  std::vector<std::string> recovered_log_texts = DeserializeLogs();
+  ASSERT_EQ(8U, recovered_log_texts.size());
+  EXPECT_EQ(log_texts[1], recovered_log_texts[0]);
+  EXPECT_EQ(log_texts[8], recovered_log_texts[7]);
+}
+
+// Logs persisted to prefs by previous versions are moved to files.
+TEST_F(MetricsLogSerializerFilesTest, MigratesLogsFromPrefs) {
+  WriteLogToPrefs("Hello world!");
+
+  scoped_ptr<MetricsLogSerializer> serializer(CreateSerializer());
+  std::vector<MetricsLogManager::SerializedLog> logs;
+  serializer->DeserializeLogs(MetricsLogBase::ONGOING_LOG, &logs);
+  ASSERT_EQ(1U, logs.size());
+  EXPECT_EQ("Hello world!", logs[0].log_text());
+
+  // The prefs are only cleared once the files are written.
+  StartSerializingLogs(serializer.get(),
+                       std::vector<std::string>(1, logs[0].log_text()));
+  EXPECT_FALSE(local_state()->GetList(prefs::kMetricsOngoingLogs)->empty());
+  message_loop()->RunUntilIdle();
+  EXPECT_TRUE(local_state()->GetList(prefs::kMetricsOngoingLogs)->empty());
+  std::vector<std::string> log_texts = DeserializeLogs();
+  ASSERT_EQ(1U, log_texts.size());
+  EXPECT_EQ("Hello world!", log_texts[0]);
+
+  // A log left in prefs after it was written to files is only read once.
+  WriteLogToPrefs("Hello world!");
+  log_texts = DeserializeLogs();
+  ASSERT_EQ(1U, log_texts.size());
+  EXPECT_EQ("Hello world!", log_texts[0]);
+}
+
+// The log files are only read once asked for, and then only once.
+TEST_F(MetricsLogSerializerFilesTest, LoadsLogFilesOnDemand) {
+  SerializeLogs(CreateSerializer().get(),
+                std::vector<std::string>(1, "Hello world!"));
+
+  scoped_ptr<MetricsLogSerializer> serializer(CreateUnloadedSerializer());
+  message_loop()->RunUntilIdle();
+  EXPECT_FALSE(serializer->log_files_loaded());
+
+  int loaded_count = 0;
+  serializer->LoadLogFiles(base::Bind(&Increment, &loaded_count));
+  serializer->LoadLogFiles(base::Bind(&Increment, &loaded_count));
+  EXPECT_EQ(0, loaded_count);
+  message_loop()->RunUntilIdle();
+  EXPECT_TRUE(serializer->log_files_loaded());
+  EXPECT_EQ(2, loaded_count);
+
+  // Once read, the callback is run right away.
+  serializer->LoadLogFiles(base::Bind(&Increment, &loaded_count));
+  EXPECT_EQ(3, loaded_count);
+
+  std::vector<MetricsLogManager::SerializedLog> logs;
+  serializer->DeserializeLogs(MetricsLogBase::ONGOING_LOG, &logs);
+  ASSERT_EQ(1U, logs.size());
+  EXPECT_EQ("Hello world!", logs[0].log_text());
+}
+
+// Logs prepared before the files were read are newer than the stored logs.
+TEST_F(MetricsLogSerializerFilesTest, StoredLogsAreOlderThanPendingLogs) {
+  SerializeLogs(CreateSerializer().get(),
+                std::vector<std::string>(1, "Hello world!"));
+
+  scoped_ptr<MetricsLogSerializer> serializer(CreateSerializer());
+  std::vector<MetricsLogManager::SerializedLog> logs(1);
+  SetLogText("Goodbye world!", &logs[0]);
+  serializer->DeserializeLogs(MetricsLogBase::ONGOING_LOG, &logs);
+  ASSERT_EQ(2U, logs.size());
+  EXPECT_EQ("Hello world!", logs[0].log_text());
+  EXPECT_EQ("Goodbye world!", logs[1].log_text());
+}
@@ -168,10 +168,12 @@
 #include "base/bind.h"
 #include "base/callback.h"
 #include "base/command_line.h"
+#include "base/files/file_path.h"
 #include "base/guid.h"
 #include "base/metrics/histogram.h"
 #include "base/metrics/sparse_histogram.h"
 #include "base/metrics/statistics_recorder.h"
+#include "base/path_service.h"
 #include "base/prefs/pref_registry_simple.h"
 #include "base/prefs/pref_service.h"
 #include "base/prefs/scoped_user_pref_update.h"
@@ -179,6 +181,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/threading/platform_thread.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "base/threading/thread.h"
 #include "base/threading/thread_restrictions.h"
 #include "base/tracked_objects.h"
@@ -203,6 +206,7 @@
 #include "chrome/browser/ui/browser_otr_state.h"
 #include "chrome/browser/ui/search/search_tab_helper.h"
 #include "chrome/common/chrome_constants.h"
+#include "chrome/common/chrome_paths.h"
 #include "chrome/common/chrome_result_codes.h"
 #include "chrome/common/chrome_switches.h"
 #include "chrome/common/crash_keys.h"
@@ -213,6 +217,7 @@
 #include "chrome/common/render_messages.h"
 #include "components/variations/entropy_provider.h"
 #include "components/variations/metrics_util.h"
+#include "content/public/browser/browser_thread.h"
 #include "content/public/browser/child_process_data.h"
 #include "content/public/browser/histogram_fetcher.h"
 #include "content/public/browser/load_notification_details.h"
@@ -291,6 +296,10 @@ const size_t kUploadLogAvoidRetransmitSize = 50000;
 // Interval, in minutes, between state saves.
 const int kSaveStateIntervalMinutes = 5;
 
+// The directory, under the user data directory, holding the unsent logs.
+const base::FilePath::CharType kUnsentLogsDirname[] =
+    FILE_PATH_LITERAL("Unsent Metrics Logs");
+
 enum ResponseStatus {
   UNKNOWN_FAILURE,
   SUCCESS,
@@ -350,6 +359,15 @@ void MarkAppCleanShutdownAndCommit() {
   pref->CommitPendingWrite();
 }
 
+// Returns the directory holding the unsent logs, or an empty path if the user
+// data directory is unknown.
+base::FilePath GetUnsentLogsDirectory() {
+  base::FilePath user_data_dir;
+  if (!PathService::Get(chrome::DIR_USER_DATA, &user_data_dir))
+    return base::FilePath();
+  return user_data_dir.Append(kUnsentLogsDirname);
+}
+
 }  // namespace
 
 
@@ -495,6 +513,7 @@ MetricsService::MetricsService()
       test_mode_active_(false),
       state_(INITIALIZED),
       has_initial_stability_log_(false),
+      log_serializer_(NULL),
       low_entropy_source_(kLowEntropySourceNotSet),
       idle_since_last_transmission_(false),
       session_id_(-1),
@@ -506,7 +525,14 @@ MetricsService::MetricsService()
       entropy_source_returned_(LAST_ENTROPY_NONE) {
   DCHECK(IsSingleThreaded());
 
-  log_manager_.set_log_serializer(new MetricsLogSerializer);
+  // Unsent logs must be written before shutdown completes.
+  base::SequencedWorkerPool* pool = BrowserThread::GetBlockingPool();
+  log_serializer_ = new MetricsLogSerializer(
+      GetUnsentLogsDirectory(),
+      pool->GetSequencedTaskRunnerWithShutdownBehavior(
+          pool->GetSequenceToken(),
+          base::SequencedWorkerPool::BLOCK_SHUTDOWN));
+  log_manager_.set_log_serializer(log_serializer_);
   log_manager_.set_max_ongoing_log_store_size(kUploadLogAvoidRetransmitSize);
 
   BrowserChildProcessObserver::Add(this);
@@ -1357,6 +1383,15 @@ void MetricsService::StartScheduledUpload() {
     return;
   }
 
+  // The unsent logs are read from disk before the first upload, without
+  // blocking this thread; the upload starts once they are read.
+  if (!log_serializer_->log_files_loaded()) {
+    log_serializer_->LoadLogFiles(
+        base::Bind(&MetricsService::StartScheduledUpload,
+                   self_ptr_factory_.GetWeakPtr()));
+    return;
+  }
+
   // If the callback was to upload an old log, but there no longer is one,
   // just report success back to the scheduler to begin the ongoing log
   // callbacks.
@@ -1545,7 +1580,6 @@ void MetricsService::PrepareInitialStabilityLog() {
     return;
   initial_stability_log->RecordStabilityMetrics(base::TimeDelta(),
                                                 base::TimeDelta());
-  log_manager_.LoadPersistedUnsentLogs();
 
   log_manager_.PauseCurrentLog();
   log_manager_.BeginLoggingWithLog(initial_stability_log.release());
@@ -1555,12 +1589,22 @@ void MetricsService::PrepareInitialStabilityLog() {
 #endif  // defined(OS_ANDROID)
   log_manager_.FinishCurrentLog();
   log_manager_.ResumePausedLog();
+  has_initial_stability_log_ = true;
 
-  // Store unsent logs, including the stability log that was just saved, so
-  // that they're not lost in case of a crash before upload time.
-  log_manager_.PersistUnsentLogs();
+  // The unsent logs are stored once they are read from disk. This is queued
+  // ahead of the first upload, which waits for them too.
+  log_serializer_->LoadLogFiles(
+      base::Bind(&MetricsService::StoreInitialStabilityLog,
+                 self_ptr_factory_.GetWeakPtr()));
+}
 
-  has_initial_stability_log_ = true;
+void MetricsService::StoreInitialStabilityLog() {
+  // Persisted logs are loaded ahead of the stability log that was just saved.
+  log_manager_.LoadPersistedUnsentLogs();
+
+  // Store unsent logs, including the stability log, so that they're not lost
+  // in case of a crash before upload time.
+  log_manager_.PersistUnsentLogs();
 }
 
 void MetricsService::PrepareInitialMetricsLog() {
@@ -36,6 +36,7 @@
 #include "chrome/browser/chromeos/external_metrics.h"
 #endif
 
+class MetricsLogSerializer;
 class MetricsReportingScheduler;
 class PrefService;
 class PrefRegistrySimple;
@@ -447,6 +448,10 @@ class MetricsService
   // system profile from the previous session.
   void PrepareInitialStabilityLog();
 
+  // Loads the unsent logs which were persisted, and stores them along with
+  // the initial stability log. Called once the log files were read.
+  void StoreInitialStabilityLog();
+
   // Prepares the initial metrics log, which includes startup histograms and
   // profiler data, as well as incremental stability-related metrics.
   void PrepareInitialMetricsLog();
@@ -537,6 +542,11 @@ class MetricsService
   // Whether the initial stability log has been recorded during startup.
   bool has_initial_stability_log_;
 
+  // Persists the unsent logs of |log_manager_|, which owns it. Its log files
+  // are read on demand, before the first upload or to store an initial
+  // stability log.
+  MetricsLogSerializer* log_serializer_;
+
   // Chrome OS hardware class (e.g., hardware qualification ID). This
   // class identifies the configured system components such as CPU,
   // WiFi adapter, etc.  For non Chrome OS hosts, this will be an
@@ -17,6 +17,7 @@
 #include "base/strings/stringprintf.h"
 #include "base/threading/thread_restrictions.h"
 #include "build/build_config.h"
+#include "chrome/browser/metrics/jank_sampler.h"
 #include "chrome/browser/metrics/metrics_service.h"
 #include "chrome/common/chrome_switches.h"
 #include "chrome/common/chrome_version_info.h"
@@ -453,7 +454,8 @@ void ThreadWatcherList::StartWatchingAll(const CommandLine& command_line) {
       FROM_HERE,
       base::Bind(&ThreadWatcherList::InitializeAndStartWatching,
                  unresponsive_threshold,
-                 crash_on_hang_threads),
+                 crash_on_hang_threads,
+                 JankSampler::ShouldEnable(command_line)),
       base::TimeDelta::FromSeconds(g_initialize_delay_seconds));
 }
 
@@ -638,7 +640,8 @@ void ThreadWatcherList::ParseCommandLineCrashOnHangThreads(
 // static
 void ThreadWatcherList::InitializeAndStartWatching(
     uint32 unresponsive_threshold,
-    const CrashOnHangThreadMap& crash_on_hang_threads) {
+    const CrashOnHangThreadMap& crash_on_hang_threads,
+    bool sample_janks) {
   DCHECK(WatchDogThread::CurrentlyOnWatchDogThread());
 
   // This method is deferred in relationship to its StopWatchingAll()
@@ -670,6 +673,16 @@ void ThreadWatcherList::InitializeAndStartWatching(
                 unresponsive_threshold, crash_on_hang_threads);
   StartWatching(BrowserThread::CACHE, "CACHE", kSleepTime, kUnresponsiveTime,
                 unresponsive_threshold, crash_on_hang_threads);
+
+  if (sample_janks) {
+    JankSampler* jank_sampler = JankSampler::GetInstance();
+    jank_sampler->StartSampling(BrowserThread::UI, "UI");
+    jank_sampler->StartSampling(BrowserThread::IO, "IO");
+    jank_sampler->StartSampling(BrowserThread::DB, "DB");
+    jank_sampler->StartSampling(BrowserThread::FILE, "FILE");
+    jank_sampler->StartCollecting(base::TimeDelta::FromMilliseconds(
+        JankSampler::kCollectIntervalMs));
+  }
 }
 
 // static
@@ -715,6 +728,11 @@ void ThreadWatcherList::DeleteAll() {
 
   SetStopped(true);
 
+  JankSampler* jank_sampler = JankSampler::GetInstance();
+  jank_sampler->StopCollecting();
+  for (int i = 0; i < BrowserThread::ID_COUNT; ++i)
+    jank_sampler->StopSampling(static_cast<BrowserThread::ID>(i));
+
   if (!g_thread_watcher_list_)
     return;
 
@@ -443,10 +443,13 @@ class ThreadWatcherList {
 
   // This constructs the |ThreadWatcherList| singleton and starts watching
   // browser threads by calling StartWatching() on each browser thread that is
-  // watched. It disarms StartupTimeBomb.
+  // watched. It disarms StartupTimeBomb. If |sample_janks| is true, it also
+  // starts timing the tasks of the UI, IO, DB and FILE threads with
+  // JankSampler, and collecting the samples on the WatchDogThread.
   static void InitializeAndStartWatching(
       uint32 unresponsive_threshold,
-      const CrashOnHangThreadMap& crash_on_hang_threads);
+      const CrashOnHangThreadMap& crash_on_hang_threads,
+      bool sample_janks);
 
   // This method calls ThreadWatcher::StartWatching() to perform health check on
   // the given |thread_id|.
@@ -28,6 +28,14 @@ const int kSampleIntervalInSeconds = 10;
 // switch with an associated (positive integer) value.
 const int kDefaultGatherIntervalInSeconds = 120;
 
+// The granularities at which metrics are pre-aggregated in the rollup db.
+enum RollupResolution {
+  ROLLUP_MINUTE,
+  ROLLUP_HOUR,
+  ROLLUP_DAY,
+  ROLLUP_NUMBER_OF_RESOLUTIONS
+};
+
 // Unit values (for use in metric, and on the UI side).
 
 // Memory measurements
@@ -12,6 +12,7 @@
 #include "base/path_service.h"
 #include "base/stl_util.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/time/time.h"
 #include "chrome/browser/performance_monitor/key_builder.h"
@@ -30,7 +31,19 @@ const char kEventDb[] = "Events";
 const char kStateDb[] = "Configuration";
 const char kActiveIntervalDb[] = "Active Interval";
 const char kMetricDb[] = "Metrics";
+const char kRollupDb[] = "Metric Rollups";
 const double kDefaultMaxValue = 0.0;
+const char kRollupValueDelimiter = '!';
+
+// Returns the start of the bucket containing |time| at the given resolution.
+// Buckets are aligned to the internal time epoch, which falls on a UTC
+// midnight, so day buckets are UTC days.
+base::Time RollupBucketStart(RollupResolution resolution,
+                             const base::Time& time) {
+  int64 width = Database::GetRollupWidth(resolution).ToInternalValue();
+  int64 value = time.ToInternalValue();
+  return base::Time::FromInternalValue(value - value % width);
+}
 
 // If the db is quiet for this number of minutes, then it is considered down.
 const base::TimeDelta kActiveIntervalTimeout() {
@@ -81,10 +94,77 @@ TimeRange::TimeRange(base::Time start_time, base::Time end_time)
 TimeRange::~TimeRange() {
 }
 
+MetricRollup::MetricRollup()
+    : count(0),
+      first_value(0.0),
+      last_value(0.0),
+      integral(0.0) {
+}
+
+MetricRollup::~MetricRollup() {
+}
+
+void MetricRollup::AddMetric(const Metric& metric) {
+  if (count) {
+    integral += metric.value * (metric.time - last_time).InSecondsF();
+  } else {
+    first_time = metric.time;
+    first_value = metric.value;
+  }
+  last_time = metric.time;
+  last_value = metric.value;
+  ++count;
+}
+
+std::string MetricRollup::ToString() const {
+  return base::Int64ToString(count) + kRollupValueDelimiter +
+         base::Int64ToString(first_time.ToInternalValue()) +
+         kRollupValueDelimiter + base::DoubleToString(first_value) +
+         kRollupValueDelimiter +
+         base::Int64ToString(last_time.ToInternalValue()) +
+         kRollupValueDelimiter + base::DoubleToString(last_value) +
+         kRollupValueDelimiter + base::DoubleToString(integral);
+}
+
+bool MetricRollup::FromString(const std::string& value) {
+  std::vector<std::string> split;
+  base::SplitString(value, kRollupValueDelimiter, &split);
+  int64 first = 0;
+  int64 last = 0;
+  if (split.size() != 6u ||
+      !base::StringToInt64(split[0], &count) ||
+      !base::StringToInt64(split[1], &first) ||
+      !base::StringToDouble(split[2], &first_value) ||
+      !base::StringToInt64(split[3], &last) ||
+      !base::StringToDouble(split[4], &last_value) ||
+      !base::StringToDouble(split[5], &integral) ||
+      count <= 0 || last < first) {
+    return false;
+  }
+  first_time = base::Time::FromInternalValue(first);
+  last_time = base::Time::FromInternalValue(last);
+  return true;
+}
+
 base::Time Database::SystemClock::GetTime() {
   return base::Time::Now();
 }
 
+// static
+base::TimeDelta Database::GetRollupWidth(RollupResolution resolution) {
+  switch (resolution) {
+    case ROLLUP_MINUTE:
+      return base::TimeDelta::FromMinutes(1);
+    case ROLLUP_HOUR:
+      return base::TimeDelta::FromHours(1);
+    case ROLLUP_DAY:
+      return base::TimeDelta::FromDays(1);
+    default:
+      NOTREACHED();
+      return base::TimeDelta::FromMinutes(1);
+  }
+}
+
 // Static
 scoped_ptr<Database> Database::Create(base::FilePath path) {
   CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
@@ -239,7 +319,40 @@ bool Database::AddMetric(const std::string& activity,
 
   bool max_value_success =
       UpdateMaxValue(activity, metric.type, metric.ValueAsString());
-  return recent_status.ok() && metric_status.ok() && max_value_success;
+  bool rollup_success = UpdateRollups(activity, metric);
+  return recent_status.ok() && metric_status.ok() && max_value_success &&
+         rollup_success;
+}
+
+bool Database::UpdateRollups(const std::string& activity,
+                             const Metric& metric) {
+  leveldb::WriteBatch batch;
+  for (int i = 0; i < ROLLUP_NUMBER_OF_RESOLUTIONS; ++i) {
+    RollupResolution resolution = static_cast<RollupResolution>(i);
+    std::string rollup_key = key_builder_->CreateRollupKey(
+        resolution, metric.type, activity,
+        RollupBucketStart(resolution, metric.time));
+    std::string rollup_map_key = key_builder_->CreateRollupKey(
+        resolution, metric.type, activity, base::Time());
+
+    // Only go to the database when the metric opens a new bucket; it may have
+    // been written by a previous session.
+    std::pair<std::string, MetricRollup>& open_bucket =
+        rollup_map_[rollup_map_key];
+    if (open_bucket.first != rollup_key) {
+      open_bucket.first = rollup_key;
+      open_bucket.second = MetricRollup();
+      std::string value;
+      if (rollup_db_->Get(read_options_, rollup_key, &value).ok() &&
+          !open_bucket.second.FromString(value)) {
+        open_bucket.second = MetricRollup();
+      }
+    }
+
+    open_bucket.second.AddMetric(metric);
+    batch.Put(rollup_key, open_bucket.second.ToString());
+  }
+  return rollup_db_->Write(write_options_, &batch).ok();
 }
 
 bool Database::UpdateMaxValue(const std::string& activity,
@@ -389,6 +502,51 @@ scoped_ptr<Database::MetricVector> Database::GetStatsForActivityAndMetric(
   return results.Pass();
 }
 
+scoped_ptr<Database::MetricRollupVector>
+Database::GetRollupsForActivityAndMetric(const std::string& activity,
+                                         MetricType metric_type,
+                                         RollupResolution resolution,
+                                         const base::Time& start,
+                                         const base::Time& end) {
+  CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
+  scoped_ptr<MetricRollupVector> results(new MetricRollupVector());
+  std::string start_key = key_builder_->CreateRollupKey(
+      resolution, metric_type, activity, RollupBucketStart(resolution, start));
+  std::string end_key = key_builder_->CreateRollupKey(
+      resolution, metric_type, activity, RollupBucketStart(resolution, end));
+  scoped_ptr<leveldb::Iterator> it(rollup_db_->NewIterator(read_options_));
+  for (it->Seek(start_key);
+       it->Valid() && it->key().ToString() <= end_key;
+       it->Next()) {
+    MetricRollup rollup;
+    if (!rollup.FromString(it->value().ToString())) {
+      LOG(ERROR) << "Found bad rollup in the database. Key: "
+                 << it->key().ToString() << ". Skipping.";
+      continue;
+    }
+    rollup.bucket_start = RollupBucketStart(resolution, rollup.first_time);
+
+    if (rollup.last_time < start)
+      continue;
+    if (rollup.first_time > end)
+      break;
+    if (rollup.first_time < start)
+      return scoped_ptr<MetricRollupVector>();
+    if (rollup.last_time > end) {
+      // Only a sample at exactly |end|, opening the bucket, can be returned
+      // without the rest of the bucket.
+      if (rollup.first_time != end)
+        return scoped_ptr<MetricRollupVector>();
+      rollup.count = 1;
+      rollup.last_time = rollup.first_time;
+      rollup.last_value = rollup.first_value;
+      rollup.integral = 0.0;
+    }
+    results->push_back(rollup);
+  }
+  return results.Pass();
+}
+
 Database::MetricVectorMap Database::GetStatsForMetricByActivity(
     MetricType metric_type,
     const base::Time& start,
@@ -434,6 +592,7 @@ Database::Database(const base::FilePath& path)
     return;
   LoadRecents();
   LoadMaxValues();
+  BackfillRollups();
   clock_ = scoped_ptr<Clock>(new SystemClock());
   valid_ = true;
 }
@@ -466,8 +625,11 @@ bool Database::InitDBs() {
   event_db_ = SafelyOpenDatabase(open_options,
                                  kEventDb,
                                  true);  // fix if damaged
+  rollup_db_ = SafelyOpenDatabase(open_options,
+                                  kRollupDb,
+                                  true);  // fix if damaged
   return recent_db_ && max_value_db_ && state_db_ &&
-         active_interval_db_ && metric_db_ && event_db_;
+         active_interval_db_ && metric_db_ && event_db_ && rollup_db_;
 }
 
 scoped_ptr<leveldb::DB> Database::SafelyOpenDatabase(
@@ -543,6 +705,8 @@ bool Database::Close() {
   max_value_db_.reset();
   state_db_.reset();
   active_interval_db_.reset();
+  rollup_db_.reset();
+  rollup_map_.clear();
   start_time_key_.clear();
   return true;
 }
@@ -569,6 +733,47 @@ void Database::LoadMaxValues() {
   }
 }
 
+void Database::BackfillRollups() {
+  CHECK(!content::BrowserThread::CurrentlyOn(content::BrowserThread::UI));
+  scoped_ptr<leveldb::Iterator> rollup_it(
+      rollup_db_->NewIterator(read_options_));
+  rollup_it->SeekToFirst();
+  if (rollup_it->Valid() &&
+      MetricRollup().FromString(rollup_it->value().ToString())) {
+    return;
+  }
+
+  // The rollup db is empty or in an older format, so either this is a new
+  // database or it predates the current rollups. Either way, a single pass
+  // over the metric db rebuilds it.
+  leveldb::WriteBatch batch;
+  for (; rollup_it->Valid(); rollup_it->Next())
+    batch.Delete(rollup_it->key());
+
+  std::map<std::string, MetricRollup> buckets;
+  scoped_ptr<leveldb::Iterator> it(metric_db_->NewIterator(read_options_));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    MetricKey split_key = key_builder_->SplitMetricKey(it->key().ToString());
+    Metric metric(split_key.type, split_key.time, it->value().ToString());
+    if (!metric.IsValid())
+      continue;
+    for (int i = 0; i < ROLLUP_NUMBER_OF_RESOLUTIONS; ++i) {
+      RollupResolution resolution = static_cast<RollupResolution>(i);
+      buckets[key_builder_->CreateRollupKey(
+          resolution, metric.type, split_key.activity,
+          RollupBucketStart(resolution, metric.time))].AddMetric(metric);
+    }
+  }
+  for (std::map<std::string, MetricRollup>::const_iterator bucket =
+           buckets.begin();
+       bucket != buckets.end(); ++bucket) {
+    batch.Put(bucket->first, bucket->second.ToString());
+  }
+  leveldb::Status status = rollup_db_->Write(write_options_, &batch);
+  if (!status.ok())
+    LOG(ERROR) << "Failed to backfill metric rollups. " << status.ToString();
+}
+
 // TODO(chebert): Only update the active interval under certian circumstances
 // eg. every 10 times or when forced.
 void Database::UpdateActiveInterval() {
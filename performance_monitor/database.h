@@ -5,8 +5,10 @@
 #ifndef CHROME_BROWSER_PERFORMANCE_MONITOR_DATABASE_H_
 #define CHROME_BROWSER_PERFORMANCE_MONITOR_DATABASE_H_
 
+#include <map>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/files/file_path.h"
@@ -30,6 +32,34 @@ struct TimeRange {
   base::Time end;
 };
 
+// The statistics of the samples of one metric and activity in one rollup
+// bucket. Each sample is taken to hold its value from the sample before it,
+// as the mean aggregation of the performance monitor UI does, and |integral|
+// is the area under that step function from the first to the last sample of
+// the bucket. Together with the first sample of the next bucket, this gives
+// the time-weighted mean over whole buckets without reading the samples.
+struct MetricRollup {
+  MetricRollup();
+  ~MetricRollup();
+
+  // Folds |metric| into the bucket. Samples must be added in time order.
+  void AddMetric(const Metric& metric);
+
+  // Converts to and from the value stored in the rollup db. FromString()
+  // returns false if |value| is malformed.
+  std::string ToString() const;
+  bool FromString(const std::string& value);
+
+  base::Time bucket_start;
+  int64 count;
+  base::Time first_time;
+  double first_value;
+  base::Time last_time;
+  double last_value;
+  // In value-seconds.
+  double integral;
+};
+
 class KeyBuilder;
 class DatabaseTestHelper;
 
@@ -96,6 +126,15 @@ class DatabaseTestHelper;
 // interval.
 // Key: Metric - Time - Activity
 // Value: Statistic
+//
+// Rollup DB:
+// Stores pre-aggregated statistics for every metric at minute, hour and day
+// granularity. The buckets are updated as each metric is added, so queries at
+// a coarse resolution only need to read one row per bucket rather than every
+// sample in the range. Databases written before rollups existed are backfilled
+// from the metric db the first time they are opened.
+// Key: Resolution - Metric - Activity - Bucket Start Time
+// Value: Count - First Time - First Value - Last Time - Last Value - Integral
 class Database {
  public:
   typedef std::set<EventType> EventTypeSet;
@@ -103,6 +142,7 @@ class Database {
   typedef std::set<MetricType> MetricTypeSet;
   typedef std::vector<Metric> MetricVector;
   typedef std::map<std::string, linked_ptr<MetricVector> > MetricVectorMap;
+  typedef std::vector<MetricRollup> MetricRollupVector;
 
   static const char kDatabaseSequenceToken[];
 
@@ -119,6 +159,10 @@ class Database {
 
   static scoped_ptr<Database> Create(base::FilePath path);
 
+  // Returns the width of the rollup buckets at |resolution|. Buckets are
+  // aligned to the internal time epoch, which falls on a UTC midnight.
+  static base::TimeDelta GetRollupWidth(RollupResolution resolution);
+
   // A "state" value is anything that can only have one value at a time, and
   // usually describes the state of the browser eg. version.
   bool AddStateValue(const std::string& key, const std::string& value);
@@ -214,6 +258,28 @@ class Database {
                                         base::Time(), clock_->GetTime());
   }
 
+  // Query the rollup buckets at |resolution| of the given |metric_type| and
+  // |activity| which hold the samples between |start| and |end|, inclusive, in
+  // time order. A sample at exactly |end| is returned as a bucket of its own.
+  // Returns NULL if a bucket also holds samples outside of the range, which
+  // happens when |start| or |end| isn't on a bucket boundary; the raw samples
+  // are needed then.
+  scoped_ptr<MetricRollupVector> GetRollupsForActivityAndMetric(
+      const std::string& activity,
+      MetricType metric_type,
+      RollupResolution resolution,
+      const base::Time& start,
+      const base::Time& end);
+
+  scoped_ptr<MetricRollupVector> GetRollupsForActivityAndMetric(
+      MetricType metric_type,
+      RollupResolution resolution,
+      const base::Time& start,
+      const base::Time& end) {
+    return GetRollupsForActivityAndMetric(kProcessChromeAggregate, metric_type,
+                                          resolution, start, end);
+  }
+
   // Query given |metric_type|. The returned map is keyed by activity.
   MetricVectorMap GetStatsForMetricByActivity(MetricType metric_type,
                                               const base::Time& start,
@@ -241,6 +307,12 @@ class Database {
   typedef std::map<std::string, std::string> RecentMap;
   typedef std::map<std::string, double> MaxValueMap;
 
+  // The key and contents of the most recently written bucket at each
+  // resolution, keyed by resolution, metric and activity. This lets AddMetric
+  // update the open bucket without reading it back from the rollup db.
+  typedef std::map<std::string, std::pair<std::string, MetricRollup> >
+      RollupMap;
+
   // By default, the database uses a clock that simply returns the current time.
   class SystemClock : public Clock {
    public:
@@ -267,6 +339,9 @@ class Database {
   void LoadRecents();
   // Load max values from the db into the max_value_map_.
   void LoadMaxValues();
+  // Builds the rollup db from the metric db if it was written by a version
+  // which did not maintain rollups, or stored them in another format.
+  void BackfillRollups();
 
   // Mark the database as being active for the current time.
   void UpdateActiveInterval();
@@ -275,6 +350,8 @@ class Database {
   bool UpdateMaxValue(const std::string& activity,
                       MetricType metric,
                       const std::string& value);
+  // Folds the given metric into its bucket at each rollup resolution.
+  bool UpdateRollups(const std::string& activity, const Metric& metric);
 
   scoped_ptr<KeyBuilder> key_builder_;
 
@@ -285,6 +362,8 @@ class Database {
 
   MaxValueMap max_value_map_;
 
+  RollupMap rollup_map_;
+
   // The directory where all the databases will reside.
   base::FilePath path_;
 
@@ -308,6 +387,8 @@ class Database {
 
   scoped_ptr<leveldb::DB> event_db_;
 
+  scoped_ptr<leveldb::DB> rollup_db_;
+
   leveldb::ReadOptions read_options_;
   leveldb::WriteOptions write_options_;
 
@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 
+#include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/memory/scoped_ptr.h"
@@ -531,4 +532,105 @@ TEST_F(PerformanceMonitorDatabaseMetricTest, GetRange) {
   ASSERT_EQ(9, stats[1].value);
 }
 
+TEST_F(PerformanceMonitorDatabaseMetricTest, GetRollups) {
+  base::Time start = base::Time::FromInternalValue(0) +
+      base::TimeDelta::FromDays(1);
+  db_->AddMetric(activity_, Metric(METRIC_NETWORK_BYTES_READ, start, 10.0));
+  db_->AddMetric(activity_,
+                 Metric(METRIC_NETWORK_BYTES_READ,
+                        start + base::TimeDelta::FromSeconds(30),
+                        20.0));
+  db_->AddMetric(activity_,
+                 Metric(METRIC_NETWORK_BYTES_READ,
+                        start + base::TimeDelta::FromMinutes(90),
+                        60.0));
+  base::Time end = start + base::TimeDelta::FromHours(2);
+
+  // The first two samples share a minute bucket, and the second holds its
+  // value for the 30 seconds since the first.
+  Database::MetricRollupVector rollups = *db_->GetRollupsForActivityAndMetric(
+      activity_, METRIC_NETWORK_BYTES_READ, ROLLUP_MINUTE, start, end);
+  ASSERT_EQ(2u, rollups.size());
+  EXPECT_EQ(start, rollups[0].bucket_start);
+  EXPECT_EQ(2, rollups[0].count);
+  EXPECT_EQ(start, rollups[0].first_time);
+  EXPECT_EQ(10.0, rollups[0].first_value);
+  EXPECT_EQ(start + base::TimeDelta::FromSeconds(30), rollups[0].last_time);
+  EXPECT_EQ(20.0, rollups[0].last_value);
+  EXPECT_EQ(600.0, rollups[0].integral);
+  EXPECT_EQ(start + base::TimeDelta::FromMinutes(90), rollups[1].bucket_start);
+  EXPECT_EQ(1, rollups[1].count);
+  EXPECT_EQ(0.0, rollups[1].integral);
+
+  // The day bucket holds all three.
+  rollups = *db_->GetRollupsForActivityAndMetric(
+      activity_, METRIC_NETWORK_BYTES_READ, ROLLUP_DAY, start, end);
+  ASSERT_EQ(1u, rollups.size());
+  EXPECT_EQ(3, rollups[0].count);
+  EXPECT_EQ(60.0, rollups[0].last_value);
+  EXPECT_EQ(600.0 + 60.0 * 89.5 * 60.0, rollups[0].integral);
+
+  // A bucket beginning before the range is skipped if none of its samples are
+  // in it.
+  rollups = *db_->GetRollupsForActivityAndMetric(
+      activity_, METRIC_NETWORK_BYTES_READ, ROLLUP_MINUTE,
+      start + base::TimeDelta::FromSeconds(45), end);
+  ASSERT_EQ(1u, rollups.size());
+  EXPECT_EQ(60.0, rollups[0].first_value);
+
+  // A bucket with samples on both sides of either end of the range can't be
+  // returned.
+  EXPECT_FALSE(db_->GetRollupsForActivityAndMetric(
+      activity_, METRIC_NETWORK_BYTES_READ, ROLLUP_MINUTE,
+      start + base::TimeDelta::FromSeconds(15), end));
+  EXPECT_FALSE(db_->GetRollupsForActivityAndMetric(
+      activity_, METRIC_NETWORK_BYTES_READ, ROLLUP_MINUTE,
+      start, start + base::TimeDelta::FromSeconds(15)));
+
+  // A sample at exactly the end of the range is returned on its own.
+  rollups = *db_->GetRollupsForActivityAndMetric(
+      activity_, METRIC_NETWORK_BYTES_READ, ROLLUP_HOUR,
+      start - base::TimeDelta::FromHours(1), start);
+  ASSERT_EQ(1u, rollups.size());
+  EXPECT_EQ(1, rollups[0].count);
+  EXPECT_EQ(start, rollups[0].last_time);
+  EXPECT_EQ(10.0, rollups[0].last_value);
+  EXPECT_EQ(0.0, rollups[0].integral);
+
+  // Other activities are not mixed in.
+  rollups = *db_->GetRollupsForActivityAndMetric(
+      METRIC_NETWORK_BYTES_READ, ROLLUP_DAY, start, end);
+  EXPECT_TRUE(rollups.empty());
+}
+
+TEST(PerformanceMonitorDatabaseSetupTest, BackfillRollups) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::Time time = base::Time::FromInternalValue(0) +
+      base::TimeDelta::FromDays(1);
+  {
+    scoped_ptr<Database> db = Database::Create(temp_dir.path());
+    ASSERT_TRUE(db.get());
+    db->AddMetric(Metric(METRIC_CPU_USAGE, time, 4.0));
+    db->AddMetric(Metric(METRIC_CPU_USAGE,
+                         time + base::TimeDelta::FromSeconds(1),
+                         8.0));
+  }
+
+  // Simulate a database written before rollups existed.
+  ASSERT_TRUE(base::DeleteFile(
+      temp_dir.path().AppendASCII("Metric Rollups"), true));
+
+  scoped_ptr<Database> db = Database::Create(temp_dir.path());
+  ASSERT_TRUE(db.get());
+  Database::MetricRollupVector rollups = *db->GetRollupsForActivityAndMetric(
+      METRIC_CPU_USAGE, ROLLUP_HOUR, time,
+      time + base::TimeDelta::FromHours(1));
+  ASSERT_EQ(1u, rollups.size());
+  EXPECT_EQ(2, rollups[0].count);
+  EXPECT_EQ(4.0, rollups[0].first_value);
+  EXPECT_EQ(8.0, rollups[0].last_value);
+  EXPECT_EQ(8.0, rollups[0].integral);
+}
+
 }  // namespace performance_monitor
@@ -45,6 +45,12 @@ METRIC_NETWORK_BYTES_READ_KEY_CHAR = 42,
 METRIC_NUMBER_OF_METRICS_KEY_CHAR = 255,
 };
 
+enum RollupKeyChar {
+ROLLUP_MINUTE_KEY_CHAR = 35,
+ROLLUP_HOUR_KEY_CHAR = 36,
+ROLLUP_DAY_KEY_CHAR = 37,
+};
+
 enum EventKeyChar {
 EVENT_UNDEFINED_KEY_CHAR = 34,
 EVENT_EXTENSION_INSTALL_KEY_CHAR = 35,
@@ -86,6 +92,20 @@ enum MetricKeyPosition {
   METRIC_ACTIVITY  // The unique identifier for the activity.
 };
 
+int RollupResolutionToKeyChar(RollupResolution resolution) {
+  switch (resolution) {
+    case ROLLUP_MINUTE:
+      return ROLLUP_MINUTE_KEY_CHAR;
+    case ROLLUP_HOUR:
+      return ROLLUP_HOUR_KEY_CHAR;
+    case ROLLUP_DAY:
+      return ROLLUP_DAY_KEY_CHAR;
+    default:
+      NOTREACHED();
+      return ROLLUP_MINUTE_KEY_CHAR;
+  }
+}
+
 }  // namespace
 
 RecentKey::RecentKey(const std::string& recent_time,
@@ -216,6 +236,17 @@ std::string KeyBuilder::CreateMaxValueKey(const MetricType type,
                             kDelimiter, activity.c_str());
 }
 
+std::string KeyBuilder::CreateRollupKey(const RollupResolution resolution,
+                                        const MetricType type,
+                                        const std::string& activity,
+                                        const base::Time& bucket_start) {
+  return base::StringPrintf("%c%c%c%c%s%c%016" PRId64,
+                            RollupResolutionToKeyChar(resolution), kDelimiter,
+                            metric_type_to_metric_key_char_[type], kDelimiter,
+                            activity.c_str(), kDelimiter,
+                            bucket_start.ToInternalValue());
+}
+
 EventType KeyBuilder::EventKeyToEventType(const std::string& event_key) {
   std::vector<std::string> split;
   base::SplitString(event_key, kDelimiter, &split);
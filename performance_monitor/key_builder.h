@@ -7,6 +7,7 @@
 
 #include <map>
 
+#include "chrome/browser/performance_monitor/constants.h"
 #include "chrome/browser/performance_monitor/event.h"
 #include "chrome/browser/performance_monitor/metric.h"
 
@@ -79,6 +80,14 @@ class KeyBuilder {
   std::string CreateMaxValueKey(const MetricType type,
                                 const std::string& activity);
 
+  // Key Schema: <Resolution>-<Metric>-<Activity>-<Bucket Time>
+  // The bucket time comes last so that all the buckets for a given resolution,
+  // metric and activity form one contiguous, time-ordered range.
+  std::string CreateRollupKey(const RollupResolution resolution,
+                              const MetricType type,
+                              const std::string& activity,
+                              const base::Time& bucket_start);
+
   EventType EventKeyToEventType(const std::string& key);
   RecentKey SplitRecentKey(const std::string& key);
   MetricKey SplitMetricKey(const std::string& key);
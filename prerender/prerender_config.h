@@ -19,6 +19,11 @@ struct Config {
   // Maximum memory use for a prerendered page until it is killed.
   size_t max_bytes;
 
+  // Memory budget shared by all running prerenders. A new prerender that
+  // would exceed it displaces running prerenders with a lower expected hit
+  // rate, or is not started.
+  size_t max_total_bytes;
+
   // Number of simultaneous prerender pages from link elements allowed. Enforced
   // by PrerenderLinkManager.
   size_t max_link_concurrency;
@@ -238,7 +238,8 @@ PrerenderContents::PrerenderContents(
       main_frame_id_(0),
       cookie_status_(0),
       cookie_send_type_(COOKIE_SEND_TYPE_NONE),
-      network_bytes_(0) {
+      network_bytes_(0),
+      private_bytes_(0) {
   DCHECK(prerender_manager != NULL);
 }
 
@@ -729,10 +730,11 @@ void PrerenderContents::DestroyWhenUsingTooManyResources() {
     return;
 
   size_t private_bytes, shared_bytes;
-  if (metrics->GetMemoryBytes(&private_bytes, &shared_bytes) &&
-      private_bytes > prerender_manager_->config().max_bytes) {
+  if (!metrics->GetMemoryBytes(&private_bytes, &shared_bytes))
+    return;
+  private_bytes_ = private_bytes;
+  if (private_bytes > prerender_manager_->config().max_bytes)
     Destroy(FINAL_STATUS_MEMORY_LIMIT_EXCEEDED);
-  }
 }
 
 WebContents* PrerenderContents::ReleasePrerenderContents() {
@@ -774,6 +776,9 @@ base::Value* PrerenderContents::GetAsValue() const {
   dict_value->SetInteger("duration", duration.InSeconds());
   dict_value->SetBoolean("is_loaded", prerender_contents_ &&
                                       !prerender_contents_->IsLoading());
+  dict_value->SetString("origin", NameFromOrigin(origin_));
+  dict_value->SetInteger("private_mb",
+                         static_cast<int>(private_bytes_ / 1024 / 1024));
   return dict_value;
 }
 
@@ -157,6 +157,10 @@ class PrerenderContents : public content::NotificationObserver,
   // it if not.
   void DestroyWhenUsingTooManyResources();
 
+  // The private memory of the prerendering renderer, in bytes, as of the last
+  // call to DestroyWhenUsingTooManyResources. 0 if it was never measured.
+  size_t private_bytes() const { return private_bytes_; }
+
   content::RenderViewHost* GetRenderViewHostMutable();
   const content::RenderViewHost* GetRenderViewHost() const;
 
@@ -476,6 +480,8 @@ class PrerenderContents : public content::NotificationObserver,
   // transferred over the network for resources.  Updated with AddNetworkBytes.
   int64 network_bytes_;
 
+  size_t private_bytes_;
+
   DISALLOW_COPY_AND_ASSIGN(PrerenderContents);
 };
 
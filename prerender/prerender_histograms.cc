@@ -4,6 +4,7 @@
 
 #include "chrome/browser/prerender/prerender_histograms.h"
 
+#include <algorithm>
 #include <string>
 
 #include "base/format_macros.h"
@@ -148,6 +149,8 @@ PrerenderHistograms::PrerenderHistograms()
       origin_experiment_wash_(false),
       seen_any_pageload_(true),
       seen_pageload_started_after_prerender_(true) {
+  std::fill(started_count_, started_count_ + ORIGIN_MAX, 0);
+  std::fill(used_count_, used_count_ + ORIGIN_MAX, 0);
 }
 
 void PrerenderHistograms::RecordPrerender(Origin origin, const GURL& url) {
@@ -179,7 +182,8 @@ void PrerenderHistograms::RecordPrerender(Origin origin, const GURL& url) {
   seen_pageload_started_after_prerender_ = false;
 }
 
-void PrerenderHistograms::RecordPrerenderStarted(Origin origin) const {
+void PrerenderHistograms::RecordPrerenderStarted(Origin origin) {
+  ++started_count_[origin];
   if (OriginIsOmnibox(origin)) {
     UMA_HISTOGRAM_ENUMERATION(
         base::StringPrintf("Prerender.OmniboxPrerenderCount%s",
@@ -196,7 +200,8 @@ void PrerenderHistograms::RecordConcurrency(size_t prerender_count) const {
       prerender_count, kMaxRecordableConcurrency + 1);
 }
 
-void PrerenderHistograms::RecordUsedPrerender(Origin origin) const {
+void PrerenderHistograms::RecordUsedPrerender(Origin origin) {
+  ++used_count_[origin];
   if (OriginIsOmnibox(origin)) {
     UMA_HISTOGRAM_ENUMERATION(
         base::StringPrintf("Prerender.OmniboxNavigationsUsedPrerenderCount%s",
@@ -204,6 +209,13 @@ void PrerenderHistograms::RecordUsedPrerender(Origin origin) const {
   }
 }
 
+double PrerenderHistograms::GetHitRate(Origin origin) const {
+  DCHECK_LT(origin, ORIGIN_MAX);
+  // Laplace smoothing: behaves as if one prerender had been used and one had
+  // not before any were seen.
+  return (used_count_[origin] + 1.0) / (started_count_[origin] + 2.0);
+}
+
 void PrerenderHistograms::RecordTimeSinceLastRecentVisit(
     Origin origin,
     base::TimeDelta delta) const {
@@ -87,14 +87,20 @@ class PrerenderHistograms {
   void RecordPrerender(Origin origin, const GURL& url);
 
   // To be called when a new prerender is started.
-  void RecordPrerenderStarted(Origin origin) const;
+  void RecordPrerenderStarted(Origin origin);
 
   // To be called when we know how many prerenders are running after starting
   // a prerender.
   void RecordConcurrency(size_t prerender_count) const;
 
   // Called when we swap in a prerender.
-  void RecordUsedPrerender(Origin origin) const;
+  void RecordUsedPrerender(Origin origin);
+
+  // Returns the fraction of the prerenders from |origin| started during this
+  // session which were used. With few samples the estimate is pulled towards
+  // one half, so that an origin is neither favored nor shunned before we know
+  // anything about it.
+  double GetHitRate(Origin origin) const;
 
   // Record the time since a page was recently visited.
   void RecordTimeSinceLastRecentVisit(Origin origin,
@@ -167,6 +173,10 @@ class PrerenderHistograms {
   bool seen_any_pageload_;
   bool seen_pageload_started_after_prerender_;
 
+  // The number of prerenders started and used during this session, by origin.
+  int started_count_[ORIGIN_MAX];
+  int used_count_[ORIGIN_MAX];
+
   DISALLOW_COPY_AND_ASSIGN(PrerenderHistograms);
 };
 
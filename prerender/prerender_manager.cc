@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -16,6 +17,7 @@
 #include "base/metrics/histogram.h"
 #include "base/prefs/pref_service.h"
 #include "base/stl_util.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/time/time.h"
 #include "base/timer/elapsed_timer.h"
@@ -93,6 +95,9 @@ const char* const kValidHttpMethods[] = {
 // Length of prerender history, for display in chrome://net-internals
 const int kHistoryLength = 100;
 
+// Length of the admission decision list.
+const size_t kAdmissionDecisionsLength = 20;
+
 // Timeout, in ms, for a session storage namespace merge.
 const int kSessionStorageNamespaceMergeTimeoutMs = 500;
 
@@ -234,6 +239,26 @@ struct PrerenderManager::NavigationRecord {
   base::TimeTicks time;
 };
 
+struct PrerenderManager::AdmissionDecision {
+  AdmissionDecision(const GURL& url,
+                    Origin origin,
+                    double value,
+                    const std::string& decision,
+                    base::Time time)
+      : url(url),
+        origin(origin),
+        value(value),
+        decision(decision),
+        time(time) {
+  }
+
+  GURL url;
+  Origin origin;
+  double value;
+  std::string decision;
+  base::Time time;
+};
+
 PrerenderManager::PrerenderManager(Profile* profile,
                                    PrerenderTracker* prerender_tracker)
     : enabled_(profile && profile->GetPrefs() &&
@@ -246,7 +271,10 @@ PrerenderManager::PrerenderManager(Profile* profile,
       prerender_history_(new PrerenderHistory(kHistoryLength)),
       histograms_(new PrerenderHistograms()),
       profile_network_bytes_(0),
-      last_recorded_profile_network_bytes_(0) {
+      last_recorded_profile_network_bytes_(0),
+      memory_pressure_listener_(new base::MemoryPressureListener(
+          base::Bind(&PrerenderManager::OnMemoryPressure,
+                     base::Unretained(this)))) {
   // There are some assumptions that the PrerenderManager is on the UI thread.
   // Any other checks simply make sure that the PrerenderManager is accessed on
   // the same thread that it was created on.
@@ -906,6 +934,7 @@ base::DictionaryValue* PrerenderManager::GetAsValue() const {
   base::DictionaryValue* dict_value = new base::DictionaryValue();
   dict_value->Set("history", prerender_history_->GetEntriesAsValue());
   dict_value->Set("active", GetActivePrerendersAsValue());
+  dict_value->Set("admission", GetAdmissionDecisionsAsValue());
   dict_value->SetBoolean("enabled", enabled_);
   dict_value->SetBoolean("omnibox_enabled", IsOmniboxEnabled(profile_));
   // If prerender is disabled via a flag this method is not even called.
@@ -1282,6 +1311,13 @@ PrerenderHandle* PrerenderManager::AddPrerender(
     return NULL;
   }
 
+  // Check that the prerender fits in the memory budget, or is worth more than
+  // the prerenders it would displace.
+  if (!AdmitPrerender(origin, url)) {
+    RecordFinalStatus(origin, experiment, FINAL_STATUS_LOW_VALUE);
+    return NULL;
+  }
+
   PrerenderContents* prerender_contents = CreatePrerenderContents(
       url, referrer, origin, experiment);
   DCHECK(prerender_contents);
@@ -1349,6 +1385,118 @@ void PrerenderManager::StopSchedulingPeriodicCleanups() {
   repeating_timer_.Stop();
 }
 
+double PrerenderManager::GetPrerenderValue(Origin origin) const {
+  return histograms_->GetHitRate(origin);
+}
+
+size_t PrerenderManager::GetActivePrerendersBytes() const {
+  size_t bytes = 0;
+  for (ScopedVector<PrerenderData>::const_iterator it =
+           active_prerenders_.begin();
+       it != active_prerenders_.end(); ++it) {
+    // Control group and match complete replacements don't use any resources.
+    const PrerenderContents* contents = (*it)->contents();
+    if (!contents->prerendering_has_started())
+      continue;
+    if (contents->private_bytes())
+      bytes += contents->private_bytes();
+    else
+      bytes += kDefaultPrerenderBytes;
+  }
+  return bytes;
+}
+
+bool PrerenderManager::AdmitPrerender(Origin origin, const GURL& url) {
+  DCHECK(CalledOnValidThread());
+  if (!ActuallyPrerendering())
+    return true;
+
+  const double value = GetPrerenderValue(origin);
+  while (GetActivePrerendersBytes() + kDefaultPrerenderBytes >
+         config_.max_total_bytes) {
+    if (!DestroyLowestValuePrerender(value, FINAL_STATUS_LOW_VALUE)) {
+      RecordAdmissionDecision(url, origin, "Rejected");
+      return false;
+    }
+  }
+  RecordAdmissionDecision(url, origin, "Admitted");
+  return true;
+}
+
+bool PrerenderManager::DestroyLowestValuePrerender(double value,
+                                                   FinalStatus final_status) {
+  DCHECK(CalledOnValidThread());
+  PrerenderContents* lowest = NULL;
+  double lowest_value = value;
+  for (ScopedVector<PrerenderData>::iterator it = active_prerenders_.begin();
+       it != active_prerenders_.end(); ++it) {
+    // Prerenders being swapped in are about to be used.
+    PrerenderContents* contents = (*it)->contents();
+    if (!contents->prerendering_has_started() || (*it)->pending_swap())
+      continue;
+    double contents_value = GetPrerenderValue(contents->origin());
+    if (contents_value < lowest_value) {
+      lowest = contents;
+      lowest_value = contents_value;
+    }
+  }
+  if (!lowest)
+    return false;
+
+  RecordAdmissionDecision(lowest->prerender_url(), lowest->origin(),
+                          std::string("Evicted: ") +
+                              NameFromFinalStatus(final_status));
+  lowest->Destroy(final_status);
+  return true;
+}
+
+void PrerenderManager::OnMemoryPressure(
+    base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level) {
+  DCHECK(CalledOnValidThread());
+  const double kAnyValue = std::numeric_limits<double>::infinity();
+  // Under moderate pressure, give up the prerender least likely to be used.
+  // Under critical pressure, give up all of them.
+  if (memory_pressure_level ==
+      base::MemoryPressureListener::MEMORY_PRESSURE_MODERATE) {
+    DestroyLowestValuePrerender(kAnyValue, FINAL_STATUS_MEMORY_PRESSURE);
+  } else {
+    while (DestroyLowestValuePrerender(kAnyValue,
+                                       FINAL_STATUS_MEMORY_PRESSURE)) {
+    }
+  }
+}
+
+void PrerenderManager::RecordAdmissionDecision(const GURL& url,
+                                               Origin origin,
+                                               const std::string& decision) {
+  admission_decisions_.push_back(AdmissionDecision(
+      url, origin, GetPrerenderValue(origin), decision, GetCurrentTime()));
+  if (admission_decisions_.size() > kAdmissionDecisionsLength)
+    admission_decisions_.pop_front();
+}
+
+base::Value* PrerenderManager::GetAdmissionDecisionsAsValue() const {
+  base::ListValue* list_value = new base::ListValue();
+  // Javascript needs times in terms of milliseconds since Jan 1, 1970.
+  base::Time epoch_start = base::Time::UnixEpoch();
+  for (std::list<AdmissionDecision>::const_reverse_iterator it =
+           admission_decisions_.rbegin();
+       it != admission_decisions_.rend(); ++it) {
+    base::DictionaryValue* decision_value = new base::DictionaryValue();
+    decision_value->SetString("url", it->url.spec());
+    decision_value->SetString("origin", NameFromOrigin(it->origin));
+    decision_value->SetDouble("value", it->value);
+    decision_value->SetString("decision", it->decision);
+    // Use a string to prevent overflow, as Values don't support 64-bit
+    // integers.
+    decision_value->SetString(
+        "time",
+        base::Int64ToString((it->time - epoch_start).InMilliseconds()));
+    list_value->Append(decision_value);
+  }
+  return list_value;
+}
+
 void PrerenderManager::PeriodicCleanup() {
   DCHECK(CalledOnValidThread());
 
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "base/gtest_prod_util.h"
+#include "base/memory/memory_pressure_listener.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/scoped_vector.h"
 #include "base/memory/weak_ptr.h"
@@ -244,9 +245,9 @@ class PrerenderManager : public base::SupportsWeakPtr<PrerenderManager>,
   // prerendering.
   static bool DoesSubresourceURLHaveValidScheme(const GURL& url);
 
-  // Returns a Value object containing the active pages being prerendered, and
-  // a history of pages which were prerendered. The caller is responsible for
-  // deleting the return value.
+  // Returns a Value object containing the active pages being prerendered, a
+  // history of pages which were prerendered and the recent admission
+  // decisions. The caller is responsible for deleting the return value.
   base::DictionaryValue* GetAsValue() const;
 
   // Clears the data indicated by which bits of clear_flags are set.
@@ -520,6 +521,7 @@ class PrerenderManager : public base::SupportsWeakPtr<PrerenderManager>,
 
   class OnCloseWebContentsDeleter;
   struct NavigationRecord;
+  struct AdmissionDecision;
 
   // Time interval before a new prerender is allowed.
   static const int kMinTimeBetweenPrerendersMs = 500;
@@ -527,6 +529,9 @@ class PrerenderManager : public base::SupportsWeakPtr<PrerenderManager>,
   // Time window for which we record old navigations, in milliseconds.
   static const int kNavigationRecordWindowMs = 5000;
 
+  // Memory assumed for a prerender whose renderer has not been measured yet.
+  static const size_t kDefaultPrerenderBytes = 50 * 1024 * 1024;
+
   void OnCancelPrerenderHandle(PrerenderData* prerender_data);
 
   // Adds a prerender for |url| from |referrer| initiated from the process
@@ -545,6 +550,37 @@ class PrerenderManager : public base::SupportsWeakPtr<PrerenderManager>,
   void StartSchedulingPeriodicCleanups();
   void StopSchedulingPeriodicCleanups();
 
+  // Returns the expected value of a prerender from |origin|, which is the
+  // chance it will be used.
+  double GetPrerenderValue(Origin origin) const;
+
+  // Returns the memory used by the running prerenders. Prerenders which have
+  // not been measured yet are assumed to use a typical amount.
+  size_t GetActivePrerendersBytes() const;
+
+  // Makes room within |config_.max_total_bytes| for a new prerender of |url|
+  // from |origin|, destroying running prerenders of lower value if needed.
+  // Returns false if the new prerender should not be started.
+  bool AdmitPrerender(Origin origin, const GURL& url);
+
+  // Destroys the running prerender with the lowest value with |final_status|,
+  // provided that value is less than |value|. Returns false if there was no
+  // such prerender.
+  bool DestroyLowestValuePrerender(double value, FinalStatus final_status);
+
+  // Sheds prerenders when the system is low on memory.
+  void OnMemoryPressure(
+      base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level);
+
+  // Records an admission decision for display in net-internals.
+  void RecordAdmissionDecision(const GURL& url,
+                               Origin origin,
+                               const std::string& decision);
+
+  // Returns a new Value representing the recent admission decisions. The
+  // caller is responsible for delete'ing the return value.
+  base::Value* GetAdmissionDecisionsAsValue() const;
+
   void EvictOldestPrerendersIfNecessary();
 
   // Deletes stale and cancelled prerendered PrerenderContents, as well as
@@ -720,6 +756,11 @@ class PrerenderManager : public base::SupportsWeakPtr<PrerenderManager>,
   // The value of profile_network_bytes_ that was last recorded.
   int64 last_recorded_profile_network_bytes_;
 
+  // The most recent admission decisions, oldest first.
+  std::list<AdmissionDecision> admission_decisions_;
+
+  scoped_ptr<base::MemoryPressureListener> memory_pressure_listener_;
+
   DISALLOW_COPY_AND_ASSIGN(PrerenderManager);
 };
 
@@ -93,6 +93,8 @@ class UnitTestPrerenderManager : public PrerenderManager {
  public:
   using PrerenderManager::kMinTimeBetweenPrerendersMs;
   using PrerenderManager::kNavigationRecordWindowMs;
+  using PrerenderManager::kDefaultPrerenderBytes;
+  using PrerenderManager::OnMemoryPressure;
 
   explicit UnitTestPrerenderManager(Profile* profile,
                                     PrerenderTracker* prerender_tracker)
@@ -143,6 +145,13 @@ class UnitTestPrerenderManager : public PrerenderManager {
     return prerender_contents;
   }
 
+  // Lowers the expected hit rate of |origin| as if |count| of its prerenders
+  // had gone unused.
+  void RecordUnusedPrerenders(Origin origin, int count) {
+    for (int i = 0; i < count; ++i)
+      histograms_->RecordPrerenderStarted(origin);
+  }
+
   void AdvanceTime(TimeDelta delta) {
     time_ += delta;
   }
@@ -1021,6 +1030,74 @@ TEST_F(PrerenderTest, CancelAllTest) {
   EXPECT_EQ(null, prerender_manager()->FindEntry(url));
 }
 
+// Tests that a prerender which does not fit in the memory budget displaces a
+// running prerender with a lower expected hit rate.
+TEST_F(PrerenderTest, AdmissionEvictsLowerValuePrerender) {
+  prerender_manager()->mutable_config().max_total_bytes =
+      3 * UnitTestPrerenderManager::kDefaultPrerenderBytes / 2;
+  prerender_manager()->RecordUnusedPrerenders(ORIGIN_LOCAL_PREDICTOR, 10);
+
+  GURL low_value_url("http://www.google.com/low_value");
+  DummyPrerenderContents* low_value_contents =
+      prerender_manager()->CreateNextPrerenderContents(
+          low_value_url, ORIGIN_LOCAL_PREDICTOR, FINAL_STATUS_LOW_VALUE);
+  scoped_ptr<PrerenderHandle> low_value_handle(
+      prerender_manager()->AddPrerenderFromLocalPredictor(
+          low_value_url, NULL, kSize));
+  ASSERT_TRUE(low_value_handle.get());
+  EXPECT_TRUE(low_value_contents->prerendering_has_started());
+
+  GURL url("http://www.google.com/");
+  DummyPrerenderContents* prerender_contents =
+      prerender_manager()->CreateNextPrerenderContents(
+          url, ORIGIN_OMNIBOX, FINAL_STATUS_USED);
+  scoped_ptr<PrerenderHandle> prerender_handle(
+      prerender_manager()->AddPrerenderFromOmnibox(url, NULL, kSize));
+  ASSERT_TRUE(prerender_handle.get());
+  EXPECT_TRUE(prerender_contents->prerendering_has_started());
+  EXPECT_TRUE(low_value_contents->prerendering_has_been_cancelled());
+  ASSERT_EQ(prerender_contents, prerender_manager()->FindAndUseEntry(url));
+}
+
+// Tests that a prerender which does not fit in the memory budget is rejected
+// if the running prerenders are worth more.
+TEST_F(PrerenderTest, AdmissionRejectsLowerValuePrerender) {
+  prerender_manager()->mutable_config().max_total_bytes =
+      3 * UnitTestPrerenderManager::kDefaultPrerenderBytes / 2;
+  prerender_manager()->RecordUnusedPrerenders(ORIGIN_LOCAL_PREDICTOR, 10);
+
+  GURL url("http://www.google.com/");
+  DummyPrerenderContents* prerender_contents =
+      prerender_manager()->CreateNextPrerenderContents(
+          url, ORIGIN_OMNIBOX, FINAL_STATUS_USED);
+  scoped_ptr<PrerenderHandle> prerender_handle(
+      prerender_manager()->AddPrerenderFromOmnibox(url, NULL, kSize));
+  ASSERT_TRUE(prerender_handle.get());
+
+  GURL low_value_url("http://www.google.com/low_value");
+  EXPECT_FALSE(prerender_manager()->AddPrerenderFromLocalPredictor(
+      low_value_url, NULL, kSize));
+  EXPECT_FALSE(prerender_contents->prerendering_has_been_cancelled());
+  ASSERT_EQ(prerender_contents, prerender_manager()->FindAndUseEntry(url));
+}
+
+// Tests that critical memory pressure cancels running prerenders.
+TEST_F(PrerenderTest, CriticalMemoryPressureCancelsPrerenders) {
+  GURL url("http://www.google.com/");
+  DummyPrerenderContents* prerender_contents =
+      prerender_manager()->CreateNextPrerenderContents(
+          url, ORIGIN_OMNIBOX, FINAL_STATUS_MEMORY_PRESSURE);
+  scoped_ptr<PrerenderHandle> prerender_handle(
+      prerender_manager()->AddPrerenderFromOmnibox(url, NULL, kSize));
+  ASSERT_TRUE(prerender_handle.get());
+  EXPECT_TRUE(prerender_contents->prerendering_has_started());
+
+  prerender_manager()->OnMemoryPressure(
+      base::MemoryPressureListener::MEMORY_PRESSURE_CRITICAL);
+  EXPECT_TRUE(prerender_contents->prerendering_has_been_cancelled());
+  EXPECT_FALSE(prerender_manager()->FindEntry(url));
+}
+
 TEST_F(PrerenderTest, OmniboxNotAllowedWhenDisabled) {
   prerender_manager()->set_enabled(false);
   EXPECT_FALSE(prerender_manager()->AddPrerenderFromOmnibox(
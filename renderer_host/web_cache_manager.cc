@@ -33,6 +33,9 @@ using blink::WebCache;
 
 static const int kReviseAllocationDelayMS = 200;
 
+// The weight of the latest sample in a renderer's |fill_ratio|.
+static const double kFillRatioSmoothingFactor = 0.25;
+
 // The default size limit of the in-memory cache is 8 MB
 static const int kDefaultMemoryCacheSize = 8 * 1024 * 1024;
 
@@ -69,11 +72,16 @@ WebCacheManager* WebCacheManager::GetInstance() {
 
 WebCacheManager::WebCacheManager()
     : global_size_limit_(GetDefaultGlobalSizeLimit()),
+      revision_pending_(false),
+      memory_pressure_level_(
+          base::MemoryPressureListener::MEMORY_PRESSURE_MODERATE),
       weak_factory_(this) {
   registrar_.Add(this, content::NOTIFICATION_RENDERER_PROCESS_CREATED,
                  content::NotificationService::AllBrowserContextsAndSources());
   registrar_.Add(this, content::NOTIFICATION_RENDERER_PROCESS_TERMINATED,
                  content::NotificationService::AllBrowserContextsAndSources());
+  memory_pressure_listener_.reset(new base::MemoryPressureListener(
+      base::Bind(&WebCacheManager::OnMemoryPressure, base::Unretained(this))));
 }
 
 WebCacheManager::~WebCacheManager() {
@@ -143,6 +151,16 @@ void WebCacheManager::ObserveStats(int renderer_id,
   entry->second.liveSize = stats.liveSize;
   entry->second.maxDeadCapacity = stats.maxDeadCapacity;
   entry->second.minDeadCapacity = stats.minDeadCapacity;
+
+  double fill_ratio = 0.0;
+  if (stats.capacity) {
+    fill_ratio = std::min(
+        1.0,
+        static_cast<double>(stats.liveSize + stats.deadSize) / stats.capacity);
+  }
+  entry->second.fill_ratio =
+      kFillRatioSmoothingFactor * fill_ratio +
+      (1.0 - kFillRatioSmoothingFactor) * entry->second.fill_ratio;
 }
 
 void WebCacheManager::SetGlobalSizeLimit(size_t bytes) {
@@ -251,11 +269,12 @@ bool WebCacheManager::AttemptTactic(
   size_t inactive_size = GetSize(inactive_tactic, inactive_stats);
 
   // Give up if we don't have enough space to use this tactic.
-  if (global_size_limit_ < active_size + inactive_size)
+  size_t size_limit = GetEffectiveSizeLimit();
+  if (size_limit < active_size + inactive_size)
     return false;
 
   // Compute the unreserved space available.
-  size_t total_extra = global_size_limit_ - (active_size + inactive_size);
+  size_t total_extra = size_limit - (active_size + inactive_size);
 
   // The plan for the extra space is to divide it evenly amoung the active
   // renderers.
@@ -291,15 +310,29 @@ void WebCacheManager::AddToStrategy(const std::set<int>& renderers,
   if (renderers.empty())
     return;
 
-  // Divide the extra memory evenly among the renderers.
-  size_t extra_each = extra_bytes_to_allocate / renderers.size();
-
+  // Each renderer has a weight between 1 and 2 depending on how full its
+  // cache has been.  Renderers we have no stats for get the minimum.
+  double total_weight = 0.0;
   std::set<int>::const_iterator iter = renderers.begin();
+  for (; iter != renderers.end(); ++iter) {
+    StatsMap::const_iterator elmt = stats_.find(*iter);
+    if (elmt != stats_.end())
+      total_weight += elmt->second.fill_ratio;
+    total_weight += 1.0;
+  }
+
+  iter = renderers.begin();
   while (iter != renderers.end()) {
-    size_t cache_size = extra_each;
+    StatsMap::iterator elmt = stats_.find(*iter);
+    double weight = 1.0;
+    if (elmt != stats_.end())
+      weight += elmt->second.fill_ratio;
+
+    // Rounding down keeps the total within |extra_bytes_to_allocate|.
+    size_t cache_size = static_cast<size_t>(
+        extra_bytes_to_allocate * (weight / total_weight));
 
     // Add in the space required to implement |tactic|.
-    StatsMap::iterator elmt = stats_.find(*iter);
     if (elmt != stats_.end())
       cache_size += GetSize(tactic, elmt->second);
 
@@ -355,6 +388,7 @@ void WebCacheManager::ClearRendererCache(
 void WebCacheManager::ReviseAllocationStrategy() {
   DCHECK(stats_.size() <=
       active_renderers_.size() + inactive_renderers_.size());
+  revision_pending_ = false;
 
   // Check if renderers have gone inactive.
   FindInactiveRenderers();
@@ -423,6 +457,12 @@ void WebCacheManager::ReviseAllocationStrategy() {
 }
 
 void WebCacheManager::ReviseAllocationStrategyLater() {
+  // The pending revision will take into account whatever changed since it was
+  // scheduled.
+  if (revision_pending_)
+    return;
+  revision_pending_ = true;
+
   // Ask to be called back in a few milliseconds to actually recompute our
   // allocation.
   base::MessageLoop::current()->PostDelayedTask(FROM_HERE,
@@ -432,6 +472,47 @@ void WebCacheManager::ReviseAllocationStrategyLater() {
       base::TimeDelta::FromMilliseconds(kReviseAllocationDelayMS));
 }
 
+void WebCacheManager::OnMemoryPressure(
+    base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level) {
+  // Don't let a moderate signal relax the limit set by a recent critical one.
+  if (GetEffectiveSizeLimit() == global_size_limit_ ||
+      memory_pressure_level ==
+          base::MemoryPressureListener::MEMORY_PRESSURE_CRITICAL) {
+    memory_pressure_level_ = memory_pressure_level;
+  }
+  memory_pressure_time_ = base::TimeTicks::Now();
+
+  // Inactive renderers are the least likely to need their caches soon.
+  if (memory_pressure_level ==
+      base::MemoryPressureListener::MEMORY_PRESSURE_CRITICAL) {
+    ClearRendererCache(inactive_renderers_, INSTANTLY);
+  }
+
+  // Shrink the allocations right away, and restore them once the pressure
+  // has subsided.
+  ReviseAllocationStrategy();
+  base::MessageLoop::current()->PostDelayedTask(FROM_HERE,
+      base::Bind(
+          &WebCacheManager::ReviseAllocationStrategy,
+          weak_factory_.GetWeakPtr()),
+      base::TimeDelta::FromSeconds(kMemoryPressureRecoverySeconds));
+}
+
+size_t WebCacheManager::GetEffectiveSizeLimit() const {
+  if (memory_pressure_time_.is_null() ||
+      base::TimeTicks::Now() - memory_pressure_time_ >=
+          TimeDelta::FromSeconds(kMemoryPressureRecoverySeconds)) {
+    return global_size_limit_;
+  }
+  // Halve the caches under moderate pressure and quarter them under critical
+  // pressure.
+  if (memory_pressure_level_ ==
+      base::MemoryPressureListener::MEMORY_PRESSURE_CRITICAL) {
+    return global_size_limit_ / 4;
+  }
+  return global_size_limit_ / 2;
+}
+
 void WebCacheManager::FindInactiveRenderers() {
   std::set<int>::const_iterator iter = active_renderers_.begin();
   while (iter != active_renderers_.end()) {
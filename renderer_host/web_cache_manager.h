@@ -15,6 +15,8 @@
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
 #include "base/gtest_prod_util.h"
+#include "base/memory/memory_pressure_listener.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/time/time.h"
 #include "content/public/browser/notification_observer.h"
@@ -56,7 +58,8 @@ class WebCacheManager : public content::NotificationObserver {
 
   // Periodically, renderers should inform the cache manager of their current
   // statistics.  The more up-to-date the cache manager's statistics, the
-  // better it can allocate cache resources.
+  // better it can allocate cache resources.  Renderers whose caches keep
+  // filling up are given a larger share of any spare capacity.
   void ObserveStats(
       int renderer_id, const blink::WebCache::UsageStats& stats);
 
@@ -86,10 +89,19 @@ class WebCacheManager : public content::NotificationObserver {
   // The amount of idle time before we consider a tab to be "inactive"
   static const int kRendererInactiveThresholdMinutes = 5;
 
+  // How long the global size limit stays reduced after a memory pressure
+  // signal.
+  static const int kMemoryPressureRecoverySeconds = 60;
+
   // Keep track of some renderer information.
   struct RendererInfo : blink::WebCache::UsageStats {
     // The access time for this renderer.
     base::Time access;
+
+    // Moving average of how full this renderer's cache has been, from 0 (no
+    // resources) to 1 (at capacity).  A cache that stays full is evicting
+    // resources and so benefits the most from extra space.
+    double fill_ratio;
   };
 
   typedef std::map<int, RendererInfo> StatsMap;
@@ -112,9 +124,20 @@ class WebCacheManager : public content::NotificationObserver {
   // informs the renderers of their new allocation.
   void ReviseAllocationStrategy();
 
-  // Schedules a call to ReviseAllocationStrategy after a short delay.
+  // Schedules a call to ReviseAllocationStrategy after a short delay.  Does
+  // nothing if a call is already scheduled, so bursts of activity result in a
+  // single revision.
   void ReviseAllocationStrategyLater();
 
+  // Shrinks the cache allocations when the system is low on memory.  The
+  // reduction lasts for kMemoryPressureRecoverySeconds after the last signal.
+  void OnMemoryPressure(
+      base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level);
+
+  // Returns the number of bytes the caches may currently use:
+  // |global_size_limit_|, reduced while recovering from memory pressure.
+  size_t GetEffectiveSizeLimit() const;
+
   // The various tactics used as part of an allocation strategy.  To decide
   // how many resources a given renderer should be allocated, we consider its
   // usage statistics.  Each tactic specifies the function that maps usage
@@ -122,7 +145,7 @@ class WebCacheManager : public content::NotificationObserver {
   //
   // Determining a resource allocation strategy amounts to picking a tactic
   // for each renderer and checking that the total memory required fits within
-  // our |global_size_limit_|.
+  // GetEffectiveSizeLimit().
   enum AllocationTactic {
     // Ignore cache statistics and divide resources equally among the given
     // set of caches.
@@ -172,7 +195,8 @@ class WebCacheManager : public content::NotificationObserver {
 
   // For each renderer in |renderers|, computes its allocation according to
   // |tactic| and add the result to |strategy|.  Any |extra_bytes_to_allocate|
-  // is divided evenly among the renderers.
+  // is divided among the renderers, weighted by their |fill_ratio| so that a
+  // full cache gets up to twice the share of an empty one.
   void AddToStrategy(const std::set<int>& renderers,
                      AllocationTactic tactic,
                      size_t extra_bytes_to_allocate,
@@ -212,6 +236,17 @@ class WebCacheManager : public content::NotificationObserver {
   // recently than they have been active.
   std::set<int> inactive_renderers_;
 
+  // True while a call to ReviseAllocationStrategy is scheduled.
+  bool revision_pending_;
+
+  // The most severe memory pressure signalled within the recovery period, and
+  // when it was last signalled.  |memory_pressure_time_| is null if there has
+  // been no memory pressure.
+  base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level_;
+  base::TimeTicks memory_pressure_time_;
+
+  scoped_ptr<base::MemoryPressureListener> memory_pressure_listener_;
+
   base::WeakPtrFactory<WebCacheManager> weak_factory_;
 
   content::NotificationRegistrar registrar_;
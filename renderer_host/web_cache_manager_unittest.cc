@@ -41,6 +41,25 @@ class WebCacheManagerTest : public testing::Test {
     h->FindInactiveRenderers();
   }
 
+  static void SimulateMemoryPressure(
+      WebCacheManager* h,
+      base::MemoryPressureListener::MemoryPressureLevel level) {
+    h->OnMemoryPressure(level);
+  }
+
+  static void SimulateMemoryPressureRecovery(WebCacheManager* h) {
+    h->memory_pressure_time_ = base::TimeTicks::Now() -
+        TimeDelta::FromSeconds(WebCacheManager::kMemoryPressureRecoverySeconds);
+  }
+
+  static size_t GetEffectiveSizeLimit(WebCacheManager* h) {
+    return h->GetEffectiveSizeLimit();
+  }
+
+  static bool revision_pending(WebCacheManager* h) {
+    return h->revision_pending_;
+  }
+
   static std::set<int>& active_renderers(WebCacheManager* h) {
     return h->active_renderers_;
   }
@@ -309,3 +328,80 @@ TEST_F(WebCacheManagerTest, AddToStrategyTest) {
   manager()->Remove(kRendererID);
   manager()->Remove(kRendererID2);
 }
+
+TEST_F(WebCacheManagerTest, AddToStrategyWeightsFullCachesTest) {
+  manager()->Add(kRendererID);
+  manager()->Add(kRendererID2);
+
+  std::set<int> renderer_set;
+  renderer_set.insert(kRendererID);
+  renderer_set.insert(kRendererID2);
+
+  // The first renderer's cache is at capacity, the second one's is mostly
+  // empty.
+  WebCache::UsageStats full_stats = kStats;
+  full_stats.capacity = kStats.liveSize + kStats.deadSize;
+  WebCache::UsageStats empty_stats = kStats;
+  empty_stats.capacity = 100 * (kStats.liveSize + kStats.deadSize);
+  for (int i = 0; i < 10; ++i) {
+    manager()->ObserveStats(kRendererID, full_stats);
+    manager()->ObserveStats(kRendererID2, empty_stats);
+  }
+
+  const size_t kExtraBytesToAllocate = 10 * 1024;
+
+  AllocationStrategy strategy;
+  AddToStrategy(manager(),
+                renderer_set,
+                DIVIDE_EVENLY,
+                kExtraBytesToAllocate,
+                &strategy);
+
+  ASSERT_EQ(2U, strategy.size());
+
+  std::map<int, size_t> allocations(strategy.begin(), strategy.end());
+  EXPECT_GT(allocations[kRendererID], allocations[kRendererID2]);
+  EXPECT_GT(allocations[kRendererID2], 0U);
+  EXPECT_GE(kExtraBytesToAllocate,
+            allocations[kRendererID] + allocations[kRendererID2]);
+
+  manager()->Remove(kRendererID);
+  manager()->Remove(kRendererID2);
+}
+
+TEST_F(WebCacheManagerTest, MemoryPressureTest) {
+  const size_t kLimit = 4 * 1024 * 1024;
+  manager()->SetGlobalSizeLimit(kLimit);
+  EXPECT_EQ(kLimit, GetEffectiveSizeLimit(manager()));
+
+  SimulateMemoryPressure(
+      manager(), base::MemoryPressureListener::MEMORY_PRESSURE_MODERATE);
+  EXPECT_EQ(kLimit / 2, GetEffectiveSizeLimit(manager()));
+  EXPECT_EQ(kLimit, manager()->global_size_limit());
+
+  SimulateMemoryPressure(
+      manager(), base::MemoryPressureListener::MEMORY_PRESSURE_CRITICAL);
+  EXPECT_EQ(kLimit / 4, GetEffectiveSizeLimit(manager()));
+
+  // A moderate signal doesn't relax a critical one.
+  SimulateMemoryPressure(
+      manager(), base::MemoryPressureListener::MEMORY_PRESSURE_MODERATE);
+  EXPECT_EQ(kLimit / 4, GetEffectiveSizeLimit(manager()));
+
+  SimulateMemoryPressureRecovery(manager());
+  EXPECT_EQ(kLimit, GetEffectiveSizeLimit(manager()));
+}
+
+TEST_F(WebCacheManagerTest, CoalesceRevisionsTest) {
+  EXPECT_FALSE(revision_pending(manager()));
+
+  manager()->Add(kRendererID);
+  EXPECT_TRUE(revision_pending(manager()));
+
+  // Further changes are handled by the revision already scheduled.
+  manager()->Add(kRendererID2);
+  manager()->Remove(kRendererID);
+  EXPECT_TRUE(revision_pending(manager()));
+
+  manager()->Remove(kRendererID2);
+}
@@ -148,6 +148,40 @@ function updateInFlightOperations(inFlightOperations) {
   }
 }
 
+/**
+ * Updates the statistics of the job queues.
+ * @param {Array} jobQueues List of dictionaries describing the statistics of
+ * the jobs of each context type in each queue.
+ */
+function updateJobQueues(jobQueues) {
+  var container = $('job-queues-contents');
+
+  // Reset the table. Remove children in reverse order, as in
+  // updateInFlightOperations().
+  var existingNodes = container.childNodes;
+  for (var i = existingNodes.length - 1; i >= 0; i--) {
+    var node = existingNodes[i];
+    if (node.className == 'job-queue')
+      container.removeChild(node);
+  }
+
+  for (var i = 0; i < jobQueues.length; i++) {
+    var jobQueue = jobQueues[i];
+    var tr = document.createElement('tr');
+    tr.className = 'job-queue';
+    tr.appendChild(createElementFromText('td', jobQueue.queue));
+    tr.appendChild(createElementFromText('td', jobQueue.context));
+    tr.appendChild(createElementFromText('td', jobQueue.num_queued));
+    tr.appendChild(createElementFromText('td', jobQueue.num_running));
+    tr.appendChild(createElementFromText('td', jobQueue.num_started));
+    tr.appendChild(createElementFromText(
+        'td', Math.round(jobQueue.average_wait_time)));
+    tr.appendChild(createElementFromText(
+        'td', Math.round(jobQueue.max_wait_time)));
+    container.appendChild(tr);
+  }
+}
+
 /**
  * Updates the summary about about resource.
  * @param {Object} aboutResource Dictionary describing about resource.
@@ -33,6 +33,7 @@ var PrerenderView = (function() {
   // Used in tests.
   PrerenderView.HISTORY_TABLE_ID = 'prerender-view-history-table';
   PrerenderView.ACTIVE_TABLE_ID = 'prerender-view-active-table';
+  PrerenderView.ADMISSION_TABLE_ID = 'prerender-view-admission-table';
 
   cr.addSingletonGetter(PrerenderView);
 
@@ -1194,6 +1194,42 @@ var MainView = (function() {
     return keys;
   }
 
+  /**
+   * Parses the |text| of a saved file into the version 1 format. Version 1
+   * files are a single JSON dictionary. Version 2 files, written by the
+   * browser, have a header dictionary on the first line and one dictionary of
+   * process data per following line, all from a single snapshot.
+   */
+  function parseSnapshotsFile(text) {
+    var firstLineEnd = text.indexOf('\n');
+    if (firstLineEnd != -1) {
+      var header = null;
+      try {
+        header = JSON.parse(text.substring(0, firstLineEnd));
+      } catch (error) {
+        // Not a version 2 file; pretty printed version 1 files span lines.
+      }
+      if (header && header.version == 2) {
+        var data = [];
+        var lines = text.substring(firstLineEnd + 1).split('\n');
+        for (var i = 0; i < lines.length; ++i) {
+          if (lines[i].trim() != '')
+            data.push(JSON.parse(lines[i]));
+        }
+        return {
+          'userAgent': header.userAgent,
+          'version': 1,
+          'snapshots': [{ data: data, timestamp: header.timestamp }]
+        };
+      }
+    }
+
+    var parsed = JSON.parse(text);
+    if (parsed.version != 1)
+      throw new Error('Unrecognized version: ' + parsed.version);
+    return parsed;
+  }
+
   // --------------------------------------------------------------------------
 
   /**
@@ -1823,12 +1859,7 @@ var MainView = (function() {
 
     onLoadSnapshotsFile_: function(file, event) {
       try {
-        var parsed = null;
-        parsed = JSON.parse(event.target.result);
-
-        if (parsed.version != 1) {
-          throw new Error('Unrecognized version: ' + parsed.version);
-        }
+        var parsed = parseSnapshotsFile(event.target.result);
 
         if (parsed.snapshots.length < 1) {
           throw new Error('File contains no data');
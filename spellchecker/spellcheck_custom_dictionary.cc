@@ -5,6 +5,7 @@
 #include "chrome/browser/spellchecker/spellcheck_custom_dictionary.h"
 
 #include <functional>
+#include <iterator>
 
 #include "base/file_util.h"
 #include "base/files/important_file_writer.h"
@@ -29,9 +30,21 @@ namespace {
 // Filename extension for backup dictionary file.
 const base::FilePath::CharType BACKUP_EXTENSION[] = FILE_PATH_LITERAL("backup");
 
+// Filename extension for the journal of dictionary changes.
+const base::FilePath::CharType JOURNAL_EXTENSION[] =
+    FILE_PATH_LITERAL("journal");
+
 // Prefix for the checksum in the dictionary file.
 const char CHECKSUM_PREFIX[] = "checksum_v1 = ";
 
+// Prefixes for the records of added and removed words in the journal.
+const char JOURNAL_ADD_PREFIX = '+';
+const char JOURNAL_REMOVE_PREFIX = '-';
+
+// Changes that add more than 1/kLinearMergeRatio of the number of words in the
+// dictionary are merged into it in linear time.
+const size_t kLinearMergeRatio = 8;
+
 // The status of the checksum in a custom spellcheck dictionary.
 enum ChecksumStatus {
   VALID_CHECKSUM,
@@ -106,8 +119,9 @@ void LoadDictionaryFileReliably(WordList& custom_words,
 }
 
 // Backs up the original dictionary, saves |custom_words| and its checksum into
-// the custom spellcheck dictionary at |path|.
-void SaveDictionaryFileReliably(
+// the custom spellcheck dictionary at |path|. Returns false if the dictionary
+// could not be written.
+bool SaveDictionaryFileReliably(
     const WordList& custom_words,
     const base::FilePath& path) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
@@ -120,7 +134,90 @@ void SaveDictionaryFileReliably(
   std::string checksum = base::MD5String(content.str());
   content << CHECKSUM_PREFIX << checksum;
   base::CopyFile(path, path.AddExtension(BACKUP_EXTENSION));
-  base::ImportantFileWriter::WriteFileAtomically(path, content.str());
+  return base::ImportantFileWriter::WriteFileAtomically(path, content.str());
+}
+
+// Applies the records of the journal of the custom spellcheck dictionary at
+// |path| to |custom_words|, which ends up sorted and without duplicates if the
+// journal has any records. A record without a trailing newline was only
+// partially written, and is ignored. Must be called on the file thread.
+void LoadJournal(WordList& custom_words, const base::FilePath& path) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
+  std::string contents;
+  if (!base::ReadFileToString(path.AddExtension(JOURNAL_EXTENSION),
+                              &contents) ||
+      contents.empty()) {
+    return;
+  }
+  // Replaying the records in order leaves each word as its last record says,
+  // so the journal can be applied again to a dictionary that includes it.
+  WordSet words(custom_words.begin(), custom_words.end());
+  for (size_t start = 0, end = contents.find('\n');
+       end != std::string::npos;
+       start = end + 1, end = contents.find('\n', start)) {
+    if (end == start)
+      continue;
+    std::string word = contents.substr(start + 1, end - start - 1);
+    if (contents[start] == JOURNAL_ADD_PREFIX)
+      words.insert(word);
+    else if (contents[start] == JOURNAL_REMOVE_PREFIX)
+      words.erase(word);
+  }
+  custom_words.assign(words.begin(), words.end());
+}
+
+// Appends the records of the added and removed words to the journal of the
+// custom spellcheck dictionary at |path|. A partially written record at the end
+// of the journal is dropped first, so that the new records do not extend it.
+// Returns false if the journal would grow larger than |max_journal_bytes| or
+// could not be written.
+bool AppendToJournal(const WordList& to_add,
+                     const WordList& to_remove,
+                     const base::FilePath& path,
+                     int64 max_journal_bytes) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
+  std::string records;
+  for (WordList::const_iterator it = to_add.begin(); it != to_add.end(); ++it)
+    records.append(1, JOURNAL_ADD_PREFIX).append(*it).append(1, '\n');
+  for (WordList::const_iterator it = to_remove.begin();
+       it != to_remove.end();
+       ++it) {
+    records.append(1, JOURNAL_REMOVE_PREFIX).append(*it).append(1, '\n');
+  }
+
+  base::FilePath journal = path.AddExtension(JOURNAL_EXTENSION);
+  int64 journal_size = 0;
+  if (!base::GetFileSize(journal, &journal_size))
+    journal_size = 0;
+  if (journal_size + static_cast<int64>(records.size()) > max_journal_bytes)
+    return false;
+
+  int size = static_cast<int>(records.size());
+  if (journal_size == 0)
+    return base::WriteFile(journal, records.data(), size) == size;
+
+  std::string contents;
+  if (!base::ReadFileToString(journal, &contents))
+    return false;
+  if (!contents.empty() && contents[contents.size() - 1] != '\n') {
+    size_t last_newline = contents.rfind('\n');
+    contents.resize(last_newline == std::string::npos ? 0 : last_newline + 1);
+    contents.append(records);
+    size = static_cast<int>(contents.size());
+    return base::WriteFile(journal, contents.data(), size) == size;
+  }
+  return base::AppendToFile(journal, records.data(), size) == size;
+}
+
+// Saves |custom_words| into the custom spellcheck dictionary at |path| like
+// SaveDictionaryFileReliably(), and deletes its journal, whose records the
+// words include. The journal is kept if the dictionary could not be written,
+// so that its changes are not lost.
+void CompactDictionaryFileReliably(const WordList& custom_words,
+                                   const base::FilePath& path) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
+  if (SaveDictionaryFileReliably(custom_words, path))
+    base::DeleteFile(path.AddExtension(JOURNAL_EXTENSION), false);
 }
 
 // Removes duplicate and invalid words from |to_add| word list and sorts it.
@@ -169,6 +266,9 @@ int SanitizeWordsToRemove(const WordSet& existing, WordList& to_remove) {
 
 }  // namespace
 
+// static
+const int64 SpellcheckCustomDictionary::kMaxJournalBytes = 64 * 1024;
+
 
 SpellcheckCustomDictionary::Change::Change() {
 }
@@ -398,8 +498,9 @@ WordList SpellcheckCustomDictionary::LoadDictionaryFile(
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
   WordList words;
   LoadDictionaryFileReliably(words, path);
+  LoadJournal(words, path);
   if (!words.empty() && VALID_CHANGE != SanitizeWordsToAdd(WordSet(), words))
-    SaveDictionaryFileReliably(words, path);
+    CompactDictionaryFileReliably(words, path);
   SpellCheckHostMetrics::RecordCustomWordCountStats(words.size());
   return words;
 }
@@ -412,8 +513,18 @@ void SpellcheckCustomDictionary::UpdateDictionaryFile(
   if (dictionary_change.empty())
     return;
 
+  if (AppendToJournal(dictionary_change.to_add(),
+                      dictionary_change.to_remove(),
+                      path,
+                      kMaxJournalBytes)) {
+    return;
+  }
+
+  // The journal is too large, or could not be written: fold it and the change
+  // into the dictionary file instead.
   WordList custom_words;
   LoadDictionaryFileReliably(custom_words, path);
+  LoadJournal(custom_words, path);
 
   // Add words.
   custom_words.insert(custom_words.end(),
@@ -427,7 +538,17 @@ void SpellcheckCustomDictionary::UpdateDictionaryFile(
                                        dictionary_change.to_remove());
   std::swap(custom_words, remaining);
 
-  SaveDictionaryFileReliably(custom_words, path);
+  CompactDictionaryFileReliably(custom_words, path);
+}
+
+// static
+void SpellcheckCustomDictionary::CompactDictionaryFile(
+    const base::FilePath& path) {
+  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::FILE));
+  WordList custom_words;
+  LoadDictionaryFileReliably(custom_words, path);
+  LoadJournal(custom_words, path);
+  CompactDictionaryFileReliably(custom_words, path);
 }
 
 void SpellcheckCustomDictionary::OnLoaded(WordList custom_words) {
@@ -443,9 +564,17 @@ void SpellcheckCustomDictionary::OnLoaded(WordList custom_words) {
 void SpellcheckCustomDictionary::Apply(
     const SpellcheckCustomDictionary::Change& dictionary_change) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
-  if (!dictionary_change.to_add().empty()) {
-    words_.insert(dictionary_change.to_add().begin(),
-                  dictionary_change.to_add().end());
+  const WordList& to_add = dictionary_change.to_add();
+  if (to_add.size() > words_.size() / kLinearMergeRatio) {
+    // The words to add are sorted, so a large change, such as a sync merge,
+    // is merged in a single pass instead of looking up each word.
+    WordSet updated_words;
+    std::set_union(words_.begin(), words_.end(),
+                   to_add.begin(), to_add.end(),
+                   std::inserter(updated_words, updated_words.end()));
+    std::swap(words_, updated_words);
+  } else if (!to_add.empty()) {
+    words_.insert(to_add.begin(), to_add.end());
   }
   if (!dictionary_change.to_remove().empty()) {
     WordSet updated_words =
@@ -24,6 +24,15 @@
 //   foo
 //   checksum_v1 = ec3df4034567e59e119fcf87f2d9bad4
 //
+// Changes are appended to a journal file next to the dictionary file, with one
+// record per added or removed word, so that a change doesn't rewrite the whole
+// dictionary. Example journal file contents:
+//
+//   +baz
+//   -foo
+//
+// The journal is compacted into the dictionary file once it grows larger than
+// |kMaxJournalBytes|.
 class SpellcheckCustomDictionary : public SpellcheckDictionary,
                                    public syncer::SyncableService {
  public:
@@ -74,6 +83,10 @@ class SpellcheckCustomDictionary : public SpellcheckDictionary,
     virtual void OnCustomDictionaryChanged(const Change& dictionary_change) = 0;
   };
 
+  // The size of the journal file above which it is compacted into the
+  // dictionary file.
+  static const int64 kMaxJournalBytes;
+
   explicit SpellcheckCustomDictionary(const base::FilePath& path);
   virtual ~SpellcheckCustomDictionary();
 
@@ -125,18 +138,24 @@ class SpellcheckCustomDictionary : public SpellcheckDictionary,
   friend class DictionarySyncIntegrationTestHelper;
   friend class SpellcheckCustomDictionaryTest;
 
-  // Returns the list of words in the custom spellcheck dictionary at |path|.
-  // Makes sure that the custom dictionary file does not have duplicates and
-  // contains only valid words.
+  // Returns the list of words in the custom spellcheck dictionary at |path|,
+  // including the changes in its journal. Makes sure that the custom
+  // dictionary file does not have duplicates and contains only valid words.
   static chrome::spellcheck_common::WordList LoadDictionaryFile(
       const base::FilePath& path);
 
   // Applies the change in |dictionary_change| to the custom spellcheck
-  // dictionary. Assumes that |dictionary_change| has been sanitized.
+  // dictionary, by appending it to the journal or, if the journal would grow
+  // too large, by compacting the dictionary. Assumes that |dictionary_change|
+  // has been sanitized.
   static void UpdateDictionaryFile(
       const Change& dictionary_change,
       const base::FilePath& path);
 
+  // Rewrites the custom spellcheck dictionary at |path| with its checksum to
+  // include the changes in its journal, and deletes the journal.
+  static void CompactDictionaryFile(const base::FilePath& path);
+
   // The reply point for PostTaskAndReplyWithResult, called when
   // LoadDictionaryFile finishes reading the dictionary file. Does not modify
   // |custom_words|, but cannot be a const-ref due to the signature of
@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <vector>
 
 #include "base/file_util.h"
@@ -88,6 +89,13 @@ class SpellcheckCustomDictionaryTest : public testing::Test {
     SpellcheckCustomDictionary::UpdateDictionaryFile(dictionary_change, path);
   }
 
+  // A wrapper around SpellcheckCustomDictionary::CompactDictionaryFile private
+  // function to avoid a large number of FRIEND_TEST declarations in
+  // SpellcheckCustomDictionary.
+  void CompactDictionaryFile(const base::FilePath& path) {
+    SpellcheckCustomDictionary::CompactDictionaryFile(path);
+  }
+
   // A wrapper around SpellcheckCustomDictionary::OnLoaded private method to
   // avoid a large number of FRIEND_TEST declarations in
   // SpellcheckCustomDictionary.
@@ -265,9 +273,9 @@ TEST_F(SpellcheckCustomDictionaryTest,
   EXPECT_EQ(expected, loaded_custom_words);
 }
 
-// Write to dictionary should backup previous version and write the word to the
-// end of the dictionary. If the dictionary file is corrupted on disk, the
-// previous version should be reloaded.
+// Compacting the dictionary should backup previous version and write the
+// journaled word to the dictionary. If the dictionary file is corrupted on
+// disk, the previous version should be reloaded.
 TEST_F(SpellcheckCustomDictionaryTest, CorruptedWriteShouldBeRecovered) {
   base::FilePath path =
       profile_.GetPath().Append(chrome::kCustomDictionaryFileName);
@@ -283,6 +291,7 @@ TEST_F(SpellcheckCustomDictionaryTest, CorruptedWriteShouldBeRecovered) {
   SpellcheckCustomDictionary::Change change;
   change.AddWord("baz");
   UpdateDictionaryFile(change, path);
+  CompactDictionaryFile(path);
   content.clear();
   base::ReadFileToString(path, &content);
   content.append("corruption");
@@ -291,6 +300,102 @@ TEST_F(SpellcheckCustomDictionaryTest, CorruptedWriteShouldBeRecovered) {
   EXPECT_EQ(expected, loaded_custom_words);
 }
 
+// Changes should be appended to the journal without rewriting the dictionary
+// file, and a partially written record should be ignored.
+TEST_F(SpellcheckCustomDictionaryTest, ChangesShouldBeJournaled) {
+  base::FilePath path =
+      profile_.GetPath().Append(chrome::kCustomDictionaryFileName);
+  base::FilePath journal = path.AddExtension(FILE_PATH_LITERAL("journal"));
+
+  SpellcheckCustomDictionary::Change change;
+  change.AddWord("bar");
+  change.AddWord("foo");
+  UpdateDictionaryFile(change, path);
+  CompactDictionaryFile(path);
+  EXPECT_FALSE(base::PathExists(journal));
+  std::string compacted;
+  ASSERT_TRUE(base::ReadFileToString(path, &compacted));
+
+  change = SpellcheckCustomDictionary::Change();
+  change.AddWord("baz");
+  change.RemoveWord("foo");
+  UpdateDictionaryFile(change, path);
+  std::string content;
+  ASSERT_TRUE(base::ReadFileToString(path, &content));
+  EXPECT_EQ(compacted, content);
+  ASSERT_TRUE(base::ReadFileToString(journal, &content));
+  EXPECT_EQ("+baz\n-foo\n", content);
+
+  content.append("+qux");
+  base::WriteFile(journal, content.c_str(), content.length());
+  WordList loaded_custom_words = LoadDictionaryFile(path);
+  WordList expected;
+  expected.push_back("bar");
+  expected.push_back("baz");
+  EXPECT_EQ(expected, loaded_custom_words);
+
+  // Appending after the partial record should drop it rather than extend it.
+  change = SpellcheckCustomDictionary::Change();
+  change.AddWord("quux");
+  UpdateDictionaryFile(change, path);
+  ASSERT_TRUE(base::ReadFileToString(journal, &content));
+  EXPECT_EQ("+baz\n-foo\n+quux\n", content);
+  loaded_custom_words = LoadDictionaryFile(path);
+  expected.push_back("quux");
+  EXPECT_EQ(expected, loaded_custom_words);
+}
+
+// The journal should be compacted into the dictionary file once it grows too
+// large.
+TEST_F(SpellcheckCustomDictionaryTest, LargeJournalShouldBeCompacted) {
+  base::FilePath path =
+      profile_.GetPath().Append(chrome::kCustomDictionaryFileName);
+  base::FilePath journal = path.AddExtension(FILE_PATH_LITERAL("journal"));
+
+  SpellcheckCustomDictionary::Change change;
+  change.AddWord("foo");
+  UpdateDictionaryFile(change, path);
+  EXPECT_TRUE(base::PathExists(journal));
+
+  // Each record takes more than 3 bytes, so these overflow the journal.
+  change = SpellcheckCustomDictionary::Change();
+  WordList expected;
+  expected.push_back("foo");
+  for (int64 i = 0; i < SpellcheckCustomDictionary::kMaxJournalBytes / 3;
+       ++i) {
+    std::string word = "word" + base::Int64ToString(i);
+    change.AddWord(word);
+    expected.push_back(word);
+  }
+  UpdateDictionaryFile(change, path);
+  EXPECT_FALSE(base::PathExists(journal));
+
+  std::sort(expected.begin(), expected.end());
+  WordList loaded_custom_words = LoadDictionaryFile(path);
+  EXPECT_EQ(expected, loaded_custom_words);
+}
+
+// The journal should be kept if the compacted dictionary can't be written, or
+// its changes would be lost.
+TEST_F(SpellcheckCustomDictionaryTest, FailedCompactionShouldKeepJournal) {
+  base::FilePath path =
+      profile_.GetPath().Append(chrome::kCustomDictionaryFileName);
+  base::FilePath journal = path.AddExtension(FILE_PATH_LITERAL("journal"));
+
+  SpellcheckCustomDictionary::Change change;
+  change.AddWord("foo");
+  UpdateDictionaryFile(change, path);
+  ASSERT_TRUE(base::PathExists(journal));
+
+  // A directory in place of the dictionary file can't be replaced by it.
+  ASSERT_TRUE(base::CreateDirectory(path));
+  CompactDictionaryFile(path);
+  EXPECT_TRUE(base::DirectoryExists(path));
+  std::string content;
+  ASSERT_TRUE(base::ReadFileToString(journal, &content));
+  EXPECT_EQ("+foo\n", content);
+}
+
 TEST_F(SpellcheckCustomDictionaryTest,
        GetAllSyncDataAccuratelyReflectsDictionaryState) {
   SpellcheckCustomDictionary* dictionary =
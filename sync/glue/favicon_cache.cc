@@ -6,11 +6,15 @@
 
 #include "base/message_loop/message_loop.h"
 #include "base/metrics/histogram.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "chrome/browser/chrome_notification_types.h"
 #include "chrome/browser/favicon/favicon_service.h"
 #include "chrome/browser/favicon/favicon_service_factory.h"
 #include "chrome/browser/history/history_notifications.h"
 #include "chrome/browser/history/history_types.h"
+#include "chrome/browser/profiles/profile.h"
+#include "chrome/browser/sync/glue/synced_favicon_store.h"
+#include "content/public/browser/browser_thread.h"
 #include "content/public/browser/notification_details.h"
 #include "content/public/browser/notification_source.h"
 #include "sync/api/time.h"
@@ -30,6 +34,7 @@ namespace browser_sync {
 struct SyncedFaviconInfo {
   explicit SyncedFaviconInfo(const GURL& favicon_url)
       : favicon_url(favicon_url),
+        images_spilled(false),
         is_bookmarked(false),
         received_local_update(false) {}
 
@@ -37,6 +42,9 @@ struct SyncedFaviconInfo {
   // TODO(zea): don't keep around the actual data for locally sourced
   // favicons (UI can access those directly).
   chrome::FaviconBitmapResult bitmap_data[NUM_SIZES];
+  // Whether |bitmap_data| was moved to the on-disk favicon store. If set,
+  // |bitmap_data| is empty.
+  bool images_spilled;
   // The URL this favicon was loaded from.
   const GURL favicon_url;
   // Is the favicon for a bookmarked page?
@@ -69,8 +77,13 @@ struct LocalFaviconUpdateInfo {
 
 namespace {
 
-// Maximum number of favicons to keep in memory (0 means no limit).
-const size_t kMaxFaviconsInMem = 0;
+// Maximum number of favicons to keep the images of in memory. The images of
+// the others are kept on disk, and only their tracking data stays in memory.
+const size_t kMaxFaviconsInMem = 64;
+
+// Name of the directory in the profile holding the favicon images evicted
+// from memory.
+const char kSyncedFaviconStoreDirname[] = "Synced Favicons";
 
 // Maximum width/height resolution supported.
 const int kMaxFaviconResolution = 16;
@@ -150,6 +163,7 @@ void FillSpecificsWithImageData(
 void BuildImageSpecifics(
     const SyncedFaviconInfo* favicon_info,
     sync_pb::FaviconImageSpecifics* image_specifics) {
+  DCHECK(!favicon_info->images_spilled);
   image_specifics->set_favicon_url(favicon_info->favicon_url.spec());
   FillSpecificsWithImageData(favicon_info->bitmap_data[SIZE_16],
                              image_specifics->mutable_favicon_web());
@@ -187,7 +201,8 @@ bool UpdateFaviconFromBitmapResult(
              << bitmap_result.pixel_size.height() << "x"
              << bitmap_result.pixel_size.width();
     return false;
-  } else if (!favicon_info->bitmap_data[icon_size].bitmap_data.get() ||
+  } else if ((!favicon_info->bitmap_data[icon_size].bitmap_data.get() &&
+              !favicon_info->images_spilled) ||
              !favicon_info->received_local_update) {
     DVLOG(1) << "Storing " << IconSizeToString(icon_size) << "p"
              << " favicon for " << favicon_info->favicon_url.spec()
@@ -203,12 +218,17 @@ bool UpdateFaviconFromBitmapResult(
   }
 }
 
-bool FaviconInfoHasImages(const SyncedFaviconInfo& favicon_info) {
+bool FaviconInfoHasImagesInMemory(const SyncedFaviconInfo& favicon_info) {
   return favicon_info.bitmap_data[SIZE_16].bitmap_data.get() ||
          favicon_info.bitmap_data[SIZE_32].bitmap_data.get() ||
          favicon_info.bitmap_data[SIZE_64].bitmap_data.get();
 }
 
+bool FaviconInfoHasImages(const SyncedFaviconInfo& favicon_info) {
+  return favicon_info.images_spilled ||
+         FaviconInfoHasImagesInMemory(favicon_info);
+}
+
 bool FaviconInfoHasTracking(const SyncedFaviconInfo& favicon_info) {
   return !favicon_info.last_visit_time.is_null();
 }
@@ -227,12 +247,26 @@ bool FaviconInfoHasValidTypeData(const SyncedFaviconInfo& favicon_info,
 
 FaviconCache::FaviconCache(Profile* profile, int max_sync_favicon_limit)
     : profile_(profile),
+      max_favicons_in_memory_(kMaxFaviconsInMem),
+      next_image_read_id_(0),
       max_sync_favicon_limit_(max_sync_favicon_limit),
       weak_ptr_factory_(this) {
   notification_registrar_.Add(this,
                               chrome::NOTIFICATION_HISTORY_URLS_DELETED,
                               content::Source<Profile>(profile_));
   DVLOG(1) << "Setting favicon limit to " << max_sync_favicon_limit;
+
+  if (profile_) {
+    base::SequencedWorkerPool* pool = content::BrowserThread::GetBlockingPool();
+    favicon_store_.reset(new SyncedFaviconStore(
+        profile_->GetPath().AppendASCII(kSyncedFaviconStoreDirname),
+        pool->GetSequencedTaskRunnerWithShutdownBehavior(
+            pool->GetSequenceToken(),
+            base::SequencedWorkerPool::SKIP_ON_SHUTDOWN)));
+    // The cache is rebuilt from sync data, so images spilled in a previous
+    // session are of no use.
+    favicon_store_->Clear();
+  }
 }
 
 FaviconCache::~FaviconCache() {}
@@ -284,10 +318,16 @@ syncer::SyncMergeResult FaviconCache::MergeDataAndStartSyncing(
   for (std::set<GURL>::const_iterator iter = unsynced_favicon_urls.begin();
        iter != unsynced_favicon_urls.end(); ++iter) {
     if (available_favicons > 0) {
-      local_changes.push_back(
-          syncer::SyncChange(FROM_HERE,
-                             syncer::SyncChange::ACTION_ADD,
-                             CreateSyncDataFromLocalFavicon(type, *iter)));
+      if (type == syncer::FAVICON_IMAGES &&
+          synced_favicons_.find(*iter)->second->images_spilled) {
+        // The images are added once they are read back.
+        ReadSpilledImages(*iter, syncer::SyncChange::ACTION_ADD);
+      } else {
+        local_changes.push_back(
+            syncer::SyncChange(FROM_HERE,
+                               syncer::SyncChange::ACTION_ADD,
+                               CreateSyncDataFromLocalFavicon(type, *iter)));
+      }
       available_favicons--;
     } else {
       FaviconMap::iterator favicon_iter = synced_favicons_.find(*iter);
@@ -320,15 +360,33 @@ void FaviconCache::StopSyncing(syncer::ModelType type) {
 syncer::SyncDataList FaviconCache::GetAllSyncData(syncer::ModelType type)
     const {
   syncer::SyncDataList data_list;
+  std::set<GURL> spilled_favicon_urls;
   for (FaviconMap::const_iterator iter = synced_favicons_.begin();
        iter != synced_favicons_.end(); ++iter) {
-    if ((type == syncer::FAVICON_IMAGES &&
-         FaviconInfoHasImages(*iter->second)) ||
-        (type == syncer::FAVICON_TRACKING &&
-         FaviconInfoHasTracking(*iter->second))) {
+    if (type == syncer::FAVICON_IMAGES && iter->second->images_spilled) {
+      spilled_favicon_urls.insert(iter->first);
+    } else if ((type == syncer::FAVICON_IMAGES &&
+                FaviconInfoHasImages(*iter->second)) ||
+               (type == syncer::FAVICON_TRACKING &&
+                FaviconInfoHasTracking(*iter->second))) {
       data_list.push_back(CreateSyncDataFromLocalFavicon(type, iter->first));
     }
   }
+
+  // Once syncing, images are pushed to sync before they can be spilled, and
+  // those spilled before are pushed once read back, so sync has the same data
+  // as the on-disk copies.
+  if (!spilled_favicon_urls.empty() && favicon_images_sync_processor_.get()) {
+    syncer::SyncDataList synced_images =
+        favicon_images_sync_processor_->GetAllSyncData(syncer::FAVICON_IMAGES);
+    for (syncer::SyncDataList::const_iterator iter = synced_images.begin();
+         iter != synced_images.end(); ++iter) {
+      if (spilled_favicon_urls.count(
+              GetFaviconURLFromSpecifics(iter->GetSpecifics()))) {
+        data_list.push_back(*iter);
+      }
+    }
+  }
   return data_list;
 }
 
@@ -419,7 +477,8 @@ void FaviconCache::OnPageFaviconUpdated(const GURL& page_url) {
     // TODO(zea): consider what to do when only a subset of supported
     // resolutions are available.
     if (icon_iter != synced_favicons_.end() &&
-        icon_iter->second->bitmap_data[SIZE_16].bitmap_data.get()) {
+        (icon_iter->second->bitmap_data[SIZE_16].bitmap_data.get() ||
+         icon_iter->second->images_spilled)) {
       DVLOG(2) << "Using cached favicon url for " << page_url.spec()
                << ": " << icon_iter->second->favicon_url.spec();
       UpdateFaviconVisitTime(icon_iter->second->favicon_url, base::Time::Now());
@@ -511,6 +570,32 @@ bool FaviconCache::GetSyncedFaviconForPageURL(
   return GetSyncedFaviconForFaviconURL(iter->second, favicon_png);
 }
 
+void FaviconCache::LoadSyncedFaviconForPageURL(
+    const GURL& page_url,
+    const FaviconPngCallback& callback) {
+  PageFaviconMap::const_iterator page_iter = page_favicon_map_.find(page_url);
+  if (page_iter != page_favicon_map_.end()) {
+    FaviconMap::const_iterator favicon_iter =
+        synced_favicons_.find(page_iter->second);
+    if (favicon_iter != synced_favicons_.end() &&
+        favicon_iter->second->images_spilled) {
+      DCHECK(favicon_store_);
+      favicon_store_->Read(
+          page_iter->second,
+          base::Bind(&FaviconCache::OnSyncedFaviconRead,
+                     weak_ptr_factory_.GetWeakPtr(),
+                     page_iter->second,
+                     callback));
+      return;
+    }
+  }
+
+  scoped_refptr<base::RefCountedMemory> favicon_png;
+  GetSyncedFaviconForPageURL(page_url, &favicon_png);
+  base::MessageLoop::current()->PostTask(FROM_HERE,
+                                         base::Bind(callback, favicon_png));
+}
+
 void FaviconCache::OnReceivedSyncFavicon(const GURL& page_url,
                                          const GURL& icon_url,
                                          const std::string& icon_bytes,
@@ -546,11 +631,6 @@ void FaviconCache::OnReceivedSyncFaviconImpl(
   if (synced_favicons_.find(icon_url) != synced_favicons_.end())
     return;
 
-  // Don't add any more favicons once we hit our in memory limit.
-  // TODO(zea): UMA this.
-  if (kMaxFaviconsInMem != 0 && synced_favicons_.size() > kMaxFaviconsInMem)
-    return;
-
   SyncedFaviconInfo* favicon_info = GetFaviconInfo(icon_url);
   if (!favicon_info)
     return;  // We reached the in-memory limit.
@@ -569,6 +649,7 @@ void FaviconCache::OnReceivedSyncFaviconImpl(
                   (added_tracking ?
                    syncer::SyncChange::ACTION_ADD :
                    syncer::SyncChange::ACTION_UPDATE));
+  OnImagesChanged(icon_url);
 }
 
 void FaviconCache::Observe(int type,
@@ -648,8 +729,11 @@ void FaviconCache::OnFaviconDataAvailable(
         !FaviconInfoHasImages(*favicon_info);
     favicon_updates[favicon_url].new_tracking |=
         !FaviconInfoHasTracking(*favicon_info);
-    favicon_updates[favicon_url].image_needs_rewrite |=
-        UpdateFaviconFromBitmapResult(bitmap_result, favicon_info);
+    if (UpdateFaviconFromBitmapResult(bitmap_result, favicon_info)) {
+      // The new image replaces the spilled ones.
+      DiscardSpilledImages(favicon_info);
+      favicon_updates[favicon_url].image_needs_rewrite = true;
+    }
     favicon_updates[favicon_url].favicon_info = favicon_info;
   }
 
@@ -682,6 +766,14 @@ void FaviconCache::OnFaviconDataAvailable(
       tracking_change = syncer::SyncChange::ACTION_ADD;
     UpdateSyncState(favicon_url, image_change, tracking_change);
   }
+
+  // The images are only spilled once UpdateSyncState() pushed them, which may
+  // also have expired some of the updated favicons.
+  for (std::map<GURL, LocalFaviconUpdateInfo>::const_iterator
+           iter = favicon_updates.begin(); iter != favicon_updates.end();
+       ++iter) {
+    OnImagesChanged(iter->first);
+  }
 }
 
 void FaviconCache::UpdateSyncState(
@@ -748,7 +840,6 @@ SyncedFaviconInfo* FaviconCache::GetFaviconInfo(
   if (synced_favicons_.count(icon_url) != 0)
     return synced_favicons_[icon_url].get();
 
-  // TODO(zea): implement in-memory eviction.
   DVLOG(1) << "Adding favicon info for " << icon_url.spec();
   SyncedFaviconInfo* favicon_info = new SyncedFaviconInfo(icon_url);
   synced_favicons_[icon_url] = make_linked_ptr(favicon_info);
@@ -766,10 +857,14 @@ void FaviconCache::UpdateFaviconVisitTime(const GURL& icon_url,
     return;
   // Erase, update the time, then re-insert to maintain ordering.
   recent_favicons_.erase(iter->second);
+  bool is_resident = resident_favicons_.erase(iter->second) > 0;
   DVLOG(1) << "Updating " << icon_url.spec() << " visit time to "
            << syncer::GetTimeDebugString(time);
   iter->second->last_visit_time = time;
   recent_favicons_.insert(iter->second);
+  if (is_resident)
+    resident_favicons_.insert(iter->second);
+  ReadSpilledImagesIfRecent(synced_favicons_.find(icon_url));
 
   if (VLOG_IS_ON(2)) {
     for (RecencySet::const_iterator iter = recent_favicons_.begin();
@@ -785,9 +880,6 @@ void FaviconCache::ExpireFaviconsIfNecessary(
     syncer::SyncChangeList* image_changes,
     syncer::SyncChangeList* tracking_changes) {
   DCHECK_EQ(recent_favicons_.size(), synced_favicons_.size());
-  // TODO(zea): once we have in-memory eviction, we'll need to track sync
-  // favicon count separately from the synced_favicons_/recent_favicons_.
-
   // Iterate until we've removed the necessary amount. |recent_favicons_| is
   // already in recency order, so just start from the beginning.
   // TODO(zea): to reduce thrashing, consider removing more than the minimum.
@@ -822,6 +914,17 @@ void FaviconCache::MergeSyncFavicon(const syncer::SyncData& sync_favicon,
     sync_pb::FaviconImageSpecifics image_specifics =
         sync_favicon.GetSpecifics().favicon_image();
 
+    if (favicon_info->images_spilled) {
+      if (!image_specifics.has_favicon_web()) {
+        // Our image has to be pushed back, which can only be done once it is
+        // read back.
+        ReadSpilledImages(favicon_url, syncer::SyncChange::ACTION_UPDATE);
+        return;
+      }
+      // Only the 16p image is synced, which the remote data clobbers anyway.
+      DiscardSpilledImages(favicon_info);
+    }
+
     // Remote image data always clobbers local image data.
     bool needs_update = false;
     if (image_specifics.has_favicon_web()) {
@@ -845,6 +948,7 @@ void FaviconCache::MergeSyncFavicon(const syncer::SyncData& sync_favicon,
 
     if (needs_update)
       BuildImageSpecifics(favicon_info, new_specifics.mutable_favicon_image());
+    OnImagesChanged(favicon_url);
   } else {
     sync_pb::FaviconTrackingSpecifics tracking_specifics =
         sync_favicon.GetSpecifics().favicon_tracking();
@@ -910,6 +1014,7 @@ void FaviconCache::AddLocalFaviconFromSyncedData(
       favicon_info->bitmap_data[SIZE_64] = GetImageDataFromSpecifics(
           image_specifics.favicon_touch_64());
     }
+    OnImagesChanged(favicon_url);
   } else {
     sync_pb::FaviconTrackingSpecifics tracking_specifics =
         sync_favicon.GetSpecifics().favicon_tracking();
@@ -1012,7 +1117,9 @@ void FaviconCache::DeleteSyncedFavicon(
 
 void FaviconCache::DropSyncedFavicon(FaviconMap::iterator favicon_iter) {
   DVLOG(1) << "Dropping favicon " << favicon_iter->second.get()->favicon_url;
+  DiscardSpilledImages(favicon_iter->second.get());
   recent_favicons_.erase(favicon_iter->second);
+  resident_favicons_.erase(favicon_iter->second);
   synced_favicons_.erase(favicon_iter);
 }
 
@@ -1043,19 +1150,193 @@ void FaviconCache::DropPartialFavicon(FaviconMap::iterator favicon_iter,
       favicon_iter->second->bitmap_data[i] =
           chrome::FaviconBitmapResult();
     }
+    resident_favicons_.erase(favicon_iter->second);
+    DiscardSpilledImages(favicon_iter->second.get());
     DCHECK(!FaviconInfoHasImages(*favicon_iter->second));
   } else {
     DCHECK_EQ(type, syncer::FAVICON_TRACKING);
     DVLOG(1) << "Dropping favicon tracking "
              << favicon_iter->second.get()->favicon_url;
     recent_favicons_.erase(favicon_iter->second);
+    bool is_resident = resident_favicons_.erase(favicon_iter->second) > 0;
     favicon_iter->second->last_visit_time = base::Time();
     favicon_iter->second->is_bookmarked = false;
     recent_favicons_.insert(favicon_iter->second);
+    if (is_resident)
+      resident_favicons_.insert(favicon_iter->second);
     DCHECK(!FaviconInfoHasTracking(*favicon_iter->second));
   }
 }
 
+void FaviconCache::OnImagesChanged(const GURL& icon_url) {
+  FaviconMap::iterator favicon_iter = synced_favicons_.find(icon_url);
+  if (favicon_iter == synced_favicons_.end())
+    return;
+  if (FaviconInfoHasImagesInMemory(*favicon_iter->second))
+    resident_favicons_.insert(favicon_iter->second);
+  else
+    resident_favicons_.erase(favicon_iter->second);
+  SpillImagesIfNecessary();
+}
+
+void FaviconCache::SpillImagesIfNecessary() {
+  if (!favicon_store_)
+    return;
+
+  DCHECK_LE(resident_favicons_.size(), synced_favicons_.size());
+  while (resident_favicons_.size() > max_favicons_in_memory_) {
+    linked_ptr<SyncedFaviconInfo> favicon_info = *resident_favicons_.begin();
+    resident_favicons_.erase(resident_favicons_.begin());
+    SpillImages(favicon_info.get());
+  }
+}
+
+void FaviconCache::SpillImages(SyncedFaviconInfo* favicon_info) {
+  DCHECK(favicon_store_);
+  DCHECK(!favicon_info->images_spilled);
+  DVLOG(1) << "Spilling images of " << favicon_info->favicon_url.spec();
+
+  // Unlike BuildImageSpecifics(), keep all the resolutions.
+  sync_pb::FaviconImageSpecifics image_specifics;
+  image_specifics.set_favicon_url(favicon_info->favicon_url.spec());
+  FillSpecificsWithImageData(favicon_info->bitmap_data[SIZE_16],
+                             image_specifics.mutable_favicon_web());
+  FillSpecificsWithImageData(favicon_info->bitmap_data[SIZE_32],
+                             image_specifics.mutable_favicon_web_32());
+  FillSpecificsWithImageData(favicon_info->bitmap_data[SIZE_64],
+                             image_specifics.mutable_favicon_touch_64());
+  favicon_store_->Write(favicon_info->favicon_url,
+                        image_specifics.SerializeAsString());
+
+  for (int i = 0; i < NUM_SIZES; ++i)
+    favicon_info->bitmap_data[i] = chrome::FaviconBitmapResult();
+  favicon_info->images_spilled = true;
+}
+
+void FaviconCache::ReadSpilledImages(
+    const GURL& icon_url,
+    syncer::SyncChange::SyncChangeType image_change_type) {
+  DCHECK(favicon_store_);
+  PendingImageReadMap::iterator iter = pending_image_reads_.find(icon_url);
+  if (iter != pending_image_reads_.end()) {
+    // An ADD which hasn't been pushed yet stays an ADD.
+    if (iter->second.image_change_type == syncer::SyncChange::ACTION_INVALID)
+      iter->second.image_change_type = image_change_type;
+    return;
+  }
+  PendingImageRead& read = pending_image_reads_[icon_url];
+  read.read_id = next_image_read_id_++;
+  read.image_change_type = image_change_type;
+  favicon_store_->Read(icon_url,
+                       base::Bind(&FaviconCache::OnSpilledImagesRead,
+                                  weak_ptr_factory_.GetWeakPtr(),
+                                  icon_url,
+                                  read.read_id));
+}
+
+void FaviconCache::ReadSpilledImagesIfRecent(
+    FaviconMap::iterator favicon_iter) {
+  if (!favicon_iter->second->images_spilled)
+    return;
+  if (resident_favicons_.size() >= max_favicons_in_memory_ &&
+      (resident_favicons_.empty() ||
+       !FaviconRecencyFunctor()(*resident_favicons_.begin(),
+                                favicon_iter->second))) {
+    return;
+  }
+  ReadSpilledImages(favicon_iter->first, syncer::SyncChange::ACTION_INVALID);
+}
+
+void FaviconCache::OnSpilledImagesRead(const GURL& icon_url,
+                                       int read_id,
+                                       const std::string& data) {
+  PendingImageReadMap::iterator read_iter = pending_image_reads_.find(icon_url);
+  if (read_iter == pending_image_reads_.end() ||
+      read_iter->second.read_id != read_id) {
+    return;  // Dropped or replaced while being read.
+  }
+  syncer::SyncChange::SyncChangeType image_change_type =
+      read_iter->second.image_change_type;
+  pending_image_reads_.erase(read_iter);
+
+  FaviconMap::iterator favicon_iter = synced_favicons_.find(icon_url);
+  DCHECK(favicon_iter != synced_favicons_.end());
+  SyncedFaviconInfo* favicon_info = favicon_iter->second.get();
+  DCHECK(favicon_info->images_spilled);
+
+  sync_pb::FaviconImageSpecifics image_specifics;
+  if (!image_specifics.ParseFromString(data) ||
+      image_specifics.favicon_url() != icon_url.spec()) {
+    // The images are lost locally, but sync still has them.
+    DVLOG(1) << "Failed to read images of " << icon_url.spec();
+    DropPartialFavicon(favicon_iter, syncer::FAVICON_IMAGES);
+    return;
+  }
+
+  favicon_info->images_spilled = false;
+  favicon_store_->Delete(icon_url);
+  if (image_specifics.has_favicon_web()) {
+    favicon_info->bitmap_data[SIZE_16] = GetImageDataFromSpecifics(
+        image_specifics.favicon_web());
+  }
+  if (image_specifics.has_favicon_web_32()) {
+    favicon_info->bitmap_data[SIZE_32] = GetImageDataFromSpecifics(
+        image_specifics.favicon_web_32());
+  }
+  if (image_specifics.has_favicon_touch_64()) {
+    favicon_info->bitmap_data[SIZE_64] = GetImageDataFromSpecifics(
+        image_specifics.favicon_touch_64());
+  }
+
+  if (image_change_type != syncer::SyncChange::ACTION_INVALID &&
+      favicon_images_sync_processor_.get()) {
+    syncer::SyncChangeList image_changes;
+    image_changes.push_back(
+        syncer::SyncChange(FROM_HERE,
+                           image_change_type,
+                           CreateSyncDataFromLocalFavicon(
+                               syncer::FAVICON_IMAGES, icon_url)));
+    favicon_images_sync_processor_->ProcessSyncChanges(FROM_HERE,
+                                                       image_changes);
+  }
+
+  // The favicon may have become cold again while being read, in which case
+  // its images are spilled right back.
+  OnImagesChanged(icon_url);
+}
+
+void FaviconCache::OnSyncedFaviconRead(const GURL& icon_url,
+                                       const FaviconPngCallback& callback,
+                                       const std::string& data) {
+  scoped_refptr<base::RefCountedMemory> favicon_png;
+  FaviconMap::const_iterator favicon_iter = synced_favicons_.find(icon_url);
+  if (favicon_iter == synced_favicons_.end()) {
+    // Dropped while being read.
+  } else if (!favicon_iter->second->images_spilled) {
+    // Read back or replaced while being read.
+    favicon_png = favicon_iter->second->bitmap_data[SIZE_16].bitmap_data;
+  } else {
+    sync_pb::FaviconImageSpecifics image_specifics;
+    if (image_specifics.ParseFromString(data) &&
+        image_specifics.favicon_url() == icon_url.spec() &&
+        image_specifics.has_favicon_web()) {
+      favicon_png = GetImageDataFromSpecifics(
+          image_specifics.favicon_web()).bitmap_data;
+    }
+  }
+  // The favicon isn't visited by being looked up, so it stays on disk.
+  callback.Run(favicon_png);
+}
+
+void FaviconCache::DiscardSpilledImages(SyncedFaviconInfo* favicon_info) {
+  if (!favicon_info->images_spilled)
+    return;
+  DCHECK(favicon_store_);
+  favicon_info->images_spilled = false;
+  favicon_store_->Delete(favicon_info->favicon_url);
+  pending_image_reads_.erase(favicon_info->favicon_url);
+}
+
 size_t FaviconCache::NumFaviconsForTest() const {
   return synced_favicons_.size();
 }
@@ -1064,4 +1345,18 @@ size_t FaviconCache::NumTasksForTest() const {
   return page_task_map_.size();
 }
 
+void FaviconCache::SetUpFaviconStoreForTest(
+    const base::FilePath& directory,
+    const scoped_refptr<base::SequencedTaskRunner>& task_runner,
+    size_t max_favicons_in_memory) {
+  favicon_store_.reset(new SyncedFaviconStore(directory, task_runner));
+  max_favicons_in_memory_ = max_favicons_in_memory;
+  SpillImagesIfNecessary();
+}
+
+bool FaviconCache::IsImageSpilledForTest(const GURL& icon_url) const {
+  FaviconMap::const_iterator iter = synced_favicons_.find(icon_url);
+  return iter != synced_favicons_.end() && iter->second->images_spilled;
+}
+
 }  // namespace browser_sync
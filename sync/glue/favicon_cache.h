@@ -9,6 +9,7 @@
 #include <string>
 
 #include "base/basictypes.h"
+#include "base/callback.h"
 #include "base/compiler_specific.h"
 #include "base/memory/linked_ptr.h"
 #include "base/memory/ref_counted.h"
@@ -27,6 +28,11 @@
 
 class Profile;
 
+namespace base {
+class FilePath;
+class SequencedTaskRunner;
+}
+
 namespace chrome {
 struct FaviconBitmapResult;
 }
@@ -42,12 +48,19 @@ enum IconSize {
 };
 
 struct SyncedFaviconInfo;
+class SyncedFaviconStore;
 
 // Encapsulates the logic for loading and storing synced favicons.
 // TODO(zea): make this a KeyedService.
 class FaviconCache : public syncer::SyncableService,
                      public content::NotificationObserver {
  public:
+  // Called with the png-encoded image of a synced favicon, or NULL if no valid
+  // favicon was found.
+  typedef base::Callback<void(
+      const scoped_refptr<base::RefCountedMemory>& favicon_png)>
+      FaviconPngCallback;
+
   FaviconCache(Profile* profile, int max_sync_favicon_limit);
   virtual ~FaviconCache();
 
@@ -64,20 +77,26 @@ class FaviconCache : public syncer::SyncableService,
       const tracked_objects::Location& from_here,
       const syncer::SyncChangeList& change_list) OVERRIDE;
 
-  // If a valid favicon for the icon at |favicon_url| is found, fills
-  // |favicon_png| with the png-encoded image and returns true. Else, returns
-  // false.
+  // If a valid favicon for the icon at |favicon_url| is found in memory,
+  // fills |favicon_png| with the png-encoded image and returns true. Else,
+  // returns false. Only the images of recently visited favicons are kept in
+  // memory, see LoadSyncedFaviconForPageURL() for the others.
   bool GetSyncedFaviconForFaviconURL(
       const GURL& favicon_url,
       scoped_refptr<base::RefCountedMemory>* favicon_png) const;
 
-  // If a valid favicon for the icon associated with |page_url| is found, fills
-  // |favicon_png| with the png-encoded image and returns true. Else, returns
-  // false.
+  // If a valid favicon for the icon associated with |page_url| is found in
+  // memory, fills |favicon_png| with the png-encoded image and returns true.
+  // Else, returns false.
   bool GetSyncedFaviconForPageURL(
       const GURL& page_url,
       scoped_refptr<base::RefCountedMemory>* favicon_png) const;
 
+  // Like GetSyncedFaviconForPageURL(), but also finds the favicons whose
+  // images were moved to disk. |callback| is always run asynchronously.
+  void LoadSyncedFaviconForPageURL(const GURL& page_url,
+                                   const FaviconPngCallback& callback);
+
   // Load the favicon for |page_url|. Will create a new sync node or update
   // an existing one as necessary, and set the last visit time to the current
   // time. Only those favicon types defined in SupportedFaviconTypes will be
@@ -120,6 +139,15 @@ class FaviconCache : public syncer::SyncableService,
   typedef std::map<GURL, base::CancelableTaskTracker::TaskId> PageTaskMap;
   // Map of page url to favicon url.
   typedef std::map<GURL, GURL> PageFaviconMap;
+  // A read back of spilled images from |favicon_store_|.
+  struct PendingImageRead {
+    // Tells this read from those of images which were replaced since.
+    int read_id;
+    // The image change to push to sync once the images are read back.
+    syncer::SyncChange::SyncChangeType image_change_type;
+  };
+  // Map of favicon url to the read back of its images.
+  typedef std::map<GURL, PendingImageRead> PendingImageReadMap;
 
   // Helper method to perform OnReceivedSyncFavicon work without worrying about
   // whether caller holds a sync transaction.
@@ -193,9 +221,51 @@ class FaviconCache : public syncer::SyncableService,
   void DropPartialFavicon(FaviconMap::iterator favicon_iter,
                           syncer::ModelType type);
 
+  // Updates the position of the favicon at |icon_url| in |resident_favicons_|
+  // after its images changed, then spills the images of the least recently
+  // visited favicons over the in-memory limit.
+  void OnImagesChanged(const GURL& icon_url);
+
+  // Moves the images of the least recently visited favicons in
+  // |resident_favicons_| to |favicon_store_| until at most
+  // |max_favicons_in_memory_| favicons have their images in memory.
+  void SpillImagesIfNecessary();
+
+  // Moves all the images of |favicon_info| to |favicon_store_|.
+  void SpillImages(SyncedFaviconInfo* favicon_info);
+
+  // Reads back the spilled images of the favicon at |icon_url|. Once read,
+  // pushes |image_change_type| for the images to sync unless it's
+  // ACTION_INVALID.
+  void ReadSpilledImages(const GURL& icon_url,
+                         syncer::SyncChange::SyncChangeType image_change_type);
+
+  // Reads back the spilled images of the favicon at |favicon_iter| if it was
+  // visited more recently than one of the favicons having its images in
+  // memory.
+  void ReadSpilledImagesIfRecent(FaviconMap::iterator favicon_iter);
+
+  // Callback for ReadSpilledImages().
+  void OnSpilledImagesRead(const GURL& icon_url,
+                           int read_id,
+                           const std::string& data);
+
+  // Callback for the reads of LoadSyncedFaviconForPageURL().
+  void OnSyncedFaviconRead(const GURL& icon_url,
+                           const FaviconPngCallback& callback,
+                           const std::string& data);
+
+  // Forgets the spilled images of |favicon_info|, if any.
+  void DiscardSpilledImages(SyncedFaviconInfo* favicon_info);
+
   // For testing only.
   size_t NumFaviconsForTest() const;
   size_t NumTasksForTest() const;
+  void SetUpFaviconStoreForTest(
+      const base::FilePath& directory,
+      const scoped_refptr<base::SequencedTaskRunner>& task_runner,
+      size_t max_favicons_in_memory);
+  bool IsImageSpilledForTest(const GURL& icon_url) const;
 
   // Trask tracker for loading favicons.
   base::CancelableTaskTracker cancelable_task_tracker_;
@@ -207,6 +277,9 @@ class FaviconCache : public syncer::SyncableService,
   // newest).
   RecencySet recent_favicons_;
 
+  // The same ordering, of only the favicons having their images in memory.
+  RecencySet resident_favicons_;
+
   // Our set of pending favicon loads, indexed by page url.
   PageTaskMap page_task_map_;
 
@@ -215,6 +288,17 @@ class FaviconCache : public syncer::SyncableService,
 
   Profile* profile_;
 
+  // Holds the images of favicons evicted from memory. NULL if there is no
+  // profile to store them in, in which case all images stay in memory.
+  scoped_ptr<SyncedFaviconStore> favicon_store_;
+
+  // Maximum number of favicons to keep the images of in memory.
+  size_t max_favicons_in_memory_;
+
+  // Spilled images being read back.
+  PendingImageReadMap pending_image_reads_;
+  int next_image_read_id_;
+
   // TODO(zea): consider creating a favicon handler here for fetching unsynced
   // favicons from the web.
 
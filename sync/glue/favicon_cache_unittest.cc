@@ -4,6 +4,8 @@
 
 #include "chrome/browser/sync/glue/favicon_cache.h"
 
+#include "base/bind.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/message_loop/message_loop.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/stringprintf.h"
@@ -255,6 +257,12 @@ int GetFaviconId(const syncer::SyncChange change) {
   return result;
 }
 
+// Saves the favicon a FaviconCache::FaviconPngCallback is run with.
+void SaveFavicon(scoped_refptr<base::RefCountedMemory>* result,
+                 const scoped_refptr<base::RefCountedMemory>& favicon_png) {
+  *result = favicon_png;
+}
+
 }  // namespace
 
 class SyncFaviconCacheTest : public testing::Test {
@@ -282,6 +290,16 @@ class SyncFaviconCacheTest : public testing::Test {
   FaviconCache* cache() { return &cache_; }
   TestChangeProcessor* processor() { return sync_processor_.get(); }
 
+  // Keeps only the images of |max_favicons_in_memory| favicons in memory and
+  // spills the others to a temporary directory.
+  void SetUpFaviconStore(size_t max_favicons_in_memory);
+  bool IsImageSpilled(const GURL& icon_url) const;
+  void RunUntilIdle() { message_loop_.RunUntilIdle(); }
+
+  // Returns the favicon LoadSyncedFaviconForPageURL() finds for |page_url|, or
+  // an empty string if none.
+  std::string LoadFavicon(const GURL& page_url);
+
   // Finish an outstanding favicon load for the icon described in |test_data|.
   void OnCustomFaviconDataAvailable(const TestFaviconData& test_data);
 
@@ -294,6 +312,7 @@ class SyncFaviconCacheTest : public testing::Test {
 
  private:
   base::MessageLoopForUI message_loop_;
+  base::ScopedTempDir temp_dir_;
   FaviconCache cache_;
 
   // Our dummy ChangeProcessor used to inspect changes pushed to Sync.
@@ -322,6 +341,28 @@ void SyncFaviconCacheTest::SetUpInitialSync(
   ASSERT_EQ(0U, processor()->GetAndResetChangeList().size());
 }
 
+void SyncFaviconCacheTest::SetUpFaviconStore(size_t max_favicons_in_memory) {
+  ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+  cache_.SetUpFaviconStoreForTest(temp_dir_.path(),
+                                  message_loop_.message_loop_proxy(),
+                                  max_favicons_in_memory);
+}
+
+bool SyncFaviconCacheTest::IsImageSpilled(const GURL& icon_url) const {
+  return cache_.IsImageSpilledForTest(icon_url);
+}
+
+std::string SyncFaviconCacheTest::LoadFavicon(const GURL& page_url) {
+  scoped_refptr<base::RefCountedMemory> favicon;
+  cache_.LoadSyncedFaviconForPageURL(page_url,
+                                     base::Bind(&SaveFavicon, &favicon));
+  message_loop_.RunUntilIdle();
+  if (!favicon.get())
+    return std::string();
+  return std::string(reinterpret_cast<const char*>(favicon->front()),
+                     favicon->size());
+}
+
 size_t SyncFaviconCacheTest::GetFaviconCount() const {
   return cache_.NumFaviconsForTest();
 }
@@ -1938,4 +1979,122 @@ TEST_F(SyncFaviconCacheTest, MixedThreshold) {
   EXPECT_EQ(0, GetFaviconId(changes[5]));
 }
 
+// The images of the favicons beyond the in-memory limit should be spilled,
+// least recently visited first, and only be found by asynchronous lookups.
+TEST_F(SyncFaviconCacheTest, SpillImages) {
+  SetUpInitialSync(syncer::SyncDataList(), syncer::SyncDataList());
+  SetUpFaviconStore(2);
+  for (int i = 0; i < kFaviconBatchSize; ++i) {
+    TestFaviconData test_data = BuildFaviconData(i);
+    cache()->OnFaviconVisited(test_data.page_url, test_data.icon_url);
+    OnCustomFaviconDataAvailable(test_data);
+  }
+  EXPECT_EQ(static_cast<size_t>(kFaviconBatchSize), GetFaviconCount());
+  for (int i = 0; i < kFaviconBatchSize; ++i) {
+    TestFaviconData test_data = BuildFaviconData(i);
+    if (i < kFaviconBatchSize - 2) {
+      EXPECT_TRUE(IsImageSpilled(test_data.icon_url));
+      EXPECT_FALSE(ExpectFaviconEquals(test_data.page_url.spec(),
+                                       test_data.image_16));
+    } else {
+      EXPECT_FALSE(IsImageSpilled(test_data.icon_url));
+      EXPECT_TRUE(ExpectFaviconEquals(test_data.page_url.spec(),
+                                      test_data.image_16));
+    }
+    EXPECT_EQ(test_data.image_16, LoadFavicon(test_data.page_url));
+  }
+
+  // Lookups don't count as visits.
+  EXPECT_TRUE(IsImageSpilled(BuildFaviconData(0).icon_url));
+
+  // Visiting a spilled favicon reads its images back, and spills those of the
+  // least recently visited favicon in memory.
+  TestFaviconData test_data = BuildFaviconData(0);
+  cache()->OnFaviconVisited(test_data.page_url, test_data.icon_url);
+  processor()->GetAndResetChangeList();
+  RunUntilIdle();
+  EXPECT_FALSE(IsImageSpilled(test_data.icon_url));
+  EXPECT_TRUE(ExpectFaviconEquals(test_data.page_url.spec(),
+                                  test_data.image_16));
+  EXPECT_TRUE(IsImageSpilled(BuildFaviconData(kFaviconBatchSize - 2).icon_url));
+  EXPECT_FALSE(
+      IsImageSpilled(BuildFaviconData(kFaviconBatchSize - 1).icon_url));
+  // Sync already has the images which were read back.
+  EXPECT_EQ(0U, processor()->GetAndResetChangeList().size());
+}
+
+// A remote image update for a spilled favicon should replace the spilled
+// image.
+TEST_F(SyncFaviconCacheTest, ReceiveImagesOfSpilledFavicon) {
+  SetUpInitialSync(syncer::SyncDataList(), syncer::SyncDataList());
+  SetUpFaviconStore(1);
+  for (int i = 0; i < 2; ++i) {
+    TestFaviconData test_data = BuildFaviconData(i);
+    cache()->OnFaviconVisited(test_data.page_url, test_data.icon_url);
+    OnCustomFaviconDataAvailable(test_data);
+  }
+  processor()->GetAndResetChangeList();
+  TestFaviconData test_data = BuildFaviconData(0);
+  EXPECT_TRUE(IsImageSpilled(test_data.icon_url));
+
+  test_data.image_16 = "new 16 0";
+  sync_pb::EntitySpecifics image_specifics;
+  FillImageSpecifics(test_data, image_specifics.mutable_favicon_image());
+  syncer::SyncChangeList changes;
+  changes.push_back(syncer::SyncChange(
+      FROM_HERE,
+      syncer::SyncChange::ACTION_UPDATE,
+      syncer::SyncData::CreateRemoteData(
+          1,
+          image_specifics,
+          base::Time(),
+          syncer::AttachmentIdList(),
+          syncer::AttachmentServiceProxyForTest::Create())));
+  cache()->ProcessSyncChanges(FROM_HERE, changes);
+  EXPECT_EQ(0U, processor()->GetAndResetChangeList().size());
+
+  // The favicon is still the least recently visited one.
+  EXPECT_TRUE(IsImageSpilled(test_data.icon_url));
+  EXPECT_EQ(test_data.image_16, LoadFavicon(test_data.page_url));
+}
+
+// Favicons spilled before sync started should be added to sync once their
+// images are read back.
+TEST_F(SyncFaviconCacheTest, SyncSpilledImages) {
+  SetUpFaviconStore(1);
+  for (int i = 0; i < 3; ++i) {
+    TestFaviconData test_data = BuildFaviconData(i);
+    cache()->OnFaviconVisited(test_data.page_url, test_data.icon_url);
+    OnCustomFaviconDataAvailable(test_data);
+  }
+  EXPECT_TRUE(IsImageSpilled(BuildFaviconData(0).icon_url));
+  EXPECT_TRUE(IsImageSpilled(BuildFaviconData(1).icon_url));
+  EXPECT_FALSE(IsImageSpilled(BuildFaviconData(2).icon_url));
+
+  cache()->MergeDataAndStartSyncing(syncer::FAVICON_IMAGES,
+                                    syncer::SyncDataList(),
+                                    CreateAndPassProcessor(),
+                                    CreateAndPassSyncErrorFactory());
+  syncer::SyncChangeList changes = processor()->GetAndResetChangeList();
+  ASSERT_EQ(1U, changes.size());
+  EXPECT_EQ(2, GetFaviconId(changes[0]));
+
+  RunUntilIdle();
+  changes = processor()->GetAndResetChangeList();
+  ASSERT_EQ(2U, changes.size());
+  for (size_t i = 0; i < changes.size(); ++i) {
+    EXPECT_EQ(syncer::SyncChange::ACTION_ADD, changes[i].change_type());
+    int id = GetFaviconId(changes[i]);
+    EXPECT_EQ(static_cast<int>(i), id);
+    EXPECT_EQ(BuildFaviconData(id).image_16,
+              changes[i].sync_data().GetSpecifics().favicon_image().
+                  favicon_web().favicon());
+  }
+
+  // The favicons are still cold, so their images are spilled again.
+  EXPECT_TRUE(IsImageSpilled(BuildFaviconData(0).icon_url));
+  EXPECT_TRUE(IsImageSpilled(BuildFaviconData(1).icon_url));
+  EXPECT_FALSE(IsImageSpilled(BuildFaviconData(2).icon_url));
+}
+
 }  // namespace browser_sync
@@ -363,6 +363,7 @@ syncer::SyncError GenericChangeProcessor::ProcessSyncChanges(
     const syncer::SyncChangeList& list_of_changes) {
   DCHECK(CalledOnValidThread());
   syncer::WriteTransaction trans(from_here, share_handle());
+  RootNodeMap root_nodes;
 
   for (syncer::SyncChangeList::const_iterator iter = list_of_changes.begin();
        iter != list_of_changes.end();
@@ -386,7 +387,8 @@ syncer::SyncError GenericChangeProcessor::ProcessSyncChanges(
       }
     } else if (change.change_type() == syncer::SyncChange::ACTION_ADD) {
       syncer::SyncError error =
-          HandleActionAdd(change, type_str, type, trans, &sync_node);
+          HandleActionAdd(change, type_str, type, trans, &root_nodes,
+                          &sync_node);
       if (error.IsSet()) {
         return error;
       }
@@ -422,26 +424,34 @@ syncer::SyncError GenericChangeProcessor::HandleActionAdd(
     const std::string& type_str,
     const syncer::ModelType& type,
     const syncer::WriteTransaction& trans,
+    RootNodeMap* root_nodes,
     syncer::WriteNode* sync_node) {
   // TODO(sync): Handle other types of creation (custom parents, folders,
   // etc.).
-  syncer::ReadNode root_node(&trans);
-  if (root_node.InitByTagLookup(syncer::ModelTypeToRootTag(
-          change.sync_data().GetDataType())) != syncer::BaseNode::INIT_OK) {
-    syncer::SyncError error(FROM_HERE,
-                            syncer::SyncError::DATATYPE_ERROR,
-                            "Failed to look up root node for type " + type_str,
-                            type);
-    error_handler()->OnSingleDatatypeUnrecoverableError(FROM_HERE,
-                                                        error.message());
-    NOTREACHED();
-    LOG(ERROR) << "Create: no root node.";
-    return error;
+  // Looking up a root node by its tag is not indexed, so only do it once per
+  // type and transaction.
+  linked_ptr<syncer::ReadNode>& root_node = (*root_nodes)[type];
+  if (!root_node.get()) {
+    root_node.reset(new syncer::ReadNode(&trans));
+    if (root_node->InitByTagLookup(syncer::ModelTypeToRootTag(type)) !=
+            syncer::BaseNode::INIT_OK) {
+      root_node.reset();
+      syncer::SyncError error(
+          FROM_HERE,
+          syncer::SyncError::DATATYPE_ERROR,
+          "Failed to look up root node for type " + type_str,
+          type);
+      error_handler()->OnSingleDatatypeUnrecoverableError(FROM_HERE,
+                                                          error.message());
+      NOTREACHED();
+      LOG(ERROR) << "Create: no root node.";
+      return error;
+    }
   }
   syncer::WriteNode::InitUniqueByCreationResult result =
       sync_node->InitUniqueByCreation(
           change.sync_data().GetDataType(),
-          root_node,
+          *root_node,
           syncer::SyncDataLocal(change.sync_data()).GetTag());
   if (result != syncer::WriteNode::INIT_SUCCESS) {
     std::string error_prefix = "Failed to create " + type_str + " node: " +
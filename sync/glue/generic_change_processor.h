@@ -5,9 +5,11 @@
 #ifndef CHROME_BROWSER_SYNC_GLUE_GENERIC_CHANGE_PROCESSOR_H_
 #define CHROME_BROWSER_SYNC_GLUE_GENERIC_CHANGE_PROCESSOR_H_
 
+#include <map>
 #include <vector>
 
 #include "base/compiler_specific.h"
+#include "base/memory/linked_ptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/threading/non_thread_safe.h"
 #include "chrome/browser/sync/glue/change_processor.h"
@@ -19,6 +21,7 @@
 #include "sync/api/sync_merge_result.h"
 
 namespace syncer {
+class ReadNode;
 class SyncData;
 class SyncableService;
 class WriteNode;
@@ -94,12 +97,17 @@ class GenericChangeProcessor : public ChangeProcessor,
   virtual syncer::UserShare* share_handle() const OVERRIDE;
 
  private:
+  // Root nodes already looked up in the current transaction, by type.
+  typedef std::map<syncer::ModelType, linked_ptr<syncer::ReadNode> >
+      RootNodeMap;
+
   // Helper methods for acting on changes coming from the datatype. These are
   // logically part of ProcessSyncChanges.
   syncer::SyncError HandleActionAdd(const syncer::SyncChange& change,
                                     const std::string& type_str,
                                     const syncer::ModelType& type,
                                     const syncer::WriteTransaction& trans,
+                                    RootNodeMap* root_nodes,
                                     syncer::WriteNode* sync_node);
   syncer::SyncError HandleActionUpdate(const syncer::SyncChange& change,
                                        const std::string& type_str,
@@ -4,6 +4,8 @@
 
 #include "chrome/browser/sync/glue/generic_change_processor.h"
 
+#include <set>
+
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/message_loop/message_loop.h"
@@ -77,6 +79,30 @@ class SyncGenericChangeProcessorTest : public testing::Test {
     return test_user_share_.user_share();
   }
 
+  const syncer::SyncMergeResult& sync_merge_result() const {
+    return sync_merge_result_;
+  }
+
+  // Returns a list of |n| changes of type |change_type| to preference nodes.
+  static syncer::SyncChangeList BuildPreferenceChanges(
+      int n,
+      syncer::SyncChange::SyncChangeType change_type) {
+    syncer::SyncChangeList change_list;
+    sync_pb::EntitySpecifics specifics;
+    for (int i = 0; i < n; ++i) {
+      const std::string tag = base::StringPrintf("pref%05d", i);
+      specifics.mutable_preference()->set_name(tag);
+      specifics.mutable_preference()->set_value(
+          base::StringPrintf("%d", change_type));
+      change_list.push_back(
+          syncer::SyncChange(FROM_HERE,
+                             change_type,
+                             syncer::SyncData::CreateLocalData(
+                                 tag, tag, specifics)));
+    }
+    return change_list;
+  }
+
  private:
   base::MessageLoopForUI loop_;
 
@@ -238,6 +264,82 @@ TEST_F(SyncGenericChangeProcessorTest, UpdatePasswords) {
   }
 }
 
+// Verify that a change list touching the same nodes several times is applied
+// in full and in order, and that the root node looked up once for all the
+// adds is the parent of every added node.
+TEST_F(SyncGenericChangeProcessorTest, ProcessSyncChangesInOrder) {
+  const int kNumChanges = 10;
+
+  ASSERT_FALSE(change_processor()->ProcessSyncChanges(
+      FROM_HERE,
+      BuildPreferenceChanges(kNumChanges,
+                             syncer::SyncChange::ACTION_ADD)).IsSet());
+  EXPECT_EQ(kNumChanges, sync_merge_result().num_items_added());
+  EXPECT_EQ(kNumChanges, change_processor()->GetSyncCountForType(kType));
+  {
+    syncer::ReadTransaction trans(FROM_HERE, user_share());
+    syncer::ReadNode root(&trans);
+    ASSERT_EQ(syncer::BaseNode::INIT_OK,
+              root.InitByTagLookup(syncer::ModelTypeToRootTag(kType)));
+    for (int i = 0; i < kNumChanges; ++i) {
+      syncer::ReadNode node(&trans);
+      ASSERT_EQ(syncer::BaseNode::INIT_OK,
+                node.InitByClientTagLookup(
+                    kType, base::StringPrintf("pref%05d", i)));
+      EXPECT_EQ(root.GetId(), node.GetParentId());
+    }
+  }
+
+  // Updating and then deleting the same nodes within one list only works if
+  // the changes are applied in order.
+  syncer::SyncChangeList change_list =
+      BuildPreferenceChanges(kNumChanges, syncer::SyncChange::ACTION_UPDATE);
+  syncer::SyncChangeList deletions =
+      BuildPreferenceChanges(kNumChanges / 2,
+                             syncer::SyncChange::ACTION_DELETE);
+  change_list.insert(change_list.end(), deletions.begin(), deletions.end());
+  ASSERT_FALSE(
+      change_processor()->ProcessSyncChanges(FROM_HERE, change_list).IsSet());
+  EXPECT_EQ(kNumChanges, sync_merge_result().num_items_modified());
+  EXPECT_EQ(kNumChanges / 2, sync_merge_result().num_items_deleted());
+
+  syncer::SyncDataList sync_data = change_processor()->GetAllSyncData(kType);
+  ASSERT_EQ(static_cast<size_t>(kNumChanges - kNumChanges / 2),
+            sync_data.size());
+  for (size_t i = 0; i < sync_data.size(); ++i) {
+    EXPECT_EQ(base::StringPrintf("%d", syncer::SyncChange::ACTION_UPDATE),
+              sync_data[i].GetSpecifics().preference().value());
+  }
+}
+
+// Similar to StressGetAllSyncData, for the write path used at association
+// time.
+TEST_F(SyncGenericChangeProcessorTest, StressProcessSyncChanges) {
+  const int kNumChanges = 10000;
+
+  ASSERT_FALSE(change_processor()->ProcessSyncChanges(
+      FROM_HERE,
+      BuildPreferenceChanges(kNumChanges,
+                             syncer::SyncChange::ACTION_ADD)).IsSet());
+  EXPECT_EQ(kNumChanges, sync_merge_result().num_items_added());
+  EXPECT_EQ(kNumChanges, change_processor()->GetSyncCountForType(kType));
+
+  // Every change made it to its own node with the right data.
+  syncer::SyncDataList sync_data = change_processor()->GetAllSyncData(kType);
+  ASSERT_EQ(static_cast<size_t>(kNumChanges), sync_data.size());
+  std::set<std::string> names;
+  for (size_t i = 0; i < sync_data.size(); ++i) {
+    const sync_pb::PreferenceSpecifics& preference =
+        sync_data[i].GetSpecifics().preference();
+    EXPECT_EQ(base::StringPrintf("%d", syncer::SyncChange::ACTION_ADD),
+              preference.value());
+    names.insert(preference.name());
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumChanges), names.size());
+  EXPECT_EQ(1U, names.count("pref00000"));
+  EXPECT_EQ(1U, names.count(base::StringPrintf("pref%05d", kNumChanges - 1)));
+}
+
 // TODO(maniscalco): Add test cases that verify GenericChangeProcessor calls the
 // right methods on its AttachmentService at the right times (bug 353303).
 
@@ -0,0 +1,92 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/sync/glue/synced_favicon_store.h"
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/location.h"
+#include "base/md5.h"
+#include "base/sequenced_task_runner.h"
+
+namespace browser_sync {
+
+namespace {
+
+void WriteOnBlockingThread(const base::FilePath& directory,
+                           const base::FilePath& path,
+                           const std::string& data) {
+  if (!base::CreateDirectory(directory)) {
+    DVLOG(1) << "Failed to create " << directory.value();
+    return;
+  }
+  if (base::WriteFile(path, data.data(), data.size()) !=
+      static_cast<int>(data.size())) {
+    DVLOG(1) << "Failed to write " << path.value();
+    base::DeleteFile(path, false /* recursive */);
+  }
+}
+
+void ReadOnBlockingThread(const base::FilePath& path, std::string* data) {
+  if (!base::ReadFileToString(path, data))
+    data->clear();
+}
+
+void DeleteOnBlockingThread(const base::FilePath& path, bool recursive) {
+  base::DeleteFile(path, recursive);
+}
+
+}  // namespace
+
+SyncedFaviconStore::SyncedFaviconStore(
+    const base::FilePath& directory,
+    const scoped_refptr<base::SequencedTaskRunner>& task_runner)
+    : directory_(directory),
+      task_runner_(task_runner),
+      weak_ptr_factory_(this) {}
+
+SyncedFaviconStore::~SyncedFaviconStore() {}
+
+void SyncedFaviconStore::Clear() {
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&DeleteOnBlockingThread, directory_, true /* recursive */));
+}
+
+void SyncedFaviconStore::Write(const GURL& icon_url, const std::string& data) {
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&WriteOnBlockingThread,
+                 directory_, GetFilePath(icon_url), data));
+}
+
+void SyncedFaviconStore::Delete(const GURL& icon_url) {
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&DeleteOnBlockingThread,
+                 GetFilePath(icon_url), false /* recursive */));
+}
+
+void SyncedFaviconStore::Read(const GURL& icon_url,
+                              const ReadCallback& callback) {
+  std::string* data = new std::string;
+  task_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(&ReadOnBlockingThread, GetFilePath(icon_url), data),
+      base::Bind(&SyncedFaviconStore::OnRead,
+                 weak_ptr_factory_.GetWeakPtr(),
+                 callback,
+                 base::Owned(data)));
+}
+
+base::FilePath SyncedFaviconStore::GetFilePath(const GURL& icon_url) const {
+  return directory_.AppendASCII(base::MD5String(icon_url.spec()));
+}
+
+void SyncedFaviconStore::OnRead(const ReadCallback& callback,
+                                const std::string* data) {
+  callback.Run(*data);
+}
+
+}  // namespace browser_sync
@@ -0,0 +1,67 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_SYNC_GLUE_SYNCED_FAVICON_STORE_H_
+#define CHROME_BROWSER_SYNC_GLUE_SYNCED_FAVICON_STORE_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "url/gurl.h"
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace browser_sync {
+
+// Keeps the images of synced favicons that FaviconCache evicted from memory.
+// Each favicon is stored in its own file in |directory|, holding its
+// serialized FaviconImageSpecifics. The contents are only meaningful for the
+// current session, since FaviconCache is rebuilt from sync data on startup.
+//
+// All file operations run in order on |task_runner|, so a read returns the
+// data of the writes and deletions issued before it. Read results are
+// delivered on the thread the store was created on.
+class SyncedFaviconStore {
+ public:
+  // Called with the data written for a favicon, or an empty string if none
+  // was found.
+  typedef base::Callback<void(const std::string& data)> ReadCallback;
+
+  SyncedFaviconStore(
+      const base::FilePath& directory,
+      const scoped_refptr<base::SequencedTaskRunner>& task_runner);
+  ~SyncedFaviconStore();
+
+  // Deletes all the stored images, including those left by a previous session.
+  void Clear();
+
+  void Write(const GURL& icon_url, const std::string& data);
+  void Delete(const GURL& icon_url);
+
+  // Reads the data for |icon_url| and runs |callback| with it, unless the
+  // store is destroyed first.
+  void Read(const GURL& icon_url, const ReadCallback& callback);
+
+ private:
+  base::FilePath GetFilePath(const GURL& icon_url) const;
+
+  void OnRead(const ReadCallback& callback, const std::string* data);
+
+  const base::FilePath directory_;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  base::WeakPtrFactory<SyncedFaviconStore> weak_ptr_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(SyncedFaviconStore);
+};
+
+}  // namespace browser_sync
+
+#endif  // CHROME_BROWSER_SYNC_GLUE_SYNCED_FAVICON_STORE_H_
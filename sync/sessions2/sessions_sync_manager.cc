@@ -4,6 +4,7 @@
 
 #include "chrome/browser/sync/sessions2/sessions_sync_manager.h"
 
+#include "base/md5.h"
 #include "chrome/browser/chrome_notification_types.h"
 #if !defined(OS_ANDROID)
 #include "chrome/browser/network_time/navigation_time_helper.h"
@@ -135,6 +136,8 @@ syncer::SyncMergeResult SessionsSyncManager::MergeDataAndStartSyncing(
 
   merge_result.set_error(
       sync_processor_->ProcessSyncChanges(FROM_HERE, new_changes));
+  if (!merge_result.error().IsSet())
+    OnLocalChangesProcessed(new_changes);
 
   local_event_router_->StartRoutingTo(this);
   return merge_result;
@@ -239,11 +242,13 @@ void SessionsSyncManager::AssociateWindows(
   local_tab_pool_.DeleteUnassociatedTabNodes(change_output);
   session_tracker_.CleanupSession(local_tag);
 
-  // Always update the header.  Sync takes care of dropping this update
-  // if the entity specifics are identical (i.e windows, client name did
-  // not change).
+  // Only update the header if the windows or client name changed since the
+  // last update, so that a burst of navigations within the same tabs doesn't
+  // rewrite it on every event.
   sync_pb::EntitySpecifics entity;
   entity.mutable_session()->CopyFrom(specifics);
+  if (HashSpecifics(entity) == local_session_header_hash_)
+    return;
   syncer::SyncData data = syncer::SyncData::CreateLocalData(
         current_machine_tag(), current_session_name_, entity);
   change_output->push_back(syncer::SyncChange(
@@ -299,16 +304,19 @@ void SessionsSyncManager::AssociateTab(SyncedTabDelegate* const tab,
   DVLOG(1) << "Reloading tab " << tab_id << " from window "
            << tab->GetWindowId();
 
-  // Write to sync model.
+  // Write to sync model, unless the tab looks exactly as it did the last time
+  // it was written (e.g. for a load completion or a favicon change).
   sync_pb::EntitySpecifics specifics;
   LocalTabDelegateToSpecifics(*tab, specifics.mutable_session());
-  syncer::SyncData data = syncer::SyncData::CreateLocalData(
-      TabNodePool2::TabIdToTag(current_machine_tag_,
-                               tab_link->tab_node_id()),
-      current_session_name_,
-      specifics);
-  change_output->push_back(syncer::SyncChange(
-      FROM_HERE, syncer::SyncChange::ACTION_UPDATE, data));
+  if (HashSpecifics(specifics) != tab_link->specifics_hash()) {
+    syncer::SyncData data = syncer::SyncData::CreateLocalData(
+        TabNodePool2::TabIdToTag(current_machine_tag_,
+                                 tab_link->tab_node_id()),
+        current_session_name_,
+        specifics);
+    change_output->push_back(syncer::SyncChange(
+        FROM_HERE, syncer::SyncChange::ACTION_UPDATE, data));
+  }
 
   const GURL new_url = GetCurrentVirtualURL(*tab);
   if (new_url != tab_link->url()) {
@@ -360,7 +368,12 @@ void SessionsSyncManager::OnLocalTabModified(SyncedTabDelegate* modified_tab) {
   // "interesting" by going to a valid URL, in which case it needs to be added
   // to the window's tab information.
   AssociateWindows(DONT_RELOAD_TABS, syncer::SyncDataList(), &changes);
-  sync_processor_->ProcessSyncChanges(FROM_HERE, changes);
+  if (changes.empty())
+    return;
+  syncer::SyncError error =
+      sync_processor_->ProcessSyncChanges(FROM_HERE, changes);
+  if (!error.IsSet())
+    OnLocalChangesProcessed(changes);
 }
 
 void SessionsSyncManager::OnFaviconPageUrlsUpdated(
@@ -388,6 +401,7 @@ void SessionsSyncManager::StopSyncing(syncer::ModelType type) {
   current_machine_tag_.clear();
   current_session_name_.clear();
   local_session_header_node_id_ = TabNodePool2::kInvalidTabNodeID;
+  local_session_header_hash_.clear();
 }
 
 syncer::SyncDataList SessionsSyncManager::GetAllSyncData(
@@ -852,6 +866,35 @@ void SessionsSyncManager::LocalTabDelegateToSpecifics(
   specifics->mutable_tab()->CopyFrom(tab_s);
 }
 
+void SessionsSyncManager::OnLocalChangesProcessed(
+    const syncer::SyncChangeList& changes) {
+  for (syncer::SyncChangeList::const_iterator it = changes.begin();
+       it != changes.end(); ++it) {
+    if (it->change_type() == syncer::SyncChange::ACTION_DELETE)
+      continue;
+    const sync_pb::EntitySpecifics& entity = it->sync_data().GetSpecifics();
+    const sync_pb::SessionSpecifics& specifics = entity.session();
+    if (specifics.session_tag() != current_machine_tag())
+      continue;
+    if (specifics.has_header()) {
+      local_session_header_hash_ = HashSpecifics(entity);
+    } else if (specifics.has_tab()) {
+      TabLinksMap::iterator tab_iter =
+          local_tab_map_.find(specifics.tab().tab_id());
+      if (tab_iter != local_tab_map_.end() &&
+          tab_iter->second->tab_node_id() == specifics.tab_node_id()) {
+        tab_iter->second->set_specifics_hash(HashSpecifics(entity));
+      }
+    }
+  }
+}
+
+// static
+std::string SessionsSyncManager::HashSpecifics(
+    const sync_pb::EntitySpecifics& specifics) {
+  return base::MD5String(specifics.SerializeAsString());
+}
+
 void SessionsSyncManager::AssociateRestoredPlaceholderTab(
     const SyncedTabDelegate& tab_delegate,
     SessionID::id_type new_tab_id,
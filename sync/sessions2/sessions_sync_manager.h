@@ -33,6 +33,7 @@ class SyncErrorFactory;
 }
 
 namespace sync_pb {
+class EntitySpecifics;
 class SessionHeader;
 class SessionSpecifics;
 class SessionTab;
@@ -166,10 +167,14 @@ class SessionsSyncManager : public syncer::SyncableService,
 
     void set_tab(const SyncedTabDelegate* tab) { tab_ = tab; }
     void set_url(const GURL& url) { url_ = url; }
+    void set_specifics_hash(const std::string& hash) {
+      specifics_hash_ = hash;
+    }
 
     int tab_node_id() const { return tab_node_id_; }
     const SyncedTabDelegate* tab() const { return tab_; }
     const GURL& url() const { return url_; }
+    const std::string& specifics_hash() const { return specifics_hash_; }
 
    private:
     // The id for the sync node this tab is stored in.
@@ -181,6 +186,10 @@ class SessionsSyncManager : public syncer::SyncableService,
     // The currently visible url of the tab (used for syncing favicons).
     GURL url_;
 
+    // Hash of the specifics last accepted by sync for this tab, or empty if
+    // none was since the tab was associated.
+    std::string specifics_hash_;
+
     DISALLOW_COPY_AND_ASSIGN(TabLink);
   };
 
@@ -206,6 +215,8 @@ class SessionsSyncManager : public syncer::SyncableService,
                            SwappedOutOnRestore);
   FRIEND_TEST_ALL_PREFIXES(SessionsSyncManagerTest,
                            ProcessRemoteDeleteOfLocalSession);
+  FRIEND_TEST_ALL_PREFIXES(SessionsSyncManagerTest,
+                           SkipUnchangedLocalUpdates);
 
   void InitializeCurrentMachineTag();
 
@@ -325,6 +336,15 @@ class SessionsSyncManager : public syncer::SyncableService,
       const syncer::SyncDataList& restored_tabs,
       syncer::SyncChangeList* change_output);
 
+  // Remembers the hashes of the local header and tab specifics in |changes|,
+  // once the sync processor accepted them, so that later local events only
+  // resend what differs from them.
+  void OnLocalChangesProcessed(const syncer::SyncChangeList& changes);
+
+  // Returns a hash of |specifics|, used to detect whether a local node needs
+  // to be sent to sync again.
+  static std::string HashSpecifics(const sync_pb::EntitySpecifics& specifics);
+
   // Stops and re-starts syncing to rebuild association mappings.
   // See |local_tab_pool_out_of_sync_|.
   void RebuildAssociations();
@@ -366,6 +386,10 @@ class SessionsSyncManager : public syncer::SyncableService,
   // client.
   int local_session_header_node_id_;
 
+  // Hash of the header specifics last accepted by sync. Local tab events that
+  // don't change the set of windows and tabs leave the header untouched.
+  std::string local_session_header_hash_;
+
   // Number of days without activity after which we consider a session to be
   // stale and a candidate for garbage collection.
   size_t stale_session_threshold_days_;
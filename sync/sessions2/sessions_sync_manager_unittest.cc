@@ -1378,14 +1378,15 @@ TEST_F(SessionsSyncManagerTest, OnLocalTabModified) {
   // One add, one update for each AddTab.
   // One update for each NavigateAndCommit.
   // = 6 total tab updates.
-  // One header update corresponding to each of those.
-  // = 6 total header updates.
-  // 12 total updates.
-  ASSERT_EQ(12U, out.size());
+  // One header update for each AddTab, as the other events don't change the
+  // window state.
+  // = 2 total header updates.
+  // 8 total updates.
+  ASSERT_EQ(8U, out.size());
 
   // Verify the tab node creations and updates to ensure the SyncProcessor
   // sees the right operations.
-  for (int i = 0; i < 12; i++) {
+  for (int i = 0; i < 8; i++) {
     SCOPED_TRACE(i);
     EXPECT_TRUE(out[i].IsValid());
     const SyncData data(out[i].sync_data());
@@ -1393,20 +1394,15 @@ TEST_F(SessionsSyncManagerTest, OnLocalTabModified) {
                                 manager()->current_machine_tag(), true));
     const sync_pb::SessionSpecifics& specifics(data.GetSpecifics().session());
     EXPECT_EQ(manager()->current_machine_tag(), specifics.session_tag());
-    if (i % 6 == 0) {
-      // First thing on an AddTab is a no-op header update for parented tab.
-      EXPECT_EQ(header.SerializeAsString(),
-                data.GetSpecifics().SerializeAsString());
-      EXPECT_EQ(manager()->current_machine_tag(),
-                syncer::SyncDataLocal(data).GetTag());
-    } else if (i % 6 == 1) {
-      // Next, the TabNodePool should create the tab node.
+    if (i % 4 == 0) {
+      // The parented tab doesn't change the header, so the first thing on an
+      // AddTab is the TabNodePool creating the tab node.
       EXPECT_EQ(SyncChange::ACTION_ADD, out[i].change_type());
       EXPECT_EQ(TabNodePool2::TabIdToTag(
                     manager()->current_machine_tag(),
                     data.GetSpecifics().session().tab_node_id()),
                 syncer::SyncDataLocal(data).GetTag());
-    } else if (i % 6 == 2) {
+    } else if (i % 4 == 1) {
       // Then we see the tab update to the URL.
       EXPECT_EQ(SyncChange::ACTION_UPDATE, out[i].change_type());
       EXPECT_EQ(TabNodePool2::TabIdToTag(
@@ -1414,11 +1410,14 @@ TEST_F(SessionsSyncManagerTest, OnLocalTabModified) {
                     data.GetSpecifics().session().tab_node_id()),
                 syncer::SyncDataLocal(data).GetTag());
       ASSERT_TRUE(specifics.has_tab());
-    } else if (i % 6 == 3) {
+    } else if (i % 4 == 2) {
       // The header needs to be updated to reflect the new window state.
       EXPECT_EQ(SyncChange::ACTION_UPDATE, out[i].change_type());
-      EXPECT_TRUE(specifics.has_header());
-    } else if (i % 6 == 4) {
+      ASSERT_TRUE(specifics.has_header());
+      EXPECT_NE(header.SerializeAsString(),
+                data.GetSpecifics().SerializeAsString());
+      header = data.GetSpecifics();
+    } else if (i % 4 == 3) {
       // Now we move on to NavigateAndCommit.  Update the tab.
       EXPECT_EQ(SyncChange::ACTION_UPDATE, out[i].change_type());
       EXPECT_EQ(TabNodePool2::TabIdToTag(
@@ -1426,11 +1425,6 @@ TEST_F(SessionsSyncManagerTest, OnLocalTabModified) {
                     data.GetSpecifics().session().tab_node_id()),
                 syncer::SyncDataLocal(data).GetTag());
       ASSERT_TRUE(specifics.has_tab());
-    } else if (i % 6 == 5) {
-      // The header needs to be updated to reflect the new window state.
-      EXPECT_EQ(SyncChange::ACTION_UPDATE, out[i].change_type());
-      ASSERT_TRUE(specifics.has_header());
-      header = data.GetSpecifics();
     }
   }
 
@@ -1443,27 +1437,80 @@ TEST_F(SessionsSyncManagerTest, OnLocalTabModified) {
   // ASSERT_TRUEs above allow us to dive in freely here.
   // Verify first tab.
   const sync_pb::SessionTab& tab1_1 =
-      out[2].sync_data().GetSpecifics().session().tab();
+      out[1].sync_data().GetSpecifics().session().tab();
   ASSERT_EQ(1, tab1_1.navigation_size());
   EXPECT_EQ(foo1.spec(), tab1_1.navigation(0).virtual_url());
   const sync_pb::SessionTab& tab1_2 =
-      out[4].sync_data().GetSpecifics().session().tab();
+      out[3].sync_data().GetSpecifics().session().tab();
   ASSERT_EQ(2, tab1_2.navigation_size());
   EXPECT_EQ(foo1.spec(), tab1_2.navigation(0).virtual_url());
   EXPECT_EQ(foo2.spec(), tab1_2.navigation(1).virtual_url());
 
   // Verify second tab.
   const sync_pb::SessionTab& tab2_1 =
-      out[8].sync_data().GetSpecifics().session().tab();
+      out[5].sync_data().GetSpecifics().session().tab();
   ASSERT_EQ(1, tab2_1.navigation_size());
   EXPECT_EQ(bar1.spec(), tab2_1.navigation(0).virtual_url());
   const sync_pb::SessionTab& tab2_2 =
-      out[10].sync_data().GetSpecifics().session().tab();
+      out[7].sync_data().GetSpecifics().session().tab();
   ASSERT_EQ(2, tab2_2.navigation_size());
   EXPECT_EQ(bar1.spec(), tab2_2.navigation(0).virtual_url());
   EXPECT_EQ(bar2.spec(), tab2_2.navigation(1).virtual_url());
 }
 
+// Tests that local tab events that don't change what we would write to sync
+// don't generate any changes.
+TEST_F(SessionsSyncManagerTest, SkipUnchangedLocalUpdates) {
+  syncer::SyncChangeList out;
+  InitWithSyncDataTakeOutput(syncer::SyncDataList(), &out);
+  AddTab(browser(), GURL("http://foo1"));
+  out.clear();
+
+  SyncedTabDelegate* tab = SyncedTabDelegate::ImplFromWebContents(
+      browser()->tab_strip_model()->GetActiveWebContents());
+  ASSERT_TRUE(tab);
+  SessionsSyncManager::TabLinksMap::const_iterator iter =
+      manager()->local_tab_map_.find(tab->GetSessionId());
+  ASSERT_TRUE(iter != manager()->local_tab_map_.end());
+  const std::string specifics_hash = iter->second->specifics_hash();
+  EXPECT_FALSE(specifics_hash.empty());
+
+  // Nothing changed since the tab was last written.
+  manager()->OnLocalTabModified(tab);
+  EXPECT_TRUE(out.empty());
+  EXPECT_EQ(specifics_hash, iter->second->specifics_hash());
+
+  // A navigation rewrites the tab but leaves the header alone.
+  NavigateAndCommitActiveTab(GURL("http://foo2"));
+  ASSERT_EQ(1U, out.size());
+  EXPECT_EQ(SyncChange::ACTION_UPDATE, out[0].change_type());
+  const sync_pb::SessionSpecifics& specifics =
+      out[0].sync_data().GetSpecifics().session();
+  ASSERT_TRUE(specifics.has_tab());
+  EXPECT_EQ(2, specifics.tab().navigation_size());
+  EXPECT_NE(specifics_hash, iter->second->specifics_hash());
+
+  // A navigation that sync failed to process is sent again by the next event.
+  out.clear();
+  TriggerProcessSyncChangesError();
+  NavigateAndCommitActiveTab(GURL("http://foo3"));
+  manager()->OnLocalTabModified(tab);
+  ASSERT_EQ(1U, out.size());
+  const sync_pb::SessionSpecifics& resent =
+      out[0].sync_data().GetSpecifics().session();
+  ASSERT_TRUE(resent.has_tab());
+  EXPECT_EQ(3, resent.tab().navigation_size());
+
+  // Restarting sync writes everything again.
+  manager()->StopSyncing(syncer::SESSIONS);
+  EXPECT_TRUE(manager()->local_session_header_hash_.empty());
+  out.clear();
+  InitWithSyncDataTakeOutput(syncer::SyncDataList(), &out);
+  ASSERT_EQ(4U, out.size());  // Header, tab ADD, tab UPDATE, header UPDATE.
+  EXPECT_TRUE(out[2].sync_data().GetSpecifics().session().has_tab());
+  EXPECT_TRUE(out[3].sync_data().GetSpecifics().session().has_header());
+}
+
 // Ensure model association associates the pre-existing tabs.
 TEST_F(SessionsSyncManagerTest, MergeLocalSessionExistingTabs) {
   AddTab(browser(), GURL("http://foo1"));
@@ -1694,9 +1741,13 @@ TEST_F(SessionsSyncManagerTest, CheckPrerenderedWebContentsSwap) {
       old_web_contents.get());
   browser()->tab_strip_model()->ReplaceWebContentsAt(index, new_web_contents);
 
-  ASSERT_EQ(9U, out.size());
+  // The new WebContents gets a new tab node and the header is updated to
+  // point at it. Events that don't change the tab any further are dropped.
+  ASSERT_EQ(7U, out.size());
   EXPECT_EQ(SyncChange::ACTION_ADD, out[4].change_type());
   EXPECT_EQ(SyncChange::ACTION_UPDATE, out[5].change_type());
+  EXPECT_EQ(SyncChange::ACTION_UPDATE, out[6].change_type());
+  EXPECT_TRUE(out[6].sync_data().GetSpecifics().session().has_header());
 
   // Navigate away.
   NavigateAndCommitActiveTab(GURL("http://bar2"));
@@ -1711,7 +1762,10 @@ TEST_F(SessionsSyncManagerTest, CheckPrerenderedWebContentsSwap) {
 
   AddTab(browser(), GURL("http://bar4"));
   NavigateAndCommitActiveTab(GURL("http://bar5"));
-  ASSERT_EQ(19U, out.size());
+
+  // One tab update for each navigation, plus a tab add, tab update and header
+  // update for the new tab.
+  ASSERT_EQ(13U, out.size());
 }
 
 namespace {
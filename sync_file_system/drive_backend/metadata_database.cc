@@ -9,6 +9,7 @@
 
 #include "base/bind.h"
 #include "base/callback.h"
+#include "base/command_line.h"
 #include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/location.h"
@@ -26,6 +27,7 @@
 #include "chrome/browser/sync_file_system/drive_backend/drive_backend_util.h"
 #include "chrome/browser/sync_file_system/drive_backend/metadata_database.pb.h"
 #include "chrome/browser/sync_file_system/drive_backend/metadata_database_index.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database_index_on_disk.h"
 #include "chrome/browser/sync_file_system/drive_backend/metadata_db_migration_util.h"
 #include "chrome/browser/sync_file_system/logger.h"
 #include "chrome/browser/sync_file_system/syncable_file_system_util.h"
@@ -41,6 +43,9 @@ namespace drive_backend {
 
 namespace {
 
+// Keeps the indexes of MetadataDatabase on disk instead of on memory.
+const char kEnableSyncFileSystemOnDiskIndex[] = "enable-syncfs-on-disk-index";
+
 bool IsAppRoot(const FileTracker& tracker) {
   return tracker.tracker_kind() == TRACKER_KIND_APP_ROOT ||
       tracker.tracker_kind() == TRACKER_KIND_DISABLED_APP_ROOT;
@@ -365,7 +370,7 @@ bool HasInvalidTitle(const std::string& title) {
 }
 
 void MarkTrackerSetDirty(const TrackerIDSet& trackers,
-                         MetadataDatabaseIndex* index,
+                         MetadataDatabaseIndexInterface* index,
                          leveldb::WriteBatch* batch) {
   for (TrackerIDSet::const_iterator itr = trackers.begin();
        itr != trackers.end(); ++itr) {
@@ -381,7 +386,7 @@ void MarkTrackerSetDirty(const TrackerIDSet& trackers,
 
 void MarkTrackersDirtyByPath(int64 parent_tracker_id,
                              const std::string& title,
-                             MetadataDatabaseIndex* index,
+                             MetadataDatabaseIndexInterface* index,
                              leveldb::WriteBatch* batch) {
   if (parent_tracker_id == kInvalidTrackerID || title.empty())
     return;
@@ -391,14 +396,14 @@ void MarkTrackersDirtyByPath(int64 parent_tracker_id,
 }
 
 void MarkTrackersDirtyByFileID(const std::string& file_id,
-                               MetadataDatabaseIndex* index,
+                               MetadataDatabaseIndexInterface* index,
                                leveldb::WriteBatch* batch) {
   MarkTrackerSetDirty(index->GetFileTrackerIDsByFileID(file_id),
                       index, batch);
 }
 
 void MarkTrackersDirtyRecursively(int64 root_tracker_id,
-                                  MetadataDatabaseIndex* index,
+                                  MetadataDatabaseIndexInterface* index,
                                   leveldb::WriteBatch* batch) {
   std::vector<int64> stack;
   stack.push_back(root_tracker_id);
@@ -417,7 +422,7 @@ void MarkTrackersDirtyRecursively(int64 root_tracker_id,
 }
 
 void RemoveAllDescendantTrackers(int64 root_tracker_id,
-                                 MetadataDatabaseIndex* index,
+                                 MetadataDatabaseIndexInterface* index,
                                  leveldb::WriteBatch* batch) {
   std::vector<int64> pending_trackers;
   AppendContents(index->GetFileTrackerIDsByParent(root_tracker_id),
@@ -458,7 +463,7 @@ void RemoveAllDescendantTrackers(int64 root_tracker_id,
 }
 
 const FileTracker* FilterFileTrackersByParent(
-    const MetadataDatabaseIndex& index,
+    const MetadataDatabaseIndexInterface& index,
     const TrackerIDSet& trackers,
     int64 parent_tracker_id) {
   for (TrackerIDSet::const_iterator itr = trackers.begin();
@@ -476,7 +481,7 @@ const FileTracker* FilterFileTrackersByParent(
 }
 
 const FileTracker* FilterFileTrackersByParentAndTitle(
-    const MetadataDatabaseIndex& index,
+    const MetadataDatabaseIndexInterface& index,
     const TrackerIDSet& trackers,
     int64 parent_tracker_id,
     const std::string& title) {
@@ -506,7 +511,7 @@ const FileTracker* FilterFileTrackersByParentAndTitle(
 }
 
 const FileTracker* FilterFileTrackersByFileID(
-    const MetadataDatabaseIndex& index,
+    const MetadataDatabaseIndexInterface& index,
     const TrackerIDSet& trackers,
     const std::string& file_id) {
   for (TrackerIDSet::const_iterator itr = trackers.begin();
@@ -533,7 +538,7 @@ enum DirtyingOption {
 
 void ActivateFileTracker(int64 tracker_id,
                          int dirtying_options,
-                         MetadataDatabaseIndex* index,
+                         MetadataDatabaseIndexInterface* index,
                          leveldb::WriteBatch* batch) {
   DCHECK(dirtying_options == MARK_NOTHING_DIRTY ||
          dirtying_options == MARK_ITSELF_DIRTY);
@@ -557,7 +562,7 @@ void ActivateFileTracker(int64 tracker_id,
 
 void DeactivateFileTracker(int64 tracker_id,
                            int dirtying_options,
-                           MetadataDatabaseIndex* index,
+                           MetadataDatabaseIndexInterface* index,
                            leveldb::WriteBatch* batch) {
   RemoveAllDescendantTrackers(tracker_id, index, batch);
 
@@ -580,7 +585,7 @@ void DeactivateFileTracker(int64 tracker_id,
 
 void RemoveFileTracker(int64 tracker_id,
                        int dirtying_options,
-                       MetadataDatabaseIndex* index,
+                       MetadataDatabaseIndexInterface* index,
                        leveldb::WriteBatch* batch) {
   DCHECK(!(dirtying_options & MARK_ITSELF_DIRTY));
 
@@ -627,10 +632,11 @@ void MetadataDatabase::Create(base::SequencedTaskRunner* task_runner,
 // static
 SyncStatusCode MetadataDatabase::CreateForTesting(
     scoped_ptr<leveldb::DB> db,
+    bool enable_on_disk_index,
     scoped_ptr<MetadataDatabase>* metadata_database_out) {
   scoped_ptr<MetadataDatabase> metadata_database(
       new MetadataDatabase(base::MessageLoopProxy::current(),
-                           base::FilePath(), NULL));
+                           base::FilePath(), enable_on_disk_index, NULL));
   metadata_database->db_ = db.Pass();
   SyncStatusCode status =
       metadata_database->InitializeOnTaskRunner();
@@ -687,8 +693,8 @@ void MetadataDatabase::PopulateInitialData(
     const google_apis::FileResource& sync_root_folder,
     const ScopedVector<google_apis::FileResource>& app_root_folders,
     const SyncStatusCallback& callback) {
-  DCHECK(index_->tracker_by_id_.empty());
-  DCHECK(index_->metadata_by_id_.empty());
+  DCHECK(!index_->CountFileTracker());
+  DCHECK(!index_->CountFileMetadata());
 
   scoped_ptr<leveldb::WriteBatch> batch(new leveldb::WriteBatch);
   service_metadata_->set_largest_change_id(largest_change_id);
@@ -1366,8 +1372,7 @@ bool MetadataDatabase::HasDirtyTracker() const {
 }
 
 size_t MetadataDatabase::CountDirtyTracker() const {
-  return index_->dirty_trackers_.size() +
-      index_->demoted_dirty_trackers_.size();
+  return index_->CountDirtyTracker();
 }
 
 bool MetadataDatabase::GetMultiParentFileTrackers(std::string* file_id_out,
@@ -1391,11 +1396,11 @@ bool MetadataDatabase::GetMultiParentFileTrackers(std::string* file_id_out,
 }
 
 size_t MetadataDatabase::CountFileMetadata() const {
-  return index_->metadata_by_id_.size();
+  return index_->CountFileMetadata();
 }
 
 size_t MetadataDatabase::CountFileTracker() const {
-  return index_->tracker_by_id_.size();
+  return index_->CountFileTracker();
 }
 
 bool MetadataDatabase::GetConflictingTrackers(TrackerIDSet* trackers_out) {
@@ -1423,10 +1428,12 @@ void MetadataDatabase::GetRegisteredAppIDs(std::vector<std::string>* app_ids) {
 
 MetadataDatabase::MetadataDatabase(base::SequencedTaskRunner* task_runner,
                                    const base::FilePath& database_path,
+                                   bool enable_on_disk_index,
                                    leveldb::Env* env_override)
     : task_runner_(task_runner),
       database_path_(database_path),
       env_override_(env_override),
+      enable_on_disk_index_(enable_on_disk_index),
       largest_known_change_id_(0),
       weak_ptr_factory_(this) {
   DCHECK(task_runner);
@@ -1440,7 +1447,10 @@ void MetadataDatabase::CreateOnTaskRunner(
     leveldb::Env* env_override,
     const CreateCallback& callback) {
   scoped_ptr<MetadataDatabase> metadata_database(
-      new MetadataDatabase(task_runner, database_path, env_override));
+      new MetadataDatabase(task_runner, database_path,
+                           CommandLine::ForCurrentProcess()->HasSwitch(
+                               kEnableSyncFileSystemOnDiskIndex),
+                           env_override));
   SyncStatusCode status =
       metadata_database->InitializeOnTaskRunner();
   if (status != SYNC_STATUS_OK)
@@ -1483,23 +1493,41 @@ SyncStatusCode MetadataDatabase::InitializeOnTaskRunner() {
   if (status != SYNC_STATUS_OK)
     return status;
 
+  size_t num_metadata = contents.file_metadata.size();
+  size_t num_trackers = contents.file_trackers.size();
   status = RemoveUnreachableItems(&contents, &batch);
   if (status != SYNC_STATUS_OK)
     return status;
 
+  // On-disk indexes can't follow changes made outside of them, so let them be
+  // rebuilt on the next use.
+  if (!enable_on_disk_index_ ||
+      num_metadata != contents.file_metadata.size() ||
+      num_trackers != contents.file_trackers.size())
+    MetadataDatabaseIndexOnDisk::InvalidateIndexes(&batch);
+
   status = LevelDBStatusToSyncStatusCode(
       db_->Write(leveldb::WriteOptions(), &batch));
   if (status != SYNC_STATUS_OK)
     return status;
 
-  BuildIndexes(&contents);
-  return status;
+  return BuildIndexes(&contents);
 }
 
-void MetadataDatabase::BuildIndexes(DatabaseContents* contents) {
+SyncStatusCode MetadataDatabase::BuildIndexes(DatabaseContents* contents) {
   service_metadata_ = contents->service_metadata.Pass();
   UpdateLargestKnownChangeID(service_metadata_->largest_change_id());
-  index_.reset(new MetadataDatabaseIndex(contents));
+
+  if (!enable_on_disk_index_) {
+    index_.reset(new MetadataDatabaseIndex(contents));
+    return SYNC_STATUS_OK;
+  }
+
+  index_ = MetadataDatabaseIndexOnDisk::Create(db_.get(), contents)
+      .PassAs<MetadataDatabaseIndexInterface>();
+  if (!index_)
+    return SYNC_DATABASE_ERROR_FAILED;
+  return SYNC_STATUS_OK;
 }
 
 void MetadataDatabase::CreateTrackerForParentAndFileID(
@@ -1740,6 +1768,7 @@ void MetadataDatabase::WriteToDatabase(scoped_ptr<leveldb::WriteBatch> batch,
     return;
   }
 
+  index_->FlushPendingChanges(batch.get());
   base::PostTaskAndReplyWithResult(
       task_runner_.get(),
       FROM_HERE,
@@ -1747,7 +1776,17 @@ void MetadataDatabase::WriteToDatabase(scoped_ptr<leveldb::WriteBatch> batch,
                  base::Unretained(db_.get()),
                  leveldb::WriteOptions(),
                  base::Owned(batch.release())),
-      base::Bind(&AdaptLevelDBStatusToSyncStatusCode, callback));
+      base::Bind(&MetadataDatabase::DidWriteDatabase,
+                 weak_ptr_factory_.GetWeakPtr(), callback));
+}
+
+// static
+void MetadataDatabase::DidWriteDatabase(base::WeakPtr<MetadataDatabase> self,
+                                        const SyncStatusCallback& callback,
+                                        const leveldb::Status& status) {
+  if (self)
+    self->index_->OnChangesWritten();
+  AdaptLevelDBStatusToSyncStatusCode(callback, status);
 }
 
 scoped_ptr<base::ListValue> MetadataDatabase::DumpFiles(
@@ -1832,10 +1871,15 @@ scoped_ptr<base::ListValue> MetadataDatabase::DumpTrackers() {
   trackers->Append(metadata);
 
   // Append tracker data.
-  for (MetadataDatabaseIndex::TrackerByID::const_iterator itr =
-           index_->tracker_by_id_.begin();
-       itr != index_->tracker_by_id_.end(); ++itr) {
-    const FileTracker& tracker = *itr->second;
+  std::vector<int64> tracker_ids(index_->GetAllTrackerIDs());
+  for (std::vector<int64>::const_iterator itr = tracker_ids.begin();
+       itr != tracker_ids.end(); ++itr) {
+    const FileTracker* tracker_ptr = index_->GetFileTracker(*itr);
+    if (!tracker_ptr) {
+      NOTREACHED();
+      continue;
+    }
+    const FileTracker& tracker = *tracker_ptr;
     base::DictionaryValue* dict = new base::DictionaryValue;
     base::FilePath path = BuildDisplayPathForTracker(tracker);
     dict->SetString("tracker_id", base::Int64ToString(tracker.tracker_id()));
@@ -1885,10 +1929,15 @@ scoped_ptr<base::ListValue> MetadataDatabase::DumpMetadata() {
   files->Append(metadata);
 
   // Append metadata data.
-  for (MetadataDatabaseIndex::MetadataByID::const_iterator itr =
-           index_->metadata_by_id_.begin();
-       itr != index_->metadata_by_id_.end(); ++itr) {
-    const FileMetadata& file = *itr->second;
+  std::vector<std::string> metadata_ids(index_->GetAllMetadataIDs());
+  for (std::vector<std::string>::const_iterator itr = metadata_ids.begin();
+       itr != metadata_ids.end(); ++itr) {
+    const FileMetadata* file_ptr = index_->GetFileMetadata(*itr);
+    if (!file_ptr) {
+      NOTREACHED();
+      continue;
+    }
+    const FileMetadata& file = *file_ptr;
 
     base::DictionaryValue* dict = new base::DictionaryValue;
     dict->SetString("file_id", file.file_id());
@@ -30,6 +30,7 @@ class SingleThreadTaskRunner;
 namespace leveldb {
 class DB;
 class Env;
+class Status;
 class WriteBatch;
 }
 
@@ -49,7 +50,7 @@ namespace drive_backend {
 class FileDetails;
 class FileMetadata;
 class FileTracker;
-class MetadataDatabaseIndex;
+class MetadataDatabaseIndexInterface;
 class ServiceMetadata;
 
 struct DatabaseContents {
@@ -147,6 +148,7 @@ class MetadataDatabase {
                      const CreateCallback& callback);
   static SyncStatusCode CreateForTesting(
       scoped_ptr<leveldb::DB> db,
+      bool enable_on_disk_index,
       scoped_ptr<MetadataDatabase>* metadata_database_out);
 
   ~MetadataDatabase();
@@ -357,6 +359,7 @@ class MetadataDatabase {
 
   MetadataDatabase(base::SequencedTaskRunner* task_runner,
                    const base::FilePath& database_path,
+                   bool enable_on_disk_index,
                    leveldb::Env* env_override);
   static void CreateOnTaskRunner(base::SingleThreadTaskRunner* callback_runner,
                                  base::SequencedTaskRunner* task_runner,
@@ -364,7 +367,7 @@ class MetadataDatabase {
                                  leveldb::Env* env_override,
                                  const CreateCallback& callback);
   SyncStatusCode InitializeOnTaskRunner();
-  void BuildIndexes(DatabaseContents* contents);
+  SyncStatusCode BuildIndexes(DatabaseContents* contents);
 
   // Database manipulation methods.
   void RegisterTrackerAsAppRoot(const std::string& app_id,
@@ -407,6 +410,9 @@ class MetadataDatabase {
 
   void WriteToDatabase(scoped_ptr<leveldb::WriteBatch> batch,
                        const SyncStatusCallback& callback);
+  static void DidWriteDatabase(base::WeakPtr<MetadataDatabase> self,
+                               const SyncStatusCallback& callback,
+                               const leveldb::Status& status);
 
   bool HasNewerFileMetadata(const std::string& file_id, int64 change_id);
 
@@ -428,10 +434,13 @@ class MetadataDatabase {
   leveldb::Env* env_override_;
   scoped_ptr<leveldb::DB> db_;
 
+  // True if |index_| keeps its indexes on |db_| instead of on memory.
+  bool enable_on_disk_index_;
+
   scoped_ptr<ServiceMetadata> service_metadata_;
   int64 largest_known_change_id_;
 
-  scoped_ptr<MetadataDatabaseIndex> index_;
+  scoped_ptr<MetadataDatabaseIndexInterface> index_;
 
   base::WeakPtrFactory<MetadataDatabase> weak_ptr_factory_;
 
@@ -11,21 +11,6 @@
 namespace sync_file_system {
 namespace drive_backend {
 
-ParentIDAndTitle::ParentIDAndTitle() : parent_id(0) {}
-ParentIDAndTitle::ParentIDAndTitle(int64 parent_id,
-                                   const std::string& title)
-    : parent_id(parent_id), title(title) {}
-
-bool operator==(const ParentIDAndTitle& left, const ParentIDAndTitle& right) {
-  return left.parent_id == right.parent_id && left.title == right.title;
-}
-
-bool operator<(const ParentIDAndTitle& left, const ParentIDAndTitle& right) {
-  if (left.parent_id != right.parent_id)
-    return left.parent_id < right.parent_id;
-  return left.title < right.title;
-}
-
 namespace {
 
 template <typename Container>
@@ -210,6 +195,18 @@ void MetadataDatabaseIndex::PromoteDemotedDirtyTrackers() {
   demoted_dirty_trackers_.clear();
 }
 
+size_t MetadataDatabaseIndex::CountDirtyTracker() const {
+  return dirty_trackers_.size() + demoted_dirty_trackers_.size();
+}
+
+size_t MetadataDatabaseIndex::CountFileMetadata() const {
+  return metadata_by_id_.size();
+}
+
+size_t MetadataDatabaseIndex::CountFileTracker() const {
+  return tracker_by_id_.size();
+}
+
 std::vector<std::string> MetadataDatabaseIndex::GetRegisteredAppIDs() const {
   std::vector<std::string> result;
   result.reserve(app_root_by_app_id_.size());
@@ -219,6 +216,31 @@ std::vector<std::string> MetadataDatabaseIndex::GetRegisteredAppIDs() const {
   return result;
 }
 
+std::vector<int64> MetadataDatabaseIndex::GetAllTrackerIDs() const {
+  std::vector<int64> result;
+  result.reserve(tracker_by_id_.size());
+  for (TrackerByID::const_iterator itr = tracker_by_id_.begin();
+       itr != tracker_by_id_.end(); ++itr)
+    result.push_back(itr->first);
+  return result;
+}
+
+std::vector<std::string> MetadataDatabaseIndex::GetAllMetadataIDs() const {
+  std::vector<std::string> result;
+  result.reserve(metadata_by_id_.size());
+  for (MetadataByID::const_iterator itr = metadata_by_id_.begin();
+       itr != metadata_by_id_.end(); ++itr)
+    result.push_back(itr->first);
+  return result;
+}
+
+void MetadataDatabaseIndex::FlushPendingChanges(leveldb::WriteBatch* batch) {
+  // Everything is kept on memory, and MetadataDatabase writes the entries
+  // themselves.  Nothing to do here.
+}
+
+void MetadataDatabaseIndex::OnChangesWritten() {}
+
 void MetadataDatabaseIndex::AddToAppIDIndex(
     const FileTracker& new_tracker) {
   if (!IsAppRoot(new_tracker))
@@ -0,0 +1,26 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database_index_interface.h"
+
+namespace sync_file_system {
+namespace drive_backend {
+
+ParentIDAndTitle::ParentIDAndTitle() : parent_id(0) {}
+ParentIDAndTitle::ParentIDAndTitle(int64 parent_id,
+                                   const std::string& title)
+    : parent_id(parent_id), title(title) {}
+
+bool operator==(const ParentIDAndTitle& left, const ParentIDAndTitle& right) {
+  return left.parent_id == right.parent_id && left.title == right.title;
+}
+
+bool operator<(const ParentIDAndTitle& left, const ParentIDAndTitle& right) {
+  if (left.parent_id != right.parent_id)
+    return left.parent_id < right.parent_id;
+  return left.title < right.title;
+}
+
+}  // namespace drive_backend
+}  // namespace sync_file_system
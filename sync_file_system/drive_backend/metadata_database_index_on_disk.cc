@@ -0,0 +1,835 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database_index_on_disk.h"
+
+#include "base/bind.h"
+#include "base/format_macros.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/metrics/histogram.h"
+#include "base/stl_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread_restrictions.h"
+#include "chrome/browser/sync_file_system/drive_backend/drive_backend_constants.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database.pb.h"
+#include "chrome/browser/sync_file_system/logger.h"
+#include "third_party/leveldatabase/src/include/leveldb/db.h"
+#include "third_party/leveldatabase/src/include/leveldb/write_batch.h"
+
+// LevelDB database schema of the indexes
+// ======================================
+//
+// NOTE
+// - Tracker IDs in index keys are 16 digit hexadecimal numbers, so that keys
+//   are ordered by tracker ID.
+// - '\0' separates the components of a key.
+//
+// Version of the indexes:
+//   key: "IDX_VERSION"
+//   value: "1"
+//
+// App-root tracker by app ID:
+//   key: "IDX_APP_ROOT: " + <string 'app_id'>
+//   value: <int64 'app_root_tracker_id'>
+//
+// Trackers by file ID:
+//   key: "IDX_FILE_ID: " + <string 'file_id'> + '\0' + <'tracker_id'>
+//   value: "1" for the active tracker, "0" for others.
+//
+// Trackers by parent tracker ID and title:
+//   key: "IDX_PATH: " + <'parent_tracker_id'> + '\0' + <string 'title'> +
+//        '\0' + <'tracker_id'>
+//   value: "1" for the active tracker, "0" for others.
+//
+// File IDs that have multiple trackers:
+//   key: "IDX_MULTI_TRACKER: " + <string 'file_id'>
+//   value: <empty>
+//
+// Paths that have multiple trackers:
+//   key: "IDX_MULTI_PATH: " + <'parent_tracker_id'> + '\0' +
+//        <string 'title'>
+//   value: <empty>
+//
+// Dirty trackers:
+//   key: "IDX_DIRTY: " + <'tracker_id'>
+//   value: <empty>
+
+namespace sync_file_system {
+namespace drive_backend {
+
+namespace {
+
+// The number of entries to keep on memory for each of FileMetadata and
+// FileTracker.
+const size_t kMaxCachedMetadata = 1024;
+const size_t kMaxCachedTrackers = 1024;
+
+const char kIndexKeyPrefix[] = "IDX_";
+const char kIndexVersionKey[] = "IDX_VERSION";
+const char kCurrentIndexVersion[] = "1";
+
+const char kAppRootIDKeyPrefix[] = "IDX_APP_ROOT: ";
+const char kFileIDIndexKeyPrefix[] = "IDX_FILE_ID: ";
+const char kPathIndexKeyPrefix[] = "IDX_PATH: ";
+const char kMultiTrackerKeyPrefix[] = "IDX_MULTI_TRACKER: ";
+const char kMultiBackingPathKeyPrefix[] = "IDX_MULTI_PATH: ";
+const char kDirtyTrackerKeyPrefix[] = "IDX_DIRTY: ";
+
+const char kKeySeparator = '\0';
+const char kActiveTrackerValue[] = "1";
+const char kInactiveTrackerValue[] = "0";
+
+bool IsAppRoot(const FileTracker& tracker) {
+  return tracker.tracker_kind() == TRACKER_KIND_APP_ROOT ||
+      tracker.tracker_kind() == TRACKER_KIND_DISABLED_APP_ROOT;
+}
+
+std::string GetTrackerTitle(const FileTracker& tracker) {
+  if (tracker.has_synced_details())
+    return tracker.synced_details().title();
+  return std::string();
+}
+
+// Returns true if |left| and |right| occupy the same index entries.
+bool HasSameIndexEntries(const FileTracker& left, const FileTracker& right) {
+  return left.active() == right.active() &&
+      left.file_id() == right.file_id() &&
+      left.parent_tracker_id() == right.parent_tracker_id() &&
+      GetTrackerTitle(left) == GetTrackerTitle(right) &&
+      IsAppRoot(left) == IsAppRoot(right) &&
+      left.app_id() == right.app_id();
+}
+
+std::string EncodeTrackerID(int64 tracker_id) {
+  return base::StringPrintf("%016" PRIx64, static_cast<uint64>(tracker_id));
+}
+
+int64 DecodeTrackerID(const std::string& encoded) {
+  uint64 tracker_id = 0;
+  if (!base::HexStringToUInt64(encoded, &tracker_id))
+    return kInvalidTrackerID;
+  return static_cast<int64>(tracker_id);
+}
+
+std::string GenerateMetadataKey(const std::string& file_id) {
+  return kFileMetadataKeyPrefix + file_id;
+}
+
+std::string GenerateTrackerKey(int64 tracker_id) {
+  return kFileTrackerKeyPrefix + base::Int64ToString(tracker_id);
+}
+
+std::string GenerateAppRootIDKey(const std::string& app_id) {
+  return kAppRootIDKeyPrefix + app_id;
+}
+
+std::string GenerateFileIDIndexKeyPrefix(const std::string& file_id) {
+  return kFileIDIndexKeyPrefix + file_id + kKeySeparator;
+}
+
+std::string GeneratePathIndexKeyPrefix(int64 parent_tracker_id) {
+  return kPathIndexKeyPrefix + EncodeTrackerID(parent_tracker_id) +
+      kKeySeparator;
+}
+
+std::string GeneratePathIndexKeyPrefix(int64 parent_tracker_id,
+                                       const std::string& title) {
+  return GeneratePathIndexKeyPrefix(parent_tracker_id) + title +
+      kKeySeparator;
+}
+
+std::string GenerateMultiTrackerKey(const std::string& file_id) {
+  return kMultiTrackerKeyPrefix + file_id;
+}
+
+std::string GenerateMultiBackingPathKey(int64 parent_tracker_id,
+                                        const std::string& title) {
+  return kMultiBackingPathKeyPrefix + EncodeTrackerID(parent_tracker_id) +
+      kKeySeparator + title;
+}
+
+std::string GenerateDirtyTrackerKey(int64 tracker_id) {
+  return kDirtyTrackerKeyPrefix + EncodeTrackerID(tracker_id);
+}
+
+// Returns the tracker ID at the end of an index key.
+int64 ExtractTrackerID(const std::string& key) {
+  size_t separator = key.rfind(kKeySeparator);
+  if (separator == std::string::npos)
+    return kInvalidTrackerID;
+  return DecodeTrackerID(key.substr(separator + 1));
+}
+
+}  // namespace
+
+// static
+scoped_ptr<MetadataDatabaseIndexOnDisk> MetadataDatabaseIndexOnDisk::Create(
+    leveldb::DB* db,
+    DatabaseContents* contents) {
+  base::ThreadRestrictions::AssertIOAllowed();
+  DCHECK(db);
+  DCHECK(contents);
+
+  scoped_ptr<MetadataDatabaseIndexOnDisk> index(
+      new MetadataDatabaseIndexOnDisk(db));
+  std::string version;
+  if (!index->ReadEntry(kIndexVersionKey, &version) ||
+      version != kCurrentIndexVersion) {
+    if (!index->BuildIndexes(contents))
+      return scoped_ptr<MetadataDatabaseIndexOnDisk>();
+  }
+
+  for (size_t i = 0; i < contents->file_trackers.size(); ++i) {
+    if (contents->file_trackers[i]->dirty())
+      ++index->num_dirty_trackers_;
+  }
+  index->num_metadata_ = contents->file_metadata.size();
+  index->num_trackers_ = contents->file_trackers.size();
+
+  UMA_HISTOGRAM_COUNTS("SyncFileSystem.MetadataNumber", index->num_metadata_);
+  UMA_HISTOGRAM_COUNTS("SyncFileSystem.TrackerNumber", index->num_trackers_);
+  UMA_HISTOGRAM_COUNTS_100("SyncFileSystem.RegisteredAppNumber",
+                           index->GetRegisteredAppIDs().size());
+  return index.Pass();
+}
+
+// static
+void MetadataDatabaseIndexOnDisk::InvalidateIndexes(
+    leveldb::WriteBatch* batch) {
+  batch->Delete(kIndexVersionKey);
+}
+
+MetadataDatabaseIndexOnDisk::MetadataDatabaseIndexOnDisk(leveldb::DB* db)
+    : db_(db),
+      num_flushes_(0),
+      metadata_cache_(MetadataCache::NO_AUTO_EVICT),
+      tracker_cache_(TrackerCache::NO_AUTO_EVICT),
+      num_metadata_(0),
+      num_trackers_(0),
+      num_dirty_trackers_(0),
+      has_pending_deletion_(false),
+      weak_ptr_factory_(this) {}
+
+MetadataDatabaseIndexOnDisk::~MetadataDatabaseIndexOnDisk() {}
+
+const FileMetadata* MetadataDatabaseIndexOnDisk::GetFileMetadata(
+    const std::string& file_id) const {
+  MetadataCache::iterator found = metadata_cache_.Get(file_id);
+  if (found != metadata_cache_.end())
+    return found->second.get();
+
+  std::string value;
+  if (!ReadEntry(GenerateMetadataKey(file_id), &value))
+    return NULL;
+
+  linked_ptr<FileMetadata> metadata(new FileMetadata);
+  if (!metadata->ParseFromString(value)) {
+    util::Log(logging::LOG_WARNING, FROM_HERE,
+              "Failed to parse a FileMetadata");
+    return NULL;
+  }
+  metadata_cache_.Put(file_id, metadata);
+  ShrinkCaches();
+  return metadata.get();
+}
+
+const FileTracker* MetadataDatabaseIndexOnDisk::GetFileTracker(
+    int64 tracker_id) const {
+  TrackerCache::iterator found = tracker_cache_.Get(tracker_id);
+  if (found != tracker_cache_.end())
+    return found->second.get();
+
+  std::string value;
+  if (!ReadEntry(GenerateTrackerKey(tracker_id), &value))
+    return NULL;
+
+  linked_ptr<FileTracker> tracker(new FileTracker);
+  if (!tracker->ParseFromString(value)) {
+    util::Log(logging::LOG_WARNING, FROM_HERE,
+              "Failed to parse a Tracker");
+    return NULL;
+  }
+  tracker_cache_.Put(tracker_id, tracker);
+  ShrinkCaches();
+  return tracker.get();
+}
+
+void MetadataDatabaseIndexOnDisk::StoreFileMetadata(
+    scoped_ptr<FileMetadata> metadata) {
+  if (!metadata) {
+    NOTREACHED();
+    return;
+  }
+
+  std::string file_id = metadata->file_id();
+  if (!GetFileMetadata(file_id))
+    ++num_metadata_;
+
+  // MetadataDatabase writes the entry itself.
+  std::string value;
+  bool success = metadata->SerializeToString(&value);
+  DCHECK(success);
+  PutEntry(GenerateMetadataKey(file_id), value);
+
+  MetadataCache::iterator found = metadata_cache_.Peek(file_id);
+  if (found != metadata_cache_.end()) {
+    evicted_metadata_.push_back(found->second);
+    metadata_cache_.Erase(found);
+  }
+  metadata_cache_.Put(file_id, make_linked_ptr(metadata.release()));
+  ShrinkCaches();
+}
+
+void MetadataDatabaseIndexOnDisk::StoreFileTracker(
+    scoped_ptr<FileTracker> tracker) {
+  if (!tracker) {
+    NOTREACHED();
+    return;
+  }
+
+  int64 tracker_id = tracker->tracker_id();
+  const FileTracker* old_tracker = GetFileTracker(tracker_id);
+
+  if (!old_tracker) {
+    DVLOG(3) << "Adding new tracker: " << tracker->tracker_id()
+             << " " << GetTrackerTitle(*tracker);
+
+    ++num_trackers_;
+    AddToIndexes(*tracker);
+    if (tracker->dirty()) {
+      PutEntry(GenerateDirtyTrackerKey(tracker_id), std::string());
+      ++num_dirty_trackers_;
+    }
+  } else {
+    DVLOG(3) << "Updating tracker: " << tracker->tracker_id()
+             << " " << GetTrackerTitle(*tracker);
+
+    if (!HasSameIndexEntries(*old_tracker, *tracker)) {
+      RemoveFromIndexes(*old_tracker);
+      AddToIndexes(*tracker);
+    }
+
+    if (old_tracker->dirty() && !tracker->dirty()) {
+      DeleteEntry(GenerateDirtyTrackerKey(tracker_id));
+      demoted_dirty_trackers_.erase(tracker_id);
+      --num_dirty_trackers_;
+    } else if (!old_tracker->dirty() && tracker->dirty()) {
+      PutEntry(GenerateDirtyTrackerKey(tracker_id), std::string());
+      ++num_dirty_trackers_;
+    }
+
+    // |old_tracker| stays valid until DeleteEvictedEntries() runs.
+    TrackerCache::iterator found = tracker_cache_.Peek(tracker_id);
+    DCHECK(found != tracker_cache_.end());
+    evicted_trackers_.push_back(found->second);
+    tracker_cache_.Erase(found);
+  }
+
+  // MetadataDatabase writes the entry itself.
+  std::string value;
+  bool success = tracker->SerializeToString(&value);
+  DCHECK(success);
+  PutEntry(GenerateTrackerKey(tracker_id), value);
+
+  tracker_cache_.Put(tracker_id, make_linked_ptr(tracker.release()));
+  ShrinkCaches();
+}
+
+void MetadataDatabaseIndexOnDisk::RemoveFileMetadata(
+    const std::string& file_id) {
+  if (GetFileMetadata(file_id)) {
+    --num_metadata_;
+    DeleteEntry(GenerateMetadataKey(file_id));
+  }
+
+  MetadataCache::iterator found = metadata_cache_.Peek(file_id);
+  if (found != metadata_cache_.end()) {
+    evicted_metadata_.push_back(found->second);
+    metadata_cache_.Erase(found);
+    ShrinkCaches();
+  }
+}
+
+void MetadataDatabaseIndexOnDisk::RemoveFileTracker(int64 tracker_id) {
+  const FileTracker* tracker = GetFileTracker(tracker_id);
+  if (!tracker) {
+    NOTREACHED();
+    return;
+  }
+
+  DVLOG(3) << "Removing tracker: "
+           << tracker->tracker_id() << " " << GetTrackerTitle(*tracker);
+
+  RemoveFromIndexes(*tracker);
+  if (tracker->dirty()) {
+    DeleteEntry(GenerateDirtyTrackerKey(tracker_id));
+    demoted_dirty_trackers_.erase(tracker_id);
+    --num_dirty_trackers_;
+  }
+
+  --num_trackers_;
+  DeleteEntry(GenerateTrackerKey(tracker_id));
+
+  TrackerCache::iterator found = tracker_cache_.Peek(tracker_id);
+  DCHECK(found != tracker_cache_.end());
+  evicted_trackers_.push_back(found->second);
+  tracker_cache_.Erase(found);
+  ShrinkCaches();
+}
+
+TrackerIDSet MetadataDatabaseIndexOnDisk::GetFileTrackerIDsByFileID(
+    const std::string& file_id) const {
+  return ReadTrackerIDSet(GenerateFileIDIndexKeyPrefix(file_id));
+}
+
+int64 MetadataDatabaseIndexOnDisk::GetAppRootTracker(
+    const std::string& app_id) const {
+  std::string value;
+  int64 tracker_id = kInvalidTrackerID;
+  if (!ReadEntry(GenerateAppRootIDKey(app_id), &value) ||
+      !base::StringToInt64(value, &tracker_id))
+    return kInvalidTrackerID;
+  return tracker_id;
+}
+
+TrackerIDSet MetadataDatabaseIndexOnDisk::GetFileTrackerIDsByParentAndTitle(
+    int64 parent_tracker_id,
+    const std::string& title) const {
+  return ReadTrackerIDSet(GeneratePathIndexKeyPrefix(parent_tracker_id, title));
+}
+
+std::vector<int64> MetadataDatabaseIndexOnDisk::GetFileTrackerIDsByParent(
+    int64 parent_tracker_id) const {
+  std::vector<std::string> keys;
+  ReadKeysWithPrefix(GeneratePathIndexKeyPrefix(parent_tracker_id), &keys);
+
+  std::vector<int64> result;
+  result.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+    result.push_back(ExtractTrackerID(keys[i]));
+  return result;
+}
+
+std::string MetadataDatabaseIndexOnDisk::PickMultiTrackerFileID() const {
+  std::string key;
+  if (!FindFirstKey(kMultiTrackerKeyPrefix, kMultiTrackerKeyPrefix, &key))
+    return std::string();
+  return key.substr(arraysize(kMultiTrackerKeyPrefix) - 1);
+}
+
+ParentIDAndTitle MetadataDatabaseIndexOnDisk::PickMultiBackingFilePath() const {
+  std::string key;
+  if (!FindFirstKey(kMultiBackingPathKeyPrefix, kMultiBackingPathKeyPrefix,
+                    &key))
+    return ParentIDAndTitle(kInvalidTrackerID, std::string());
+
+  std::string path = key.substr(arraysize(kMultiBackingPathKeyPrefix) - 1);
+  size_t separator = path.find(kKeySeparator);
+  if (separator == std::string::npos) {
+    NOTREACHED();
+    return ParentIDAndTitle(kInvalidTrackerID, std::string());
+  }
+  return ParentIDAndTitle(DecodeTrackerID(path.substr(0, separator)),
+                          path.substr(separator + 1));
+}
+
+int64 MetadataDatabaseIndexOnDisk::PickDirtyTracker() const {
+  std::string start = kDirtyTrackerKeyPrefix;
+  std::string key;
+  while (FindFirstKey(kDirtyTrackerKeyPrefix, start, &key)) {
+    int64 tracker_id = DecodeTrackerID(
+        key.substr(arraysize(kDirtyTrackerKeyPrefix) - 1));
+    if (!ContainsKey(demoted_dirty_trackers_, tracker_id))
+      return tracker_id;
+
+    // Appending the separator gives the smallest key that follows |key|.
+    start = key + kKeySeparator;
+  }
+  return kInvalidTrackerID;
+}
+
+void MetadataDatabaseIndexOnDisk::DemoteDirtyTracker(int64 tracker_id) {
+  std::string value;
+  if (ReadEntry(GenerateDirtyTrackerKey(tracker_id), &value))
+    demoted_dirty_trackers_.insert(tracker_id);
+}
+
+bool MetadataDatabaseIndexOnDisk::HasDemotedDirtyTracker() const {
+  return !demoted_dirty_trackers_.empty();
+}
+
+void MetadataDatabaseIndexOnDisk::PromoteDemotedDirtyTrackers() {
+  demoted_dirty_trackers_.clear();
+}
+
+size_t MetadataDatabaseIndexOnDisk::CountDirtyTracker() const {
+  return num_dirty_trackers_;
+}
+
+size_t MetadataDatabaseIndexOnDisk::CountFileMetadata() const {
+  return num_metadata_;
+}
+
+size_t MetadataDatabaseIndexOnDisk::CountFileTracker() const {
+  return num_trackers_;
+}
+
+std::vector<std::string>
+MetadataDatabaseIndexOnDisk::GetRegisteredAppIDs() const {
+  std::vector<std::string> keys;
+  ReadKeysWithPrefix(kAppRootIDKeyPrefix, &keys);
+
+  std::vector<std::string> result;
+  result.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+    result.push_back(keys[i].substr(arraysize(kAppRootIDKeyPrefix) - 1));
+  return result;
+}
+
+std::vector<int64> MetadataDatabaseIndexOnDisk::GetAllTrackerIDs() const {
+  std::vector<std::string> keys;
+  ReadKeysWithPrefix(kFileTrackerKeyPrefix, &keys);
+
+  std::vector<int64> result;
+  result.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    int64 tracker_id = kInvalidTrackerID;
+    if (base::StringToInt64(
+            keys[i].substr(std::string(kFileTrackerKeyPrefix).size()),
+            &tracker_id))
+      result.push_back(tracker_id);
+  }
+  return result;
+}
+
+std::vector<std::string>
+MetadataDatabaseIndexOnDisk::GetAllMetadataIDs() const {
+  std::vector<std::string> keys;
+  ReadKeysWithPrefix(kFileMetadataKeyPrefix, &keys);
+
+  std::vector<std::string> result;
+  result.reserve(keys.size());
+  size_t prefix_size = std::string(kFileMetadataKeyPrefix).size();
+  for (size_t i = 0; i < keys.size(); ++i)
+    result.push_back(keys[i].substr(prefix_size));
+  return result;
+}
+
+void MetadataDatabaseIndexOnDisk::FlushPendingChanges(
+    leveldb::WriteBatch* batch) {
+  DCHECK(batch);
+
+  // MetadataDatabase writes the FileMetadata and FileTracker entries.
+  for (std::set<std::string>::const_iterator itr = unflushed_keys_.begin();
+       itr != unflushed_keys_.end(); ++itr) {
+    if (!StartsWithASCII(*itr, kIndexKeyPrefix, true))
+      continue;
+    const UnwrittenEntry& entry = unwritten_entries_[*itr];
+    if (entry.deleted)
+      batch->Delete(*itr);
+    else
+      batch->Put(*itr, entry.value);
+  }
+
+  unwritten_flushes_.push_back(std::vector<std::string>(
+      unflushed_keys_.begin(), unflushed_keys_.end()));
+  unflushed_keys_.clear();
+  ++num_flushes_;
+}
+
+void MetadataDatabaseIndexOnDisk::OnChangesWritten() {
+  if (unwritten_flushes_.empty()) {
+    NOTREACHED();
+    return;
+  }
+
+  // Changes made after the written flush override the database until their
+  // own batch is written.
+  size_t written_flush_count = num_flushes_ - unwritten_flushes_.size();
+  const std::vector<std::string>& keys = unwritten_flushes_.front();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    UnwrittenEntries::iterator found = unwritten_entries_.find(keys[i]);
+    if (found != unwritten_entries_.end() &&
+        found->second.flush_count == written_flush_count)
+      unwritten_entries_.erase(found);
+  }
+  unwritten_flushes_.pop_front();
+}
+
+bool MetadataDatabaseIndexOnDisk::BuildIndexes(DatabaseContents* contents) {
+  // Drop stale entries left by a previous build.
+  std::vector<std::string> stale_keys;
+  ReadKeysWithPrefix(kIndexKeyPrefix, &stale_keys);
+  for (size_t i = 0; i < stale_keys.size(); ++i)
+    DeleteEntry(stale_keys[i]);
+
+  for (size_t i = 0; i < contents->file_trackers.size(); ++i) {
+    const FileTracker& tracker = *contents->file_trackers[i];
+    AddToIndexes(tracker);
+    if (tracker.dirty())
+      PutEntry(GenerateDirtyTrackerKey(tracker.tracker_id()), std::string());
+  }
+  PutEntry(kIndexVersionKey, kCurrentIndexVersion);
+  return WriteIndexes();
+}
+
+bool MetadataDatabaseIndexOnDisk::WriteIndexes() {
+  leveldb::WriteBatch batch;
+  FlushPendingChanges(&batch);
+  leveldb::Status status = db_->Write(leveldb::WriteOptions(), &batch);
+  OnChangesWritten();
+  if (!status.ok()) {
+    util::Log(logging::LOG_WARNING, FROM_HERE,
+              "Failed to build indexes: %s", status.ToString().c_str());
+    return false;
+  }
+  return true;
+}
+
+void MetadataDatabaseIndexOnDisk::AddToIndexes(const FileTracker& tracker) {
+  int64 tracker_id = tracker.tracker_id();
+  std::string active_value =
+      tracker.active() ? kActiveTrackerValue : kInactiveTrackerValue;
+
+  if (IsAppRoot(tracker)) {
+    DCHECK(tracker.active());
+    PutEntry(GenerateAppRootIDKey(tracker.app_id()),
+             base::Int64ToString(tracker_id));
+  }
+
+  std::string file_id_prefix = GenerateFileIDIndexKeyPrefix(tracker.file_id());
+  PutEntry(file_id_prefix + EncodeTrackerID(tracker_id), active_value);
+  if (HasMultipleEntriesWithPrefix(file_id_prefix))
+    PutEntry(GenerateMultiTrackerKey(tracker.file_id()), std::string());
+
+  int64 parent = tracker.parent_tracker_id();
+  std::string title = GetTrackerTitle(tracker);
+  std::string path_prefix = GeneratePathIndexKeyPrefix(parent, title);
+  PutEntry(path_prefix + EncodeTrackerID(tracker_id), active_value);
+  if (HasMultipleEntriesWithPrefix(path_prefix))
+    PutEntry(GenerateMultiBackingPathKey(parent, title), std::string());
+}
+
+void MetadataDatabaseIndexOnDisk::RemoveFromIndexes(
+    const FileTracker& tracker) {
+  int64 tracker_id = tracker.tracker_id();
+
+  if (IsAppRoot(tracker))
+    DeleteEntry(GenerateAppRootIDKey(tracker.app_id()));
+
+  std::string file_id_prefix = GenerateFileIDIndexKeyPrefix(tracker.file_id());
+  DeleteEntry(file_id_prefix + EncodeTrackerID(tracker_id));
+  if (!HasMultipleEntriesWithPrefix(file_id_prefix))
+    DeleteEntry(GenerateMultiTrackerKey(tracker.file_id()));
+
+  int64 parent = tracker.parent_tracker_id();
+  std::string title = GetTrackerTitle(tracker);
+  std::string path_prefix = GeneratePathIndexKeyPrefix(parent, title);
+  DeleteEntry(path_prefix + EncodeTrackerID(tracker_id));
+  if (!HasMultipleEntriesWithPrefix(path_prefix))
+    DeleteEntry(GenerateMultiBackingPathKey(parent, title));
+}
+
+TrackerIDSet MetadataDatabaseIndexOnDisk::ReadTrackerIDSet(
+    const std::string& prefix) const {
+  Entries entries;
+  ReadEntriesWithPrefix(prefix, &entries);
+
+  TrackerIDSet trackers;
+  for (Entries::const_iterator itr = entries.begin();
+       itr != entries.end(); ++itr) {
+    int64 tracker_id = ExtractTrackerID(itr->first);
+    if (itr->second == kActiveTrackerValue)
+      trackers.InsertActiveTracker(tracker_id);
+    else
+      trackers.InsertInactiveTracker(tracker_id);
+  }
+  return trackers;
+}
+
+void MetadataDatabaseIndexOnDisk::ShrinkCaches() const {
+  while (metadata_cache_.size() > kMaxCachedMetadata) {
+    MetadataCache::reverse_iterator oldest = metadata_cache_.rbegin();
+    evicted_metadata_.push_back(oldest->second);
+    metadata_cache_.Erase(oldest);
+  }
+  while (tracker_cache_.size() > kMaxCachedTrackers) {
+    TrackerCache::reverse_iterator oldest = tracker_cache_.rbegin();
+    evicted_trackers_.push_back(oldest->second);
+    tracker_cache_.Erase(oldest);
+  }
+
+  if (has_pending_deletion_ ||
+      (evicted_metadata_.empty() && evicted_trackers_.empty()))
+    return;
+  has_pending_deletion_ = true;
+  base::MessageLoopProxy::current()->PostTask(
+      FROM_HERE,
+      base::Bind(&MetadataDatabaseIndexOnDisk::DeleteEvictedEntries,
+                 weak_ptr_factory_.GetWeakPtr()));
+}
+
+void MetadataDatabaseIndexOnDisk::DeleteEvictedEntries() {
+  has_pending_deletion_ = false;
+  evicted_metadata_.clear();
+  evicted_trackers_.clear();
+}
+
+bool MetadataDatabaseIndexOnDisk::ReadEntry(const std::string& key,
+                                            std::string* value) const {
+  UnwrittenEntries::const_iterator found = unwritten_entries_.find(key);
+  if (found != unwritten_entries_.end()) {
+    if (found->second.deleted)
+      return false;
+    *value = found->second.value;
+    return true;
+  }
+
+  leveldb::Status status = db_->Get(leveldb::ReadOptions(), key, value);
+  if (!status.ok() && !status.IsNotFound()) {
+    util::Log(logging::LOG_WARNING, FROM_HERE,
+              "Failed to read an entry: %s", status.ToString().c_str());
+  }
+  return status.ok();
+}
+
+void MetadataDatabaseIndexOnDisk::ReadEntriesWithPrefix(
+    const std::string& prefix,
+    Entries* entries) const {
+  ScanEntries(prefix, 0, true, entries);
+}
+
+void MetadataDatabaseIndexOnDisk::ReadKeysWithPrefix(
+    const std::string& prefix,
+    std::vector<std::string>* keys) const {
+  DCHECK(keys);
+  Entries entries;
+  ScanEntries(prefix, 0, false, &entries);
+
+  keys->clear();
+  keys->reserve(entries.size());
+  for (Entries::const_iterator itr = entries.begin();
+       itr != entries.end(); ++itr)
+    keys->push_back(itr->first);
+}
+
+bool MetadataDatabaseIndexOnDisk::HasMultipleEntriesWithPrefix(
+    const std::string& prefix) const {
+  Entries entries;
+  ScanEntries(prefix, 2, false, &entries);
+  return entries.size() > 1;
+}
+
+bool MetadataDatabaseIndexOnDisk::FindFirstKey(const std::string& prefix,
+                                               const std::string& start,
+                                               std::string* key) const {
+  DCHECK(key);
+  DCHECK(StartsWithASCII(start, prefix, true));
+
+  // The first key in the database that is not deleted yet.
+  std::string stored_key;
+  scoped_ptr<leveldb::Iterator> itr(db_->NewIterator(leveldb::ReadOptions()));
+  for (itr->Seek(start); itr->Valid(); itr->Next()) {
+    std::string found = itr->key().ToString();
+    if (!StartsWithASCII(found, prefix, true))
+      break;
+    UnwrittenEntries::const_iterator unwritten =
+        unwritten_entries_.find(found);
+    if (unwritten == unwritten_entries_.end() || !unwritten->second.deleted) {
+      stored_key = found;
+      break;
+    }
+  }
+
+  // The first key that is not written yet.
+  std::string unwritten_key;
+  for (UnwrittenEntries::const_iterator unwritten =
+           unwritten_entries_.lower_bound(start);
+       unwritten != unwritten_entries_.end() &&
+           StartsWithASCII(unwritten->first, prefix, true);
+       ++unwritten) {
+    if (!unwritten->second.deleted) {
+      unwritten_key = unwritten->first;
+      break;
+    }
+  }
+
+  if (stored_key.empty() && unwritten_key.empty())
+    return false;
+  if (stored_key.empty() ||
+      (!unwritten_key.empty() && unwritten_key < stored_key))
+    *key = unwritten_key;
+  else
+    *key = stored_key;
+  return true;
+}
+
+void MetadataDatabaseIndexOnDisk::PutEntry(const std::string& key,
+                                           const std::string& value) {
+  UnwrittenEntry& entry = unwritten_entries_[key];
+  entry.value = value;
+  entry.deleted = false;
+  entry.flush_count = num_flushes_;
+  unflushed_keys_.insert(key);
+}
+
+void MetadataDatabaseIndexOnDisk::DeleteEntry(const std::string& key) {
+  UnwrittenEntry& entry = unwritten_entries_[key];
+  entry.value.clear();
+  entry.deleted = true;
+  entry.flush_count = num_flushes_;
+  unflushed_keys_.insert(key);
+}
+
+void MetadataDatabaseIndexOnDisk::ScanEntries(const std::string& prefix,
+                                              size_t max_entries,
+                                              bool read_values,
+                                              Entries* entries) const {
+  DCHECK(entries);
+  entries->clear();
+
+  // Unwritten deletions may hide entries read from the database, so that many
+  // more are read to return |max_entries|.
+  UnwrittenEntries::const_iterator unwritten_begin =
+      unwritten_entries_.lower_bound(prefix);
+  size_t num_deleted = 0;
+  for (UnwrittenEntries::const_iterator unwritten = unwritten_begin;
+       unwritten != unwritten_entries_.end() &&
+           StartsWithASCII(unwritten->first, prefix, true);
+       ++unwritten) {
+    if (unwritten->second.deleted)
+      ++num_deleted;
+  }
+
+  scoped_ptr<leveldb::Iterator> itr(db_->NewIterator(leveldb::ReadOptions()));
+  for (itr->Seek(prefix); itr->Valid(); itr->Next()) {
+    if (max_entries && entries->size() >= max_entries + num_deleted)
+      break;
+    std::string key = itr->key().ToString();
+    if (!StartsWithASCII(key, prefix, true))
+      break;
+    (*entries)[key] = read_values ? itr->value().ToString() : std::string();
+  }
+  if (!itr->status().ok()) {
+    util::Log(logging::LOG_WARNING, FROM_HERE,
+              "Failed to read entries: %s", itr->status().ToString().c_str());
+  }
+
+  for (UnwrittenEntries::const_iterator unwritten = unwritten_begin;
+       unwritten != unwritten_entries_.end() &&
+           StartsWithASCII(unwritten->first, prefix, true);
+       ++unwritten) {
+    if (unwritten->second.deleted)
+      entries->erase(unwritten->first);
+    else
+      (*entries)[unwritten->first] =
+          read_values ? unwritten->second.value : std::string();
+  }
+}
+
+}  // namespace drive_backend
+}  // namespace sync_file_system
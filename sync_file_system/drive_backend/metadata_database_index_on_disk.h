@@ -0,0 +1,182 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_SYNC_FILE_SYSTEM_DRIVE_BACKEND_METADATA_DATABASE_INDEX_ON_DISK_H_
+#define CHROME_BROWSER_SYNC_FILE_SYSTEM_DRIVE_BACKEND_METADATA_DATABASE_INDEX_ON_DISK_H_
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/containers/mru_cache.h"
+#include "base/memory/linked_ptr.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database_index_interface.h"
+
+namespace leveldb {
+class DB;
+class WriteBatch;
+}
+
+namespace sync_file_system {
+namespace drive_backend {
+
+class FileMetadata;
+class FileTracker;
+struct DatabaseContents;
+
+// Maintains indexes of MetadataDatabase as key ranges in the LevelDB database
+// that holds the entries themselves, so that they are not rebuilt on every
+// startup.
+//
+// Only the most recently used FileMetadata and FileTracker are kept decoded on
+// memory, along with the changes that are not written to the database yet.
+// Everything else, including the index key ranges, is read from the database
+// on demand, on the calling thread.  Index changes are written out together
+// with the batch of MetadataDatabase (see FlushPendingChanges()), which writes
+// the entries themselves.
+class MetadataDatabaseIndexOnDisk : public MetadataDatabaseIndexInterface {
+ public:
+  // Returns NULL if the indexes couldn't be loaded nor rebuilt.  |contents| is
+  // only used to rebuild the indexes and to count the entries.  Must be called
+  // on a thread that allows IO.
+  static scoped_ptr<MetadataDatabaseIndexOnDisk> Create(
+      leveldb::DB* db,
+      DatabaseContents* contents);
+
+  // Marks the on-disk indexes as stale so that the next Create() rebuilds
+  // them.  This must be called whenever the database is modified without
+  // going through this class.
+  static void InvalidateIndexes(leveldb::WriteBatch* batch);
+
+  virtual ~MetadataDatabaseIndexOnDisk();
+
+  // MetadataDatabaseIndexInterface overrides.
+  virtual const FileMetadata* GetFileMetadata(
+      const std::string& file_id) const OVERRIDE;
+  virtual const FileTracker* GetFileTracker(int64 tracker_id) const OVERRIDE;
+  virtual void StoreFileMetadata(scoped_ptr<FileMetadata> metadata) OVERRIDE;
+  virtual void StoreFileTracker(scoped_ptr<FileTracker> tracker) OVERRIDE;
+  virtual void RemoveFileMetadata(const std::string& file_id) OVERRIDE;
+  virtual void RemoveFileTracker(int64 tracker_id) OVERRIDE;
+  virtual TrackerIDSet GetFileTrackerIDsByFileID(
+      const std::string& file_id) const OVERRIDE;
+  virtual int64 GetAppRootTracker(const std::string& app_id) const OVERRIDE;
+  virtual TrackerIDSet GetFileTrackerIDsByParentAndTitle(
+      int64 parent_tracker_id,
+      const std::string& title) const OVERRIDE;
+  virtual std::vector<int64> GetFileTrackerIDsByParent(
+      int64 parent_tracker_id) const OVERRIDE;
+  virtual std::string PickMultiTrackerFileID() const OVERRIDE;
+  virtual ParentIDAndTitle PickMultiBackingFilePath() const OVERRIDE;
+  virtual int64 PickDirtyTracker() const OVERRIDE;
+  virtual void DemoteDirtyTracker(int64 tracker_id) OVERRIDE;
+  virtual bool HasDemotedDirtyTracker() const OVERRIDE;
+  virtual void PromoteDemotedDirtyTrackers() OVERRIDE;
+  virtual size_t CountDirtyTracker() const OVERRIDE;
+  virtual size_t CountFileMetadata() const OVERRIDE;
+  virtual size_t CountFileTracker() const OVERRIDE;
+  virtual std::vector<std::string> GetRegisteredAppIDs() const OVERRIDE;
+  virtual std::vector<int64> GetAllTrackerIDs() const OVERRIDE;
+  virtual std::vector<std::string> GetAllMetadataIDs() const OVERRIDE;
+  virtual void FlushPendingChanges(leveldb::WriteBatch* batch) OVERRIDE;
+  virtual void OnChangesWritten() OVERRIDE;
+
+ private:
+  typedef base::MRUCache<std::string, linked_ptr<FileMetadata> >
+      MetadataCache;
+  typedef base::MRUCache<int64, linked_ptr<FileTracker> > TrackerCache;
+  typedef std::map<std::string, std::string> Entries;
+
+  // A change to an entry of the database that may not be written yet.
+  struct UnwrittenEntry {
+    UnwrittenEntry() : deleted(false), flush_count(0) {}
+
+    std::string value;
+    bool deleted;
+
+    // The number of FlushPendingChanges() calls made before the change.
+    size_t flush_count;
+  };
+  typedef std::map<std::string, UnwrittenEntry> UnwrittenEntries;
+
+  explicit MetadataDatabaseIndexOnDisk(leveldb::DB* db);
+
+  bool BuildIndexes(DatabaseContents* contents);
+  bool WriteIndexes();
+
+  // Maintains the app-root, file ID and path indexes.  The dirty tracker index
+  // is maintained by the callers since demotion has to survive updates.
+  void AddToIndexes(const FileTracker& tracker);
+  void RemoveFromIndexes(const FileTracker& tracker);
+
+  TrackerIDSet ReadTrackerIDSet(const std::string& prefix) const;
+
+  // Keeps the decoded entries within the cache limits.  Entries dropped from
+  // the caches are only deleted by a posted task, since callers may still
+  // hold pointers to them.
+  void ShrinkCaches() const;
+  void DeleteEvictedEntries();
+
+  // Low level accessors of the database, which see the unwritten changes.
+  // Only the index keys changed by PutEntry() and DeleteEntry() are written
+  // out by FlushPendingChanges().
+  bool ReadEntry(const std::string& key, std::string* value) const;
+  void ReadEntriesWithPrefix(const std::string& prefix, Entries* entries) const;
+  void ReadKeysWithPrefix(const std::string& prefix,
+                          std::vector<std::string>* keys) const;
+  bool HasMultipleEntriesWithPrefix(const std::string& prefix) const;
+  bool FindFirstKey(const std::string& prefix,
+                    const std::string& start,
+                    std::string* key) const;
+  void PutEntry(const std::string& key, const std::string& value);
+  void DeleteEntry(const std::string& key);
+
+  // Reads at most |max_entries| entries whose key starts with |prefix|, or
+  // all of them if |max_entries| is 0.  Values are only read if
+  // |read_values|.
+  void ScanEntries(const std::string& prefix,
+                   size_t max_entries,
+                   bool read_values,
+                   Entries* entries) const;
+
+  leveldb::DB* db_;  // Not owned.
+
+  // The changes made since the batch holding them was written, keyed as in
+  // the database.
+  UnwrittenEntries unwritten_entries_;
+
+  // The keys changed since the last FlushPendingChanges(), and the keys
+  // flushed by each call whose batch is not written yet, oldest first.
+  std::set<std::string> unflushed_keys_;
+  std::deque<std::vector<std::string> > unwritten_flushes_;
+  size_t num_flushes_;
+
+  mutable MetadataCache metadata_cache_;
+  mutable TrackerCache tracker_cache_;
+  mutable std::vector<linked_ptr<FileMetadata> > evicted_metadata_;
+  mutable std::vector<linked_ptr<FileTracker> > evicted_trackers_;
+
+  // Demotion is not persisted, as with MetadataDatabaseIndex.
+  std::set<int64> demoted_dirty_trackers_;
+
+  size_t num_metadata_;
+  size_t num_trackers_;
+  size_t num_dirty_trackers_;
+
+  // True while DeleteEvictedEntries() is posted.
+  mutable bool has_pending_deletion_;
+
+  mutable base::WeakPtrFactory<MetadataDatabaseIndexOnDisk> weak_ptr_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetadataDatabaseIndexOnDisk);
+};
+
+}  // namespace drive_backend
+}  // namespace sync_file_system
+
+#endif  // CHROME_BROWSER_SYNC_FILE_SYSTEM_DRIVE_BACKEND_METADATA_DATABASE_INDEX_ON_DISK_H_
@@ -0,0 +1,419 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database_index_on_disk.h"
+
+#include "base/files/scoped_temp_dir.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "chrome/browser/sync_file_system/drive_backend/drive_backend_constants.h"
+#include "chrome/browser/sync_file_system/drive_backend/drive_backend_util.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database.pb.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/leveldatabase/src/helpers/memenv/memenv.h"
+#include "third_party/leveldatabase/src/include/leveldb/db.h"
+#include "third_party/leveldatabase/src/include/leveldb/env.h"
+#include "third_party/leveldatabase/src/include/leveldb/write_batch.h"
+
+namespace sync_file_system {
+namespace drive_backend {
+
+namespace {
+
+const int64 kSyncRootTrackerID = 1;
+const int64 kAppRootTrackerID = 2;
+const int64 kFileTrackerID = 3;
+const int64 kPlaceholderTrackerID = 4;
+
+scoped_ptr<FileMetadata> CreateFolderMetadata(const std::string& file_id,
+                                              const std::string& title) {
+  FileDetails details;
+  details.set_title(title);
+  details.set_file_kind(FILE_KIND_FOLDER);
+  details.set_missing(false);
+
+  scoped_ptr<FileMetadata> metadata(new FileMetadata);
+  metadata->set_file_id(file_id);
+  *metadata->mutable_details() = details;
+
+  return metadata.Pass();
+}
+
+scoped_ptr<FileMetadata> CreateFileMetadata(const std::string& file_id,
+                                            const std::string& title,
+                                            const std::string& md5) {
+  FileDetails details;
+  details.set_title(title);
+  details.set_file_kind(FILE_KIND_FILE);
+  details.set_missing(false);
+  details.set_md5(md5);
+
+  scoped_ptr<FileMetadata> metadata(new FileMetadata);
+  metadata->set_file_id(file_id);
+  *metadata->mutable_details() = details;
+
+  return metadata.Pass();
+}
+
+scoped_ptr<FileTracker> CreateTracker(const FileMetadata& metadata,
+                                      int64 tracker_id,
+                                      const FileTracker* parent_tracker) {
+  scoped_ptr<FileTracker> tracker(new FileTracker);
+  tracker->set_tracker_id(tracker_id);
+  if (parent_tracker)
+    tracker->set_parent_tracker_id(parent_tracker->tracker_id());
+  tracker->set_file_id(metadata.file_id());
+  if (parent_tracker)
+    tracker->set_app_id(parent_tracker->app_id());
+  tracker->set_tracker_kind(TRACKER_KIND_REGULAR);
+  *tracker->mutable_synced_details() = metadata.details();
+  tracker->set_dirty(false);
+  tracker->set_active(true);
+  tracker->set_needs_folder_listing(false);
+  return tracker.Pass();
+}
+
+scoped_ptr<FileTracker> CreatePlaceholderTracker(
+    const std::string& file_id,
+    int64 tracker_id,
+    const FileTracker* parent_tracker) {
+  scoped_ptr<FileTracker> tracker(new FileTracker);
+  tracker->set_tracker_id(tracker_id);
+  if (parent_tracker)
+    tracker->set_parent_tracker_id(parent_tracker->tracker_id());
+  tracker->set_file_id(file_id);
+  if (parent_tracker)
+    tracker->set_app_id(parent_tracker->app_id());
+  tracker->set_tracker_kind(TRACKER_KIND_REGULAR);
+  tracker->set_dirty(true);
+  tracker->set_active(false);
+  tracker->set_needs_folder_listing(false);
+  return tracker.Pass();
+}
+
+scoped_ptr<DatabaseContents> CreateTestDatabaseContents() {
+  scoped_ptr<DatabaseContents> contents(new DatabaseContents);
+
+  scoped_ptr<FileMetadata> sync_root_metadata =
+      CreateFolderMetadata("sync_root_folder_id",
+                           "Chrome Syncable FileSystem");
+  scoped_ptr<FileTracker> sync_root_tracker =
+      CreateTracker(*sync_root_metadata, kSyncRootTrackerID, NULL);
+
+  scoped_ptr<FileMetadata> app_root_metadata =
+      CreateFolderMetadata("app_root_folder_id", "app_id");
+  scoped_ptr<FileTracker> app_root_tracker =
+      CreateTracker(*app_root_metadata, kAppRootTrackerID,
+                    sync_root_tracker.get());
+  app_root_tracker->set_app_id("app_id");
+  app_root_tracker->set_tracker_kind(TRACKER_KIND_APP_ROOT);
+
+  scoped_ptr<FileMetadata> file_metadata =
+      CreateFileMetadata("file_id", "file", "file_md5");
+  scoped_ptr<FileTracker> file_tracker =
+      CreateTracker(*file_metadata, kFileTrackerID, app_root_tracker.get());
+
+  scoped_ptr<FileTracker> placeholder_tracker =
+      CreatePlaceholderTracker("unsynced_file_id", kPlaceholderTrackerID,
+                               app_root_tracker.get());
+
+  contents->file_metadata.push_back(sync_root_metadata.release());
+  contents->file_trackers.push_back(sync_root_tracker.release());
+  contents->file_metadata.push_back(app_root_metadata.release());
+  contents->file_trackers.push_back(app_root_tracker.release());
+  contents->file_metadata.push_back(file_metadata.release());
+  contents->file_trackers.push_back(file_tracker.release());
+  contents->file_trackers.push_back(placeholder_tracker.release());
+  return contents.Pass();
+}
+
+}  // namespace
+
+class MetadataDatabaseIndexOnDiskTest : public testing::Test {
+ public:
+  MetadataDatabaseIndexOnDiskTest() {}
+  virtual ~MetadataDatabaseIndexOnDiskTest() {}
+
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(database_dir_.CreateUniqueTempDir());
+    in_memory_env_.reset(leveldb::NewMemEnv(leveldb::Env::Default()));
+
+    leveldb::DB* db = NULL;
+    leveldb::Options options;
+    options.create_if_missing = true;
+    options.env = in_memory_env_.get();
+    leveldb::Status status =
+        leveldb::DB::Open(options, database_dir_.path().AsUTF8Unsafe(), &db);
+    ASSERT_TRUE(status.ok());
+    db_.reset(db);
+
+    contents_ = CreateTestDatabaseContents();
+    leveldb::WriteBatch batch;
+    for (size_t i = 0; i < contents_->file_metadata.size(); ++i)
+      PutFileMetadataToBatch(*contents_->file_metadata[i], &batch);
+    for (size_t i = 0; i < contents_->file_trackers.size(); ++i)
+      PutFileTrackerToBatch(*contents_->file_trackers[i], &batch);
+    ASSERT_TRUE(db_->Write(leveldb::WriteOptions(), &batch).ok());
+  }
+
+  virtual void TearDown() OVERRIDE {
+    db_.reset();
+    in_memory_env_.reset();
+  }
+
+  // Creates an index from the entries currently in the database, as
+  // MetadataDatabase does.
+  scoped_ptr<MetadataDatabaseIndexOnDisk> CreateIndex() {
+    DatabaseContents contents;
+    scoped_ptr<leveldb::Iterator> itr(db_->NewIterator(leveldb::ReadOptions()));
+    for (itr->SeekToFirst(); itr->Valid(); itr->Next()) {
+      std::string key = itr->key().ToString();
+      if (StartsWithASCII(key, kFileMetadataKeyPrefix, true)) {
+        scoped_ptr<FileMetadata> metadata(new FileMetadata);
+        EXPECT_TRUE(metadata->ParseFromString(itr->value().ToString()));
+        contents.file_metadata.push_back(metadata.release());
+      } else if (StartsWithASCII(key, kFileTrackerKeyPrefix, true)) {
+        scoped_ptr<FileTracker> tracker(new FileTracker);
+        EXPECT_TRUE(tracker->ParseFromString(itr->value().ToString()));
+        contents.file_trackers.push_back(tracker.release());
+      }
+    }
+    return MetadataDatabaseIndexOnDisk::Create(db_.get(), &contents);
+  }
+
+  // Writes |batch| along with the index changes, as MetadataDatabase does.
+  void WriteChanges(MetadataDatabaseIndexOnDisk* index,
+                    leveldb::WriteBatch* batch) {
+    index->FlushPendingChanges(batch);
+    EXPECT_TRUE(db_->Write(leveldb::WriteOptions(), batch).ok());
+    index->OnChangesWritten();
+  }
+
+  leveldb::DB* db() { return db_.get(); }
+
+  void RunUntilIdle() { message_loop_.RunUntilIdle(); }
+
+ private:
+  base::MessageLoop message_loop_;
+  base::ScopedTempDir database_dir_;
+  scoped_ptr<leveldb::Env> in_memory_env_;
+  scoped_ptr<leveldb::DB> db_;
+  scoped_ptr<DatabaseContents> contents_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetadataDatabaseIndexOnDiskTest);
+};
+
+TEST_F(MetadataDatabaseIndexOnDiskTest, GetEntryTest) {
+  scoped_ptr<MetadataDatabaseIndexOnDisk> index = CreateIndex();
+  ASSERT_TRUE(index);
+
+  EXPECT_FALSE(index->GetFileMetadata(std::string()));
+  EXPECT_FALSE(index->GetFileTracker(kInvalidTrackerID));
+
+  const FileTracker* tracker = index->GetFileTracker(kFileTrackerID);
+  ASSERT_TRUE(tracker);
+  EXPECT_EQ(kFileTrackerID, tracker->tracker_id());
+  EXPECT_EQ("file_id", tracker->file_id());
+
+  const FileMetadata* metadata = index->GetFileMetadata("file_id");
+  ASSERT_TRUE(metadata);
+  EXPECT_EQ("file_id", metadata->file_id());
+
+  EXPECT_EQ(3u, index->CountFileMetadata());
+  EXPECT_EQ(4u, index->CountFileTracker());
+  EXPECT_EQ(1u, index->CountDirtyTracker());
+}
+
+TEST_F(MetadataDatabaseIndexOnDiskTest, IndexLookUpTest) {
+  scoped_ptr<MetadataDatabaseIndexOnDisk> index = CreateIndex();
+  ASSERT_TRUE(index);
+
+  TrackerIDSet trackers = index->GetFileTrackerIDsByFileID("file_id");
+  EXPECT_EQ(1u, trackers.size());
+  EXPECT_TRUE(trackers.has_active());
+  EXPECT_EQ(kFileTrackerID, trackers.active_tracker());
+
+  int64 app_root_tracker_id = index->GetAppRootTracker("app_id");
+  EXPECT_EQ(kAppRootTrackerID, app_root_tracker_id);
+
+  trackers = index->GetFileTrackerIDsByParentAndTitle(
+      app_root_tracker_id, "file");
+  EXPECT_EQ(1u, trackers.size());
+  EXPECT_TRUE(trackers.has_active());
+  EXPECT_EQ(kFileTrackerID, trackers.active_tracker());
+
+  std::vector<int64> children =
+      index->GetFileTrackerIDsByParent(app_root_tracker_id);
+  EXPECT_EQ(2u, children.size());
+
+  EXPECT_TRUE(index->PickMultiTrackerFileID().empty());
+  EXPECT_EQ(kInvalidTrackerID,
+            index->PickMultiBackingFilePath().parent_id);
+  EXPECT_EQ(kPlaceholderTrackerID, index->PickDirtyTracker());
+
+  std::vector<std::string> app_ids = index->GetRegisteredAppIDs();
+  ASSERT_EQ(1u, app_ids.size());
+  EXPECT_EQ("app_id", app_ids[0]);
+}
+
+TEST_F(MetadataDatabaseIndexOnDiskTest, UpdateTest) {
+  scoped_ptr<MetadataDatabaseIndexOnDisk> index = CreateIndex();
+  ASSERT_TRUE(index);
+
+  index->DemoteDirtyTracker(kPlaceholderTrackerID);
+  EXPECT_EQ(kInvalidTrackerID, index->PickDirtyTracker());
+  index->PromoteDemotedDirtyTrackers();
+  EXPECT_EQ(kPlaceholderTrackerID, index->PickDirtyTracker());
+
+  int64 new_tracker_id = 100;
+  scoped_ptr<FileTracker> new_tracker =
+      CreateTracker(*index->GetFileMetadata("file_id"),
+                    new_tracker_id,
+                    index->GetFileTracker(kAppRootTrackerID));
+  new_tracker->set_active(false);
+  index->StoreFileTracker(new_tracker.Pass());
+
+  EXPECT_EQ("file_id", index->PickMultiTrackerFileID());
+  EXPECT_EQ(ParentIDAndTitle(kAppRootTrackerID, std::string("file")),
+            index->PickMultiBackingFilePath());
+
+  index->RemoveFileMetadata("file_id");
+  index->RemoveFileTracker(kFileTrackerID);
+
+  EXPECT_FALSE(index->GetFileMetadata("file_id"));
+  EXPECT_FALSE(index->GetFileTracker(kFileTrackerID));
+  EXPECT_TRUE(index->PickMultiTrackerFileID().empty());
+  EXPECT_EQ(kInvalidTrackerID,
+            index->PickMultiBackingFilePath().parent_id);
+}
+
+TEST_F(MetadataDatabaseIndexOnDiskTest, PersistenceTest) {
+  scoped_ptr<MetadataDatabaseIndexOnDisk> index = CreateIndex();
+  ASSERT_TRUE(index);
+
+  leveldb::WriteBatch batch;
+  scoped_ptr<FileTracker> tracker =
+      CloneFileTracker(index->GetFileTracker(kPlaceholderTrackerID));
+  tracker->set_dirty(false);
+  PutFileTrackerToBatch(*tracker, &batch);
+  index->StoreFileTracker(tracker.Pass());
+  PutFileTrackerDeletionToBatch(kFileTrackerID, &batch);
+  index->RemoveFileTracker(kFileTrackerID);
+  PutFileMetadataDeletionToBatch("file_id", &batch);
+  index->RemoveFileMetadata("file_id");
+
+  // Nothing is written to the database until the changes are flushed.
+  std::string value;
+  EXPECT_TRUE(db()->Get(leveldb::ReadOptions(),
+                        kFileTrackerKeyPrefix +
+                            base::Int64ToString(kFileTrackerID),
+                        &value).ok());
+  EXPECT_FALSE(index->GetFileTracker(kFileTrackerID));
+  EXPECT_EQ(kInvalidTrackerID, index->PickDirtyTracker());
+
+  WriteChanges(index.get(), &batch);
+  index.reset();
+
+  // The indexes are up to date, so they are loaded rather than rebuilt here.
+  index = CreateIndex();
+  ASSERT_TRUE(index);
+  EXPECT_FALSE(index->GetFileTracker(kFileTrackerID));
+  EXPECT_FALSE(index->GetFileMetadata("file_id"));
+  EXPECT_TRUE(index->GetFileTrackerIDsByFileID("file_id").empty());
+  EXPECT_TRUE(index->GetFileTrackerIDsByParentAndTitle(
+      kAppRootTrackerID, "file").empty());
+  EXPECT_EQ(kInvalidTrackerID, index->PickDirtyTracker());
+}
+
+TEST_F(MetadataDatabaseIndexOnDiskTest, EvictedEntryTest) {
+  scoped_ptr<MetadataDatabaseIndexOnDisk> index = CreateIndex();
+  ASSERT_TRUE(index);
+
+  const FileTracker* app_root_tracker =
+      index->GetFileTracker(kAppRootTrackerID);
+  ASSERT_TRUE(app_root_tracker);
+
+  // Add far more trackers than are kept decoded on memory.
+  const int64 kFirstTrackerID = 100;
+  const int64 kNumTrackers = 3000;
+  for (int64 tracker_id = kFirstTrackerID;
+       tracker_id < kFirstTrackerID + kNumTrackers; ++tracker_id) {
+    std::string file_id = "file_id_" + base::Int64ToString(tracker_id);
+    scoped_ptr<FileMetadata> metadata =
+        CreateFileMetadata(file_id, file_id, "md5");
+    index->StoreFileTracker(
+        CreateTracker(*metadata, tracker_id, app_root_tracker));
+    index->StoreFileMetadata(metadata.Pass());
+  }
+  for (int64 tracker_id = kFirstTrackerID;
+       tracker_id < kFirstTrackerID + kNumTrackers; ++tracker_id)
+    ASSERT_TRUE(index->GetFileTracker(tracker_id));
+
+  // Entries dropped from the cache stay valid until the task deleting them
+  // runs.
+  EXPECT_EQ(kAppRootTrackerID, app_root_tracker->tracker_id());
+  EXPECT_EQ("app_id", app_root_tracker->app_id());
+  RunUntilIdle();
+
+  // Dropped entries are decoded again.
+  const FileTracker* tracker = index->GetFileTracker(kFirstTrackerID);
+  ASSERT_TRUE(tracker);
+  EXPECT_EQ("file_id_" + base::Int64ToString(kFirstTrackerID),
+            tracker->file_id());
+  EXPECT_TRUE(index->GetFileMetadata(tracker->file_id()));
+  EXPECT_EQ(static_cast<size_t>(kNumTrackers) + 4, index->CountFileTracker());
+  EXPECT_EQ(static_cast<size_t>(kNumTrackers) + 2,
+            index->GetFileTrackerIDsByParent(kAppRootTrackerID).size());
+}
+
+TEST_F(MetadataDatabaseIndexOnDiskTest, UnwrittenChangesTest) {
+  scoped_ptr<MetadataDatabaseIndexOnDisk> index = CreateIndex();
+  ASSERT_TRUE(index);
+
+  // Add a tracker, and flush it without writing the batch yet.
+  const int64 kNewTrackerID = 100;
+  leveldb::WriteBatch batch;
+  scoped_ptr<FileMetadata> metadata =
+      CreateFileMetadata("new_file_id", "new_file", "md5");
+  scoped_ptr<FileTracker> tracker =
+      CreateTracker(*metadata, kNewTrackerID,
+                    index->GetFileTracker(kAppRootTrackerID));
+  PutFileMetadataToBatch(*metadata, &batch);
+  PutFileTrackerToBatch(*tracker, &batch);
+  index->StoreFileMetadata(metadata.Pass());
+  index->StoreFileTracker(tracker.Pass());
+  index->FlushPendingChanges(&batch);
+
+  // Remove it before the first batch is written.
+  leveldb::WriteBatch second_batch;
+  PutFileTrackerDeletionToBatch(kNewTrackerID, &second_batch);
+  index->RemoveFileTracker(kNewTrackerID);
+  index->FlushPendingChanges(&second_batch);
+
+  // Writing the first batch doesn't bring the tracker back.
+  EXPECT_TRUE(db()->Write(leveldb::WriteOptions(), &batch).ok());
+  index->OnChangesWritten();
+  RunUntilIdle();
+  EXPECT_FALSE(index->GetFileTracker(kNewTrackerID));
+  EXPECT_TRUE(index->GetFileTrackerIDsByFileID("new_file_id").empty());
+  EXPECT_TRUE(index->GetFileMetadata("new_file_id"));
+
+  // Once everything is written, lookups are served from the database.
+  EXPECT_TRUE(db()->Write(leveldb::WriteOptions(), &second_batch).ok());
+  index->OnChangesWritten();
+  RunUntilIdle();
+  EXPECT_FALSE(index->GetFileTracker(kNewTrackerID));
+  EXPECT_TRUE(index->GetFileTrackerIDsByFileID("new_file_id").empty());
+  EXPECT_EQ(2u, index->GetFileTrackerIDsByParent(kAppRootTrackerID).size());
+  const FileMetadata* stored_metadata = index->GetFileMetadata("new_file_id");
+  ASSERT_TRUE(stored_metadata);
+  EXPECT_EQ("new_file", stored_metadata->details().title());
+  EXPECT_EQ(4u, index->CountFileMetadata());
+  EXPECT_EQ(4u, index->CountFileTracker());
+}
+
+}  // namespace drive_backend
+}  // namespace sync_file_system
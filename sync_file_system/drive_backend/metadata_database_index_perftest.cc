@@ -0,0 +1,251 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/files/scoped_temp_dir.h"
+#include "base/message_loop/message_loop.h"
+#include "base/process/process_metrics.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "chrome/browser/sync_file_system/drive_backend/drive_backend_constants.h"
+#include "chrome/browser/sync_file_system/drive_backend/drive_backend_util.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database.pb.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database_index.h"
+#include "chrome/browser/sync_file_system/drive_backend/metadata_database_index_on_disk.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "third_party/leveldatabase/src/include/leveldb/db.h"
+#include "third_party/leveldatabase/src/include/leveldb/write_batch.h"
+
+namespace sync_file_system {
+namespace drive_backend {
+
+namespace {
+
+// The database holds |kNumFolders| folders of |kNumFilesPerFolder| files each
+// under a single app root.
+const int kNumFolders = 100;
+const int kNumFilesPerFolder = 200;
+const int64 kAppRootTrackerID = 1;
+
+scoped_ptr<FileMetadata> CreateMetadata(const std::string& file_id,
+                                        FileKind file_kind) {
+  scoped_ptr<FileMetadata> metadata(new FileMetadata);
+  metadata->set_file_id(file_id);
+  FileDetails* details = metadata->mutable_details();
+  details->set_title(file_id);
+  details->set_file_kind(file_kind);
+  details->set_missing(false);
+  details->set_md5("md5_" + file_id);
+  details->set_etag("etag_" + file_id);
+  details->set_change_id(1);
+  return metadata.Pass();
+}
+
+scoped_ptr<FileTracker> CreateTracker(const FileMetadata& metadata,
+                                      int64 tracker_id,
+                                      int64 parent_tracker_id) {
+  scoped_ptr<FileTracker> tracker(new FileTracker);
+  tracker->set_tracker_id(tracker_id);
+  tracker->set_parent_tracker_id(parent_tracker_id);
+  tracker->set_file_id(metadata.file_id());
+  tracker->set_app_id("app_id");
+  tracker->set_tracker_kind(parent_tracker_id == kInvalidTrackerID ?
+                            TRACKER_KIND_APP_ROOT : TRACKER_KIND_REGULAR);
+  *tracker->mutable_synced_details() = metadata.details();
+  tracker->set_dirty(false);
+  tracker->set_active(true);
+  tracker->set_needs_folder_listing(false);
+  return tracker.Pass();
+}
+
+void AddEntry(scoped_ptr<FileMetadata> metadata,
+              scoped_ptr<FileTracker> tracker,
+              DatabaseContents* contents) {
+  contents->file_metadata.push_back(metadata.release());
+  contents->file_trackers.push_back(tracker.release());
+}
+
+scoped_ptr<DatabaseContents> CreateContents() {
+  scoped_ptr<DatabaseContents> contents(new DatabaseContents);
+  scoped_ptr<FileMetadata> app_root =
+      CreateMetadata("app_root", FILE_KIND_FOLDER);
+  scoped_ptr<FileTracker> app_root_tracker =
+      CreateTracker(*app_root, kAppRootTrackerID, kInvalidTrackerID);
+  AddEntry(app_root.Pass(), app_root_tracker.Pass(), contents.get());
+
+  int64 tracker_id = kAppRootTrackerID;
+  for (int i = 0; i < kNumFolders; ++i) {
+    int64 folder_tracker_id = ++tracker_id;
+    scoped_ptr<FileMetadata> folder =
+        CreateMetadata("folder_" + base::IntToString(i), FILE_KIND_FOLDER);
+    scoped_ptr<FileTracker> folder_tracker =
+        CreateTracker(*folder, folder_tracker_id, kAppRootTrackerID);
+    AddEntry(folder.Pass(), folder_tracker.Pass(), contents.get());
+
+    for (int j = 0; j < kNumFilesPerFolder; ++j) {
+      scoped_ptr<FileMetadata> file = CreateMetadata(
+          "file_" + base::IntToString(i) + "_" + base::IntToString(j),
+          FILE_KIND_FILE);
+      scoped_ptr<FileTracker> file_tracker =
+          CreateTracker(*file, ++tracker_id, folder_tracker_id);
+      AddEntry(file.Pass(), file_tracker.Pass(), contents.get());
+    }
+  }
+  return contents.Pass();
+}
+
+// The private and resident memory of the process.
+struct MemoryUsage {
+  MemoryUsage() : private_bytes(0), resident_bytes(0) {}
+
+  size_t private_bytes;
+  size_t resident_bytes;
+};
+
+MemoryUsage GetMemoryUsage() {
+  scoped_ptr<base::ProcessMetrics> metrics(
+      base::ProcessMetrics::CreateProcessMetrics(
+          base::GetCurrentProcessHandle()));
+  MemoryUsage usage;
+  if (!metrics->GetMemoryBytes(&usage.private_bytes, NULL))
+    usage.private_bytes = 0;
+  usage.resident_bytes = metrics->GetWorkingSetSize();
+  return usage;
+}
+
+size_t GetGrowth(size_t before, size_t after) {
+  return after > before ? after - before : 0;
+}
+
+class MetadataDatabaseIndexPerfTest : public testing::Test {
+ public:
+  MetadataDatabaseIndexPerfTest() {}
+  virtual ~MetadataDatabaseIndexPerfTest() {}
+
+  virtual void SetUp() OVERRIDE {
+    // The database is on disk, so that its contents don't count as memory
+    // used by the index.
+    ASSERT_TRUE(database_dir_.CreateUniqueTempDir());
+
+    leveldb::DB* db = NULL;
+    leveldb::Options options;
+    options.create_if_missing = true;
+    leveldb::Status status =
+        leveldb::DB::Open(options, database_dir_.path().AsUTF8Unsafe(), &db);
+    ASSERT_TRUE(status.ok());
+    db_.reset(db);
+
+    scoped_ptr<DatabaseContents> contents = CreateContents();
+    leveldb::WriteBatch batch;
+    for (size_t i = 0; i < contents->file_metadata.size(); ++i)
+      PutFileMetadataToBatch(*contents->file_metadata[i], &batch);
+    for (size_t i = 0; i < contents->file_trackers.size(); ++i)
+      PutFileTrackerToBatch(*contents->file_trackers[i], &batch);
+    ASSERT_TRUE(db_->Write(leveldb::WriteOptions(), &batch).ok());
+
+    // Build the on-disk indexes once, so that the measured runs load them.
+    ASSERT_TRUE(MetadataDatabaseIndexOnDisk::Create(db_.get(),
+                                                    contents.get()));
+    message_loop_.RunUntilIdle();
+  }
+
+  virtual void TearDown() OVERRIDE {
+    db_.reset();
+  }
+
+  // Creates an index with |create_index|, and prints the time and the private
+  // and resident memory it took, and the time taken by lookups on it.  The
+  // resident memory is also measured once every tracker was looked up.
+  void MeasureIndex(
+      const std::string& trace,
+      scoped_ptr<MetadataDatabaseIndexInterface> (*create_index)(
+          leveldb::DB* db, DatabaseContents* contents)) {
+    scoped_ptr<DatabaseContents> contents = CreateContents();
+    MemoryUsage usage_before = GetMemoryUsage();
+    base::TimeTicks start = base::TimeTicks::HighResNow();
+    scoped_ptr<MetadataDatabaseIndexInterface> index =
+        create_index(db_.get(), contents.get());
+    base::TimeDelta create_time = base::TimeTicks::HighResNow() - start;
+    ASSERT_TRUE(index);
+    contents.reset();
+    message_loop_.RunUntilIdle();
+    MemoryUsage usage_after_create = GetMemoryUsage();
+
+    int64 num_trackers = index->CountFileTracker();
+    start = base::TimeTicks::HighResNow();
+    for (int64 tracker_id = kAppRootTrackerID; tracker_id <= num_trackers;
+         ++tracker_id)
+      ASSERT_TRUE(index->GetFileTracker(tracker_id));
+    base::TimeDelta tracker_lookup_time = base::TimeTicks::HighResNow() - start;
+
+    start = base::TimeTicks::HighResNow();
+    for (int i = 0; i < kNumFolders; ++i) {
+      std::string file_id = "file_" + base::IntToString(i) + "_0";
+      ASSERT_EQ(1u, index->GetFileTrackerIDsByFileID(file_id).size());
+    }
+    base::TimeDelta index_lookup_time = base::TimeTicks::HighResNow() - start;
+    message_loop_.RunUntilIdle();
+    MemoryUsage usage_after_lookups = GetMemoryUsage();
+
+    perf_test::PrintResult("metadata_database_index", trace, "create",
+                           create_time.InMillisecondsF(), "ms", true);
+    perf_test::PrintResult(
+        "metadata_database_index", trace, "private_memory",
+        GetGrowth(usage_before.private_bytes, usage_after_create.private_bytes),
+        "bytes", true);
+    perf_test::PrintResult(
+        "metadata_database_index", trace, "resident_memory",
+        GetGrowth(usage_before.resident_bytes,
+                  usage_after_create.resident_bytes),
+        "bytes", true);
+    perf_test::PrintResult(
+        "metadata_database_index", trace, "resident_memory_after_lookups",
+        GetGrowth(usage_before.resident_bytes,
+                  usage_after_lookups.resident_bytes),
+        "bytes", true);
+    perf_test::PrintResult(
+        "metadata_database_index", trace, "get_file_tracker",
+        tracker_lookup_time.InMicrosecondsF() / num_trackers, "us", true);
+    perf_test::PrintResult(
+        "metadata_database_index", trace, "get_trackers_by_file_id",
+        index_lookup_time.InMicrosecondsF() / kNumFolders, "us", true);
+  }
+
+ private:
+  base::MessageLoop message_loop_;
+  base::ScopedTempDir database_dir_;
+  scoped_ptr<leveldb::DB> db_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetadataDatabaseIndexPerfTest);
+};
+
+scoped_ptr<MetadataDatabaseIndexInterface> CreateIndexOnMemory(
+    leveldb::DB* db,
+    DatabaseContents* contents) {
+  return scoped_ptr<MetadataDatabaseIndexInterface>(
+      new MetadataDatabaseIndex(contents));
+}
+
+scoped_ptr<MetadataDatabaseIndexInterface> CreateIndexOnDisk(
+    leveldb::DB* db,
+    DatabaseContents* contents) {
+  return MetadataDatabaseIndexOnDisk::Create(db, contents)
+      .PassAs<MetadataDatabaseIndexInterface>();
+}
+
+}  // namespace
+
+TEST_F(MetadataDatabaseIndexPerfTest, OnMemory) {
+  MeasureIndex("_on_memory", &CreateIndexOnMemory);
+}
+
+TEST_F(MetadataDatabaseIndexPerfTest, OnDisk) {
+  MeasureIndex("_on_disk", &CreateIndexOnDisk);
+}
+
+}  // namespace drive_backend
+}  // namespace sync_file_system
@@ -463,13 +463,14 @@ class MetadataDatabaseTest : public testing::Test {
     ASSERT_EQ(SYNC_STATUS_OK,
               MetadataDatabase::CreateForTesting(
                   metadata_database_->db_.Pass(),
+                  false /* enable_on_disk_index */,
                   &metadata_database_2));
     metadata_database_->db_ = metadata_database_2->db_.Pass();
 
     const MetadataDatabaseIndex* on_memory =
-        metadata_database_->index_.get();
+        static_cast<MetadataDatabaseIndex*>(metadata_database_->index_.get());
     const MetadataDatabaseIndex* reloaded =
-        metadata_database_2->index_.get();
+        static_cast<MetadataDatabaseIndex*>(metadata_database_2->index_.get());
 
     {
       SCOPED_TRACE("Expect equivalent service_metadata");
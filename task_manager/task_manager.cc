@@ -10,11 +10,13 @@
 #include "base/prefs/pref_registry_simple.h"
 #include "base/process/process_metrics.h"
 #include "base/rand_util.h"
+#include "base/sequenced_task_runner.h"
 #include "base/stl_util.h"
 #include "base/strings/string16.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "chrome/browser/browser_process.h"
 #include "chrome/browser/profiles/profile_manager.h"
 #include "chrome/browser/task_manager/background_information.h"
@@ -156,6 +158,22 @@ void GetWinUSERHandles(base::ProcessHandle process,
 }
 #endif
 
+bool SameResourceTypeStat(const blink::WebCache::ResourceTypeStat& stat1,
+                          const blink::WebCache::ResourceTypeStat& stat2) {
+  return stat1.count == stat2.count && stat1.size == stat2.size &&
+      stat1.liveSize == stat2.liveSize &&
+      stat1.decodedSize == stat2.decodedSize;
+}
+
+bool SameResourceTypeStats(const blink::WebCache::ResourceTypeStats& stats1,
+                           const blink::WebCache::ResourceTypeStats& stats2) {
+  return SameResourceTypeStat(stats1.images, stats2.images) &&
+      SameResourceTypeStat(stats1.cssStyleSheets, stats2.cssStyleSheets) &&
+      SameResourceTypeStat(stats1.scripts, stats2.scripts) &&
+      SameResourceTypeStat(stats1.xslStyleSheets, stats2.xslStyleSheets) &&
+      SameResourceTypeStat(stats1.fonts, stats2.fonts);
+}
+
 }  // namespace
 
 class TaskManagerModelGpuDataManagerObserver
@@ -238,7 +256,11 @@ TaskManagerModel::PerProcessValues::~PerProcessValues() {}
 ////////////////////////////////////////////////////////////////////////////////
 
 TaskManagerModel::TaskManagerModel(TaskManager* task_manager)
-    : pending_video_memory_usage_stats_update_(false),
+    : sampling_task_runner_(
+          BrowserThread::GetBlockingPool()->GetSequencedTaskRunner(
+              BrowserThread::GetBlockingPool()->GetSequenceToken())),
+      sample_pending_(false),
+      pending_video_memory_usage_stats_update_(false),
       update_requests_(0),
       listen_requests_(0),
       update_state_(IDLE),
@@ -559,89 +581,44 @@ base::string16 TaskManagerModel::GetResourceV8MemoryAllocatedSize(
 }
 
 bool TaskManagerModel::GetPrivateMemory(int index, size_t* result) const {
-  *result = 0;
-  base::ProcessHandle handle = GetResource(index)->GetProcess();
-  if (!CachePrivateAndSharedMemory(handle))
-    return false;
-  *result = per_process_cache_[handle].private_bytes;
-  return true;
+  const PerProcessValues& values(
+      per_process_cache_[GetResource(index)->GetProcess()]);
+  *result = values.private_bytes;
+  return values.is_private_and_shared_valid;
 }
 
 bool TaskManagerModel::GetSharedMemory(int index, size_t* result) const {
-  *result = 0;
-  base::ProcessHandle handle = GetResource(index)->GetProcess();
-  if (!CachePrivateAndSharedMemory(handle))
-    return false;
-  *result = per_process_cache_[handle].shared_bytes;
-  return true;
+  const PerProcessValues& values(
+      per_process_cache_[GetResource(index)->GetProcess()]);
+  *result = values.shared_bytes;
+  return values.is_private_and_shared_valid;
 }
 
 bool TaskManagerModel::GetPhysicalMemory(int index, size_t* result) const {
-  *result = 0;
-
-  base::ProcessHandle handle = GetResource(index)->GetProcess();
-  PerProcessValues& values(per_process_cache_[handle]);
-
-  if (!values.is_physical_memory_valid) {
-    base::WorkingSetKBytes ws_usage;
-    MetricsMap::const_iterator iter = metrics_map_.find(handle);
-    if (iter == metrics_map_.end() ||
-        !iter->second->GetWorkingSetKBytes(&ws_usage))
-      return false;
-
-    values.is_physical_memory_valid = true;
-#if defined(OS_LINUX)
-    // On Linux private memory is also resident. Just use it.
-    values.physical_memory = ws_usage.priv * 1024;
-#else
-    // Memory = working_set.private + working_set.shareable.
-    // We exclude the shared memory.
-    values.physical_memory = iter->second->GetWorkingSetSize();
-    values.physical_memory -= ws_usage.shared * 1024;
-#endif
-  }
+  const PerProcessValues& values(
+      per_process_cache_[GetResource(index)->GetProcess()]);
   *result = values.physical_memory;
-  return true;
+  return values.is_physical_memory_valid;
 }
 
 void TaskManagerModel::GetGDIHandles(int index,
                                      size_t* current,
                                      size_t* peak) const {
-  *current = 0;
-  *peak = 0;
-#if defined(OS_WIN)
-  base::ProcessHandle handle = GetResource(index)->GetProcess();
-  PerProcessValues& values(per_process_cache_[handle]);
-
-  if (!values.is_gdi_handles_valid) {
-    GetWinGDIHandles(GetResource(index)->GetProcess(),
-                     &values.gdi_handles,
-                     &values.gdi_handles_peak);
-    values.is_gdi_handles_valid = true;
-  }
+  // Returns 0 if not valid, which is fine.
+  const PerProcessValues& values(
+      per_process_cache_[GetResource(index)->GetProcess()]);
   *current = values.gdi_handles;
   *peak = values.gdi_handles_peak;
-#endif
 }
 
 void TaskManagerModel::GetUSERHandles(int index,
                                       size_t* current,
                                       size_t* peak) const {
-  *current = 0;
-  *peak = 0;
-#if defined(OS_WIN)
-  base::ProcessHandle handle = GetResource(index)->GetProcess();
-  PerProcessValues& values(per_process_cache_[handle]);
-
-  if (!values.is_user_handles_valid) {
-    GetWinUSERHandles(GetResource(index)->GetProcess(),
-                      &values.user_handles,
-                      &values.user_handles_peak);
-    values.is_user_handles_valid = true;
-  }
+  // Returns 0 if not valid, which is fine.
+  const PerProcessValues& values(
+      per_process_cache_[GetResource(index)->GetProcess()]);
   *current = values.user_handles;
   *peak = values.user_handles_peak;
-#endif
 }
 
 bool TaskManagerModel::GetWebCoreCacheStats(
@@ -1039,10 +1016,11 @@ void TaskManagerModel::RemoveResource(Resource* resource) {
     group_map_.erase(process);
 
     // Nobody is using this process, we don't need the process metrics anymore.
+    // A pending sample may still be using them.
     MetricsMap::iterator pm_iter = metrics_map_.find(process);
     DCHECK(pm_iter != metrics_map_.end());
     if (pm_iter != metrics_map_.end()) {
-      delete pm_iter->second;
+      sampling_task_runner_->DeleteSoon(FROM_HERE, pm_iter->second);
       metrics_map_.erase(process);
     }
   }
@@ -1060,10 +1038,8 @@ void TaskManagerModel::RemoveResource(Resource* resource) {
   resources_.erase(iter);
 
   // Remove the entry from the network maps.
-  ResourceValueMap::iterator net_iter =
-      current_byte_count_map_.find(resource);
-  if (net_iter != current_byte_count_map_.end())
-    current_byte_count_map_.erase(net_iter);
+  current_byte_count_map_.erase(resource);
+  network_usage_map_.erase(resource);
 
   // Notify the table that the contents have changed.
   FOR_EACH_OBSERVER(TaskManagerModelObserver, observer_list_,
@@ -1154,11 +1130,17 @@ void TaskManagerModel::Clear() {
     // Clear the groups.
     STLDeleteValues(&group_map_);
 
-    // Clear the process related info.
-    STLDeleteValues(&metrics_map_);
+    // Clear the process related info. A pending sample may still be using the
+    // process metrics.
+    for (MetricsMap::iterator iter = metrics_map_.begin();
+         iter != metrics_map_.end(); ++iter) {
+      sampling_task_runner_->DeleteSoon(FROM_HERE, iter->second);
+    }
+    metrics_map_.clear();
 
     // Clear the network maps.
     current_byte_count_map_.clear();
+    network_usage_map_.clear();
 
     per_resource_cache_.clear();
     per_process_cache_.clear();
@@ -1168,6 +1150,17 @@ void TaskManagerModel::Clear() {
   }
 }
 
+void TaskManagerModel::StartGatheringColumn(int col_id) {
+  gathered_columns_.insert(col_id);
+}
+
+void TaskManagerModel::StopGatheringColumn(int col_id) {
+  std::multiset<int>::iterator iter = gathered_columns_.find(col_id);
+  DCHECK(iter != gathered_columns_.end());
+  if (iter != gathered_columns_.end())
+    gathered_columns_.erase(iter);
+}
+
 void TaskManagerModel::ModelChanged() {
   // Notify the table that the contents have changed for it to redraw.
   FOR_EACH_OBSERVER(TaskManagerModelObserver, observer_list_, OnModelChanged());
@@ -1176,50 +1169,22 @@ void TaskManagerModel::ModelChanged() {
 void TaskManagerModel::Refresh() {
   goat_salt_ = base::RandUint64();
 
-  per_resource_cache_.clear();
-  per_process_cache_.clear();
-
-  // Compute the CPU usage values.
-  // Note that we compute the CPU usage for all resources (instead of doing it
-  // lazily) as process_util::GetCPUUsage() returns the CPU usage since the last
-  // time it was called, and not calling it everytime would skew the value the
-  // next time it is retrieved (as it would be for more than 1 cycle).
-  // The same is true for idle wakeups.
-  for (ResourceList::iterator iter = resources_.begin();
-       iter != resources_.end(); ++iter) {
-    base::ProcessHandle process = (*iter)->GetProcess();
-    PerProcessValues& values(per_process_cache_[process]);
-    if (values.is_cpu_usage_valid && values.is_idle_wakeups_valid)
-      continue;
-    MetricsMap::iterator metrics_iter = metrics_map_.find(process);
-    DCHECK(metrics_iter != metrics_map_.end());
-    if (!values.is_cpu_usage_valid) {
-      values.is_cpu_usage_valid = true;
-      values.cpu_usage = metrics_iter->second->GetCPUUsage();
-    }
-#if defined(OS_MACOSX)
-    // TODO: Implement GetIdleWakeupsPerSecond() on other platforms,
-    // crbug.com/120488
-    if (!values.is_idle_wakeups_valid) {
-      values.is_idle_wakeups_valid = true;
-      values.idle_wakeups = metrics_iter->second->GetIdleWakeupsPerSecond();
-    }
-#endif  // defined(OS_MACOSX)
-  }
-
   // Send a request to refresh GPU memory consumption values
   RefreshVideoMemoryUsageStats();
 
-  // Compute the new network usage values.
+  // Compute the new network usage values. They are published with the next
+  // process sample.
   base::TimeDelta update_time =
       base::TimeDelta::FromMilliseconds(kUpdateTimeMs);
+  network_usage_map_.clear();
   for (ResourceValueMap::iterator iter = current_byte_count_map_.begin();
        iter != current_byte_count_map_.end(); ++iter) {
-    PerResourceValues* values = &(per_resource_cache_[iter->first]);
+    int64 network_usage;
     if (update_time > base::TimeDelta::FromSeconds(1))
-      values->network_usage = iter->second / update_time.InSeconds();
+      network_usage = iter->second / update_time.InSeconds();
     else
-      values->network_usage = iter->second * (1 / update_time.InSeconds());
+      network_usage = iter->second * (1 / update_time.InSeconds());
+    network_usage_map_[iter->first] = network_usage;
 
     // Then we reset the current byte count.
     iter->second = 0;
@@ -1231,10 +1196,7 @@ void TaskManagerModel::Refresh() {
      (*iter)->Refresh();
   }
 
-  if (!resources_.empty()) {
-    FOR_EACH_OBSERVER(TaskManagerModelObserver, observer_list_,
-                      OnItemsChanged(0, ResourceCount()));
-  }
+  SampleProcesses();
 }
 
 void TaskManagerModel::NotifyResourceTypeStats(
@@ -1325,6 +1287,11 @@ void TaskManagerModel::RegisterOnDataReadyCallback(
   on_data_ready_callbacks_.push_back(callback);
 }
 
+void TaskManagerModel::RegisterOnSampledCallback(
+    const base::Closure& callback) {
+  on_sampled_callbacks_.push_back(callback);
+}
+
 TaskManagerModel::~TaskManagerModel() {
   on_data_ready_callbacks_.clear();
 }
@@ -1347,6 +1314,202 @@ void TaskManagerModel::RefreshCallback() {
       base::TimeDelta::FromMilliseconds(kUpdateTimeMs));
 }
 
+void TaskManagerModel::SampleProcesses() {
+  if (sample_pending_)
+    return;
+  sample_pending_ = true;
+  DCHECK(pending_sample_callbacks_.empty());
+  pending_sample_callbacks_.swap(on_sampled_callbacks_);
+
+  PerProcessCache* samples = new PerProcessCache;
+  sampling_task_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(&TaskManagerModel::SampleProcessesOnSequence,
+                 metrics_map_, GetSampledValues(), samples),
+      base::Bind(&TaskManagerModel::OnProcessesSampled, this,
+                 base::Owned(samples)));
+}
+
+// static
+void TaskManagerModel::SampleProcessesOnSequence(const MetricsMap& metrics_map,
+                                                 int sampled_values,
+                                                 PerProcessCache* samples) {
+  for (MetricsMap::const_iterator iter = metrics_map.begin();
+       iter != metrics_map.end(); ++iter) {
+    base::ProcessMetrics* metrics = iter->second;
+    PerProcessValues& values((*samples)[iter->first]);
+
+    // Note that we compute the CPU usage for all processes (instead of doing
+    // it lazily) as ProcessMetrics::GetCPUUsage() returns the CPU usage since
+    // the last time it was called, and not calling it everytime would skew the
+    // value the next time it is retrieved (as it would be for more than 1
+    // cycle). The same is true for idle wakeups.
+    values.is_cpu_usage_valid = true;
+    values.cpu_usage = metrics->GetCPUUsage();
+#if defined(OS_MACOSX)
+    // TODO: Implement GetIdleWakeupsPerSecond() on other platforms,
+    // crbug.com/120488
+    values.is_idle_wakeups_valid = true;
+    values.idle_wakeups = metrics->GetIdleWakeupsPerSecond();
+#endif  // defined(OS_MACOSX)
+
+    if (sampled_values & SAMPLE_PRIVATE_AND_SHARED_MEMORY) {
+      values.is_private_and_shared_valid =
+          metrics->GetMemoryBytes(&values.private_bytes, &values.shared_bytes);
+    }
+
+    base::WorkingSetKBytes ws_usage;
+    if ((sampled_values & SAMPLE_PHYSICAL_MEMORY) &&
+        metrics->GetWorkingSetKBytes(&ws_usage)) {
+      values.is_physical_memory_valid = true;
+#if defined(OS_LINUX)
+      // On Linux private memory is also resident. Just use it.
+      values.physical_memory = ws_usage.priv * 1024;
+#else
+      // Memory = working_set.private + working_set.shareable.
+      // We exclude the shared memory.
+      values.physical_memory = metrics->GetWorkingSetSize();
+      values.physical_memory -= ws_usage.shared * 1024;
+#endif
+    }
+
+#if defined(OS_WIN)
+    if (sampled_values & SAMPLE_HANDLES) {
+      GetWinGDIHandles(iter->first, &values.gdi_handles,
+                       &values.gdi_handles_peak);
+      values.is_gdi_handles_valid = true;
+      GetWinUSERHandles(iter->first, &values.user_handles,
+                        &values.user_handles_peak);
+      values.is_user_handles_valid = true;
+    }
+#endif
+  }
+}
+
+void TaskManagerModel::OnProcessesSampled(PerProcessCache* samples) {
+  DCHECK(sample_pending_);
+  sample_pending_ = false;
+
+  PerResourceCache old_resource_cache;
+  old_resource_cache.swap(per_resource_cache_);
+  PerProcessCache old_process_cache;
+  old_process_cache.swap(per_process_cache_);
+  per_process_cache_.swap(*samples);
+
+  for (ResourceValueMap::iterator iter = network_usage_map_.begin();
+       iter != network_usage_map_.end(); ++iter) {
+    per_resource_cache_[iter->first].network_usage = iter->second;
+  }
+
+  // Notify the observers of each run of changed rows.
+  int changed_start = -1;
+  for (int i = 0; i <= ResourceCount(); ++i) {
+    bool changed = false;
+    if (i < ResourceCount()) {
+      Resource* resource = GetResource(i);
+      changed = HasRowChanged(i, old_resource_cache[resource],
+                              old_process_cache[resource->GetProcess()]);
+    }
+    if (changed && changed_start == -1) {
+      changed_start = i;
+    } else if (!changed && changed_start != -1) {
+      FOR_EACH_OBSERVER(TaskManagerModelObserver, observer_list_,
+                        OnItemsChanged(changed_start, i - changed_start));
+      changed_start = -1;
+    }
+  }
+  FOR_EACH_OBSERVER(TaskManagerModelObserver, observer_list_,
+                    OnItemsRefreshed());
+
+  std::vector<base::Closure> callbacks;
+  callbacks.swap(pending_sample_callbacks_);
+  for (size_t i = 0; i < callbacks.size(); ++i)
+    callbacks[i].Run();
+}
+
+bool TaskManagerModel::HasRowChanged(
+    int index,
+    const PerResourceValues& old_resource,
+    const PerProcessValues& old_process) const {
+  const PerProcessValues& process(
+      per_process_cache_[GetResource(index)->GetProcess()]);
+  if (process.cpu_usage != old_process.cpu_usage ||
+      process.idle_wakeups != old_process.idle_wakeups ||
+      process.is_private_and_shared_valid !=
+          old_process.is_private_and_shared_valid ||
+      process.private_bytes != old_process.private_bytes ||
+      process.shared_bytes != old_process.shared_bytes ||
+      process.is_physical_memory_valid !=
+          old_process.is_physical_memory_valid ||
+      process.physical_memory != old_process.physical_memory ||
+      process.gdi_handles != old_process.gdi_handles ||
+      process.user_handles != old_process.user_handles) {
+    return true;
+  }
+  if (old_process.is_video_memory_valid) {
+    size_t video_memory;
+    bool has_duplicates;
+    if (!GetVideoMemory(index, &video_memory, &has_duplicates) ||
+        video_memory != old_process.video_memory ||
+        has_duplicates != old_process.video_memory_has_duplicates) {
+      return true;
+    }
+  }
+
+  if (GetPerResourceValues(index).network_usage != old_resource.network_usage)
+    return true;
+  if (old_resource.is_title_valid &&
+      GetResourceTitle(index) != old_resource.title) {
+    return true;
+  }
+  if (old_resource.is_profile_name_valid &&
+      GetResourceProfileName(index) != old_resource.profile_name) {
+    return true;
+  }
+  if (old_resource.is_webcore_stats_valid &&
+      (!CacheWebCoreStats(index) ||
+       !SameResourceTypeStats(GetPerResourceValues(index).webcore_stats,
+                              old_resource.webcore_stats))) {
+    return true;
+  }
+  float fps;
+  if (old_resource.is_fps_valid &&
+      (!GetFPS(index, &fps) || fps != old_resource.fps)) {
+    return true;
+  }
+  size_t sqlite_memory_bytes;
+  if (old_resource.is_sqlite_memory_bytes_valid &&
+      (!GetSqliteMemoryUsedBytes(index, &sqlite_memory_bytes) ||
+       sqlite_memory_bytes != old_resource.sqlite_memory_bytes)) {
+    return true;
+  }
+  if (old_resource.is_v8_memory_valid &&
+      (!CacheV8Memory(index) ||
+       GetPerResourceValues(index).v8_memory_allocated !=
+           old_resource.v8_memory_allocated ||
+       GetPerResourceValues(index).v8_memory_used !=
+           old_resource.v8_memory_used)) {
+    return true;
+  }
+  // The goats are salted anew on every refresh.
+  return old_resource.is_goats_teleported_valid;
+}
+
+int TaskManagerModel::GetSampledValues() const {
+  int sampled_values = 0;
+  if (gathered_columns_.count(IDS_TASK_MANAGER_PRIVATE_MEM_COLUMN) ||
+      gathered_columns_.count(IDS_TASK_MANAGER_SHARED_MEM_COLUMN)) {
+    sampled_values |= SAMPLE_PRIVATE_AND_SHARED_MEMORY;
+  }
+  if (gathered_columns_.count(IDS_TASK_MANAGER_PHYSICAL_MEM_COLUMN))
+    sampled_values |= SAMPLE_PHYSICAL_MEMORY;
+  if (gathered_columns_.count(IDS_TASK_MANAGER_GDI_HANDLES_COLUMN) ||
+      gathered_columns_.count(IDS_TASK_MANAGER_USER_HANDLES_COLUMN)) {
+    sampled_values |= SAMPLE_HANDLES;
+  }
+  return sampled_values;
+}
+
 void TaskManagerModel::RefreshVideoMemoryUsageStats() {
   if (pending_video_memory_usage_stats_update_)
     return;
@@ -1463,23 +1626,6 @@ base::string16 TaskManagerModel::GetMemCellText(int64 number) const {
 #endif
 }
 
-bool TaskManagerModel::CachePrivateAndSharedMemory(
-    base::ProcessHandle handle) const {
-  PerProcessValues& values(per_process_cache_[handle]);
-  if (values.is_private_and_shared_valid)
-    return true;
-
-  MetricsMap::const_iterator iter = metrics_map_.find(handle);
-  if (iter == metrics_map_.end() ||
-      !iter->second->GetMemoryBytes(&values.private_bytes,
-                                    &values.shared_bytes)) {
-    return false;
-  }
-
-  values.is_private_and_shared_valid = true;
-  return true;
-}
-
 bool TaskManagerModel::CacheWebCoreStats(int index) const {
   PerResourceValues& values(GetPerResourceValues(index));
   if (!values.is_webcore_stats_valid) {
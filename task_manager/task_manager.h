@@ -6,6 +6,7 @@
 #define CHROME_BROWSER_TASK_MANAGER_TASK_MANAGER_H_
 
 #include <map>
+#include <set>
 #include <vector>
 
 #include "base/basictypes.h"
@@ -28,6 +29,7 @@ class TaskManagerModelGpuDataManagerObserver;
 
 namespace base {
 class ProcessMetrics;
+class SequencedTaskRunner;
 }
 
 namespace content {
@@ -126,6 +128,11 @@ class TaskManagerModelObserver {
   // so it can be queried for and found.
   virtual void OnItemsToBeRemoved(int start, int length) {}
 
+  // Invoked once per update, after OnItemsChanged has been sent for the rows
+  // whose values changed in it. Observers that need a consistent view of all
+  // the items should read them here.
+  virtual void OnItemsRefreshed() {}
+
   // Invoked when the initialization of the model has been finished and
   // periodical updates is started. The first periodical update will be done
   // in a few seconds. (depending on platform)
@@ -136,7 +143,9 @@ class TaskManagerModelObserver {
 //
 // TaskManagerModel caches the values from all task_manager::Resources. This is
 // done so the UI sees a consistant view of the resources until it is told a
-// value has been updated.
+// value has been updated. Process metrics are sampled once per process on a
+// background sequence, and only the rows whose values changed are reported
+// to observers.
 class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
  public:
   // (start, length)
@@ -285,6 +294,13 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   void StartUpdating();
   void StopUpdating();
 
+  // Values which are expensive to sample, such as private memory, are only
+  // gathered while at least one client shows their column. Each call to
+  // StartGatheringColumn must be balanced by a call to StopGatheringColumn.
+  // |col_id| is an IDS_ value used to identify the column.
+  void StartGatheringColumn(int col_id);
+  void StopGatheringColumn(int col_id);
+
   // Listening involves calling StartUpdating on all resource providers. This
   // causes all of them to subscribe to notifications and enumerate current
   // resources. It differs from StartUpdating that it doesn't start the
@@ -321,6 +337,11 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
 
   void RegisterOnDataReadyCallback(const base::Closure& callback);
 
+  // Runs |callback| once the first process sample posted after this call has
+  // been published, so that the columns gathered at the time of the call hold
+  // valid values. Samples are only taken while the model is updating.
+  void RegisterOnSampledCallback(const base::Closure& callback);
+
   void NotifyDataReady();
 
  private:
@@ -328,6 +349,9 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   friend class TaskManagerBrowserTest;
   FRIEND_TEST_ALL_PREFIXES(ExtensionApiTest, ProcessesVsTaskManager);
   FRIEND_TEST_ALL_PREFIXES(TaskManagerTest, RefreshCalled);
+  FRIEND_TEST_ALL_PREFIXES(TaskManagerTest, SamplesGatheredColumns);
+  FRIEND_TEST_ALL_PREFIXES(TaskManagerTest, NotifiesChangedRows);
+  FRIEND_TEST_ALL_PREFIXES(TaskManagerTest, RunsSampledCallbacks);
   FRIEND_TEST_ALL_PREFIXES(TaskManagerWindowControllerTest,
                            SelectionAdaptsToSorting);
 
@@ -345,6 +369,13 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   static const int kUpdateTimeMs = 1000;
 #endif
 
+  // Per-process values sampled only while a column showing them is gathered.
+  enum SampledValues {
+    SAMPLE_PRIVATE_AND_SHARED_MEMORY = 1 << 0,
+    SAMPLE_PHYSICAL_MEMORY = 1 << 1,
+    SAMPLE_HANDLES = 1 << 2,  // GDI and USER handles.
+  };
+
   // Values cached per resource. Values are validated on demand. The is_XXX
   // members indicate if a value is valid.
   struct PerResourceValues {
@@ -452,6 +483,34 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   // Callback from the timer to refresh. Invokes Refresh() as appropriate.
   void RefreshCallback();
 
+  // Posts a task sampling every process once to |sampling_task_runner_|. Does
+  // nothing if the previous sample has not been published yet.
+  void SampleProcesses();
+
+  // Samples the processes of |metrics_map| on |sampling_task_runner_|. CPU
+  // usage and idle wakeups are always sampled, since ProcessMetrics reports
+  // them relative to the previous call; other values only if they are set in
+  // |sampled_values|.
+  static void SampleProcessesOnSequence(const MetricsMap& metrics_map,
+                                        int sampled_values,
+                                        PerProcessCache* samples);
+
+  // Publishes |samples| and the network usage of the last tick, notifies
+  // observers of the rows whose values changed, and runs the callbacks that
+  // were waiting for this sample.
+  void OnProcessesSampled(PerProcessCache* samples);
+
+  // Returns true if the values of the row at |index| differ from
+  // |old_resource| and |old_process|, the values it had before the last
+  // sample. Values read from the resource are only compared if they were
+  // displayed since then.
+  bool HasRowChanged(int index,
+                     const PerResourceValues& old_resource,
+                     const PerProcessValues& old_process) const;
+
+  // Returns the SampledValues needed by the gathered columns.
+  int GetSampledValues() const;
+
   void RefreshVideoMemoryUsageStats();
 
   // Returns the network usage (in bytes per seconds) for the specified
@@ -486,11 +545,6 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   // displayed in the task manager's memory cell.
   base::string16 GetMemCellText(int64 number) const;
 
-  // Verifies the private and shared memory for |handle| is valid in
-  // |per_process_cache_|. Returns true if the data in |per_process_cache_| is
-  // valid.
-  bool CachePrivateAndSharedMemory(base::ProcessHandle handle) const;
-
   // Verifies |webcore_stats| in |per_resource_cache_|, returning true on
   // success.
   bool CacheWebCoreStats(int index) const;
@@ -521,13 +575,32 @@ class TaskManagerModel : public base::RefCountedThreadSafe<TaskManagerModel> {
   GroupMap group_map_;
 
   // A map to retrieve the process metrics for a process. The ProcessMetrics are
-  // owned by the model.
+  // owned by the model, but only used and deleted on |sampling_task_runner_|.
   MetricsMap metrics_map_;
 
   // A map that keeps track of the number of bytes read per process since last
   // tick. The Resources are owned by the ResourceProviders.
   ResourceValueMap current_byte_count_map_;
 
+  // The network usage of each resource during the last tick, published along
+  // with the next process sample.
+  ResourceValueMap network_usage_map_;
+
+  // The sequence on which the processes are sampled.
+  scoped_refptr<base::SequencedTaskRunner> sampling_task_runner_;
+
+  // True while a process sample has been posted but not published.
+  bool sample_pending_;
+
+  // The columns for which expensive values are gathered, once per call to
+  // StartGatheringColumn.
+  std::multiset<int> gathered_columns_;
+
+  // Callbacks waiting for the next sample to be posted, and callbacks waiting
+  // for the pending sample to be published.
+  std::vector<base::Closure> on_sampled_callbacks_;
+  std::vector<base::Closure> pending_sample_callbacks_;
+
   // A map that contains the video memory usage for a process
   content::GPUVideoMemoryUsageStats video_memory_usage_stats_;
 
@@ -5,7 +5,9 @@
 #include "chrome/browser/task_manager/task_manager.h"
 
 #include <string>
+#include <vector>
 
+#include "base/bind.h"
 #include "base/message_loop/message_loop.h"
 #include "base/strings/utf_string_conversions.h"
 #include "chrome/browser/task_manager/resource_provider.h"
@@ -60,6 +62,35 @@ class TestResource : public task_manager::Resource {
   bool refresh_called_;
 };
 
+class TestObserver : public TaskManagerModelObserver {
+ public:
+  TestObserver() : refreshed_count_(0) {}
+
+  virtual void OnModelChanged() OVERRIDE {}
+  virtual void OnItemsChanged(int start, int length) OVERRIDE {
+    changed_ranges_.push_back(TaskManagerModel::GroupRange(start, length));
+  }
+  virtual void OnItemsAdded(int start, int length) OVERRIDE {}
+  virtual void OnItemsRemoved(int start, int length) OVERRIDE {}
+  virtual void OnItemsRefreshed() OVERRIDE { ++refreshed_count_; }
+
+  const std::vector<TaskManagerModel::GroupRange>& changed_ranges() const {
+    return changed_ranges_;
+  }
+  void clear_changed_ranges() { changed_ranges_.clear(); }
+  int refreshed_count() const { return refreshed_count_; }
+
+ private:
+  std::vector<TaskManagerModel::GroupRange> changed_ranges_;
+  int refreshed_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(TestObserver);
+};
+
+void IncrementCount(int* count) {
+  ++*count;
+}
+
 }  // namespace
 
 class TaskManagerTest : public testing::Test {
@@ -117,10 +148,110 @@ TEST_F(TaskManagerTest, RefreshCalled) {
   TaskManagerModel* model = task_manager.model_.get();
   TestResource resource;
 
+  model->sampling_task_runner_ = loop.message_loop_proxy();
+
   task_manager.AddResource(&resource);
   ASSERT_FALSE(resource.refresh_called());
   model->update_state_ = TaskManagerModel::TASK_PENDING;
   model->Refresh();
   ASSERT_TRUE(resource.refresh_called());
   task_manager.RemoveResource(&resource);
+  loop.RunUntilIdle();
+}
+
+// Tests that memory is only sampled while its column is gathered.
+TEST_F(TaskManagerTest, SamplesGatheredColumns) {
+  base::MessageLoop loop;
+  TaskManager task_manager;
+  TaskManagerModel* model = task_manager.model_.get();
+  model->sampling_task_runner_ = loop.message_loop_proxy();
+  TestResource resource;
+  task_manager.AddResource(&resource);
+
+  size_t private_memory;
+  model->Refresh();
+  loop.RunUntilIdle();
+  EXPECT_FALSE(model->GetPrivateMemory(0, &private_memory));
+
+  model->StartGatheringColumn(IDS_TASK_MANAGER_PRIVATE_MEM_COLUMN);
+  model->Refresh();
+  loop.RunUntilIdle();
+  EXPECT_TRUE(model->GetPrivateMemory(0, &private_memory));
+  EXPECT_GT(private_memory, 0U);
+
+  model->StopGatheringColumn(IDS_TASK_MANAGER_PRIVATE_MEM_COLUMN);
+  model->Refresh();
+  loop.RunUntilIdle();
+  EXPECT_FALSE(model->GetPrivateMemory(0, &private_memory));
+
+  task_manager.RemoveResource(&resource);
+  loop.RunUntilIdle();
+}
+
+// Tests that observers are only told about the rows whose values changed.
+TEST_F(TaskManagerTest, NotifiesChangedRows) {
+  base::MessageLoop loop;
+  TaskManager task_manager;
+  TaskManagerModel* model = task_manager.model_.get();
+  model->sampling_task_runner_ = loop.message_loop_proxy();
+  TestResource resource1, resource2;
+  task_manager.AddResource(&resource1);
+  task_manager.AddResource(&resource2);
+  TestObserver observer;
+  model->AddObserver(&observer);
+
+  // Both rows show a title, and only the second one has network usage.
+  EXPECT_EQ(ASCIIToUTF16("test title"), model->GetResourceTitle(0));
+  EXPECT_EQ(ASCIIToUTF16("test title"), model->GetResourceTitle(1));
+  TaskManagerModel::PerProcessCache samples;
+  model->per_process_cache_.clear();
+  model->network_usage_map_[&resource2] = 1024;
+  model->sample_pending_ = true;
+  model->OnProcessesSampled(&samples);
+  ASSERT_EQ(1U, observer.changed_ranges().size());
+  EXPECT_EQ(1, observer.changed_ranges()[0].first);
+  EXPECT_EQ(1, observer.changed_ranges()[0].second);
+  EXPECT_EQ(1, observer.refreshed_count());
+
+  // Nothing changed since the last sample.
+  observer.clear_changed_ranges();
+  model->sample_pending_ = true;
+  model->OnProcessesSampled(&samples);
+  EXPECT_TRUE(observer.changed_ranges().empty());
+  EXPECT_EQ(2, observer.refreshed_count());
+
+  model->RemoveObserver(&observer);
+  task_manager.RemoveResource(&resource1);
+  task_manager.RemoveResource(&resource2);
+  loop.RunUntilIdle();
+}
+
+// Tests that sampled callbacks wait for a sample posted after them.
+TEST_F(TaskManagerTest, RunsSampledCallbacks) {
+  base::MessageLoop loop;
+  TaskManager task_manager;
+  TaskManagerModel* model = task_manager.model_.get();
+  model->sampling_task_runner_ = loop.message_loop_proxy();
+  TestResource resource;
+  task_manager.AddResource(&resource);
+
+  // The pending sample may not include the columns gathered since it was
+  // posted.
+  int count = 0;
+  model->Refresh();
+  model->RegisterOnSampledCallback(base::Bind(&IncrementCount, &count));
+  loop.RunUntilIdle();
+  EXPECT_EQ(0, count);
+
+  model->Refresh();
+  loop.RunUntilIdle();
+  EXPECT_EQ(1, count);
+
+  // Callbacks only run once.
+  model->Refresh();
+  loop.RunUntilIdle();
+  EXPECT_EQ(1, count);
+
+  task_manager.RemoveResource(&resource);
+  loop.RunUntilIdle();
 }
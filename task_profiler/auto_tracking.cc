@@ -9,7 +9,7 @@ namespace task_profiler {
 
 AutoTracking::~AutoTracking() {
   if (!output_file_path_.empty()) {
-    TaskProfilerDataSerializer output;
+    TaskProfilerDataSerializer output(aggregate_by_location_);
     output.WriteToFile(output_file_path_);
   }
 }
@@ -19,7 +19,7 @@ namespace task_profiler {
 
 class AutoTracking {
  public:
-  AutoTracking() {
+  AutoTracking() : aggregate_by_location_(false) {
     tracked_objects::ThreadData::Initialize();
   }
 
@@ -27,8 +27,15 @@ class AutoTracking {
 
   void set_output_file_path(const base::FilePath &path);
 
+  // Merges the output data by location, see
+  // TaskProfilerDataSerializer::MergeByLocation().
+  void set_aggregate_by_location(bool aggregate_by_location) {
+    aggregate_by_location_ = aggregate_by_location;
+  }
+
  private:
   base::FilePath output_file_path_;
+  bool aggregate_by_location_;
 
   DISALLOW_COPY_AND_ASSIGN(AutoTracking);
 };
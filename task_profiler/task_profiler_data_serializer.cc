@@ -4,11 +4,21 @@
 
 #include "chrome/browser/task_profiler/task_profiler_data_serializer.h"
 
+#include <algorithm>
+#include <string>
+
+#include "base/bind.h"
+#include "base/callback.h"
 #include "base/file_util.h"
 #include "base/files/file_path.h"
-#include "base/json/json_string_value_serializer.h"
+#include "base/json/json_writer.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
 #include "base/time/time.h"
 #include "base/tracked_objects.h"
+#include "base/values.h"
+#include "chrome/browser/metrics/jank_sampler.h"
 #include "chrome/common/chrome_content_client.h"
 #include "content/public/common/process_type.h"
 #include "url/gurl.h"
@@ -25,6 +35,10 @@ using tracked_objects::ProcessDataSnapshot;
 
 namespace {
 
+// Version 1 files hold a single JSON dictionary; version 2 files hold a header
+// and one chunk of process data per line.
+const int kFileFormatVersion = 2;
+
 // Re-serializes the |location| into |dictionary|.
 void LocationSnapshotToValue(const LocationSnapshot& location,
                              base::DictionaryValue* dictionary) {
@@ -92,79 +106,242 @@ void TaskSnapshotToValue(const TaskSnapshot& snapshot,
 
 }
 
+// Serializes the tasks in [|task_begin|, |task_end|) and the parent-child
+// pairs in [|pair_begin|, |pair_end|) of |process_data| into |dictionary|.
+void ProcessDataRangeToValue(const ProcessDataSnapshot& process_data,
+                             int process_type,
+                             size_t task_begin,
+                             size_t task_end,
+                             size_t pair_begin,
+                             size_t pair_end,
+                             base::DictionaryValue* dictionary) {
+  scoped_ptr<base::ListValue> tasks_list(new base::ListValue);
+  for (size_t i = task_begin; i < task_end; ++i) {
+    scoped_ptr<base::DictionaryValue> snapshot(new base::DictionaryValue);
+    TaskSnapshotToValue(process_data.tasks[i], snapshot.get());
+    tasks_list->Append(snapshot.release());
+  }
+  dictionary->Set("list", tasks_list.release());
+
+  dictionary->SetInteger("process_id", process_data.process_id);
+  dictionary->SetString("process_type",
+                        content::GetProcessTypeNameInEnglish(process_type));
+
+  scoped_ptr<base::ListValue> descendants_list(new base::ListValue);
+  for (size_t i = pair_begin; i < pair_end; ++i) {
+    const ParentChildPairSnapshot& pair = process_data.descendants[i];
+    scoped_ptr<base::DictionaryValue> parent_child(new base::DictionaryValue);
+    BirthOnThreadSnapshotToValue(pair.parent, "parent", parent_child.get());
+    BirthOnThreadSnapshotToValue(pair.child, "child", parent_child.get());
+    descendants_list->Append(parent_child.release());
+  }
+  dictionary->Set("descendants", descendants_list.release());
+}
+
+// Returns |thread_name| with a numeric suffix replaced by "*", the way
+// about:profiler merges similar threads: "WorkerPool/123" is "WorkerPool/*".
+std::string MergeSimilarThreadName(const std::string& thread_name) {
+  size_t suffix_begin = thread_name.size();
+  while (suffix_begin > 0 && IsAsciiDigit(thread_name[suffix_begin - 1]))
+    --suffix_begin;
+  if (suffix_begin == 0 || suffix_begin == thread_name.size())
+    return thread_name;
+  return thread_name.substr(0, suffix_begin) + "*";
+}
+
+// Returns the key under which MergeByLocation() combines |task|.
+std::string GetMergeKey(const TaskSnapshot& task) {
+  return task.birth.location.file_name + '\n' +
+      task.birth.location.function_name + '\n' +
+      base::IntToString(task.birth.location.line_number) + '\n' +
+      task.birth.thread_name + '\n' + task.death_thread_name;
+}
+
+// Adds the deaths of |from| to |to|.
+void MergeDeathData(const DeathDataSnapshot& from, DeathDataSnapshot* to) {
+  to->count += from.count;
+  to->run_duration_sum += from.run_duration_sum;
+  to->run_duration_max = std::max(to->run_duration_max, from.run_duration_max);
+  to->run_duration_sample = from.run_duration_sample;
+  to->queue_duration_sum += from.queue_duration_sum;
+  to->queue_duration_max =
+      std::max(to->queue_duration_max, from.queue_duration_max);
+  to->queue_duration_sample = from.queue_duration_sample;
+}
+
 }  // anonymous namespace
 
 namespace task_profiler {
 
+// static
+const size_t TaskProfilerDataSerializer::kMaxTasksPerChunk = 1000;
+
+TaskProfilerDataSerializer::TaskProfilerDataSerializer(
+    bool aggregate_by_location)
+    : aggregate_by_location_(aggregate_by_location),
+      file_(NULL),
+      succeeded_(false) {
+}
+
+TaskProfilerDataSerializer::~TaskProfilerDataSerializer() {
+  if (file_)
+    base::CloseFile(file_);
+}
+
 // static
 void TaskProfilerDataSerializer::ToValue(
     const ProcessDataSnapshot& process_data,
     int process_type,
     base::DictionaryValue* dictionary) {
-  scoped_ptr<base::ListValue> tasks_list(new base::ListValue);
+  ProcessDataRangeToValue(process_data, process_type,
+                          0, process_data.tasks.size(),
+                          0, process_data.descendants.size(),
+                          dictionary);
+}
+
+// static
+void TaskProfilerDataSerializer::ToValueChunks(
+    const ProcessDataSnapshot& process_data,
+    int process_type,
+    const ChunkCallback& callback) {
+  const size_t task_count = process_data.tasks.size();
+  const size_t pair_count = process_data.descendants.size();
+  // A process without any data still gets a chunk, so that it is listed.
+  size_t begin = 0;
+  do {
+    const size_t end = begin + kMaxTasksPerChunk;
+    base::DictionaryValue chunk;
+    ProcessDataRangeToValue(process_data, process_type,
+                            std::min(begin, task_count),
+                            std::min(end, task_count),
+                            std::min(begin, pair_count),
+                            std::min(end, pair_count),
+                            &chunk);
+    callback.Run(chunk);
+    begin = end;
+  } while (begin < task_count || begin < pair_count);
+}
+
+// static
+void TaskProfilerDataSerializer::MergeByLocation(
+    const ProcessDataSnapshot& process_data,
+    ProcessDataSnapshot* merged) {
+  std::map<std::string, size_t> merged_indices;
+  for (size_t i = 0; i < merged->tasks.size(); ++i)
+    merged_indices[GetMergeKey(merged->tasks[i])] = i;
+
   for (std::vector<TaskSnapshot>::const_iterator it =
            process_data.tasks.begin();
        it != process_data.tasks.end(); ++it) {
-    scoped_ptr<base::DictionaryValue> snapshot(new base::DictionaryValue);
-    TaskSnapshotToValue(*it, snapshot.get());
-    tasks_list->Append(snapshot.release());
+    TaskSnapshot task;
+    task.birth.location = it->birth.location;
+    task.birth.thread_name = MergeSimilarThreadName(it->birth.thread_name);
+    task.death_thread_name = MergeSimilarThreadName(it->death_thread_name);
+
+    std::pair<std::map<std::string, size_t>::iterator, bool> inserted =
+        merged_indices.insert(
+            std::make_pair(GetMergeKey(task), merged->tasks.size()));
+    if (inserted.second) {
+      task.death_data = it->death_data;
+      merged->tasks.push_back(task);
+    } else {
+      MergeDeathData(it->death_data,
+                     &merged->tasks[inserted.first->second].death_data);
+    }
   }
-  dictionary->Set("list", tasks_list.release());
+}
 
-  dictionary->SetInteger("process_id", process_data.process_id);
-  dictionary->SetString("process_type",
-                        content::GetProcessTypeNameInEnglish(process_type));
+bool TaskProfilerDataSerializer::Open(const base::FilePath& path) {
+  DCHECK(!file_);
+  file_ = base::OpenFile(path, "w");
+  if (!file_)
+    return false;
+  succeeded_ = true;
 
-  scoped_ptr<base::ListValue> descendants_list(new base::ListValue);
-  for (std::vector<ParentChildPairSnapshot>::const_iterator it =
-           process_data.descendants.begin();
-       it != process_data.descendants.end(); ++it) {
-    scoped_ptr<base::DictionaryValue> parent_child(new base::DictionaryValue);
-    BirthOnThreadSnapshotToValue(it->parent, "parent", parent_child.get());
-    BirthOnThreadSnapshotToValue(it->child, "child", parent_child.get());
-    descendants_list->Append(parent_child.release());
+  base::DictionaryValue header;
+  header.SetInteger("version", kFileFormatVersion);
+  header.SetString("userAgent", GetUserAgent());
+  header.SetInteger(
+      "timestamp",
+      (base::Time::Now() - base::Time::UnixEpoch()).InSeconds());
+  WriteChunk(header);
+  return succeeded_;
+}
+
+bool TaskProfilerDataSerializer::AddProcessData(
+    const ProcessDataSnapshot& process_data,
+    int process_type) {
+  DCHECK(file_);
+  if (aggregate_by_location_) {
+    ProcessDataSnapshot* merged = &aggregated_data_[process_type];
+    MergeByLocation(process_data, merged);
+    // Aggregated data doesn't belong to a single process.
+    merged->process_id = 0;
+    return succeeded_;
   }
-  dictionary->Set("descendants", descendants_list.release());
+
+  ToValueChunks(process_data, process_type,
+                base::Bind(&TaskProfilerDataSerializer::WriteChunk,
+                           base::Unretained(this)));
+  return succeeded_;
 }
 
+bool TaskProfilerDataSerializer::Close() {
+  DCHECK(file_);
+  for (std::map<int, ProcessDataSnapshot>::const_iterator it =
+           aggregated_data_.begin();
+       it != aggregated_data_.end(); ++it) {
+    ToValueChunks(it->second, it->first,
+                  base::Bind(&TaskProfilerDataSerializer::WriteChunk,
+                             base::Unretained(this)));
+  }
+  aggregated_data_.clear();
 
-bool TaskProfilerDataSerializer::WriteToFile(const base::FilePath& path) {
-  std::string output;
-  JSONStringValueSerializer serializer(&output);
-  serializer.set_pretty_print(true);
+  if (!base::CloseFile(file_))
+    succeeded_ = false;
+  file_ = NULL;
+  return succeeded_;
+}
 
-  scoped_ptr<base::DictionaryValue> root(new base::DictionaryValue());
+void TaskProfilerDataSerializer::WriteChunk(
+    const base::DictionaryValue& chunk) {
+  if (!succeeded_)
+    return;
+  std::string line;
+  base::JSONWriter::Write(&chunk, &line);
+  line.push_back('\n');
+  if (fwrite(line.data(), 1, line.size(), file_) != line.size())
+    succeeded_ = false;
+}
 
-  base::ListValue* snapshot_list = new base::ListValue();
-  base::DictionaryValue* shutdown_snapshot = new base::DictionaryValue();
-  base::ListValue* per_process_data = new base::ListValue();
+void TaskProfilerDataSerializer::WriteJankSamplerChunk(
+    const base::DictionaryValue& chunk) {
+  scoped_ptr<base::DictionaryValue> jank_chunk(chunk.DeepCopy());
+  jank_chunk->SetString("process_type", JankSampler::kProcessTypeName);
+  WriteChunk(*jank_chunk);
+}
 
-  root->SetInteger("version", 1);
-  root->SetString("userAgent", GetUserAgent());
+bool TaskProfilerDataSerializer::WriteToFile(const base::FilePath& path) {
+  if (!Open(path))
+    return false;
 
-  // TODO(ramant): Collect data from other processes, then add that data to the
-  // 'per_process_data' array here. Should leverage the TrackingSynchronizer
-  // class to implement this.
+  // TODO(ramant): Collect data from other processes, then add it here as it
+  // arrives. Should leverage the TrackingSynchronizer class to implement this.
   ProcessDataSnapshot this_process_data;
   tracked_objects::ThreadData::Snapshot(false, &this_process_data);
-  scoped_ptr<base::DictionaryValue> this_process_data_json(
-      new base::DictionaryValue);
-  TaskProfilerDataSerializer::ToValue(this_process_data,
-                                      content::PROCESS_TYPE_BROWSER,
-                                      this_process_data_json.get());
-  per_process_data->Append(this_process_data_json.release());
-
-  shutdown_snapshot->SetInteger(
-      "timestamp",
-      (base::Time::Now() - base::Time::UnixEpoch()).InSeconds());
-  shutdown_snapshot->Set("data", per_process_data);
-  snapshot_list->Append(shutdown_snapshot);
-  root->Set("snapshots", snapshot_list);
+  AddProcessData(this_process_data, content::PROCESS_TYPE_BROWSER);
 
-  serializer.Serialize(*root);
-  int data_size = static_cast<int>(output.size());
+  // The slow tasks are already aggregated by location, and are written under
+  // their own process type so that they aren't merged into the browser's.
+  ProcessDataSnapshot jank_data;
+  JankSampler::GetInstance()->GetSnapshot(&jank_data);
+  if (!jank_data.tasks.empty()) {
+    ToValueChunks(jank_data, content::PROCESS_TYPE_BROWSER,
+                  base::Bind(&TaskProfilerDataSerializer::WriteJankSamplerChunk,
+                             base::Unretained(this)));
+  }
 
-  return data_size == base::WriteFile(path, output.data(), data_size);
+  return Close();
 }
 
 }  // namespace task_profiler
@@ -5,33 +5,98 @@
 #ifndef CHROME_BROWSER_TASK_PROFILER_TASK_PROFILER_DATA_SERIALIZER_H_
 #define CHROME_BROWSER_TASK_PROFILER_TASK_PROFILER_DATA_SERIALIZER_H_
 
+#include <stdio.h>
+
+#include <map>
+
 #include "base/basictypes.h"
+#include "base/callback_forward.h"
+#include "base/tracked_objects.h"
 
 namespace base {
 class DictionaryValue;
 class FilePath;
 }
 
-namespace tracked_objects {
-struct ProcessDataSnapshot;
-}
-
 namespace task_profiler {
 
 // This class collects task profiler data and serializes it to a file.  The file
 // format is compatible with the about:profiler UI.
+//
+// The file is written incrementally, so that the data of all processes never
+// has to be held in memory at once: the first line is a JSON header, and each
+// following line is a JSON dictionary in the ToValue() format holding a chunk
+// of at most |kMaxTasksPerChunk| tasks of one process.
 class TaskProfilerDataSerializer {
  public:
-  TaskProfilerDataSerializer() {}
+  // Called with each chunk of serialized process data.
+  typedef base::Callback<void(const base::DictionaryValue&)> ChunkCallback;
+
+  // The most tasks or parent-child pairs serialized into a single chunk.
+  static const size_t kMaxTasksPerChunk;
+
+  // If |aggregate_by_location| is true, tasks are merged by MergeByLocation()
+  // per process type as they are added, and only written when the file is
+  // closed. This bounds the file size by the number of distinct locations
+  // instead of by the number of processes.
+  explicit TaskProfilerDataSerializer(bool aggregate_by_location);
+  ~TaskProfilerDataSerializer();
 
   // Writes the contents of |process_data| and |process_type| into |dictionary|.
   static void ToValue(const tracked_objects::ProcessDataSnapshot& process_data,
                       int process_type,
                       base::DictionaryValue* dictionary);
 
+  // Serializes |process_data| like ToValue(), but in chunks of at most
+  // |kMaxTasksPerChunk| tasks and parent-child pairs, each passed to
+  // |callback| before the next one is built.
+  static void ToValueChunks(
+      const tracked_objects::ProcessDataSnapshot& process_data,
+      int process_type,
+      const ChunkCallback& callback);
+
+  // Merges the tasks of |process_data| into |merged|. Tasks born at the same
+  // location, on threads whose names only differ by a numeric suffix, and
+  // which died on such threads, are combined into one task, as when
+  // about:profiler merges similar threads. Parent-child pairs are dropped.
+  static void MergeByLocation(
+      const tracked_objects::ProcessDataSnapshot& process_data,
+      tracked_objects::ProcessDataSnapshot* merged);
+
+  // Creates the file at |path| and writes the header. Returns false if the
+  // file couldn't be written.
+  bool Open(const base::FilePath& path);
+
+  // Writes, or aggregates, the data of one process. May be called as the data
+  // of each process arrives. Returns false if the file couldn't be written.
+  bool AddProcessData(const tracked_objects::ProcessDataSnapshot& process_data,
+                      int process_type);
+
+  // Writes the aggregated data, if any, and closes the file. Returns false if
+  // the file couldn't be written.
+  bool Close();
+
+  // Writes the data of the browser process to |path|.
   bool WriteToFile(const base::FilePath& path);
 
  private:
+  // Writes |chunk| as a line of the file.
+  void WriteChunk(const base::DictionaryValue& chunk);
+
+  // Writes |chunk| of JankSampler data, under the JankSampler's process type.
+  void WriteJankSamplerChunk(const base::DictionaryValue& chunk);
+
+  const bool aggregate_by_location_;
+
+  // The file being written, or NULL.
+  FILE* file_;
+
+  // False once writing to |file_| failed.
+  bool succeeded_;
+
+  // The tasks aggregated so far, by process type.
+  std::map<int, tracked_objects::ProcessDataSnapshot> aggregated_data_;
+
   DISALLOW_COPY_AND_ASSIGN(TaskProfilerDataSerializer);
 };
 
@@ -5,9 +5,16 @@
 #include <string>
 
 #include "base/basictypes.h"
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_reader.h"
 #include "base/json/json_writer.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
 #include "base/process/process_handle.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
 #include "base/tracked_objects.h"
 #include "base/values.h"
 #include "chrome/browser/task_profiler/task_profiler_data_serializer.h"
@@ -34,6 +41,37 @@ void ExpectSerialization(
   EXPECT_EQ(expected_json, serialized_json);
 }
 
+void AddTask(const std::string& function_name,
+             const std::string& birth_thread,
+             const std::string& death_thread,
+             int run_duration,
+             tracked_objects::ProcessDataSnapshot* process_data) {
+  process_data->tasks.push_back(tracked_objects::TaskSnapshot());
+  tracked_objects::TaskSnapshot& task = process_data->tasks.back();
+  task.birth.location.file_name = "path/to/foo.cc";
+  task.birth.location.function_name = function_name;
+  task.birth.location.line_number = 101;
+  task.birth.thread_name = birth_thread;
+  task.death_data.count = 1;
+  task.death_data.run_duration_sum = run_duration;
+  task.death_data.run_duration_max = run_duration;
+  task.death_data.run_duration_sample = run_duration;
+  task.death_thread_name = death_thread;
+}
+
+void AppendChunk(ScopedVector<base::DictionaryValue>* chunks,
+                 const base::DictionaryValue& chunk) {
+  chunks->push_back(chunk.DeepCopy());
+}
+
+// Returns the number of entries in the |key| list of |chunk|.
+size_t GetListSize(const base::DictionaryValue& chunk,
+                   const std::string& key) {
+  const base::ListValue* list = NULL;
+  EXPECT_TRUE(chunk.GetList(key, &list));
+  return list ? list->GetSize() : 0;
+}
+
 }  // anonymous namespace
 
 // Tests the JSON serialization format for profiled process data.
@@ -159,3 +197,114 @@ TEST(TaskProfilerDataSerializerTest, SerializeProcessDataToJson) {
                         "}");
   }
 }
+
+TEST(TaskProfilerDataSerializerTest, SerializeProcessDataInChunks) {
+  const size_t kChunkSize =
+      task_profiler::TaskProfilerDataSerializer::kMaxTasksPerChunk;
+  tracked_objects::ProcessDataSnapshot process_data;
+  for (size_t i = 0; i < kChunkSize + 1; ++i)
+    AddTask(base::IntToString(i), "CrBrowserMain", "CrBrowserMain", 1,
+            &process_data);
+  process_data.descendants.resize(2);
+
+  ScopedVector<base::DictionaryValue> chunks;
+  task_profiler::TaskProfilerDataSerializer::ToValueChunks(
+      process_data, content::PROCESS_TYPE_BROWSER,
+      base::Bind(&AppendChunk, &chunks));
+  ASSERT_EQ(2U, chunks.size());
+  EXPECT_EQ(kChunkSize, GetListSize(*chunks[0], "list"));
+  EXPECT_EQ(2U, GetListSize(*chunks[0], "descendants"));
+  EXPECT_EQ(1U, GetListSize(*chunks[1], "list"));
+  EXPECT_EQ(0U, GetListSize(*chunks[1], "descendants"));
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    int process_id = 0;
+    EXPECT_TRUE(chunks[i]->GetInteger("process_id", &process_id));
+    EXPECT_EQ(process_data.process_id, process_id);
+  }
+
+  // A process without data is still listed.
+  chunks.clear();
+  task_profiler::TaskProfilerDataSerializer::ToValueChunks(
+      tracked_objects::ProcessDataSnapshot(), content::PROCESS_TYPE_BROWSER,
+      base::Bind(&AppendChunk, &chunks));
+  ASSERT_EQ(1U, chunks.size());
+  EXPECT_EQ(0U, GetListSize(*chunks[0], "list"));
+}
+
+TEST(TaskProfilerDataSerializerTest, MergeByLocation) {
+  tracked_objects::ProcessDataSnapshot process_data;
+  AddTask("WhizBang", "CrBrowserMain", "WorkerPool/12", 5, &process_data);
+  AddTask("WhizBang", "CrBrowserMain", "WorkerPool/345", 7, &process_data);
+  AddTask("WhizBang", "CrBrowserMain", "Chrome_IOThread", 3, &process_data);
+  AddTask("FizzBoom", "CrBrowserMain", "WorkerPool/12", 11, &process_data);
+  process_data.descendants.resize(1);
+
+  tracked_objects::ProcessDataSnapshot merged;
+  task_profiler::TaskProfilerDataSerializer::MergeByLocation(process_data,
+                                                             &merged);
+  ASSERT_EQ(3U, merged.tasks.size());
+  EXPECT_TRUE(merged.descendants.empty());
+  EXPECT_EQ("WhizBang", merged.tasks[0].birth.location.function_name);
+  EXPECT_EQ("WorkerPool/*", merged.tasks[0].death_thread_name);
+  EXPECT_EQ(2, merged.tasks[0].death_data.count);
+  EXPECT_EQ(12, merged.tasks[0].death_data.run_duration_sum);
+  EXPECT_EQ(7, merged.tasks[0].death_data.run_duration_max);
+  EXPECT_EQ("Chrome_IOThread", merged.tasks[1].death_thread_name);
+  EXPECT_EQ(1, merged.tasks[1].death_data.count);
+  EXPECT_EQ("FizzBoom", merged.tasks[2].birth.location.function_name);
+
+  // Merging another process adds to the existing tasks.
+  task_profiler::TaskProfilerDataSerializer::MergeByLocation(process_data,
+                                                             &merged);
+  ASSERT_EQ(3U, merged.tasks.size());
+  EXPECT_EQ(4, merged.tasks[0].death_data.count);
+  EXPECT_EQ(2, merged.tasks[2].death_data.count);
+}
+
+TEST(TaskProfilerDataSerializerTest, WriteFileIncrementally) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const base::FilePath path = temp_dir.path().AppendASCII("profile.json");
+
+  tracked_objects::ProcessDataSnapshot process_data;
+  AddTask("WhizBang", "CrBrowserMain", "WorkerPool/12", 5, &process_data);
+  AddTask("WhizBang", "CrBrowserMain", "WorkerPool/345", 7, &process_data);
+
+  for (int aggregate = 0; aggregate < 2; ++aggregate) {
+    SCOPED_TRACE(aggregate);
+    task_profiler::TaskProfilerDataSerializer serializer(aggregate != 0);
+    ASSERT_TRUE(serializer.Open(path));
+    EXPECT_TRUE(serializer.AddProcessData(process_data,
+                                          content::PROCESS_TYPE_RENDERER));
+    EXPECT_TRUE(serializer.AddProcessData(process_data,
+                                          content::PROCESS_TYPE_RENDERER));
+    EXPECT_TRUE(serializer.Close());
+
+    std::string contents;
+    ASSERT_TRUE(base::ReadFileToString(path, &contents));
+    std::vector<std::string> lines;
+    base::SplitString(contents, '\n', &lines);
+    // Each line, including the last one, ends with a newline.
+    ASSERT_FALSE(lines.empty());
+    EXPECT_TRUE(lines.back().empty());
+    lines.pop_back();
+
+    ASSERT_EQ(aggregate ? 2U : 3U, lines.size());
+    scoped_ptr<base::Value> header(base::JSONReader::Read(lines[0]));
+    ASSERT_TRUE(header.get());
+    base::DictionaryValue* header_dictionary = NULL;
+    ASSERT_TRUE(header->GetAsDictionary(&header_dictionary));
+    int version = 0;
+    EXPECT_TRUE(header_dictionary->GetInteger("version", &version));
+    EXPECT_EQ(2, version);
+
+    for (size_t i = 1; i < lines.size(); ++i) {
+      scoped_ptr<base::Value> value(base::JSONReader::Read(lines[i]));
+      ASSERT_TRUE(value.get());
+      base::DictionaryValue* chunk = NULL;
+      ASSERT_TRUE(value->GetAsDictionary(&chunk));
+      // Aggregation merges both processes and both worker threads.
+      EXPECT_EQ(aggregate ? 1U : 2U, GetListSize(*chunk, "list"));
+    }
+  }
+}
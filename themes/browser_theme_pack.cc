@@ -4,8 +4,10 @@
 
 #include "chrome/browser/themes/browser_theme_pack.h"
 
+#include <algorithm>
 #include <limits>
 
+#include "base/bind.h"
 #include "base/files/file.h"
 #include "base/memory/ref_counted_memory.h"
 #include "base/memory/scoped_ptr.h"
@@ -13,6 +15,9 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/sys_info.h"
 #include "base/threading/sequenced_worker_pool.h"
 #include "base/threading/thread_restrictions.h"
 #include "base/values.h"
@@ -468,7 +473,7 @@ SkBitmap CreateLowQualityResizedBitmap(const SkBitmap& source_bitmap,
 }
 
 // A ImageSkiaSource that scales 100P image to the target scale factor
-// if the ImageSkiaRep for the target scale factor isn't available.
+// if the source image has no ImageSkiaRep for the target scale factor.
 class ThemeImageSource: public gfx::ImageSkiaSource {
  public:
   explicit ThemeImageSource(const gfx::ImageSkia& source) : source_(source) {
@@ -476,8 +481,9 @@ class ThemeImageSource: public gfx::ImageSkiaSource {
   virtual ~ThemeImageSource() {}
 
   virtual gfx::ImageSkiaRep GetImageForScale(float scale) OVERRIDE {
-    if (source_.HasRepresentation(scale))
-      return source_.GetRepresentation(scale);
+    const gfx::ImageSkiaRep& rep = source_.GetRepresentation(scale);
+    if (!rep.is_null() && rep.scale() == scale)
+      return rep;
     const gfx::ImageSkiaRep& rep_100p = source_.GetRepresentation(1.0f);
     SkBitmap scaled_bitmap = CreateLowQualityResizedBitmap(
         rep_100p.sk_bitmap(),
@@ -618,6 +624,106 @@ class TabBackgroundImageSource: public gfx::CanvasImageSource {
   DISALLOW_COPY_AND_ASSIGN(TabBackgroundImageSource);
 };
 
+// Encodes bitmaps as PNGs, each as an independent task. Tasks run on the
+// blocking pool and on the thread that calls Encode(), which takes part so
+// that encoding completes even if the blocking pool is busy or shutting down.
+class ThemeImageEncoder
+    : public base::RefCountedThreadSafe<ThemeImageEncoder> {
+ public:
+  typedef std::map<int, scoped_refptr<base::RefCountedMemory> > PngMap;
+
+  ThemeImageEncoder()
+      : next_bitmap_(0),
+        pending_bitmaps_(0),
+        all_bitmaps_encoded_(&lock_) {
+  }
+
+  // Queues |bitmap| to be encoded as the image |raw_id|. Must not be called
+  // once Encode() was called.
+  void AddBitmap(int raw_id, const SkBitmap& bitmap) {
+    bitmaps_.push_back(std::make_pair(raw_id, bitmap));
+  }
+
+  // Encodes all queued bitmaps into |pngs|, and returns once they are all
+  // encoded.
+  void Encode(PngMap* pngs) {
+    if (bitmaps_.empty())
+      return;
+    pending_bitmaps_ = bitmaps_.size();
+
+    size_t helper_count =
+        std::min(bitmaps_.size(),
+                 static_cast<size_t>(base::SysInfo::NumberOfProcessors())) - 1;
+    for (size_t i = 0; i < helper_count; ++i) {
+      BrowserThread::GetBlockingPool()->PostWorkerTaskWithShutdownBehavior(
+          FROM_HERE,
+          base::Bind(&ThemeImageEncoder::EncodeBitmaps, this),
+          base::SequencedWorkerPool::SKIP_ON_SHUTDOWN);
+    }
+    EncodeBitmaps();
+
+    base::AutoLock auto_lock(lock_);
+    while (pending_bitmaps_ > 0)
+      all_bitmaps_encoded_.Wait();
+    for (PngMap::const_iterator it = pngs_.begin(); it != pngs_.end(); ++it)
+      (*pngs)[it->first] = it->second;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<ThemeImageEncoder>;
+
+  ~ThemeImageEncoder() {}
+
+  // Encodes queued bitmaps until none are left.
+  void EncodeBitmaps() {
+    while (true) {
+      size_t index;
+      {
+        base::AutoLock auto_lock(lock_);
+        if (next_bitmap_ == bitmaps_.size())
+          return;
+        index = next_bitmap_++;
+      }
+
+      std::vector<unsigned char> png_data;
+      scoped_refptr<base::RefCountedMemory> png;
+      if (gfx::PNGCodec::EncodeBGRASkBitmap(bitmaps_[index].second, false,
+                                            &png_data)) {
+        png = base::RefCountedBytes::TakeVector(&png_data);
+      } else {
+        NOTREACHED() << "Image file for raw image " << bitmaps_[index].first
+                     << " could not be encoded.";
+      }
+
+      base::AutoLock auto_lock(lock_);
+      if (png.get())
+        pngs_[bitmaps_[index].first] = png;
+      if (--pending_bitmaps_ == 0)
+        all_bitmaps_encoded_.Signal();
+    }
+  }
+
+  // The bitmaps to encode, with their raw ids. Not modified once encoding
+  // starts.
+  std::vector<std::pair<int, SkBitmap> > bitmaps_;
+
+  // Guards the members below.
+  base::Lock lock_;
+
+  // The index in |bitmaps_| of the next bitmap to encode.
+  size_t next_bitmap_;
+
+  // The number of bitmaps not encoded yet.
+  size_t pending_bitmaps_;
+
+  // Signaled once |pending_bitmaps_| drops to 0.
+  base::ConditionVariable all_bitmaps_encoded_;
+
+  PngMap pngs_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThemeImageEncoder);
+};
+
 }  // namespace
 
 BrowserThemePack::~BrowserThemePack() {
@@ -657,14 +763,21 @@ scoped_refptr<BrowserThemePack> BrowserThemePack::BuildFromExtension(
 
   pack->CreateImages(&pack->images_on_ui_thread_);
 
-  // Make sure the |images_on_file_thread_| has bitmaps for supported
-  // scale factors before passing to FILE thread.
-  pack->images_on_file_thread_ = pack->images_on_ui_thread_;
-  for (ImageCache::iterator it = pack->images_on_file_thread_.begin();
-       it != pack->images_on_file_thread_.end(); ++it) {
-    gfx::ImageSkia* image_skia =
-        const_cast<gfx::ImageSkia*>(it->second.ToImageSkia());
-    image_skia->MakeThreadSafe();
+  // Render the bitmaps of |images_on_file_thread_| before passing them to the
+  // FILE thread. Images from the theme are only rendered at the scale factors
+  // the theme provides them at, as the other scale factors are resampled from
+  // those when first requested: by ThemeImageSource below, and by
+  // ThemeImagePngSource once the pack is read back from disk. Generated images
+  // may be built from default resources, and are rendered at all supported
+  // scale factors.
+  for (ImageCache::const_iterator it = pack->images_on_ui_thread_.begin();
+       it != pack->images_on_ui_thread_.end(); ++it) {
+    FilePathMap::const_iterator file_it = file_paths.find(it->first);
+    gfx::ImageSkia image_skia = pack->CreateThreadSafeImage(
+        it->second.AsImageSkia(),
+        file_it != file_paths.end() ? &file_it->second : NULL);
+    if (!image_skia.isNull())
+      pack->images_on_file_thread_[it->first] = gfx::Image(image_skia);
   }
 
   // Set ThemeImageSource on |images_on_ui_thread_| to resample the source
@@ -1450,9 +1563,25 @@ void BrowserThemePack::CreateTabBackgroundImages(ImageCache* images) const {
   MergeImageCaches(temp_output, images);
 }
 
+gfx::ImageSkia BrowserThemePack::CreateThreadSafeImage(
+    const gfx::ImageSkia& image_skia,
+    const ScaleFactorToFileMap* theme_files) const {
+  gfx::ImageSkia thread_safe_image_skia;
+  for (size_t i = 0; i < scale_factors_.size(); ++i) {
+    if (theme_files && !theme_files->count(scale_factors_[i]))
+      continue;
+    float scale = ui::GetImageScale(scale_factors_[i]);
+    const gfx::ImageSkiaRep& rep = image_skia.GetRepresentation(scale);
+    if (!rep.is_null() && rep.scale() == scale)
+      thread_safe_image_skia.AddRepresentation(rep);
+  }
+  thread_safe_image_skia.MakeThreadSafe();
+  return thread_safe_image_skia;
+}
+
 void BrowserThemePack::RepackImages(const ImageCache& images,
                                     RawImages* reencoded_images) const {
-  typedef std::vector<ui::ScaleFactor> ScaleFactors;
+  scoped_refptr<ThemeImageEncoder> encoder(new ThemeImageEncoder);
   for (ImageCache::const_iterator it = images.begin();
        it != images.end(); ++it) {
     gfx::ImageSkia image_skia = *it->second.ToImageSkia();
@@ -1464,19 +1593,13 @@ void BrowserThemePack::RepackImages(const ImageCache& images,
     }
     for (ImageSkiaReps::iterator rep_it = image_reps.begin();
          rep_it != image_reps.end(); ++rep_it) {
-      std::vector<unsigned char> bitmap_data;
-      if (!gfx::PNGCodec::EncodeBGRASkBitmap(rep_it->sk_bitmap(), false,
-                                             &bitmap_data)) {
-        NOTREACHED() << "Image file for resource " << it->first
-                     << " could not be encoded.";
-      }
       int raw_id = GetRawIDByPersistentID(
           it->first,
           ui::GetSupportedScaleFactor(rep_it->scale()));
-      (*reencoded_images)[raw_id] =
-          base::RefCountedBytes::TakeVector(&bitmap_data);
+      encoder->AddBitmap(raw_id, rep_it->sk_bitmap());
     }
   }
+  encoder->Encode(reencoded_images);
 }
 
 void BrowserThemePack::MergeImageCaches(
@@ -30,6 +30,7 @@ class Extensions;
 
 namespace gfx {
 class Image;
+class ImageSkia;
 }
 
 namespace ui {
@@ -41,7 +42,10 @@ class DataPack;
 // The idea is to pre-process all images (tinting, compositing, etc) at theme
 // install time, save all the PNG-ified data into an mmappable file so we don't
 // suffer multiple file system access times, therefore solving two of the
-// problems with the previous implementation.
+// problems with the previous implementation. Images provided by the theme are
+// only pre-processed at the scale factors the theme provides them at; other
+// scale factors are resampled when first requested. The PNG encoding of the
+// images is split into independent tasks on the blocking pool.
 //
 // A note on const-ness. All public, non-static methods are const.  We do this
 // because once we've constructed a BrowserThemePack through the
@@ -172,8 +176,17 @@ class BrowserThemePack : public CustomThemeSupplier {
   // in |images|. Must be called after GenerateFrameImages().
   void CreateTabBackgroundImages(ImageCache* images) const;
 
-  // Takes all the SkBitmaps in |images|, encodes them as PNGs and places
-  // them in |reencoded_images|.
+  // Returns an image with the representations of |image_skia| that can be
+  // used on any thread. If |theme_files| is non-NULL, |image_skia| is built
+  // from the theme's files in |theme_files|, and only the representations for
+  // their scale factors are included. Otherwise representations for all
+  // supported scale factors are included.
+  gfx::ImageSkia CreateThreadSafeImage(
+      const gfx::ImageSkia& image_skia,
+      const ScaleFactorToFileMap* theme_files) const;
+
+  // Takes all the SkBitmaps in |images|, encodes them as PNGs in parallel and
+  // places them in |reencoded_images|.
   void RepackImages(const ImageCache& images,
                     RawImages* reencoded_images) const;
 
@@ -265,10 +278,10 @@ class BrowserThemePack : public CustomThemeSupplier {
   // thread.
   ImageCache images_on_ui_thread_;
 
-  // Cache of images created in BuildFromExtension(). Once the theme pack is
-  // created, this cache should only be accessed on the file thread. There
-  // should be no IDs in |image_memory_| that are in |images_on_file_thread_|
-  // or vice versa.
+  // Cache of images created in BuildFromExtension(), built by
+  // CreateThreadSafeImage(). Once the theme pack is created, this cache should
+  // only be accessed on the file thread. There should be no IDs in
+  // |image_memory_| that are in |images_on_file_thread_| or vice versa.
   ImageCache images_on_file_thread_;
 
   DISALLOW_COPY_AND_ASSIGN(BrowserThemePack);
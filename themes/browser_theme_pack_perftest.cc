@@ -0,0 +1,123 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/themes/browser_theme_pack.h"
+
+#include <string>
+#include <vector>
+
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_file_value_serializer.h"
+#include "base/message_loop/message_loop.h"
+#include "base/path_service.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "chrome/common/chrome_paths.h"
+#include "content/public/test/test_browser_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "ui/base/layout.h"
+
+using content::BrowserThread;
+using extensions::Extension;
+
+namespace {
+
+const int kIterations = 5;
+
+void PrintTime(const std::string& theme,
+               const std::string& trace,
+               const base::TimeDelta& total) {
+  perf_test::PrintResult("browser_theme_pack", theme, trace,
+                         total.InMillisecondsF() / kIterations, "ms", true);
+}
+
+class BrowserThemePackPerfTest : public testing::Test {
+ public:
+  BrowserThemePackPerfTest()
+      : ui_thread_(BrowserThread::UI, &message_loop_),
+        file_thread_(BrowserThread::FILE, &message_loop_) {
+    std::vector<ui::ScaleFactor> scale_factors;
+    scale_factors.push_back(ui::SCALE_FACTOR_100P);
+    scale_factors.push_back(ui::SCALE_FACTOR_200P);
+    scoped_set_supported_scale_factors_.reset(
+        new ui::test::ScopedSetSupportedScaleFactors(scale_factors));
+  }
+
+  // Returns the theme extension at |relative_path| in the test data
+  // directory.
+  scoped_refptr<Extension> LoadTheme(const base::FilePath& relative_path) {
+    base::FilePath path;
+    if (!PathService::Get(chrome::DIR_TEST_DATA, &path))
+      return NULL;
+    path = path.Append(relative_path);
+    JSONFileValueSerializer serializer(path.AppendASCII("manifest.json"));
+    std::string error;
+    scoped_ptr<base::Value> manifest(serializer.Deserialize(NULL, &error));
+    if (!manifest.get() || !manifest->IsType(base::Value::TYPE_DICTIONARY))
+      return NULL;
+    return Extension::Create(
+        path,
+        extensions::Manifest::INVALID_LOCATION,
+        *static_cast<base::DictionaryValue*>(manifest.get()),
+        Extension::REQUIRE_KEY,
+        &error);
+  }
+
+  // Builds and writes the pack of |extension| |kIterations| times, and prints
+  // the average time taken by each step.
+  void MeasureBuild(const std::string& theme, const Extension* extension) {
+    base::ScopedTempDir dir;
+    ASSERT_TRUE(dir.CreateUniqueTempDir());
+    base::FilePath file = dir.path().AppendASCII("data.pak");
+
+    base::TimeDelta build_time;
+    base::TimeDelta write_time;
+    for (int i = 0; i < kIterations; ++i) {
+      base::TimeTicks start = base::TimeTicks::HighResNow();
+      scoped_refptr<BrowserThemePack> pack =
+          BrowserThemePack::BuildFromExtension(extension);
+      base::TimeTicks built = base::TimeTicks::HighResNow();
+      ASSERT_TRUE(pack.get());
+      ASSERT_TRUE(pack->WriteToDisk(file));
+      build_time += built - start;
+      write_time += base::TimeTicks::HighResNow() - built;
+
+      // Theme packs are deleted on the FILE thread.
+      pack = NULL;
+      message_loop_.RunUntilIdle();
+    }
+    PrintTime(theme, "build_from_extension", build_time);
+    PrintTime(theme, "write_to_disk", write_time);
+  }
+
+ private:
+  base::MessageLoop message_loop_;
+  content::TestBrowserThread ui_thread_;
+  content::TestBrowserThread file_thread_;
+  scoped_ptr<ui::test::ScopedSetSupportedScaleFactors>
+      scoped_set_supported_scale_factors_;
+};
+
+}  // namespace
+
+TEST_F(BrowserThemePackPerfTest, StarGazing) {
+  scoped_refptr<Extension> extension = LoadTheme(
+      base::FilePath(FILE_PATH_LITERAL("profiles"))
+          .AppendASCII("profile_with_complex_theme")
+          .AppendASCII("Default")
+          .AppendASCII("Extensions")
+          .AppendASCII("mblmlcbknbnfebdfjnolmcapmdofhmme")
+          .AppendASCII("1.1"));
+  ASSERT_TRUE(extension.get());
+  MeasureBuild("_star_gazing", extension.get());
+}
+
+TEST_F(BrowserThemePackPerfTest, HiDpi) {
+  scoped_refptr<Extension> extension = LoadTheme(
+      base::FilePath(FILE_PATH_LITERAL("extensions"))
+          .AppendASCII("theme_hidpi"));
+  ASSERT_TRUE(extension.get());
+  MeasureBuild("_hidpi", extension.get());
+}
@@ -611,3 +611,36 @@ TEST_F(BrowserThemePackTest, HiDpiThemeTest) {
     VerifyHiDpiTheme(pack.get());
   }
 }
+
+// Images from the theme should only be packed at the scale factors the theme
+// provides them at, and be resampled for other scale factors when requested.
+TEST_F(BrowserThemePackTest, ProvidedScalesArePacked) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  base::FilePath file = dir.path().AppendASCII("theme_data.pak");
+
+  {
+    scoped_refptr<BrowserThemePack> pack;
+    BuildFromUnpackedExtension(GetHiDpiThemePath(), pack);
+    ASSERT_TRUE(pack->WriteToDisk(file));
+  }
+
+  scoped_refptr<BrowserThemePack> pack =
+      BrowserThemePack::BuildFromDataPack(file, "gllekhaobjnhgeag");
+  ASSERT_TRUE(pack.get());
+
+  // IDR_THEME_FRAME is provided for scales 100% and 200%.
+  EXPECT_TRUE(pack->GetRawData(IDR_THEME_FRAME, ui::SCALE_FACTOR_100P));
+  EXPECT_TRUE(pack->GetRawData(IDR_THEME_FRAME, ui::SCALE_FACTOR_200P));
+
+  // IDR_THEME_FRAME_INCOGNITO_INACTIVE is only provided for scale 100%.
+  int idr = IDR_THEME_FRAME_INCOGNITO_INACTIVE;
+  EXPECT_TRUE(pack->GetRawData(idr, ui::SCALE_FACTOR_100P));
+  EXPECT_FALSE(pack->GetRawData(idr, ui::SCALE_FACTOR_200P));
+  gfx::Image image = pack->GetImageNamed(idr);
+  ASSERT_FALSE(image.IsEmpty());
+  const gfx::ImageSkiaRep& rep = image.ToImageSkia()->GetRepresentation(2.0f);
+  ASSERT_FALSE(rep.is_null());
+  EXPECT_EQ(160, rep.sk_bitmap().width());
+  EXPECT_EQ(160, rep.sk_bitmap().height());
+}
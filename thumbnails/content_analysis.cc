@@ -10,9 +10,11 @@
 #include <functional>
 #include <limits>
 #include <numeric>
+#include <utility>
 #include <vector>
 
 #include "base/logging.h"
+#include "chrome/browser/thumbnails/content_analysis_kernels.h"
 #include "skia/ext/convolver.h"
 #include "skia/ext/recursive_gaussian_convolution.h"
 #include "third_party/skia/include/core/SkBitmap.h"
@@ -351,13 +353,10 @@ void ApplyGaussianGradientMagnitudeFilter(SkBitmap* input_bitmap,
 
   unsigned grad_max = 0;
   for (int r = 0; r < image_size.height(); ++r) {
-    const uint8* grad_x_row = intermediate.getAddr8(0, r);
-    const uint8* grad_y_row = intermediate2.getAddr8(0, r);
-    for (int c = 0; c < image_size.width(); ++c) {
-      unsigned grad_x = grad_x_row[c];
-      unsigned grad_y = grad_y_row[c];
-      grad_max = std::max(grad_max, grad_x * grad_x + grad_y * grad_y);
-    }
+    grad_max = std::max(grad_max, MaxSquaredGradientMagnitude(
+        intermediate.getAddr8(0, r),
+        intermediate2.getAddr8(0, r),
+        image_size.width()));
   }
 
   int bit_shift = 0;
@@ -365,14 +364,11 @@ void ApplyGaussianGradientMagnitudeFilter(SkBitmap* input_bitmap,
     bit_shift = static_cast<int>(
         std::log10(static_cast<float>(grad_max)) / std::log10(2.0f)) - 7;
   for (int r = 0; r < image_size.height(); ++r) {
-    const uint8* grad_x_row = intermediate.getAddr8(0, r);
-    const uint8* grad_y_row = intermediate2.getAddr8(0, r);
-    uint8* target_row = input_bitmap->getAddr8(0, r);
-    for (int c = 0; c < image_size.width(); ++c) {
-      unsigned grad_x = grad_x_row[c];
-      unsigned grad_y = grad_y_row[c];
-      target_row[c] = (grad_x * grad_x + grad_y * grad_y) >> bit_shift;
-    }
+    SquaredGradientMagnitude(intermediate.getAddr8(0, r),
+                             intermediate2.getAddr8(0, r),
+                             image_size.width(),
+                             bit_shift,
+                             input_bitmap->getAddr8(0, r));
   }
 }
 
@@ -396,18 +392,17 @@ void ExtractImageProfileInformation(const SkBitmap& input_bitmap,
   rows->clear();
   columns->clear();
   rows->resize(area.height(), 0);
-  columns->resize(area.width(), 0);
 
+  // Column sums are accumulated as integers and converted once at the end.
+  std::vector<uint32> column_sums(area.width(), 0);
+  uint32* column_sums_data = column_sums.empty() ? NULL : &column_sums[0];
   for (int r = 0; r < area.height(); ++r) {
     // Points to the first byte of the row in the rectangle.
     const uint8* image_row = input_bitmap.getAddr8(area.x(), r + area.y());
-    unsigned row_sum = 0;
-    for (int c = 0; c < area.width(); ++c, ++image_row) {
-      row_sum += *image_row;
-      (*columns)[c] += *image_row;
-    }
-    (*rows)[r] = row_sum;
+    (*rows)[r] =
+        AccumulateRowProfile(image_row, area.width(), column_sums_data);
   }
+  columns->assign(column_sums.begin(), column_sums.end());
 
   if (apply_log) {
     // Generally for processing we will need to take logarithm of this data.
@@ -684,35 +679,36 @@ SkBitmap ComputeDecimatedImage(const SkBitmap& bitmap,
   target.setConfig(bitmap.config(), target_column_count, target_row_count);
   target.allocPixels();
 
+  // The same columns are kept in every row, so find the runs of kept columns
+  // once, as (offset, length) pairs in bytes.
+  std::vector<std::pair<size_t, size_t> > column_runs;
+  int left_copy_pixel = -1;
+  for (int c = 0; c <= bitmap.width(); ++c) {
+    const bool keep = c < bitmap.width() && columns[c];
+    if (left_copy_pixel < 0 && keep) {
+      left_copy_pixel = c;  // Next time we will start copying from here.
+    } else if (left_copy_pixel >= 0 && !keep) {
+      // This closes a fragment we want to copy.
+      column_runs.push_back(std::make_pair(
+          left_copy_pixel * bitmap.bytesPerPixel(),
+          (c - left_copy_pixel) * bitmap.bytesPerPixel()));
+      left_copy_pixel = -1;
+    }
+  }
+
   int target_row = 0;
   for (int r = 0; r < bitmap.height(); ++r) {
     if (!rows[r])
       continue;  // We can just skip this one.
-    uint8* src_row =
+    const uint8* src_row =
         static_cast<uint8*>(bitmap.getPixels()) + r * bitmap.rowBytes();
     uint8* insertion_target = static_cast<uint8*>(target.getPixels()) +
         target_row * target.rowBytes();
-    int left_copy_pixel = -1;
-    for (int c = 0; c < bitmap.width(); ++c) {
-      if (left_copy_pixel < 0 && columns[c]) {
-        left_copy_pixel = c;  // Next time we will start copying from here.
-      } else if (left_copy_pixel >= 0 && !columns[c]) {
-        // This closes a fragment we want to copy. We do it now.
-        size_t bytes_to_copy = (c - left_copy_pixel) * bitmap.bytesPerPixel();
-        memcpy(insertion_target,
-               src_row + left_copy_pixel * bitmap.bytesPerPixel(),
-               bytes_to_copy);
-        left_copy_pixel = -1;
-        insertion_target += bytes_to_copy;
-      }
-    }
-    // We can still have the tail end to process here.
-    if (left_copy_pixel >= 0) {
-      size_t bytes_to_copy =
-          (bitmap.width() - left_copy_pixel) * bitmap.bytesPerPixel();
+    for (size_t i = 0; i < column_runs.size(); ++i) {
       memcpy(insertion_target,
-             src_row + left_copy_pixel * bitmap.bytesPerPixel(),
-             bytes_to_copy);
+             src_row + column_runs[i].first,
+             column_runs[i].second);
+      insertion_target += column_runs[i].second;
     }
     target_row++;
   }
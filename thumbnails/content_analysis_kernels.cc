@@ -0,0 +1,262 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/thumbnails/content_analysis_kernels.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace thumbnailing_utils {
+
+uint32 MaxSquaredGradientMagnitude_C(const uint8* grad_x,
+                                     const uint8* grad_y,
+                                     int width) {
+  uint32 result = 0;
+  for (int c = 0; c < width; ++c) {
+    uint32 x = grad_x[c];
+    uint32 y = grad_y[c];
+    result = std::max(result, x * x + y * y);
+  }
+  return result;
+}
+
+void SquaredGradientMagnitude_C(const uint8* grad_x,
+                                const uint8* grad_y,
+                                int width,
+                                int bit_shift,
+                                uint8* output) {
+  for (int c = 0; c < width; ++c) {
+    uint32 x = grad_x[c];
+    uint32 y = grad_y[c];
+    output[c] = static_cast<uint8>((x * x + y * y) >> bit_shift);
+  }
+}
+
+uint32 AccumulateRowProfile_C(const uint8* row,
+                              int width,
+                              uint32* column_sums) {
+  uint32 row_sum = 0;
+  for (int c = 0; c < width; ++c) {
+    row_sum += row[c];
+    column_sums[c] += row[c];
+  }
+  return row_sum;
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+namespace {
+
+// Computes x * x + y * y for the 16 pixels of |x| and |y|, as four vectors of
+// four 32-bit values each.
+inline void SquaredGradientMagnitude16(__m128i x, __m128i y, __m128i* out) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i x_lo = _mm_unpacklo_epi8(x, zero);
+  const __m128i x_hi = _mm_unpackhi_epi8(x, zero);
+  const __m128i y_lo = _mm_unpacklo_epi8(y, zero);
+  const __m128i y_hi = _mm_unpackhi_epi8(y, zero);
+  // With x and y interleaved, _mm_madd_epi16 sums the squares of each pair.
+  __m128i xy = _mm_unpacklo_epi16(x_lo, y_lo);
+  out[0] = _mm_madd_epi16(xy, xy);
+  xy = _mm_unpackhi_epi16(x_lo, y_lo);
+  out[1] = _mm_madd_epi16(xy, xy);
+  xy = _mm_unpacklo_epi16(x_hi, y_hi);
+  out[2] = _mm_madd_epi16(xy, xy);
+  xy = _mm_unpackhi_epi16(x_hi, y_hi);
+  out[3] = _mm_madd_epi16(xy, xy);
+}
+
+// SSE2 has no unsigned 32-bit max, but squared magnitudes fit in 17 bits so a
+// signed comparison is enough.
+inline __m128i Max32(__m128i a, __m128i b) {
+  const __m128i greater = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(greater, a),
+                      _mm_andnot_si128(greater, b));
+}
+
+}  // namespace
+
+uint32 MaxSquaredGradientMagnitude(const uint8* grad_x,
+                                   const uint8* grad_y,
+                                   int width) {
+  __m128i max = _mm_setzero_si128();
+  int c = 0;
+  for (; c + 16 <= width; c += 16) {
+    __m128i magnitudes[4];
+    SquaredGradientMagnitude16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(grad_x + c)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(grad_y + c)),
+        magnitudes);
+    max = Max32(max, Max32(Max32(magnitudes[0], magnitudes[1]),
+                           Max32(magnitudes[2], magnitudes[3])));
+  }
+  max = Max32(max, _mm_srli_si128(max, 8));
+  max = Max32(max, _mm_srli_si128(max, 4));
+  uint32 result = static_cast<uint32>(_mm_cvtsi128_si32(max));
+  return std::max(result, MaxSquaredGradientMagnitude_C(
+      grad_x + c, grad_y + c, width - c));
+}
+
+void SquaredGradientMagnitude(const uint8* grad_x,
+                              const uint8* grad_y,
+                              int width,
+                              int bit_shift,
+                              uint8* output) {
+  DCHECK_GE(bit_shift, 0);
+  const __m128i shift = _mm_cvtsi32_si128(bit_shift);
+  const __m128i low_byte = _mm_set1_epi32(0xFF);
+  int c = 0;
+  for (; c + 16 <= width; c += 16) {
+    __m128i magnitudes[4];
+    SquaredGradientMagnitude16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(grad_x + c)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(grad_y + c)),
+        magnitudes);
+    for (int i = 0; i < 4; ++i) {
+      magnitudes[i] =
+          _mm_and_si128(_mm_srl_epi32(magnitudes[i], shift), low_byte);
+    }
+    // The values are bytes already, so the saturating packs don't clamp.
+    const __m128i packed = _mm_packus_epi16(
+        _mm_packs_epi32(magnitudes[0], magnitudes[1]),
+        _mm_packs_epi32(magnitudes[2], magnitudes[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + c), packed);
+  }
+  SquaredGradientMagnitude_C(
+      grad_x + c, grad_y + c, width - c, bit_shift, output + c);
+}
+
+uint32 AccumulateRowProfile(const uint8* row, int width, uint32* column_sums) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i row_sum = zero;
+  int c = 0;
+  for (; c + 16 <= width; c += 16) {
+    const __m128i pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + c));
+    // Sums each half of |pixels| into the low bits of its 64-bit lane.
+    row_sum = _mm_add_epi32(row_sum, _mm_sad_epu8(pixels, zero));
+
+    const __m128i pixels_lo = _mm_unpacklo_epi8(pixels, zero);
+    const __m128i pixels_hi = _mm_unpackhi_epi8(pixels, zero);
+    __m128i* sums = reinterpret_cast<__m128i*>(column_sums + c);
+    _mm_storeu_si128(sums, _mm_add_epi32(
+        _mm_loadu_si128(sums), _mm_unpacklo_epi16(pixels_lo, zero)));
+    _mm_storeu_si128(sums + 1, _mm_add_epi32(
+        _mm_loadu_si128(sums + 1), _mm_unpackhi_epi16(pixels_lo, zero)));
+    _mm_storeu_si128(sums + 2, _mm_add_epi32(
+        _mm_loadu_si128(sums + 2), _mm_unpacklo_epi16(pixels_hi, zero)));
+    _mm_storeu_si128(sums + 3, _mm_add_epi32(
+        _mm_loadu_si128(sums + 3), _mm_unpackhi_epi16(pixels_hi, zero)));
+  }
+  uint32 result = static_cast<uint32>(_mm_cvtsi128_si32(row_sum)) +
+      static_cast<uint32>(_mm_cvtsi128_si32(_mm_srli_si128(row_sum, 8)));
+  return result + AccumulateRowProfile_C(row + c, width - c, column_sums + c);
+}
+
+#elif defined(__ARM_NEON__)
+
+namespace {
+
+// Computes x * x + y * y for the 8 pixels at |grad_x| and |grad_y|.
+inline void SquaredGradientMagnitude8(const uint8* grad_x,
+                                      const uint8* grad_y,
+                                      uint32x4_t* lo,
+                                      uint32x4_t* hi) {
+  const uint16x8_t x = vmovl_u8(vld1_u8(grad_x));
+  const uint16x8_t y = vmovl_u8(vld1_u8(grad_y));
+  *lo = vmlal_u16(vmull_u16(vget_low_u16(x), vget_low_u16(x)),
+                  vget_low_u16(y), vget_low_u16(y));
+  *hi = vmlal_u16(vmull_u16(vget_high_u16(x), vget_high_u16(x)),
+                  vget_high_u16(y), vget_high_u16(y));
+}
+
+}  // namespace
+
+uint32 MaxSquaredGradientMagnitude(const uint8* grad_x,
+                                   const uint8* grad_y,
+                                   int width) {
+  uint32x4_t max = vdupq_n_u32(0);
+  int c = 0;
+  for (; c + 8 <= width; c += 8) {
+    uint32x4_t lo, hi;
+    SquaredGradientMagnitude8(grad_x + c, grad_y + c, &lo, &hi);
+    max = vmaxq_u32(max, vmaxq_u32(lo, hi));
+  }
+  uint32x2_t max2 = vpmax_u32(vget_low_u32(max), vget_high_u32(max));
+  max2 = vpmax_u32(max2, max2);
+  uint32 result = vget_lane_u32(max2, 0);
+  return std::max(result, MaxSquaredGradientMagnitude_C(
+      grad_x + c, grad_y + c, width - c));
+}
+
+void SquaredGradientMagnitude(const uint8* grad_x,
+                              const uint8* grad_y,
+                              int width,
+                              int bit_shift,
+                              uint8* output) {
+  DCHECK_GE(bit_shift, 0);
+  // A negative left shift is a right shift.
+  const int32x4_t shift = vdupq_n_s32(-bit_shift);
+  int c = 0;
+  for (; c + 8 <= width; c += 8) {
+    uint32x4_t lo, hi;
+    SquaredGradientMagnitude8(grad_x + c, grad_y + c, &lo, &hi);
+    // The narrowing moves keep the low byte, as the C version does.
+    const uint16x8_t magnitudes = vcombine_u16(vmovn_u32(vshlq_u32(lo, shift)),
+                                               vmovn_u32(vshlq_u32(hi, shift)));
+    vst1_u8(output + c, vmovn_u16(magnitudes));
+  }
+  SquaredGradientMagnitude_C(
+      grad_x + c, grad_y + c, width - c, bit_shift, output + c);
+}
+
+uint32 AccumulateRowProfile(const uint8* row, int width, uint32* column_sums) {
+  uint32x4_t row_sum = vdupq_n_u32(0);
+  int c = 0;
+  for (; c + 8 <= width; c += 8) {
+    const uint16x8_t pixels = vmovl_u8(vld1_u8(row + c));
+    row_sum = vpadalq_u16(row_sum, pixels);
+    vst1q_u32(column_sums + c,
+              vaddw_u16(vld1q_u32(column_sums + c), vget_low_u16(pixels)));
+    vst1q_u32(column_sums + c + 4,
+              vaddw_u16(vld1q_u32(column_sums + c + 4),
+                        vget_high_u16(pixels)));
+  }
+  const uint64x2_t sum = vpaddlq_u32(row_sum);
+  uint32 result =
+      static_cast<uint32>(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+  return result + AccumulateRowProfile_C(row + c, width - c, column_sums + c);
+}
+
+#else
+
+uint32 MaxSquaredGradientMagnitude(const uint8* grad_x,
+                                   const uint8* grad_y,
+                                   int width) {
+  return MaxSquaredGradientMagnitude_C(grad_x, grad_y, width);
+}
+
+void SquaredGradientMagnitude(const uint8* grad_x,
+                              const uint8* grad_y,
+                              int width,
+                              int bit_shift,
+                              uint8* output) {
+  SquaredGradientMagnitude_C(grad_x, grad_y, width, bit_shift, output);
+}
+
+uint32 AccumulateRowProfile(const uint8* row, int width, uint32* column_sums) {
+  return AccumulateRowProfile_C(row, width, column_sums);
+}
+
+#endif
+
+}  // namespace thumbnailing_utils
@@ -0,0 +1,48 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_THUMBNAILS_CONTENT_ANALYSIS_KERNELS_H_
+#define CHROME_BROWSER_THUMBNAILS_CONTENT_ANALYSIS_KERNELS_H_
+
+#include "base/basictypes.h"
+
+// Per-row pixel kernels used by content_analysis.cc. Each kernel has a
+// portable implementation (suffixed _C) and a dispatching entry point which
+// uses SIMD instructions when they are available at compile time. Both always
+// produce identical results.
+namespace thumbnailing_utils {
+
+// Returns the maximum of |grad_x|[i]^2 + |grad_y|[i]^2 over the |width|
+// pixels of a row.
+uint32 MaxSquaredGradientMagnitude(const uint8* grad_x,
+                                   const uint8* grad_y,
+                                   int width);
+uint32 MaxSquaredGradientMagnitude_C(const uint8* grad_x,
+                                     const uint8* grad_y,
+                                     int width);
+
+// Sets |output|[i] to the low byte of
+// (|grad_x|[i]^2 + |grad_y|[i]^2) >> |bit_shift| for the |width| pixels of a
+// row.
+void SquaredGradientMagnitude(const uint8* grad_x,
+                              const uint8* grad_y,
+                              int width,
+                              int bit_shift,
+                              uint8* output);
+void SquaredGradientMagnitude_C(const uint8* grad_x,
+                                const uint8* grad_y,
+                                int width,
+                                int bit_shift,
+                                uint8* output);
+
+// Adds each of the |width| pixels of |row| to the matching entry of
+// |column_sums| and returns the sum of the row.
+uint32 AccumulateRowProfile(const uint8* row, int width, uint32* column_sums);
+uint32 AccumulateRowProfile_C(const uint8* row,
+                              int width,
+                              uint32* column_sums);
+
+}  // namespace thumbnailing_utils
+
+#endif  // CHROME_BROWSER_THUMBNAILS_CONTENT_ANALYSIS_KERNELS_H_
@@ -0,0 +1,100 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/thumbnails/content_analysis_kernels.h"
+
+#include <vector>
+
+#include "base/rand_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace thumbnailing_utils {
+
+namespace {
+
+// Covers empty rows, rows shorter than a vector and rows with a tail.
+const int kWidths[] = { 0, 1, 7, 8, 15, 16, 17, 31, 33, 100, 1920 };
+
+std::vector<uint8> RandomRow(int width) {
+  std::vector<uint8> row(width);
+  for (int i = 0; i < width; ++i)
+    row[i] = static_cast<uint8>(base::RandInt(0, 255));
+  return row;
+}
+
+// Returns a pointer usable for |width| bytes, even when |width| is 0.
+template <typename T>
+T* Data(std::vector<T>* v) {
+  return v->empty() ? NULL : &(*v)[0];
+}
+
+}  // namespace
+
+class ContentAnalysisKernelsTest : public testing::Test {
+};
+
+TEST_F(ContentAnalysisKernelsTest, MaxSquaredGradientMagnitude) {
+  for (size_t i = 0; i < arraysize(kWidths); ++i) {
+    const int width = kWidths[i];
+    SCOPED_TRACE(width);
+    std::vector<uint8> grad_x = RandomRow(width);
+    std::vector<uint8> grad_y = RandomRow(width);
+    EXPECT_EQ(MaxSquaredGradientMagnitude_C(
+                  Data(&grad_x), Data(&grad_y), width),
+              MaxSquaredGradientMagnitude(
+                  Data(&grad_x), Data(&grad_y), width));
+
+    // The largest possible value, in the tail and in the vectorized part.
+    if (width > 0) {
+      grad_x[width - 1] = grad_y[width - 1] = 255;
+      EXPECT_EQ(2U * 255 * 255, MaxSquaredGradientMagnitude(
+          Data(&grad_x), Data(&grad_y), width));
+      grad_x[0] = grad_y[0] = 255;
+      grad_x[width - 1] = grad_y[width - 1] = 0;
+      EXPECT_EQ(2U * 255 * 255, MaxSquaredGradientMagnitude(
+          Data(&grad_x), Data(&grad_y), width));
+    }
+  }
+}
+
+TEST_F(ContentAnalysisKernelsTest, SquaredGradientMagnitude) {
+  for (size_t i = 0; i < arraysize(kWidths); ++i) {
+    const int width = kWidths[i];
+    std::vector<uint8> grad_x = RandomRow(width);
+    std::vector<uint8> grad_y = RandomRow(width);
+    // Shifts too small to fit the results in a byte must still match.
+    for (int bit_shift = 0; bit_shift <= 10; ++bit_shift) {
+      SCOPED_TRACE(testing::Message() << width << " " << bit_shift);
+      std::vector<uint8> expected(width);
+      std::vector<uint8> actual(width);
+      SquaredGradientMagnitude_C(Data(&grad_x), Data(&grad_y), width,
+                                 bit_shift, Data(&expected));
+      SquaredGradientMagnitude(Data(&grad_x), Data(&grad_y), width,
+                               bit_shift, Data(&actual));
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
+TEST_F(ContentAnalysisKernelsTest, AccumulateRowProfile) {
+  for (size_t i = 0; i < arraysize(kWidths); ++i) {
+    const int width = kWidths[i];
+    SCOPED_TRACE(width);
+    std::vector<uint32> expected(width, 0);
+    std::vector<uint32> actual(width, 0);
+    for (int r = 0; r < 5; ++r) {
+      std::vector<uint8> row = RandomRow(width);
+      EXPECT_EQ(AccumulateRowProfile_C(Data(&row), width, Data(&expected)),
+                AccumulateRowProfile(Data(&row), width, Data(&actual)));
+    }
+    EXPECT_EQ(expected, actual);
+
+    // Saturated rows don't overflow the row sum.
+    std::vector<uint8> row(width, 255);
+    EXPECT_EQ(255U * width,
+              AccumulateRowProfile(Data(&row), width, Data(&actual)));
+  }
+}
+
+}  // namespace thumbnailing_utils
@@ -0,0 +1,129 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/rand_util.h"
+#include "base/time/time.h"
+#include "chrome/browser/thumbnails/content_analysis.h"
+#include "chrome/browser/thumbnails/content_analysis_kernels.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkColor.h"
+#include "ui/gfx/canvas.h"
+#include "ui/gfx/rect.h"
+#include "ui/gfx/size.h"
+
+namespace thumbnailing_utils {
+
+namespace {
+
+// A typical tab capture.
+const int kCaptureWidth = 1920;
+const int kCaptureHeight = 1080;
+const int kIterations = 10;
+
+std::vector<uint8> RandomPlane() {
+  std::vector<uint8> plane(kCaptureWidth * kCaptureHeight);
+  for (size_t i = 0; i < plane.size(); ++i)
+    plane[i] = static_cast<uint8>(base::RandInt(0, 255));
+  return plane;
+}
+
+void PrintTime(const std::string& trace, const base::TimeTicks& start) {
+  double delta =
+      (base::TimeTicks::HighResNow() - start).InMillisecondsF() / kIterations;
+  perf_test::PrintResult("content_analysis", "_1080p", trace, delta, "ms",
+                         true);
+}
+
+}  // namespace
+
+TEST(ContentAnalysisPerfTest, GradientMagnitudeKernels) {
+  std::vector<uint8> grad_x = RandomPlane();
+  std::vector<uint8> grad_y = RandomPlane();
+  std::vector<uint8> output(grad_x.size());
+  uint32 max = 0;
+
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i) {
+    for (int r = 0; r < kCaptureHeight; ++r) {
+      const int offset = r * kCaptureWidth;
+      max = std::max(max, MaxSquaredGradientMagnitude_C(
+          &grad_x[offset], &grad_y[offset], kCaptureWidth));
+      SquaredGradientMagnitude_C(&grad_x[offset], &grad_y[offset],
+                                 kCaptureWidth, 9, &output[offset]);
+    }
+  }
+  PrintTime("gradient_magnitude_c", start);
+
+  start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i) {
+    for (int r = 0; r < kCaptureHeight; ++r) {
+      const int offset = r * kCaptureWidth;
+      max = std::max(max, MaxSquaredGradientMagnitude(
+          &grad_x[offset], &grad_y[offset], kCaptureWidth));
+      SquaredGradientMagnitude(&grad_x[offset], &grad_y[offset],
+                               kCaptureWidth, 9, &output[offset]);
+    }
+  }
+  PrintTime("gradient_magnitude", start);
+  EXPECT_GT(max, 0U);
+}
+
+TEST(ContentAnalysisPerfTest, RowProfileKernels) {
+  std::vector<uint8> plane = RandomPlane();
+  std::vector<uint32> column_sums(kCaptureWidth, 0);
+  uint32 row_sum = 0;
+
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i) {
+    for (int r = 0; r < kCaptureHeight; ++r) {
+      row_sum += AccumulateRowProfile_C(
+          &plane[r * kCaptureWidth], kCaptureWidth, &column_sums[0]);
+    }
+  }
+  PrintTime("row_profile_c", start);
+
+  start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i) {
+    for (int r = 0; r < kCaptureHeight; ++r) {
+      row_sum += AccumulateRowProfile(
+          &plane[r * kCaptureWidth], kCaptureWidth, &column_sums[0]);
+    }
+  }
+  PrintTime("row_profile", start);
+  EXPECT_GT(row_sum, 0U);
+}
+
+TEST(ContentAnalysisPerfTest, CreateRetargetedThumbnailImage) {
+  // Mimics a screenshot of a web page, as in the unit test.
+  const gfx::Size image_size(kCaptureWidth, kCaptureHeight);
+  gfx::Canvas canvas(image_size, 1.0f, true);
+  canvas.FillRect(gfx::Rect(image_size), SkColorSetRGB(200, 210, 210));
+  canvas.FillRect(gfx::Rect(60, 20, kCaptureWidth - 120, 100),
+                  SkColorSetRGB(200, 40, 10));
+  canvas.FillRect(gfx::Rect(60, 140, kCaptureWidth - 120, 800),
+                  SkColorSetRGB(150, 180, 40));
+  for (int y = 960; y < kCaptureHeight - 20; y += 16) {
+    for (int x = 60; x < kCaptureWidth - 60; x += 24) {
+      canvas.FillRect(gfx::Rect(x, y, 16, 8), SkColorSetRGB(20, 20, 20));
+    }
+  }
+  SkBitmap source =
+      skia::GetTopDevice(*canvas.sk_canvas())->accessBitmap(false);
+
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i) {
+    SkBitmap result = CreateRetargetedThumbnailImage(
+        source, gfx::Size(424, 264), 5.0f);
+    EXPECT_FALSE(result.empty());
+  }
+  PrintTime("retargeted_thumbnail", start);
+}
+
+}  // namespace thumbnailing_utils
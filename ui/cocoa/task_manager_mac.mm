@@ -238,6 +238,8 @@ class SortHelper {
 
   [column.get() setHidden:!isVisible];
   [column.get() setEditable:NO];
+  if (isVisible)
+    model_->StartGatheringColumn(columnId);
 
   // The page column should by default be sorted ascending.
   BOOL ascending = columnId == IDS_TASK_MANAGER_TASK_COLUMN;
@@ -346,6 +348,10 @@ class SortHelper {
   NSInteger newState = oldState == NSOnState ? NSOffState : NSOnState;
   [column setHidden:newState == NSOffState];
   [item setState:newState];
+  if (newState == NSOnState)
+    model_->StartGatheringColumn([[column identifier] intValue]);
+  else
+    model_->StopGatheringColumn([[column identifier] intValue]);
   [tableView_ sizeToFit];
   [tableView_ setNeedsDisplay];
 }
@@ -395,6 +401,10 @@ class SortHelper {
 }
 
 - (void)windowWillClose:(NSNotification*)notification {
+  for (NSTableColumn* column in [tableView_ tableColumns]) {
+    if (![column isHidden])
+      model_->StopGatheringColumn([[column identifier] intValue]);
+  }
   if (taskManagerObserver_) {
     taskManagerObserver_->WindowWasClosed();
     taskManagerObserver_ = nil;
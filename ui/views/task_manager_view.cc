@@ -361,6 +361,11 @@ void TaskManagerView::Init() {
                                   false);
   tab_table_->SetColumnVisibility(IDS_TASK_MANAGER_GDI_HANDLES_COLUMN, false);
   tab_table_->SetColumnVisibility(IDS_TASK_MANAGER_USER_HANDLES_COLUMN, false);
+  for (std::vector<ui::TableColumn>::const_iterator i(columns_.begin());
+       i != columns_.end(); ++i) {
+    if (tab_table_->IsColumnVisible(i->id))
+      model_->StartGatheringColumn(i->id);
+  }
 
   UpdateStatsCounters();
   tab_table_->SetObserver(this);
@@ -553,6 +558,11 @@ void TaskManagerView::WindowClosing() {
   // may have already opened a new instance).
   if (instance_ == this)
     instance_ = NULL;
+  for (std::vector<ui::TableColumn>::const_iterator i(columns_.begin());
+       i != columns_.end(); ++i) {
+    if (tab_table_->IsColumnVisible(i->id))
+      model_->StopGatheringColumn(i->id);
+  }
   task_manager_->OnWindowClosed();
 }
 
@@ -621,7 +631,12 @@ bool TaskManagerView::GetAcceleratorForCommandId(
 }
 
 void TaskManagerView::ExecuteCommand(int id, int event_flags) {
-  tab_table_->SetColumnVisibility(id, !tab_table_->IsColumnVisible(id));
+  bool visible = !tab_table_->IsColumnVisible(id);
+  tab_table_->SetColumnVisibility(id, visible);
+  if (visible)
+    model_->StartGatheringColumn(id);
+  else
+    model_->StopGatheringColumn(id);
 }
 
 void TaskManagerView::InitAlwaysOnTopState() {
@@ -20,6 +20,7 @@
 #include "chrome/browser/chromeos/drive/drive_integration_service.h"
 #include "chrome/browser/chromeos/drive/file_system_util.h"
 #include "chrome/browser/chromeos/drive/job_list.h"
+#include "chrome/browser/chromeos/drive/job_scheduler.h"
 #include "chrome/browser/chromeos/file_manager/path_util.h"
 #include "chrome/browser/drive/drive_api_util.h"
 #include "chrome/browser/drive/drive_notification_manager.h"
@@ -244,6 +245,8 @@ class DriveInternalsWebUIHandler : public content::WebUIMessageHandler {
   void UpdateDeltaUpdateStatusSection(
       drive::DebugInfoCollector* debug_info_collector);
   void UpdateInFlightOperationsSection(drive::JobListInterface* job_list);
+  void UpdateJobQueuesSection(
+      drive::DebugInfoCollector* debug_info_collector);
   void UpdateGCacheContentsSection();
   void UpdateFileSystemContentsSection();
   void UpdateLocalStorageUsageSection();
@@ -441,6 +444,7 @@ void DriveInternalsWebUIHandler::OnPageLoaded(const base::ListValue* args) {
   UpdateLocalMetadataSection(debug_info_collector);
   UpdateDeltaUpdateStatusSection(debug_info_collector);
   UpdateInFlightOperationsSection(integration_service->job_list());
+  UpdateJobQueuesSection(debug_info_collector);
   UpdateGCacheContentsSection();
   UpdateCacheContentsSection(debug_info_collector);
   UpdateLocalStorageUsageSection();
@@ -657,6 +661,39 @@ void DriveInternalsWebUIHandler::UpdateInFlightOperationsSection(
                                    in_flight_operations);
 }
 
+void DriveInternalsWebUIHandler::UpdateJobQueuesSection(
+    drive::DebugInfoCollector* debug_info_collector) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  DCHECK(debug_info_collector);
+
+  std::vector<drive::JobScheduler::QueueStats> stats_list =
+      debug_info_collector->GetJobQueueStats();
+
+  base::ListValue job_queues;
+  for (size_t i = 0; i < stats_list.size(); ++i) {
+    const drive::JobScheduler::QueueStats& stats = stats_list[i];
+
+    base::DictionaryValue* dict = new base::DictionaryValue;
+    dict->SetString("queue", stats.queue_name);
+    dict->SetString("context",
+                    stats.context_type == drive::USER_INITIATED ?
+                    "USER_INITIATED" : "BACKGROUND");
+    dict->SetInteger("num_queued", static_cast<int>(stats.stats.num_queued));
+    dict->SetInteger("num_running",
+                     static_cast<int>(stats.stats.num_running));
+    dict->SetInteger("num_started",
+                     static_cast<int>(stats.stats.num_started));
+    dict->SetDouble("average_wait_time",
+                    stats.stats.num_started ?
+                    stats.stats.total_wait_time.InMillisecondsF() /
+                        stats.stats.num_started : 0);
+    dict->SetDouble("max_wait_time",
+                    stats.stats.max_wait_time.InMillisecondsF());
+    job_queues.Append(dict);
+  }
+  web_ui()->CallJavascriptFunction("updateJobQueues", job_queues);
+}
+
 void DriveInternalsWebUIHandler::UpdateGCacheContentsSection() {
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
 
@@ -883,6 +920,7 @@ void DriveInternalsWebUIHandler::OnPeriodicUpdate(const base::ListValue* args) {
     return;
 
   UpdateInFlightOperationsSection(integration_service->job_list());
+  UpdateJobQueuesSection(integration_service->debug_info_collector());
   UpdateEventLogSection();
 }
 
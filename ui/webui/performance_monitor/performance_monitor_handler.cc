@@ -307,6 +307,36 @@ void DoGetEvents(base::ListValue* results,
   }
 }
 
+// Averages |metric_type| over the windows from the coarsest rollups whose
+// buckets fit them exactly. Returns NULL if no rollups fit, in which case the
+// raw samples must be aggregated.
+scoped_ptr<VectorOfMetricVectors> AggregateMeanFromDatabaseRollups(
+    Database* db,
+    MetricType metric_type,
+    const base::Time& start,
+    const base::Time& end,
+    const std::vector<TimeRange>& intervals,
+    const base::TimeDelta& resolution) {
+  for (int i = ROLLUP_NUMBER_OF_RESOLUTIONS - 1; i >= 0; --i) {
+    RollupResolution rollup_resolution = static_cast<RollupResolution>(i);
+    if (!RollupsAlignWithWindows(Database::GetRollupWidth(rollup_resolution),
+                                 start, intervals, resolution)) {
+      continue;
+    }
+    scoped_ptr<Database::MetricRollupVector> rollups =
+        db->GetRollupsForActivityAndMetric(metric_type, rollup_resolution,
+                                           start, end);
+    if (!rollups)
+      continue;
+    scoped_ptr<VectorOfMetricVectors> aggregated_metrics =
+        AggregateMeanFromRollups(metric_type, *rollups, start, intervals,
+                                 resolution);
+    if (aggregated_metrics)
+      return aggregated_metrics.Pass();
+  }
+  return scoped_ptr<VectorOfMetricVectors>();
+}
+
 // Populates results with a dictionary for each metric requested. The dictionary
 // includes a metric id, the maximum value for the metric, and a list of lists
 // of metric points, with each sublist containing the aggregated data for an
@@ -338,18 +368,25 @@ void DoGetMetrics(base::ListValue* results,
         "maxValue",
         db->GetMaxStatsForActivityAndMetric(*metric_type) * conversion_factor);
 
-    // Retrieve all metrics in the database, and aggregate them into a series
-    // of points for each active interval.
-    scoped_ptr<Database::MetricVector> metric_vector =
-        db->GetStatsForActivityAndMetric(*metric_type, start, end);
-
-    scoped_ptr<VectorOfMetricVectors> aggregated_metrics =
-        AggregateMetric(*metric_type,
-                        metric_vector.get(),
-                        start,
-                        intervals,
-                        resolution,
-                        aggregation_method);
+    // Retrieve the metrics in the database, and aggregate them into a series
+    // of points for each active interval. The mean can come from the rollups
+    // when their buckets fit the windows; the median and the raw points need
+    // every sample.
+    scoped_ptr<VectorOfMetricVectors> aggregated_metrics;
+    if (aggregation_method == AGGREGATION_METHOD_MEAN) {
+      aggregated_metrics = AggregateMeanFromDatabaseRollups(
+          db, *metric_type, start, end, intervals, resolution);
+    }
+    if (!aggregated_metrics) {
+      scoped_ptr<Database::MetricVector> metric_vector =
+          db->GetStatsForActivityAndMetric(*metric_type, start, end);
+      aggregated_metrics = AggregateMetric(*metric_type,
+                                           metric_vector.get(),
+                                           start,
+                                           intervals,
+                                           resolution,
+                                           aggregation_method);
+    }
 
     // The JS-side expects a list to be present, even if there are no metrics.
     if (!aggregated_metrics) {
@@ -192,4 +192,112 @@ scoped_ptr<VectorOfMetricVectors> AggregateMetric(
   }
 }
 
+bool RollupsAlignWithWindows(const base::TimeDelta& bucket_width,
+                             const base::Time& start,
+                             const std::vector<TimeRange>& intervals,
+                             const base::TimeDelta& resolution) {
+  int64 width = bucket_width.ToInternalValue();
+  if (width <= 0 || resolution.ToInternalValue() % width != 0 ||
+      start.ToInternalValue() % width != 0) {
+    return false;
+  }
+  for (size_t i = 1; i < intervals.size(); ++i) {
+    if (intervals[i].start.ToInternalValue() % width != 0)
+      return false;
+  }
+  return true;
+}
+
+scoped_ptr<VectorOfMetricVectors> AggregateMeanFromRollups(
+    MetricType type,
+    const Database::MetricRollupVector& rollups,
+    const base::Time& start,
+    const std::vector<TimeRange>& intervals,
+    const base::TimeDelta& resolution) {
+  if (intervals.empty())
+    return scoped_ptr<VectorOfMetricVectors>();
+
+  CHECK(resolution > base::TimeDelta());
+
+  scoped_ptr<VectorOfMetricVectors> results(new VectorOfMetricVectors());
+  Database::MetricRollupVector::const_iterator rollup = rollups.begin();
+  // Whether the first sample of |rollup| went into the window before it,
+  // because it lies exactly on the end of that window. The next sample of
+  // |rollup| is then only known to be after |rollup->bucket_start|.
+  bool first_consumed = false;
+
+  for (std::vector<TimeRange>::const_iterator interval = intervals.begin();
+       interval != intervals.end(); ++interval) {
+    // Skip the samples before the interval, which can only be whole buckets.
+    while (rollup != rollups.end() && rollup->last_time < interval->start) {
+      ++rollup;
+      first_consumed = false;
+    }
+    if (rollup != rollups.end() &&
+        (first_consumed ? rollup->bucket_start :
+                          rollup->first_time) < interval->start) {
+      return scoped_ptr<VectorOfMetricVectors>();
+    }
+
+    base::Time time_start =
+        interval == intervals.begin() ? start : interval->start;
+    Database::MetricVector aggregated_series;
+    while (rollup != rollups.end()) {
+      if (first_consumed) {
+        if (rollup->bucket_start >= interval->end)
+          break;
+        if (rollup->last_time > interval->end)
+          return scoped_ptr<VectorOfMetricVectors>();
+      } else if (rollup->first_time > interval->end) {
+        break;
+      }
+
+      int64 window_offset = (rollup->bucket_start - time_start) / resolution;
+      base::Time window_start = time_start + (window_offset * resolution);
+      base::Time window_end = window_start + resolution;
+      // The integral of a bucket whose first sample is already used starts
+      // at that sample, so it must also be where the window starts.
+      if (first_consumed && window_start != rollup->bucket_start)
+        return scoped_ptr<VectorOfMetricVectors>();
+
+      base::Time last_sample_time = window_start;
+      double integrated = 0.0;
+      double metric_value = 0.0;
+
+      // The buckets in the window, which hold all of its samples but one at
+      // exactly |window_end|.
+      while (rollup != rollups.end() && rollup->bucket_start < window_end) {
+        if (!first_consumed) {
+          integrated += rollup->first_value *
+                        (rollup->first_time - last_sample_time).InSecondsF();
+        }
+        integrated += rollup->integral;
+        metric_value = rollup->last_value;
+        last_sample_time = rollup->last_time;
+        ++rollup;
+        first_consumed = false;
+      }
+      if (rollup != rollups.end() && rollup->first_time == window_end) {
+        metric_value = rollup->first_value;
+        integrated += metric_value *
+                      (window_end - last_sample_time).InSecondsF();
+        last_sample_time = window_end;
+        if (rollup->count == 1)
+          ++rollup;
+        else
+          first_consumed = true;
+      }
+      if (rollup != rollups.end() && !first_consumed)
+        metric_value = rollup->first_value;
+
+      integrated += metric_value * (window_end - last_sample_time).InSecondsF();
+      double average = integrated / resolution.InSecondsF();
+      aggregated_series.push_back(Metric(type, window_end, average));
+    }
+    results->push_back(aggregated_series);
+  }
+
+  return results.Pass();
+}
+
 }  // namespace performance_monitor
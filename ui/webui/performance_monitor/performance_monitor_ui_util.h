@@ -117,6 +117,27 @@ scoped_ptr<std::vector<Database::MetricVector> > AggregateMetric(
     const base::TimeDelta& resolution,
     AggregationMethod method);
 
+// Returns true if rollup buckets of |bucket_width| fit the aggregation windows
+// exactly: |resolution| is a multiple of |bucket_width|, and |start| and the
+// start of every later interval in |intervals| are on bucket boundaries.
+bool RollupsAlignWithWindows(const base::TimeDelta& bucket_width,
+                             const base::Time& start,
+                             const std::vector<TimeRange>& intervals,
+                             const base::TimeDelta& resolution);
+
+// Computes the same means as AggregateMetric() with AGGREGATION_METHOD_MEAN
+// would over the raw samples that |rollups| summarize, without reading those
+// samples. The buckets must fit the windows (see RollupsAlignWithWindows()),
+// and the samples must lie within the active |intervals|. Returns NULL if a
+// window would need a part of a bucket, in which case the raw samples are
+// needed.
+scoped_ptr<VectorOfMetricVectors> AggregateMeanFromRollups(
+    MetricType type,
+    const Database::MetricRollupVector& rollups,
+    const base::Time& start,
+    const std::vector<TimeRange>& intervals,
+    const base::TimeDelta& resolution);
+
 }  // namespace performance_monitor
 
 #endif  // CHROME_BROWSER_UI_WEBUI_PERFORMANCE_MONITOR_PERFORMANCE_MONITOR_UI_UTIL_H_
@@ -4,6 +4,7 @@
 
 #include <string>
 
+#include "base/basictypes.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/time/time.h"
 #include "chrome/browser/performance_monitor/metric.h"
@@ -47,6 +48,26 @@ class PerformanceMonitorUtilTest : public ::testing::Test {
     return aggregator->AggregateInterval(
         type, &metric, metrics->end(), start, kMaxTime, resolution);
   }
+
+  // Summarizes |metrics|, sorted in increasing time, into rollup buckets of
+  // |width| the way the database does.
+  Database::MetricRollupVector BuildRollups(
+      const Database::MetricVector& metrics,
+      const base::TimeDelta& width) {
+    Database::MetricRollupVector rollups;
+    for (Database::MetricVector::const_iterator metric = metrics.begin();
+         metric != metrics.end(); ++metric) {
+      int64 time = metric->time.ToInternalValue();
+      base::Time bucket_start = base::Time::FromInternalValue(
+          time - time % width.ToInternalValue());
+      if (rollups.empty() || rollups.back().bucket_start != bucket_start) {
+        rollups.push_back(MetricRollup());
+        rollups.back().bucket_start = bucket_start;
+      }
+      rollups.back().AddMetric(*metric);
+    }
+    return rollups;
+  }
 };
 
 TEST_F(PerformanceMonitorUtilTest, AggregateMetricEmptyTest) {
@@ -249,4 +270,79 @@ TEST_F(PerformanceMonitorUtilTest, AggregateMetricMultipleIntervals) {
   }
 }
 
+TEST_F(PerformanceMonitorUtilTest, RollupsAlignWithWindows) {
+  const base::TimeDelta width = base::TimeDelta::FromSeconds(2);
+  const base::Time start = base::Time::FromDoubleT(10);
+  std::vector<TimeRange> intervals;
+  intervals.push_back(TimeRange(base::Time::FromDoubleT(11),
+                                base::Time::FromDoubleT(20)));
+  intervals.push_back(TimeRange(base::Time::FromDoubleT(30),
+                                base::Time::FromDoubleT(40)));
+
+  EXPECT_TRUE(RollupsAlignWithWindows(width, start, intervals,
+                                      base::TimeDelta::FromSeconds(6)));
+  EXPECT_FALSE(RollupsAlignWithWindows(width, start, intervals,
+                                       base::TimeDelta::FromSeconds(3)));
+  EXPECT_FALSE(RollupsAlignWithWindows(width, base::Time::FromDoubleT(11),
+                                       intervals,
+                                       base::TimeDelta::FromSeconds(6)));
+
+  intervals.push_back(TimeRange(base::Time::FromDoubleT(45),
+                                base::Time::FromDoubleT(50)));
+  EXPECT_FALSE(RollupsAlignWithWindows(width, start, intervals,
+                                       base::TimeDelta::FromSeconds(6)));
+}
+
+// The means from the rollups must be the ones plotted from the raw samples.
+TEST_F(PerformanceMonitorUtilTest, AggregateMeanFromRollupsMatchesRaw) {
+  const base::TimeDelta width = base::TimeDelta::FromSeconds(2);
+  const base::Time start = base::Time::FromDoubleT(10);
+  std::vector<TimeRange> intervals;
+  intervals.push_back(TimeRange(start, base::Time::FromDoubleT(30)));
+  intervals.push_back(TimeRange(base::Time::FromDoubleT(40),
+                                base::Time::FromDoubleT(60)));
+
+  // Several samples per bucket, empty buckets, samples on window boundaries
+  // and on the end of an interval. Whole seconds and values keep the sums
+  // exact.
+  const int kSamples[][2] = {
+    {10, 3}, {11, 5}, {13, 1}, {14, 7}, {15, 2}, {16, 6}, {19, 4}, {26, 6},
+    {30, 8}, {41, 2}, {44, 9}, {45, 5}, {50, 1}, {58, 3}, {60, 4}
+  };
+  Database::MetricVector metrics;
+  for (size_t i = 0; i < arraysize(kSamples); ++i) {
+    metrics.push_back(Metric(METRIC_CPU_USAGE,
+                             base::Time::FromDoubleT(kSamples[i][0]),
+                             kSamples[i][1]));
+  }
+  Database::MetricRollupVector rollups = BuildRollups(metrics, width);
+
+  for (int seconds = 2; seconds <= 8; seconds += 2) {
+    const base::TimeDelta resolution = base::TimeDelta::FromSeconds(seconds);
+    ASSERT_TRUE(RollupsAlignWithWindows(width, start, intervals, resolution));
+
+    scoped_ptr<VectorOfMetricVectors> expected =
+        AggregateMetric(METRIC_CPU_USAGE, &metrics, start, intervals,
+                        resolution, AGGREGATION_METHOD_MEAN);
+    scoped_ptr<VectorOfMetricVectors> actual =
+        AggregateMeanFromRollups(METRIC_CPU_USAGE, rollups, start, intervals,
+                                 resolution);
+    ASSERT_TRUE(expected.get());
+    ASSERT_TRUE(actual.get());
+    ASSERT_EQ(expected->size(), actual->size());
+    for (size_t i = 0; i < expected->size(); ++i) {
+      const Database::MetricVector& expected_series = (*expected)[i];
+      const Database::MetricVector& actual_series = (*actual)[i];
+      ASSERT_EQ(expected_series.size(), actual_series.size())
+          << "resolution " << seconds << ", interval " << i;
+      for (size_t j = 0; j < expected_series.size(); ++j) {
+        EXPECT_EQ(expected_series[j].time, actual_series[j].time);
+        EXPECT_DOUBLE_EQ(expected_series[j].value, actual_series[j].value)
+            << "resolution " << seconds << ", interval " << i
+            << ", point " << j;
+      }
+    }
+  }
+}
+
 }  // namespace performance_monitor
@@ -18,6 +18,7 @@
 #include "base/strings/string_util.h"
 #include "base/tracked_objects.h"
 #include "base/values.h"
+#include "chrome/browser/metrics/jank_sampler.h"
 #include "chrome/browser/metrics/tracking_synchronizer.h"
 #include "chrome/browser/profiles/profile.h"
 #include "chrome/browser/task_profiler/task_profiler_data_serializer.h"
@@ -28,6 +29,7 @@
 #include "content/public/browser/web_ui.h"
 #include "content/public/browser/web_ui_data_source.h"
 #include "content/public/browser/web_ui_message_handler.h"
+#include "content/public/common/process_type.h"
 #include "grit/browser_resources.h"
 #include "grit/generated_resources.h"
 
@@ -145,6 +147,7 @@ void ProfilerMessageHandler::OnGetData(const base::ListValue* list) {
 
 void ProfilerMessageHandler::OnResetData(const base::ListValue* list) {
   tracked_objects::ThreadData::ResetAllThreadData();
+  JankSampler::GetInstance()->Reset();
 }
 
 }  // namespace
@@ -169,17 +172,36 @@ ProfilerUI::~ProfilerUI() {
 void ProfilerUI::GetData() {
   TrackingSynchronizer::FetchProfilerDataAsynchronously(
       weak_ptr_factory_.GetWeakPtr());
+
+  // Slow tasks found by the jank sampler are listed under their own process
+  // type, so that they aren't added to the tasks of the browser process.
+  tracked_objects::ProcessDataSnapshot jank_data;
+  JankSampler::GetInstance()->GetSnapshot(&jank_data);
+  if (!jank_data.tasks.empty()) {
+    task_profiler::TaskProfilerDataSerializer::ToValueChunks(
+        jank_data,
+        content::PROCESS_TYPE_BROWSER,
+        base::Bind(&ProfilerUI::SendJankSamplerData, base::Unretained(this)));
+  }
 }
 
 void ProfilerUI::ReceivedProfilerData(
     const tracked_objects::ProcessDataSnapshot& profiler_data,
     int process_type) {
-  // Serialize the data to JSON.
-  base::DictionaryValue json_data;
-  task_profiler::TaskProfilerDataSerializer::ToValue(profiler_data,
-                                                     process_type,
-                                                     &json_data);
+  // Serialize the data to JSON and send it to the renderer, a chunk at a time
+  // so that the JSON of large processes isn't built all at once.
+  task_profiler::TaskProfilerDataSerializer::ToValueChunks(
+      profiler_data,
+      process_type,
+      base::Bind(&ProfilerUI::SendProfilerData, base::Unretained(this)));
+}
 
-  // Send the data to the renderer.
+void ProfilerUI::SendProfilerData(const base::DictionaryValue& json_data) {
   web_ui()->CallJavascriptFunction("g_browserBridge.receivedData", json_data);
 }
+
+void ProfilerUI::SendJankSamplerData(const base::DictionaryValue& json_data) {
+  scoped_ptr<base::DictionaryValue> jank_data(json_data.DeepCopy());
+  jank_data->SetString("process_type", JankSampler::kProcessTypeName);
+  SendProfilerData(*jank_data);
+}
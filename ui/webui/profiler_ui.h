@@ -9,6 +9,10 @@
 #include "chrome/browser/metrics/tracking_synchronizer_observer.h"
 #include "content/public/browser/web_ui_controller.h"
 
+namespace base {
+class DictionaryValue;
+}
+
 // The C++ back-end for the chrome://profiler webui page.
 class ProfilerUI : public content::WebUIController,
                    public chrome_browser_metrics::TrackingSynchronizerObserver {
@@ -25,6 +29,13 @@ class ProfilerUI : public content::WebUIController,
       const tracked_objects::ProcessDataSnapshot& profiler_data,
       int process_type) OVERRIDE;
 
+  // Sends a chunk of serialized profiler data to the page.
+  void SendProfilerData(const base::DictionaryValue& json_data);
+
+  // Sends a chunk of JankSampler data to the page, under the JankSampler's
+  // process type.
+  void SendJankSamplerData(const base::DictionaryValue& json_data);
+
   // Used to get |weak_ptr_| to self on the UI thread.
   base::WeakPtrFactory<ProfilerUI> weak_ptr_factory_;
 